@@ -0,0 +1,244 @@
+#include <FDP.h>
+#include <MockFDP.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+#    include <process.h>
+#    define getpid _getpid
+#else
+#    include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr auto ram_size     = uint64_t{16} << 20;
+    constexpr auto MSR_APICBASE = 0x1B;
+
+    bool write_file(const fs::path& path, const void* data, size_t size)
+    {
+        auto* fh = fopen(path.string().data(), "wb");
+        if(!fh)
+            return false;
+
+        const auto ok = fwrite(data, 1, size, fh) == size;
+        fclose(fh);
+        return ok;
+    }
+
+    // in-process mock server answering on its own thread,
+    // so benchmarks measure the transport & not a hypervisor
+    struct Server
+    {
+        Server()
+        {
+            const auto name = "bench_fdp_" + std::to_string(getpid());
+            const auto dir  = fs::temp_directory_path();
+            ram_path        = dir / (name + "_ram.bin");
+            cpu_path        = dir / (name + "_cpu.json");
+            const auto ram  = std::vector<uint8_t>(ram_size);
+            const auto cpu  = std::string{R"({"rax": 42, "msrs": {"0x1b": "0xfee00900"}})"};
+            if(!write_file(ram_path, &ram[0], ram.size()) || !write_file(cpu_path, cpu.data(), cpu.size()))
+                return;
+
+            mock = MockFDP_Create(name.data(), ram_path.string().data(), cpu_path.string().data());
+            if(!mock)
+                return;
+
+            // same opt-in blocking waits as icebox
+            const auto flags = getenv("FDP_FUTEX_WAIT") ? FDP_SHM_FLAG_FUTEX_WAIT : 0;
+            shm              = FDP_OpenSHMEx(name.data(), flags);
+            if(shm && !FDP_Init(shm))
+            {
+                FDP_ExitSHM(shm);
+                shm = nullptr;
+            }
+            // FDP_Init resets the canals, start serving after
+            thread = std::thread([=] { MockFDP_ServerLoop(mock); });
+        }
+
+        ~Server()
+        {
+            if(shm)
+                FDP_ExitSHM(shm);
+            if(mock)
+                MockFDP_Stop(mock);
+            if(thread.joinable())
+                thread.join();
+            if(mock)
+                MockFDP_Destroy(mock);
+            auto ec = std::error_code{};
+            fs::remove(ram_path, ec);
+            fs::remove(cpu_path, ec);
+        }
+
+        fs::path    ram_path;
+        fs::path    cpu_path;
+        MOCK_FDP*   mock = nullptr;
+        std::thread thread;
+        FDP_SHM*    shm = nullptr;
+    };
+
+    FDP_SHM* get_shm()
+    {
+        static Server server;
+        return server.shm;
+    }
+}
+
+static void get_state(benchmark::State& state)
+{
+    auto* shm = get_shm();
+    if(!shm)
+        return state.SkipWithError("unable to start server");
+
+    auto arg = FDP_State{};
+    for(auto _ : state)
+    {
+        (void) _;
+        const auto ok = FDP_GetState(shm, &arg);
+        if(!ok)
+            return state.SkipWithError("unable to get state");
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()));
+}
+// more threads measure the shm lock under contention
+BENCHMARK(get_state)->Threads(1)->Threads(2)->Threads(4)->UseRealTime();
+
+// served from the published cpu context, without a round trip
+static void read_register(benchmark::State& state)
+{
+    auto* shm = get_shm();
+    if(!shm)
+        return state.SkipWithError("unable to start server");
+
+    for(auto _ : state)
+    {
+        (void) _;
+        auto       reg = uint64_t{};
+        const auto ok  = FDP_ReadRegister(shm, 0, FDP_RAX_REGISTER, &reg);
+        if(!ok)
+            return state.SkipWithError("unable to read rax");
+
+        benchmark::DoNotOptimize(reg);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()));
+}
+BENCHMARK(read_register);
+
+// not in the cpu context, always a round trip
+static void read_msr(benchmark::State& state)
+{
+    auto* shm = get_shm();
+    if(!shm)
+        return state.SkipWithError("unable to start server");
+
+    for(auto _ : state)
+    {
+        (void) _;
+        auto       msr = uint64_t{};
+        const auto ok  = FDP_ReadMsr(shm, 0, MSR_APICBASE, &msr);
+        if(!ok)
+            return state.SkipWithError("unable to read apic base");
+
+        benchmark::DoNotOptimize(msr);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()));
+}
+BENCHMARK(read_msr);
+
+static void write_register(benchmark::State& state)
+{
+    auto* shm = get_shm();
+    if(!shm)
+        return state.SkipWithError("unable to start server");
+
+    for(auto _ : state)
+    {
+        (void) _;
+        const auto ok = FDP_WriteRegister(shm, 0, FDP_RAX_REGISTER, 42);
+        if(!ok)
+            return state.SkipWithError("unable to write rax");
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()));
+}
+BENCHMARK(write_register);
+
+static void read_physical_memory(benchmark::State& state)
+{
+    auto* shm = get_shm();
+    if(!shm)
+        return state.SkipWithError("unable to start server");
+
+    auto bytes = std::vector<uint8_t>(state.range(0));
+    for(auto _ : state)
+    {
+        (void) _;
+        const auto ok = FDP_ReadPhysicalMemory(shm, &bytes[0], uint32_t(bytes.size()), 0);
+        if(!ok)
+            return state.SkipWithError("unable to read memory");
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(state.range(0)));
+}
+BENCHMARK(read_physical_memory)->Arg(8)->Arg(4096)->Arg(1 << 16)->Arg(10 << 20);
+
+// FDP_ReadMsr round trips under the shm spinlock, threads contend on it
+// args are FDP_SetSpinBackoff bounds
+static void spinlock_backoff(benchmark::State& state)
+{
+    auto* shm = get_shm();
+    if(!shm)
+        return state.SkipWithError("unable to start server");
+
+    if(state.thread_index == 0)
+        FDP_SetSpinBackoff(uint32_t(state.range(0)), uint32_t(state.range(1)));
+
+    for(auto _ : state)
+    {
+        (void) _;
+        auto       msr = uint64_t{};
+        const auto ok  = FDP_ReadMsr(shm, 0, MSR_APICBASE, &msr);
+        if(!ok)
+        {
+            // still restore the default bounds below
+            state.SkipWithError("unable to read apic base");
+            break;
+        }
+
+        benchmark::DoNotOptimize(msr);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()));
+
+    if(state.thread_index == 0)
+        FDP_SetSpinBackoff(0x20, 1024);
+}
+BENCHMARK(spinlock_backoff)
+    ->Args({1, 1})
+    ->Args({1, 64})
+    ->Args({0x20, 1024})
+    ->Args({0x100, 0x4000})
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+// json on stdout unless overridden, so results can be compared between builds
+int main(int argc, char** argv)
+{
+    auto args = std::vector<char*>{argv[0], const_cast<char*>("--benchmark_format=json")};
+    args.insert(args.end(), argv + 1, argv + argc);
+    auto num = int(args.size());
+    benchmark::Initialize(&num, &args[0]);
+    if(benchmark::ReportUnrecognizedArguments(num, &args[0]))
+        return 1;
+
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
@@ -38,13 +38,22 @@
 #    include <sys/shm.h>
 #    include <sys/stat.h>
 #    include <unistd.h>
+#    ifdef __linux__
+#        include <linux/futex.h>
+#        include <sys/syscall.h>
+#    endif
 #    define FORCE_INLINE inline __attribute__((__always_inline__))
 #    define PAUSE        asm("pause")
 #endif
 
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdio>
 #include <cstring>
 #include <random>
 #include <thread>
+#include <vector>
 
 namespace
 {
@@ -55,32 +64,36 @@ namespace
         static constexpr bool ok = true;
     };
 #define STATIC_ASSERT_EQ(A, B) static_assert(!!expect_eq<A, B>::ok, "");
-    STATIC_ASSERT_EQ(sizeof(FDP_SHM_CANAL), FDP_MAX_DATA_SIZE + 8);
-    STATIC_ASSERT_EQ(sizeof(FDP_SHM_SHARED), 2 * sizeof(FDP_SHM_CANAL) + 4);
+    STATIC_ASSERT_EQ(sizeof(FDP_SHM_CANAL), 40);
+    STATIC_ASSERT_EQ(sizeof(FDP_SHM_RING_SLOT), FDP_RING_SLOT_DATA_SIZE + 12);
+    STATIC_ASSERT_EQ(sizeof(FDP_SHM_RING), FDP_RING_SLOT_COUNT * sizeof(FDP_SHM_RING_SLOT) + 24);
+    STATIC_ASSERT_EQ(sizeof(FDP_SHM_SHARED), 2 * sizeof(FDP_SHM_CANAL) + sizeof(FDP_SHM_RING) + 24);
+    static_assert(sizeof(FDP_RAM_SHM) <= FDP_RAM_SHM_DATA_OFFSET, "");
 
-    constexpr size_t max_wait_iters    = 0x100000;
-    constexpr size_t min_backoff_iters = 0x20;
+    constexpr size_t max_wait_iters = 0x100000;
 
     FORCE_INLINE void yield_sleep()
     {
         std::this_thread::sleep_for(std::chrono::microseconds(500));
     }
 
-    constexpr size_t max_backoff_iters = 1024;
+    // see FDP_SetSpinBackoff
+    std::atomic<size_t> min_backoff_iters{0x20};
+    std::atomic<size_t> max_backoff_iters{1024};
 
     FORCE_INLINE void backoff(size_t& delay)
     {
         thread_local auto dist       = std::uniform_int_distribution<size_t>{};
         thread_local auto gen        = std::minstd_rand(std::random_device{}());
         const auto        spin_iters = dist(gen, decltype(dist)::param_type{0, delay});
-        delay                        = std::min(delay * 2, max_backoff_iters);
+        delay                        = std::min(delay * 2, max_backoff_iters.load(std::memory_order_relaxed));
         for(size_t i = 0; i < spin_iters; ++i)
             PAUSE;
     }
 
     FORCE_INLINE void ttas_spinlock_lock(std::atomic_bool* flag)
     {
-        size_t current_max_delay = min_backoff_iters;
+        size_t current_max_delay = min_backoff_iters.load(std::memory_order_relaxed);
         // exponential back-off spinlock
         while(true)
         {
@@ -108,41 +121,86 @@ namespace
     }
 }
 
-static bool WriteFDPDataWithStatus(FDP_SHM_CANAL* pFDPCanal, uint8_t* pData, uint32_t DataSize, bool bStatus)
+namespace
 {
-    bool dataWritten = false;
-    if(DataSize > FDP_MAX_DATA_SIZE)
+    constexpr size_t min_futex_spin_iters = 0x40;
+    constexpr size_t max_futex_spin_iters = 0x4000;
+
+    // time this thread spent asleep in wait_until, see FDP_COMMAND_STATISTICS_T
+    thread_local uint64_t wait_sleep_ns = 0;
+
+    FORCE_INLINE void add_sleep_time(std::chrono::steady_clock::time_point start)
     {
-        return false;
+        const auto slept = std::chrono::steady_clock::now() - start;
+        wait_sleep_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(slept).count();
     }
 
-    do
+#ifdef __linux__
+    // not FUTEX_PRIVATE_FLAG: canals are shared between processes
+    FORCE_INLINE void futex_wait(std::atomic<uint32_t>* word, uint32_t expected)
+    {
+        syscall(SYS_futex, word, FUTEX_WAIT, expected, nullptr, nullptr, 0);
+    }
+
+    FORCE_INLINE void futex_wake(std::atomic<uint32_t>* word)
     {
-        ttas_spinlock_lock(&pFDPCanal->lock);
-        if(!pFDPCanal->bDataPresent)
+        syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+
+    FORCE_INLINE void futex_wait_for(std::atomic<uint32_t>* word, uint32_t expected, std::chrono::nanoseconds timeout)
+    {
+        const auto secs = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+        auto       ts   = timespec{};
+        ts.tv_sec       = secs.count();
+        ts.tv_nsec      = (timeout - secs).count();
+        syscall(SYS_futex, word, FUTEX_WAIT, expected, &ts, nullptr, 0);
+    }
+
+    // spin then sleep on word until predicate is true
+    // word must change or be woken whenever predicate may change
+    template <typename T>
+    void futex_wait_until(FDP_SHM_CANAL* canal, std::atomic<uint32_t>* word, const T& predicate)
+    {
+        // adaptive spin: grow while the peer answers in time, shrink when we end up sleeping
+        thread_local size_t spin_iters = min_futex_spin_iters * 16;
+        for(size_t i = 0; i < spin_iters; ++i)
         {
-            memcpy((char*) pFDPCanal->data, pData, DataSize);
-            pFDPCanal->bDataPresent = true;
-            pFDPCanal->dataSize     = DataSize;
-            pFDPCanal->bStatus      = bStatus;
-            dataWritten             = true;
+            if(predicate())
+            {
+                spin_iters = std::min(spin_iters * 2, max_futex_spin_iters);
+                return;
+            }
+            PAUSE;
         }
-        ttas_spinlock_unlock(&pFDPCanal->lock);
-    } while(!dataWritten);
-    return true;
-}
 
-static bool WriteFDPData(FDP_SHM_CANAL* pFDPCanal, uint8_t* pData, uint32_t DataSize)
-{
-    return WriteFDPDataWithStatus(pFDPCanal, pData, DataSize, true);
-}
+        spin_iters = std::max(spin_iters / 2, min_futex_spin_iters);
+        canal->waiters.fetch_add(1);
+        const auto start = std::chrono::steady_clock::now();
+        while(true)
+        {
+            const auto current = word->load();
+            if(predicate())
+                break;
 
-namespace
-{
-    FORCE_INLINE void wait_until_bool_is(std::atomic_bool* lock, bool value)
+            futex_wait(word, current);
+        }
+        add_sleep_time(start);
+        canal->waiters.fetch_sub(1);
+    }
+#endif
+
+    template <typename T>
+    FORCE_INLINE void wait_until(FDP_SHM_CANAL* canal, std::atomic<uint32_t>* word, const T& predicate)
     {
+#ifdef __linux__
+        if(canal->bFutexWait)
+            return futex_wait_until(canal, word, predicate);
+#else
+        (void) word;
+#endif
+
         size_t num_iters = 0;
-        while(lock->load(std::memory_order_relaxed) != value)
+        while(!predicate())
         {
             if(num_iters < max_wait_iters)
             {
@@ -151,50 +209,215 @@ namespace
             }
             else
             {
+                const auto start = std::chrono::steady_clock::now();
                 yield_sleep();
+                add_sleep_time(start);
             }
         }
     }
+
+    FORCE_INLINE bool canal_has_data(FDP_SHM_CANAL* canal)
+    {
+        return canal->writeSeq.load(std::memory_order_acquire) != canal->readSeq.load(std::memory_order_acquire);
+    }
+
+    // wait until seq, owned by the peer, reaches value
+    FORCE_INLINE void wait_until_seq_is(FDP_SHM_CANAL* canal, std::atomic<uint32_t>* seq, uint32_t value)
+    {
+        wait_until(canal, seq, [=]
+        {
+            return seq->load(std::memory_order_acquire) == value;
+        });
+    }
+
+    FORCE_INLINE void notify_seq(FDP_SHM_CANAL* canal, std::atomic<uint32_t>* seq)
+    {
+#ifdef __linux__
+        if(canal->waiters.load())
+            futex_wake(seq);
+#else
+        (void) canal;
+        (void) seq;
+#endif
+    }
+
+    FORCE_INLINE void ring_doorbell(FDP_SHM_CANAL* canal)
+    {
+        canal->doorbell++;
+#ifdef __linux__
+        if(canal->waiters.load())
+            futex_wake(&canal->doorbell);
+#endif
+    }
 }
 
-static uint32_t ReadFDPDataWithStatus(FDP_SHM_CANAL* pFDPCanal, uint8_t* buffer, bool* pbStatus)
+FORCE_INLINE static uint8_t* GetCanalData(FDP_SHM_SHARED* pShared, FDP_SHM_CANAL* pFDPCanal)
 {
-    uint32_t dataReadSize = 0;
-    do
+    return (uint8_t*) pShared + pFDPCanal->dataOffset;
+}
+
+// each canal has one producer & one consumer, the client ones being serialized by LockSHM
+// sequences are only stored by their owner, seq_cst so waiters are never missed
+static bool WriteFDPDataWithStatus(FDP_SHM_SHARED* pShared, FDP_SHM_CANAL* pFDPCanal, uint8_t* pData, uint32_t DataSize, bool bStatus)
+{
+    if(DataSize > pFDPCanal->capacity)
     {
-        wait_until_bool_is(&pFDPCanal->bDataPresent, true);
-        ttas_spinlock_lock(&pFDPCanal->lock);
-        if(pFDPCanal->bDataPresent)
-        {
-            if(pFDPCanal->dataSize < FDP_MAX_DATA_SIZE)
-                memcpy(buffer, (char*) pFDPCanal->data, pFDPCanal->dataSize);
-            dataReadSize            = pFDPCanal->dataSize;
-            *pbStatus               = pFDPCanal->bStatus;
-            pFDPCanal->bDataPresent = false;
-        }
-        ttas_spinlock_unlock(&pFDPCanal->lock);
-    } while(!dataReadSize);
+        return false;
+    }
+
+    const uint32_t WriteSeq = pFDPCanal->writeSeq.load(std::memory_order_relaxed);
+    wait_until_seq_is(pFDPCanal, &pFDPCanal->readSeq, WriteSeq);
+    memcpy(GetCanalData(pShared, pFDPCanal), pData, DataSize);
+    pFDPCanal->dataSize = DataSize;
+    pFDPCanal->bStatus  = bStatus;
+    pFDPCanal->writeSeq = WriteSeq + 1;
+    notify_seq(pFDPCanal, &pFDPCanal->writeSeq);
+    ring_doorbell(pFDPCanal);
+    return true;
+}
+
+static bool WriteFDPData(FDP_SHM_SHARED* pShared, FDP_SHM_CANAL* pFDPCanal, uint8_t* pData, uint32_t DataSize)
+{
+    return WriteFDPDataWithStatus(pShared, pFDPCanal, pData, DataSize, true);
+}
+
+static uint32_t ReadFDPDataWithStatus(FDP_SHM_SHARED* pShared, FDP_SHM_CANAL* pFDPCanal, uint8_t* buffer, bool* pbStatus)
+{
+    const uint32_t ReadSeq = pFDPCanal->readSeq.load(std::memory_order_relaxed);
+    wait_until_seq_is(pFDPCanal, &pFDPCanal->writeSeq, ReadSeq + 1);
+    const uint32_t dataReadSize = pFDPCanal->dataSize;
+    if(dataReadSize <= pFDPCanal->capacity)
+    {
+        memcpy(buffer, GetCanalData(pShared, pFDPCanal), dataReadSize);
+    }
+    *pbStatus          = pFDPCanal->bStatus;
+    pFDPCanal->readSeq = ReadSeq + 1;
+    notify_seq(pFDPCanal, &pFDPCanal->readSeq);
     return dataReadSize;
 }
 
-FORCE_INLINE static uint32_t ReadFDPData(FDP_SHM_CANAL* pFDPCanal, uint8_t* buffer)
+FORCE_INLINE static uint32_t ReadFDPData(FDP_SHM_SHARED* pShared, FDP_SHM_CANAL* pFDPCanal, uint8_t* buffer)
 {
     bool bIsSuccess;
-    return ReadFDPDataWithStatus(pFDPCanal, buffer, &bIsSuccess);
+    return ReadFDPDataWithStatus(pShared, pFDPCanal, buffer, &bIsSuccess);
+}
+
+static void SetSHMFlags(FDP_SHM_SHARED* pShared, uint32_t Flags)
+{
+#ifndef __linux__
+    Flags &= ~(FDP_SHM_FLAG_FUTEX_WAIT | FDP_SHM_FLAG_HUGEPAGES);
+#endif
+    pShared->flags                     = Flags;
+    pShared->ClientToServer.bFutexWait = !!(Flags & FDP_SHM_FLAG_FUTEX_WAIT);
+    pShared->ServerToClient.bFutexWait = !!(Flags & FDP_SHM_FLAG_FUTEX_WAIT);
 }
 
 FDP_EXPORTED
 FDP_SHM* FDP_CreateSHM(const char* shmName)
+{
+    return FDP_CreateSHMEx(shmName, 0);
+}
+
+namespace
+{
+    constexpr uint64_t canal_alignment = 0x1000;
+    constexpr uint64_t huge_page_size  = 0x200000;
+
+    uint64_t AlignUp(uint64_t Value, uint64_t Alignment)
+    {
+        return (Value + Alignment - 1) & ~(Alignment - 1);
+    }
+
+    // header, client to server data, then server to client data
+    uint64_t GetSHMSize(uint32_t CanalSize, uint32_t Flags)
+    {
+        const uint64_t Size = AlignUp(FDP_SHM_SHARED_SIZE, canal_alignment) + 2 * AlignUp(CanalSize, canal_alignment);
+        return Flags & FDP_SHM_FLAG_HUGEPAGES ? AlignUp(Size, huge_page_size) : Size;
+    }
+
+    void SetupCanals(FDP_SHM_SHARED* pShared, uint32_t CanalSize)
+    {
+        const uint64_t DataOffset          = AlignUp(FDP_SHM_SHARED_SIZE, canal_alignment);
+        pShared->ClientToServer.dataOffset = DataOffset;
+        pShared->ClientToServer.capacity   = CanalSize;
+        pShared->ServerToClient.dataOffset = DataOffset + AlignUp(CanalSize, canal_alignment);
+        pShared->ServerToClient.capacity   = CanalSize;
+    }
+
+    bool IsValidCanal(const FDP_SHM_CANAL* pCanal, uint64_t Size)
+    {
+        return pCanal->capacity >= FDP_MIN_CANAL_SIZE
+               && pCanal->capacity <= FDP_MAX_CANAL_SIZE
+               && pCanal->dataOffset >= FDP_SHM_SHARED_SIZE
+               && pCanal->dataOffset + pCanal->capacity <= Size;
+    }
+
+    // only a hint, pages stay small unless shmem transparent huge pages are enabled
+    void AdviseHugePages(void* pBuf, uint64_t Size, uint32_t Flags)
+    {
+#ifdef __linux__
+        if(Flags & FDP_SHM_FLAG_HUGEPAGES)
+        {
+            madvise(pBuf, Size, MADV_HUGEPAGE);
+        }
+#else
+        (void) pBuf;
+        (void) Size;
+        (void) Flags;
+#endif
+    }
+
+    FDP_SHM* NewSHM(FDP_SHM_SHARED* pShared, uint32_t CanalSize)
+    {
+        FDP_SHM* pFDPSHM = (FDP_SHM*) malloc(sizeof *pFDPSHM);
+        if(pFDPSHM == NULL)
+        {
+            return NULL;
+        }
+        pFDPSHM->InputBuffer  = (uint8_t*) malloc(CanalSize);
+        pFDPSHM->OutputBuffer = (uint8_t*) malloc(CanalSize);
+        if(pFDPSHM->InputBuffer == NULL || pFDPSHM->OutputBuffer == NULL)
+        {
+            free(pFDPSHM->InputBuffer);
+            free(pFDPSHM->OutputBuffer);
+            free(pFDPSHM);
+            return NULL;
+        }
+        pFDPSHM->pSharedFDPSHM = pShared;
+        pFDPSHM->CanalSize     = CanalSize;
+        pFDPSHM->pCpuShm       = NULL;
+        pFDPSHM->pRamShm       = NULL;
+        pFDPSHM->pSlots        = NULL;
+        pFDPSHM->pRecorder     = NULL;
+        pFDPSHM->pReplay       = NULL;
+        pFDPSHM->pStats        = NULL;
+        pFDPSHM->RingNextTag   = 0;
+        memset(pFDPSHM->aRingRequests, 0, sizeof pFDPSHM->aRingRequests);
+        return pFDPSHM;
+    }
+}
+
+FDP_EXPORTED
+FDP_SHM* FDP_CreateSHMEx(const char* shmName, uint32_t Flags)
+{
+    return FDP_CreateSHMSized(shmName, Flags, FDP_DEFAULT_CANAL_SIZE);
+}
+
+FDP_EXPORTED
+FDP_SHM* FDP_CreateSHMSized(const char* shmName, uint32_t Flags, uint32_t CanalSize)
 {
     void* pBuf;
 
+    CanalSize           = std::min<uint32_t>(std::max<uint32_t>(CanalSize, FDP_MIN_CANAL_SIZE), FDP_MAX_CANAL_SIZE);
+    const uint64_t Size = GetSHMSize(CanalSize, Flags);
+
 #ifdef _MSC_VER
     HANDLE hMapFile;
     hMapFile = CreateFileMappingA(INVALID_HANDLE_VALUE,
                                   NULL,
                                   PAGE_READWRITE,
-                                  0,
-                                  FDP_SHM_SHARED_SIZE,
+                                  (DWORD)(Size >> 32),
+                                  (DWORD) Size,
                                   shmName);
     if(hMapFile == NULL)
     {
@@ -204,7 +427,7 @@ FDP_SHM* FDP_CreateSHM(const char* shmName)
                          FILE_MAP_ALL_ACCESS,
                          0,
                          0,
-                         FDP_SHM_SHARED_SIZE);
+                         (SIZE_T) Size);
     if(pBuf == NULL)
     {
         CloseHandle(hMapFile);
@@ -220,28 +443,46 @@ FDP_SHM* FDP_CreateSHM(const char* shmName)
     }
 
     /* configure the size of the shared memory segment */
-    auto err = ftruncate(fdSHM, FDP_SHM_SHARED_SIZE);
+    auto err = ftruncate(fdSHM, Size);
     if(err == -1)
     {
+        close(fdSHM);
         shm_unlink(shmName);
         return NULL;
     }
 
     /* now map the shared memory segment in the address space of the process */
-    pBuf = mmap(0, FDP_SHM_SHARED_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fdSHM, 0);
+    pBuf = mmap(0, Size, PROT_READ | PROT_WRITE, MAP_SHARED, fdSHM, 0);
     close(fdSHM);
-    if(pBuf == NULL)
+    if(pBuf == MAP_FAILED)
     {
         shm_unlink(shmName);
         return NULL;
     }
 #endif
 
-    // Clear SHM
+    // before the first touch, so huge pages can back the segment
+    AdviseHugePages(pBuf, Size, Flags);
+
+    // Clear SHM header, canal data is only read once written
+    FDP_SHM_SHARED* pShared = (FDP_SHM_SHARED*) pBuf;
     memset(pBuf, 0, FDP_SHM_SHARED_SIZE);
-    FDP_SHM* pFDPSHM = (FDP_SHM*) malloc(sizeof *pFDPSHM);
-    // TODO: check !
-    pFDPSHM->pSharedFDPSHM = (FDP_SHM_SHARED*) pBuf;
+    pShared->abiVersion = FDP_ABI_VERSION;
+    pShared->size       = Size;
+    SetupCanals(pShared, CanalSize);
+    SetSHMFlags(pShared, Flags);
+    FDP_SHM* pFDPSHM = NewSHM(pShared, CanalSize);
+    if(pFDPSHM == NULL)
+    {
+#ifdef _MSC_VER
+        UnmapViewOfFile(pBuf);
+        CloseHandle(hMapFile);
+#else
+        munmap(pBuf, Size);
+        shm_unlink(shmName);
+#endif
+        return NULL;
+    }
     return pFDPSHM;
 }
 
@@ -292,679 +533,886 @@ void* OpenShm(const char* pShmName, size_t szShmSize)
     return pBuf;
 }
 
-FDP_EXPORTED FDP_SHM* FDP_OpenSHM(const char* pShmName)
+static void CloseShm(void* pBuf, size_t szShmSize)
+{
+#ifdef _MSC_VER
+    (void) szShmSize;
+    UnmapViewOfFile(pBuf);
+#else
+    munmap(pBuf, szShmSize);
+#endif
+}
+
+static void* CreateShm(const char* pShmName, size_t szShmSize)
 {
-    void* pSharedFDPSHM = OpenShm(pShmName, FDP_SHM_SHARED_SIZE);
-    if(pSharedFDPSHM == NULL)
+    void* pBuf;
+
+#ifdef _MSC_VER
+    HANDLE hMapFile;
+    hMapFile = CreateFileMappingA(INVALID_HANDLE_VALUE,
+                                  NULL,
+                                  PAGE_READWRITE,
+                                  (DWORD)((uint64_t) szShmSize >> 32),
+                                  (DWORD) szShmSize,
+                                  pShmName);
+    if(hMapFile == NULL)
     {
         return NULL;
     }
-    // TODO : !
-    char aCpuShmName[512];
-    strncpy(aCpuShmName, "CPU_", sizeof aCpuShmName - 1);
-    strncat(aCpuShmName, pShmName, sizeof aCpuShmName - strlen(aCpuShmName) - 1);
-
-    void* pCpuShm = OpenShm(aCpuShmName, sizeof(FDP_CPU_CTX));
-    if(pCpuShm == NULL)
+    pBuf = MapViewOfFile(hMapFile,
+                         FILE_MAP_ALL_ACCESS,
+                         0,
+                         0,
+                         szShmSize);
+    if(pBuf == NULL)
     {
+        CloseHandle(hMapFile);
         return NULL;
     }
-    FDP_SHM* pFDPSHM = (FDP_SHM*) malloc(sizeof *pFDPSHM);
-    if(pFDPSHM == NULL)
+#else
+    auto fdSHM = shm_open(pShmName, O_CREAT | O_RDWR, 0666);
+    if(fdSHM == -1)
     {
-        // TODO : CloseShm
         return NULL;
     }
-    pFDPSHM->pSharedFDPSHM = (FDP_SHM_SHARED*) pSharedFDPSHM;
-    pFDPSHM->pCpuShm       = (FDP_CPU_CTX*) pCpuShm;
-    return pFDPSHM;
+    auto err = ftruncate(fdSHM, szShmSize);
+    if(err == -1)
+    {
+        close(fdSHM);
+        shm_unlink(pShmName);
+        return NULL;
+    }
+    pBuf = mmap(0, szShmSize, PROT_READ | PROT_WRITE, MAP_SHARED, fdSHM, 0);
+    close(fdSHM);
+    if(pBuf == MAP_FAILED)
+    {
+        shm_unlink(pShmName);
+        return NULL;
+    }
+#endif
+
+    return pBuf;
 }
 
-FDP_EXPORTED void FDP_ExitSHM(FDP_SHM* pShm)
+static void GetRamShmName(char* pDst, size_t szDst, const char* pShmName)
 {
-    free(pShm);
+    strncpy(pDst, "RAM_", szDst - 1);
+    pDst[szDst - 1] = 0;
+    strncat(pDst, pShmName, szDst - strlen(pDst) - 1);
 }
 
-static void RunCmd(FDP_SHM* pFDP, void* pDst, const void* pSrc, size_t szSize)
+// the segment is optional & sized by the server
+static FDP_RAM_SHM* OpenRamShm(const char* pShmName)
 {
-    LockSHM(pFDP->pSharedFDPSHM);
+    char aRamShmName[512];
+    GetRamShmName(aRamShmName, sizeof aRamShmName, pShmName);
+    FDP_RAM_SHM* pHeader = (FDP_RAM_SHM*) OpenShm(aRamShmName, sizeof *pHeader);
+    if(pHeader == NULL)
     {
-        WriteFDPData(&pFDP->pSharedFDPSHM->ClientToServer, (uint8_t*) pSrc, (uint32_t) szSize);
-        ReadFDPData(&pFDP->pSharedFDPSHM->ServerToClient, (uint8_t*) pDst); // TODO: return success/fail !
+        return NULL;
     }
-    UnlockSHM(pFDP->pSharedFDPSHM);
+    const uint64_t Size = pHeader->size;
+    CloseShm(pHeader, sizeof *pHeader);
+    if(Size < FDP_RAM_SHM_DATA_OFFSET)
+    {
+        return NULL;
+    }
+    return (FDP_RAM_SHM*) OpenShm(aRamShmName, (size_t) Size);
 }
 
-static bool CheckRunCmd(FDP_SHM* pFDP, const void* pSrc, size_t szSize)
+FDP_EXPORTED FDP_SHM* FDP_OpenSHM(const char* pShmName)
 {
-    bool bReturnValue = false;
-    RunCmd(pFDP, &bReturnValue, pSrc, szSize);
-    return bReturnValue;
+    return FDP_OpenSHMEx(pShmName, 0);
 }
 
-static bool RunCmdBuffer(FDP_SHM* pFDP, void* pDst, const void* pSrc, size_t szSize)
+// Flags are added to the ones selected by the server
+FDP_EXPORTED FDP_SHM* FDP_OpenSHMEx(const char* pShmName, uint32_t Flags)
 {
-    bool bReturnValue = false;
-    LockSHM(pFDP->pSharedFDPSHM);
+    FDP_SHM_SHARED* pHeader = (FDP_SHM_SHARED*) OpenShm(pShmName, FDP_SHM_SHARED_SIZE);
+    if(pHeader == NULL)
     {
-        WriteFDPData(&pFDP->pSharedFDPSHM->ClientToServer, (uint8_t*) pSrc, (uint32_t) szSize);
-        ReadFDPDataWithStatus(&pFDP->pSharedFDPSHM->ServerToClient, (uint8_t*) pDst, &bReturnValue);
+        return NULL;
     }
-    UnlockSHM(pFDP->pSharedFDPSHM);
-    return bReturnValue;
-}
+    const bool     bSameAbi = pHeader->abiVersion == FDP_ABI_VERSION;
+    const uint64_t Size     = pHeader->size;
+    CloseShm(pHeader, FDP_SHM_SHARED_SIZE);
+    if(!bSameAbi)
+    {
+        // server built with another layout
+        return NULL;
+    }
+    FDP_SHM_SHARED* pShared = (FDP_SHM_SHARED*) OpenShm(pShmName, (size_t) Size);
+    if(pShared == NULL)
+    {
+        return NULL;
+    }
+    const uint32_t CanalSize = pShared->ClientToServer.capacity;
+    if(!IsValidCanal(&pShared->ClientToServer, Size)
+       || !IsValidCanal(&pShared->ServerToClient, Size)
+       || pShared->ServerToClient.capacity != CanalSize)
+    {
+        CloseShm(pShared, (size_t) Size);
+        return NULL;
+    }
+    AdviseHugePages(pShared, Size, pShared->flags | Flags);
+    char aCpuShmName[512];
+    strncpy(aCpuShmName, "CPU_", sizeof aCpuShmName - 1);
+    aCpuShmName[sizeof aCpuShmName - 1] = 0;
+    strncat(aCpuShmName, pShmName, sizeof aCpuShmName - strlen(aCpuShmName) - 1);
 
-FDP_EXPORTED
-bool FDP_Pause(FDP_SHM* pFDP)
-{
-    if(pFDP == NULL)
+    // segments are owned by the server, only unmap them
+    void* pCpuShm = OpenShm(aCpuShmName, FDP_CPU_SHM_SIZE);
+    if(pCpuShm == NULL)
     {
-        return false;
+        CloseShm(pShared, (size_t) Size);
+        return NULL;
     }
-    FDP_SIMPLE_PKT_REQ TempPkt;
-    TempPkt.Type = FDPCMD_PAUSE_VM;
-    return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
+    FDP_SHM* pFDPSHM = NewSHM(pShared, CanalSize);
+    if(pFDPSHM == NULL)
+    {
+        CloseShm(pCpuShm, FDP_CPU_SHM_SIZE);
+        CloseShm(pShared, (size_t) Size);
+        return NULL;
+    }
+    pFDPSHM->pCpuShm = (FDP_CPU_CTX*) pCpuShm;
+    pFDPSHM->pRamShm = OpenRamShm(pShmName);
+    if(Flags)
+    {
+        SetSHMFlags(pFDPSHM->pSharedFDPSHM, pFDPSHM->pSharedFDPSHM->flags | Flags);
+    }
+    return pFDPSHM;
 }
 
-FDP_EXPORTED
-bool FDP_Resume(FDP_SHM* pFDP)
+FDP_EXPORTED uint32_t FDP_GetSHMFlags(FDP_SHM* pShm)
 {
-    if(pFDP == NULL)
+    if(pShm == NULL)
     {
-        return false;
+        return 0;
     }
-    FDP_SIMPLE_PKT_REQ TempPkt;
-    TempPkt.Type = FDPCMD_RESUME_VM;
-    return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
+    return pShm->pSharedFDPSHM->flags;
 }
 
-FDP_EXPORTED
-bool FDP_Reboot(FDP_SHM* pFDP)
+FDP_EXPORTED uint32_t FDP_GetCanalSize(FDP_SHM* pShm)
 {
-    if(pFDP == NULL)
+    if(pShm == NULL)
     {
-        return false;
+        return 0;
     }
-    FDP_SIMPLE_PKT_REQ TempPkt;
-    TempPkt.Type = FDPCMD_REBOOT;
-    return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
+    return pShm->CanalSize;
 }
 
-bool FDP_ReadPhysicalMemoryInternal(FDP_SHM* pFDP, uint8_t* pDstBuffer, uint32_t ReadSize, uint64_t PhysicalAddress)
+// session log written by FDP_StartRecording, in host byte order:
+// magic, then records starting with a record type
+//   command: u32 request size, request, u8 status, u32 answer size, answer
+//   state changed: nothing, the client saw FDP_GetStateChanged return true
+namespace
 {
-    FDP_READ_PHYSICAL_MEMORY_PKT_REQ tmpPkt;
-    tmpPkt.Type            = FDPCMD_READ_PHYSICAL;
-    tmpPkt.PhysicalAddress = PhysicalAddress;
-    tmpPkt.ReadSize        = ReadSize;
-    return RunCmdBuffer(pFDP, pDstBuffer, &tmpPkt, sizeof tmpPkt);
+    const char        record_magic[8]      = {'F', 'D', 'P', 'R', 'E', 'C', '0', '1'};
+    constexpr uint8_t record_command       = 0;
+    constexpr uint8_t record_state_changed = 1;
 }
 
-FDP_EXPORTED
-bool FDP_ReadPhysicalMemory(FDP_SHM* pFDP, uint8_t* pDstBuffer, uint32_t ReadSize, uint64_t PhysicalAddress)
+struct FDP_RECORDER_
 {
-    if(pFDP == NULL)
+    FILE*                pFile;
+    std::vector<uint8_t> Request; // last command sent, logged with its answer
+};
+
+static void DeleteRecorder(FDP_RECORDER_* pRecorder)
+{
+    if(pRecorder == NULL)
     {
-        return false;
+        return;
     }
-    uint32_t CurrentOffset = 0;
-    do
-    {
-        uint32_t CurrentReadSize = std::min<uint32_t>(ReadSize, FDP_MAX_DATA_SIZE - 1);
-        if(FDP_ReadPhysicalMemoryInternal(pFDP, pDstBuffer + CurrentOffset, CurrentReadSize,
-                                          PhysicalAddress + CurrentOffset)
-           == false)
-        {
-            return false;
-        }
-        CurrentOffset += CurrentReadSize;
-    } while(CurrentOffset < ReadSize);
-    return true;
+    fclose(pRecorder->pFile);
+    delete pRecorder;
 }
 
-bool FDP_ReadVirtualMemoryInternal(FDP_SHM* pFDP, uint32_t CpuId, uint8_t* pDstBuffer, uint32_t ReadSize,
-                                   uint64_t VirtualAddress)
+struct FDP_STATS_
 {
-    FDP_READ_VIRTUAL_MEMORY_PKT_REQ tmpPkt;
-    tmpPkt.Type           = FDPCMD_READ_VIRTUAL;
-    tmpPkt.CpuId          = CpuId;
-    tmpPkt.VirtualAddress = VirtualAddress;
-    tmpPkt.ReadSize       = ReadSize;
-    return RunCmdBuffer(pFDP, pDstBuffer, &tmpPkt, sizeof tmpPkt);
+    std::atomic<bool>     bEnabled;
+    FDP_STATISTICS_T      Statistics; // commands are counted with the SHM locked
+    std::atomic<uint64_t> CpuCtxReads;
+    std::atomic<uint64_t> RamShmReads;
+
+    // command in flight
+    bool                                  bPending;
+    uint8_t                               Type;
+    uint32_t                              BytesSent;
+    uint64_t                              SleepStartNs; // wait_sleep_ns when sent
+    std::chrono::steady_clock::time_point Start;
+};
+
+static_assert(FDPCMD_COUNT <= FDP_MAX_COMMANDS, "FDP_MAX_COMMANDS is too small");
+
+static void DeleteStats(FDP_STATS_* pStats)
+{
+    delete pStats;
 }
 
-FDP_EXPORTED
-bool FDP_ReadVirtualMemory(FDP_SHM* pFDP, uint32_t CpuId, uint8_t* pDstBuffer, uint32_t ReadSize,
-                           uint64_t VirtualAddress)
+namespace
 {
-    if(pFDP == NULL || ReadSize <= 0)
+    // see FDP_LATENCY_BUCKETS
+    uint32_t GetLatencyBucket(uint64_t Ns)
     {
-        return false;
+        if(Ns < 4)
+        {
+            return (uint32_t) Ns;
+        }
+        uint32_t Exponent = 2;
+        while(Exponent < 63 && Ns >> (Exponent + 1))
+        {
+            ++Exponent;
+        }
+        const uint32_t Bucket = (Exponent - 1) * 4 + (uint32_t) ((Ns >> (Exponent - 2)) & 3);
+        return std::min<uint32_t>(Bucket, FDP_LATENCY_BUCKETS - 1);
     }
-    uint32_t CurrentOffset = 0;
-    do
+
+    FDP_STATS_* GetActiveStats(FDP_SHM* pFDP)
     {
-        uint32_t CurrentReadSize = std::min<uint32_t>(ReadSize, FDP_MAX_DATA_SIZE - 1);
-        if(FDP_ReadVirtualMemoryInternal(pFDP, CpuId, pDstBuffer + CurrentOffset, CurrentReadSize,
-                                         VirtualAddress + CurrentOffset)
-           == false)
+        FDP_STATS_* pStats = pFDP->pStats;
+        return pStats && pStats->bEnabled.load(std::memory_order_relaxed) ? pStats : NULL;
+    }
+
+    void CountFastRead(FDP_SHM* pFDP, std::atomic<uint64_t> FDP_STATS_::*pCounter)
+    {
+        FDP_STATS_* pStats = GetActiveStats(pFDP);
+        if(pStats)
         {
-            return false;
+            (pStats->*pCounter).fetch_add(1, std::memory_order_relaxed);
         }
-        CurrentOffset += CurrentReadSize;
-    } while(CurrentOffset < ReadSize);
-    return true;
+    }
+}
+
+static void DeleteSlots(FDP_SLOTS_* pSlots);
+static void DeleteReplay(FDP_REPLAY_* pReplay);
+
+FDP_EXPORTED void FDP_ExitSHM(FDP_SHM* pShm)
+{
+    DeleteStats(pShm->pStats);
+    DeleteRecorder(pShm->pRecorder);
+    DeleteReplay(pShm->pReplay);
+    DeleteSlots(pShm->pSlots);
+    free(pShm->InputBuffer);
+    free(pShm->OutputBuffer);
+    free(pShm);
 }
 
 FDP_EXPORTED
-bool FDP_WritePhysicalMemory(FDP_SHM* pFDP, uint8_t* pSrcBuffer, uint32_t WriteSize, uint64_t PhysicalAddress)
+void FDP_SetSpinBackoff(uint32_t MinIters, uint32_t MaxIters)
 {
-    if(pFDP == NULL)
+    MinIters = std::max<uint32_t>(MinIters, 1);
+    min_backoff_iters.store(MinIters, std::memory_order_relaxed);
+    max_backoff_iters.store(std::max(MinIters, MaxIters), std::memory_order_relaxed);
+}
+
+FDP_EXPORTED
+bool FDP_StartRecording(FDP_SHM* pFDP, const char* pPath)
+{
+    if(pFDP == NULL || pPath == NULL)
     {
         return false;
     }
-    bool bReturnValue = false;
-    LockSHM(pFDP->pSharedFDPSHM);
+    FILE* pFile = fopen(pPath, "wb");
+    if(pFile == NULL)
     {
-        FDP_WRITE_PHYSICAL_MEMORY_PKT_REQ* TempPkt = (FDP_WRITE_PHYSICAL_MEMORY_PKT_REQ*) pFDP->OutputBuffer;
-        TempPkt->Type                              = FDPCMD_WRITE_PHYSICAL;
-        TempPkt->PhysicalAddress                   = PhysicalAddress;
-        TempPkt->WriteSize                         = WriteSize;
-        if(WriteSize < FDP_MAX_DATA_SIZE - sizeof *TempPkt)
-        {
-            memcpy(TempPkt->Data, pSrcBuffer, WriteSize);
-            WriteFDPData(&pFDP->pSharedFDPSHM->ClientToServer, (uint8_t*) TempPkt, sizeof *TempPkt + WriteSize);
-            ReadFDPData(&pFDP->pSharedFDPSHM->ServerToClient, (uint8_t*) &bReturnValue);
-        }
+        return false;
+    }
+    if(fwrite(record_magic, sizeof record_magic, 1, pFile) != 1)
+    {
+        fclose(pFile);
+        return false;
     }
+    FDP_RECORDER_* pRecorder = new FDP_RECORDER_{pFile, {}};
+    LockSHM(pFDP->pSharedFDPSHM);
+    std::swap(pFDP->pRecorder, pRecorder);
     UnlockSHM(pFDP->pSharedFDPSHM);
-    return bReturnValue;
+    DeleteRecorder(pRecorder);
+    return true;
 }
 
 FDP_EXPORTED
-bool FDP_WriteVirtualMemory(FDP_SHM* pFDP, uint32_t CpuId, uint8_t* pSrcBuffer, uint32_t WriteSize,
-                            uint64_t VirtualAddress)
+void FDP_StopRecording(FDP_SHM* pFDP)
 {
     if(pFDP == NULL)
     {
-        return false;
+        return;
     }
-    bool bReturnValue = false;
+    FDP_RECORDER_* pRecorder = NULL;
     LockSHM(pFDP->pSharedFDPSHM);
-    {
-        FDP_WRITE_VIRTUAL_MEMORY_PKT_REQ* TempPkt = (FDP_WRITE_VIRTUAL_MEMORY_PKT_REQ*) pFDP->OutputBuffer;
-        TempPkt->Type                             = FDPCMD_WRITE_VIRTUAL;
-        TempPkt->CpuId                            = CpuId;
-        TempPkt->VirtualAddress                   = VirtualAddress;
-        TempPkt->WriteSize                        = WriteSize;
-        if(WriteSize < FDP_MAX_DATA_SIZE - sizeof *TempPkt)
-        {
-            memcpy(TempPkt->Data, pSrcBuffer, WriteSize);
-            WriteFDPData(&pFDP->pSharedFDPSHM->ClientToServer, pFDP->OutputBuffer, sizeof *TempPkt + WriteSize);
-            ReadFDPData(&pFDP->pSharedFDPSHM->ServerToClient, (uint8_t*) &bReturnValue);
-        }
-    }
+    std::swap(pFDP->pRecorder, pRecorder);
     UnlockSHM(pFDP->pSharedFDPSHM);
-    return bReturnValue;
+    DeleteRecorder(pRecorder);
 }
 
 FDP_EXPORTED
-uint64_t FDP_SearchPhysicalMemory(FDP_SHM* pFDP, const void* pPatternData, uint32_t PatternSize, uint64_t StartOffset)
+bool FDP_EnableStatistics(FDP_SHM* pFDP, bool bEnable)
 {
     if(pFDP == NULL)
     {
         return false;
     }
-    uint64_t FoundAddress = 0x0;
     LockSHM(pFDP->pSharedFDPSHM);
+    if(pFDP->pStats == NULL && bEnable)
     {
-        FDP_SEARCH_PHYSICAL_MEMORY_PKT_REQ* TempPkt = (FDP_SEARCH_PHYSICAL_MEMORY_PKT_REQ*) pFDP->OutputBuffer;
-        TempPkt->Type                               = FDPCMD_SEARCH_PHYSICAL_MEMORY;
-        TempPkt->PatternSize                        = PatternSize;
-        TempPkt->StartOffset                        = StartOffset;
-        memcpy(TempPkt->PatternData, pPatternData, PatternSize);
-        WriteFDPData(&pFDP->pSharedFDPSHM->ClientToServer, pFDP->OutputBuffer, sizeof *TempPkt + PatternSize);
-        ReadFDPData(&pFDP->pSharedFDPSHM->ServerToClient, (uint8_t*) &FoundAddress); // TODO: return success/fail !
+        // kept until FDP_ExitSHM, fast paths read it without the lock
+        pFDP->pStats = new FDP_STATS_{};
+    }
+    if(pFDP->pStats)
+    {
+        pFDP->pStats->bEnabled = bEnable;
     }
     UnlockSHM(pFDP->pSharedFDPSHM);
-    return FoundAddress;
+    return true;
 }
 
-// TODO !
 FDP_EXPORTED
-bool FDP_SearchVirtualMemory(FDP_SHM* pFDP, uint32_t CpuId, const void* pPatternData, uint32_t PatternSize,
-                             uint64_t StartOffset)
+bool FDP_GetStatistics(FDP_SHM* pFDP, FDP_STATISTICS_T* pStatistics)
 {
-    if(pFDP == NULL)
+    if(pFDP == NULL || pStatistics == NULL)
     {
         return false;
     }
-    uint64_t FoundAddress = 0x0;
-    bool     bReturnCode  = false;
+    memset(pStatistics, 0, sizeof *pStatistics);
     LockSHM(pFDP->pSharedFDPSHM);
+    FDP_STATS_* pStats = pFDP->pStats;
+    if(pStats)
     {
-        FDP_SEARCH_VIRTUAL_MEMORY_PKT_REQ* TempPkt = (FDP_SEARCH_VIRTUAL_MEMORY_PKT_REQ*) pFDP->OutputBuffer;
-        TempPkt->Type                              = FDPCMD_SEARCH_VIRTUAL_MEMORY;
-        TempPkt->CpuId                             = CpuId;
-        TempPkt->PatternSize                       = PatternSize;
-        TempPkt->StartOffset                       = StartOffset;
-        memcpy(TempPkt->PatternData, pPatternData, PatternSize);
-        WriteFDPData(&pFDP->pSharedFDPSHM->ClientToServer, pFDP->OutputBuffer, sizeof *TempPkt + PatternSize);
-        ReadFDPData(&pFDP->pSharedFDPSHM->ServerToClient, (uint8_t*) &FoundAddress); // TODO: return success/fail !
-        bReturnCode = true;
+        memcpy(pStatistics, &pStats->Statistics, sizeof *pStatistics);
+        pStatistics->CpuCtxReads = pStats->CpuCtxReads.load();
+        pStatistics->RamShmReads = pStats->RamShmReads.load();
     }
     UnlockSHM(pFDP->pSharedFDPSHM);
-    return bReturnCode;
+    return true;
 }
 
 FDP_EXPORTED
-bool FDP_ReadRegister(FDP_SHM* pFDP, uint32_t CpuId, FDP_Register RegisterId, uint64_t* pRegisterValue)
+bool FDP_ResetStatistics(FDP_SHM* pFDP)
 {
     if(pFDP == NULL)
     {
         return false;
     }
-    // Fast way...
-    switch(RegisterId)
+    LockSHM(pFDP->pSharedFDPSHM);
+    FDP_STATS_* pStats = pFDP->pStats;
+    if(pStats)
     {
-        case FDP_RIP_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->rip;
-            return true;
-        case FDP_RAX_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->rax;
-            return true;
-        case FDP_RCX_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->rcx;
-            return true;
-        case FDP_RDX_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->rdx;
-            return true;
-        case FDP_RBX_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->rbx;
-            return true;
-        case FDP_RSP_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->rsp;
-            return true;
-        case FDP_RBP_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->rbp;
-            return true;
-        case FDP_RSI_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->rsi;
-            return true;
-        case FDP_RDI_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->rdi;
-            return true;
-        case FDP_R8_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->r8;
-            return true;
-        case FDP_R9_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->r9;
-            return true;
-        case FDP_R10_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->r10;
-            return true;
-        case FDP_R11_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->r11;
-            return true;
-        case FDP_R12_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->r12;
-            return true;
-        case FDP_R13_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->r13;
-            return true;
-        case FDP_R14_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->r14;
-            return true;
-        case FDP_R15_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->r15;
-            return true;
-        case FDP_CR0_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->cr0;
-            return true;
-        case FDP_CR2_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->cr2;
-            return true;
-        case FDP_CR3_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->cr3;
-            return true;
-        case FDP_CR4_REGISTER:
-            *pRegisterValue = pFDP->pCpuShm->cr4;
-            return true;
-        default:
-            break;
+        memset(&pStats->Statistics, 0, sizeof pStats->Statistics);
+        pStats->CpuCtxReads = 0;
+        pStats->RamShmReads = 0;
     }
-    // Old version => low performance
-    FDP_READ_REGISTER_PKT_REQ TempPkt;
-    TempPkt.Type       = FDPCMD_READ_REGISTER;
-    TempPkt.CpuId      = CpuId;
-    TempPkt.RegisterId = RegisterId;
-    RunCmd(pFDP, pRegisterValue, &TempPkt, sizeof TempPkt);
+    UnlockSHM(pFDP->pSharedFDPSHM);
     return true;
 }
 
 FDP_EXPORTED
-bool FDP_ReadMsr(FDP_SHM* pFDP, uint32_t CpuId, uint64_t MsrId, uint64_t* pMsrValue)
+const char* FDP_GetCommandName(uint32_t CommandType)
 {
-    if(pFDP == NULL)
+#define FDP_COMMAND_NAME(X) \
+    case FDPCMD_##X: return #X;
+    switch(CommandType)
     {
-        return false;
+        FDP_COMMAND_NAME(INIT)
+        FDP_COMMAND_NAME(PHYSICAL_VIRTUAL)
+        FDP_COMMAND_NAME(READ_PHYSICAL)
+        FDP_COMMAND_NAME(READ_REGISTER)
+        FDP_COMMAND_NAME(READ_MSR)
+        FDP_COMMAND_NAME(WRITE_MSR)
+        FDP_COMMAND_NAME(GET_MEMORYSIZE)
+        FDP_COMMAND_NAME(PAUSE_VM)
+        FDP_COMMAND_NAME(RESUME_VM)
+        FDP_COMMAND_NAME(SEARCH_PHYSICAL_MEMORY)
+        FDP_COMMAND_NAME(SEARCH_VIRTUAL_MEMORY)
+        FDP_COMMAND_NAME(UNSET_BP)
+        FDP_COMMAND_NAME(SET_BP)
+        FDP_COMMAND_NAME(VIRTUAL_PHYSICAL)
+        FDP_COMMAND_NAME(WRITE_PHYSICAL)
+        FDP_COMMAND_NAME(WRITE_VIRTUAL)
+        FDP_COMMAND_NAME(GET_STATE)
+        FDP_COMMAND_NAME(READ_VIRTUAL)
+        FDP_COMMAND_NAME(WRITE_REGISTER)
+        FDP_COMMAND_NAME(GET_FXSTATE)
+        FDP_COMMAND_NAME(SET_FXSTATE)
+        FDP_COMMAND_NAME(SINGLE_STEP)
+        FDP_COMMAND_NAME(GET_CPU_COUNT)
+        FDP_COMMAND_NAME(GET_CPU_STATE)
+        FDP_COMMAND_NAME(GET_CURRENT_CPU)
+        FDP_COMMAND_NAME(SWITCH_CPU)
+        FDP_COMMAND_NAME(REBOOT)
+        FDP_COMMAND_NAME(SAVE)
+        FDP_COMMAND_NAME(RESTORE)
+        FDP_COMMAND_NAME(INJECT_INTERRUPT)
+        FDP_COMMAND_NAME(TEST)
+        FDP_COMMAND_NAME(READ_VECTOR)
+        FDP_COMMAND_NAME(SYNC_PHYSICAL_MEMORY)
+        FDP_COMMAND_NAME(SET_BREAKPOINTS)
+        FDP_COMMAND_NAME(UNSET_ALL_BREAKPOINTS)
+        FDP_COMMAND_NAME(GET_DIRTY_PAGES)
+        FDP_COMMAND_NAME(RESET_DIRTY_LOG)
+        FDP_COMMAND_NAME(SAVE_SLOT)
+        FDP_COMMAND_NAME(RESTORE_SLOT)
+        FDP_COMMAND_NAME(TRANSLATE_VECTOR)
+        FDP_COMMAND_NAME(READ_VIRTUAL_PARTIAL)
+        default: break;
     }
-    FDP_READ_MSR_PKT_REQ TempPkt;
-    TempPkt.Type  = FDPCMD_READ_MSR;
-    TempPkt.CpuId = CpuId;
-    TempPkt.MsrId = MsrId;
-    RunCmd(pFDP, pMsrValue, &TempPkt, sizeof TempPkt);
-    return true;
+#undef FDP_COMMAND_NAME
+    return NULL;
 }
 
 FDP_EXPORTED
-bool FDP_WriteMsr(FDP_SHM* pFDP, uint32_t CpuId, uint64_t MsrId, uint64_t MsrValue)
+uint64_t FDP_GetLatencyBucketNs(uint32_t Bucket)
 {
-    if(pFDP == NULL)
+    if(Bucket < 4)
     {
-        return false;
+        return Bucket;
     }
-    FDP_WRITE_MSR_PKT_REQ TempPkt;
-    TempPkt.Type     = FDPCMD_WRITE_MSR;
-    TempPkt.CpuId    = CpuId;
-    TempPkt.MsrId    = MsrId;
-    TempPkt.MsrValue = MsrValue;
-    return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
+    const uint32_t Exponent = Bucket / 4 + 1;
+    return (uint64_t) (4 + Bucket % 4) << (Exponent - 2);
 }
 
-FDP_EXPORTED
-bool FDP_WriteRegister(FDP_SHM* pFDP, uint32_t CpuId, FDP_Register RegisterId, uint64_t RegisterValue)
+// client side of the canals, must be called with the SHM locked
+static bool ClientWrite(FDP_SHM* pFDP, uint8_t* pData, uint32_t DataSize)
 {
-    if(pFDP == NULL)
+    if(pFDP->pRecorder)
     {
-        return false;
+        pFDP->pRecorder->Request.assign(pData, pData + DataSize);
     }
-    FDP_WRITE_REGISTER_PKT_REQ TempPkt;
-    TempPkt.Type          = FDPCMD_WRITE_REGISTER;
-    TempPkt.CpuId         = CpuId;
-    TempPkt.RegisterId    = RegisterId;
-    TempPkt.RegisterValue = RegisterValue;
-    return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
+    FDP_STATS_* pStats = GetActiveStats(pFDP);
+    if(pStats && DataSize)
+    {
+        pStats->bPending     = true;
+        pStats->Type         = pData[0];
+        pStats->BytesSent    = DataSize;
+        pStats->SleepStartNs = wait_sleep_ns;
+        pStats->Start        = std::chrono::steady_clock::now();
+    }
+    return WriteFDPData(pFDP->pSharedFDPSHM, &pFDP->pSharedFDPSHM->ClientToServer, pData, DataSize);
 }
 
-FDP_EXPORTED
-bool FDP_UnsetBreakpoint(FDP_SHM* pFDP, int BreakpointId)
+static void CountCommand(FDP_STATS_* pStats, uint32_t BytesReceived)
 {
-    if(pFDP == NULL)
+    const auto     Elapsed = std::chrono::steady_clock::now() - pStats->Start;
+    const uint64_t Ns      = std::chrono::duration_cast<std::chrono::nanoseconds>(Elapsed).count();
+    pStats->bPending       = false;
+    if(pStats->Type >= FDP_MAX_COMMANDS)
     {
-        return false;
+        return;
     }
-    FDP_CLEAR_BREAKPOINT_PKT_REQ TempPkt;
-    TempPkt.Type         = FDPCMD_UNSET_BP;
-    TempPkt.BreakpointId = BreakpointId;
-    return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
+    FDP_COMMAND_STATISTICS_T& Command = pStats->Statistics.Commands[pStats->Type];
+    Command.Calls++;
+    Command.BytesSent += pStats->BytesSent;
+    Command.BytesReceived += BytesReceived;
+    Command.TotalNs += Ns;
+    Command.SleepNs += std::min(Ns, wait_sleep_ns - pStats->SleepStartNs);
+    Command.MaxNs = std::max(Command.MaxNs, Ns);
+    Command.LatencyBuckets[GetLatencyBucket(Ns)]++;
 }
 
-FDP_EXPORTED
-int FDP_SetBreakpoint(
-    FDP_SHM*           pFDP,
-    uint32_t           CpuId,
-    FDP_BreakpointType BreakpointType,
-    int                BreakpointId,
-    FDP_Access         BreakpointAccessType,
-    FDP_AddressType    BreakpointAddressType,
-    uint64_t           BreakpointAddress,
-    uint64_t           BreakpointLength,
-    uint64_t           BreakpointCr3)
+static uint32_t ClientReadWithStatus(FDP_SHM* pFDP, uint8_t* buffer, bool* pbStatus)
 {
-    if(pFDP == NULL)
+    const uint32_t DataSize = ReadFDPDataWithStatus(pFDP->pSharedFDPSHM, &pFDP->pSharedFDPSHM->ServerToClient, buffer, pbStatus);
+    FDP_STATS_*    pStats   = pFDP->pStats;
+    if(pStats && pStats->bPending)
     {
-        return false;
+        CountCommand(pStats, DataSize);
     }
-    int                        iReturnedBreakpointId;
-    FDP_SET_BREAKPOINT_PKT_REQ TempPkt;
-    TempPkt.Type                  = FDPCMD_SET_BP;
-    TempPkt.CpuId                 = CpuId;
-    TempPkt.BreakpointType        = BreakpointType;
-    TempPkt.BreakpointId          = BreakpointId;
-    TempPkt.BreakpointAccessType  = BreakpointAccessType;
-    TempPkt.BreakpointAddressType = BreakpointAddressType;
-    TempPkt.BreakpointAddress     = BreakpointAddress;
-    TempPkt.BreakpointLength      = BreakpointLength;
-    TempPkt.BreakpointCr3         = BreakpointCr3;
-    RunCmd(pFDP, &iReturnedBreakpointId, &TempPkt, sizeof TempPkt);
-    return iReturnedBreakpointId;
+    FDP_RECORDER_* pRecorder = pFDP->pRecorder;
+    if(pRecorder)
+    {
+        const uint8_t  Status      = *pbStatus;
+        const uint32_t RequestSize = (uint32_t) pRecorder->Request.size();
+        const uint32_t AnswerSize  = DataSize <= pFDP->CanalSize ? DataSize : 0;
+        fwrite(&record_command, sizeof record_command, 1, pRecorder->pFile);
+        fwrite(&RequestSize, sizeof RequestSize, 1, pRecorder->pFile);
+        fwrite(pRecorder->Request.data(), 1, RequestSize, pRecorder->pFile);
+        fwrite(&Status, sizeof Status, 1, pRecorder->pFile);
+        fwrite(&AnswerSize, sizeof AnswerSize, 1, pRecorder->pFile);
+        fwrite(buffer, 1, AnswerSize, pRecorder->pFile);
+        pRecorder->Request.clear();
+    }
+    return DataSize;
 }
 
-FDP_EXPORTED
-bool FDP_VirtualToPhysical(FDP_SHM* pFDP, uint32_t CpuId, uint64_t VirtualAddress, uint64_t* PhysicalAddress)
+static uint32_t ClientRead(FDP_SHM* pFDP, uint8_t* buffer)
 {
-    if(pFDP == NULL)
+    bool bIsSuccess;
+    return ClientReadWithStatus(pFDP, buffer, &bIsSuccess);
+}
+
+static void RunCmd(FDP_SHM* pFDP, void* pDst, const void* pSrc, size_t szSize)
+{
+    LockSHM(pFDP->pSharedFDPSHM);
     {
-        return false;
+        ClientWrite(pFDP, (uint8_t*) pSrc, (uint32_t) szSize);
+        ClientRead(pFDP, (uint8_t*) pDst); // TODO: return success/fail !
     }
-    FDP_VIRTUAL_PHYSICAL_PKT_REQ TempPkt;
-    TempPkt.Type           = FDPCMD_VIRTUAL_PHYSICAL;
-    TempPkt.CpuId          = CpuId;
-    TempPkt.VirtualAddress = VirtualAddress;
-    RunCmd(pFDP, PhysicalAddress, &TempPkt, sizeof TempPkt);
-    return true;
+    UnlockSHM(pFDP->pSharedFDPSHM);
 }
 
-FDP_EXPORTED
-bool FDP_GetState(FDP_SHM* pFDP, FDP_State* DebuggeeState)
+static bool CheckRunCmd(FDP_SHM* pFDP, const void* pSrc, size_t szSize)
 {
-    if(pFDP == NULL)
+    bool bReturnValue = false;
+    RunCmd(pFDP, &bReturnValue, pSrc, szSize);
+    return bReturnValue;
+}
+
+static bool RunCmdBuffer(FDP_SHM* pFDP, void* pDst, const void* pSrc, size_t szSize)
+{
+    bool bReturnValue = false;
+    LockSHM(pFDP->pSharedFDPSHM);
     {
-        return false;
+        ClientWrite(pFDP, (uint8_t*) pSrc, (uint32_t) szSize);
+        ClientReadWithStatus(pFDP, (uint8_t*) pDst, &bReturnValue);
     }
-    FDP_GET_STATE_PKT_REQ TempPkt;
-    TempPkt.Type = FDPCMD_GET_STATE;
-    RunCmd(pFDP, DebuggeeState, &TempPkt, sizeof TempPkt);
-    return true;
+    UnlockSHM(pFDP->pSharedFDPSHM);
+    return bReturnValue;
 }
 
 FDP_EXPORTED
-bool FDP_WaitForStateChanged(FDP_SHM* pFDP, FDP_State* DebuggeeState)
+bool FDP_Pause(FDP_SHM* pFDP)
 {
     if(pFDP == NULL)
     {
         return false;
     }
-    while(true)
-    {
-        std::this_thread::yield();
-        if(FDP_GetStateChanged(pFDP) == true)
-        {
-            return FDP_GetState(pFDP, DebuggeeState);
-        }
-    }
-    return true;
+    FDP_SIMPLE_PKT_REQ TempPkt = {};
+    TempPkt.Type = FDPCMD_PAUSE_VM;
+    return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
 }
 
 FDP_EXPORTED
-bool FDP_Init(FDP_SHM* pFDP)
+bool FDP_Resume(FDP_SHM* pFDP)
 {
     if(pFDP == NULL)
     {
         return false;
     }
-    bool bReturnValue = true;
-    memset(pFDP->pSharedFDPSHM, 0, FDP_SHM_SHARED_SIZE);
-    return bReturnValue;
+    FDP_SIMPLE_PKT_REQ TempPkt = {};
+    TempPkt.Type = FDPCMD_RESUME_VM;
+    return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
 }
 
 FDP_EXPORTED
-bool FDP_SingleStep(FDP_SHM* pFDP, uint32_t CpuId)
+bool FDP_Reboot(FDP_SHM* pFDP)
 {
     if(pFDP == NULL)
     {
         return false;
     }
-    FDP_SINGLE_STEP_PKT_REQ TempPkt;
-    TempPkt.Type  = FDPCMD_SINGLE_STEP;
-    TempPkt.CpuId = CpuId;
+    FDP_SIMPLE_PKT_REQ TempPkt = {};
+    TempPkt.Type = FDPCMD_REBOOT;
     return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
 }
 
-uint8_t FDP_Test(FDP_SHM* pFDP)
+namespace
 {
-    if(pFDP == NULL)
+    const FDP_RAM_RANGE* FindRamRange(const FDP_RAM_SHM* pRam, uint64_t PhysicalAddress)
     {
-        return false;
-    }
-    uint8_t DebuggeState;
-    LockSHM(pFDP->pSharedFDPSHM);
+        const uint32_t RangeCount = std::min<uint32_t>(pRam->rangeCount, FDP_MAX_PHYSICAL_RANGES);
+        for(uint32_t i = 0; i < RangeCount; ++i)
+        {
+            const FDP_RAM_RANGE* pRange = &pRam->ranges[i];
+            if(PhysicalAddress - pRange->PhysicalAddress < pRange->Size)
+            {
+                return pRange;
+            }
+        }
+        return NULL;
+    }
+
+    // read from the exported guest memory, false when stale or not covered
+    bool ReadRamShm(FDP_SHM* pFDP, uint8_t* pDstBuffer, uint32_t ReadSize, uint64_t PhysicalAddress)
     {
-        FDP_GET_STATE_PKT_REQ* tmpPkt = (FDP_GET_STATE_PKT_REQ*) pFDP->OutputBuffer;
-        tmpPkt->Type                  = FDPCMD_TEST;
-        WriteFDPData(&pFDP->pSharedFDPSHM->ClientToServer, pFDP->OutputBuffer, sizeof *tmpPkt);
-        ReadFDPData(&pFDP->pSharedFDPSHM->ServerToClient, (uint8_t*) &DebuggeState); // TODO: return success/fail !
+        const FDP_RAM_SHM* pRam = pFDP->pRamShm;
+        // recorded sessions must go through the canal to be replayed
+        if(pRam == NULL || pFDP->pRecorder)
+        {
+            return false;
+        }
+        const uint32_t generation = pRam->generation;
+        if(generation & 1)
+        {
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t CurrentOffset = 0;
+        while(CurrentOffset < ReadSize)
+        {
+            const uint64_t       Address = PhysicalAddress + CurrentOffset;
+            const FDP_RAM_RANGE* pRange  = FindRamRange(pRam, Address);
+            if(pRange == NULL || pRange->Offset + pRange->Size > pRam->size)
+            {
+                return false;
+            }
+            const uint64_t RangeOffset = Address - pRange->PhysicalAddress;
+            const uint32_t Size        = (uint32_t) std::min<uint64_t>(ReadSize - CurrentOffset, pRange->Size - RangeOffset);
+            memcpy(pDstBuffer + CurrentOffset, (const uint8_t*) pRam + pRange->Offset + RangeOffset, Size);
+            CurrentOffset += Size;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return pRam->generation == generation;
     }
-    UnlockSHM(pFDP->pSharedFDPSHM);
-    return DebuggeState;
+}
+
+bool FDP_ReadPhysicalMemoryInternal(FDP_SHM* pFDP, uint8_t* pDstBuffer, uint32_t ReadSize, uint64_t PhysicalAddress)
+{
+    FDP_READ_PHYSICAL_MEMORY_PKT_REQ tmpPkt = {};
+    tmpPkt.Type            = FDPCMD_READ_PHYSICAL;
+    tmpPkt.PhysicalAddress = PhysicalAddress;
+    tmpPkt.ReadSize        = ReadSize;
+    return RunCmdBuffer(pFDP, pDstBuffer, &tmpPkt, sizeof tmpPkt);
 }
 
 FDP_EXPORTED
-bool FDP_GetFxState64(FDP_SHM* pFDP, uint32_t CpuId, FDP_XSAVE_FORMAT64_T* pFxState)
+bool FDP_ReadPhysicalMemory(FDP_SHM* pFDP, uint8_t* pDstBuffer, uint32_t ReadSize, uint64_t PhysicalAddress)
 {
     if(pFDP == NULL)
     {
         return false;
     }
-    LockSHM(pFDP->pSharedFDPSHM);
+    if(ReadRamShm(pFDP, pDstBuffer, ReadSize, PhysicalAddress))
     {
-        FDP_GET_STATE_PKT_REQ* TempPkt = (FDP_GET_STATE_PKT_REQ*) pFDP->OutputBuffer;
-        TempPkt->Type                  = FDPCMD_GET_FXSTATE;
-        TempPkt->CpuId                 = CpuId;
-        WriteFDPData(&pFDP->pSharedFDPSHM->ClientToServer, pFDP->OutputBuffer, sizeof *TempPkt);
-        ReadFDPData(&pFDP->pSharedFDPSHM->ServerToClient, (uint8_t*) pFxState); // TODO: return success/fail !
+        CountFastRead(pFDP, &FDP_STATS_::RamShmReads);
+        return true;
     }
-    UnlockSHM(pFDP->pSharedFDPSHM);
+    uint32_t CurrentOffset = 0;
+    do
+    {
+        uint32_t CurrentReadSize = std::min<uint32_t>(ReadSize - CurrentOffset, pFDP->CanalSize);
+        if(FDP_ReadPhysicalMemoryInternal(pFDP, pDstBuffer + CurrentOffset, CurrentReadSize,
+                                          PhysicalAddress + CurrentOffset)
+           == false)
+        {
+            return false;
+        }
+        CurrentOffset += CurrentReadSize;
+    } while(CurrentOffset < ReadSize);
     return true;
 }
 
 FDP_EXPORTED
-bool FDP_SetFxState64(FDP_SHM* pFDP, uint32_t CpuId, FDP_XSAVE_FORMAT64_T* pFxState64)
+bool FDP_SyncPhysicalMemory(FDP_SHM* pFDP)
 {
-    if(pFDP == NULL)
+    if(pFDP == NULL || pFDP->pRamShm == NULL)
     {
         return false;
     }
-    bool bReturnValue = false;
-    LockSHM(pFDP->pSharedFDPSHM);
-    {
-        FDP_SET_FX_STATE_REQ* TempPkt = (FDP_SET_FX_STATE_REQ*) pFDP->OutputBuffer;
-        TempPkt->Type                 = FDPCMD_SET_FXSTATE;
-        TempPkt->CpuId                = CpuId;
-        memcpy(&TempPkt->FxState64, pFxState64, sizeof *pFxState64);
-        WriteFDPData(&pFDP->pSharedFDPSHM->ClientToServer, pFDP->OutputBuffer, sizeof *TempPkt);
-        ReadFDPData(&pFDP->pSharedFDPSHM->ServerToClient, (uint8_t*) &bReturnValue); // TODO: return success/fail !
-    }
-    UnlockSHM(pFDP->pSharedFDPSHM);
-    return bReturnValue;
+    FDP_SIMPLE_PKT_REQ TempPkt = {};
+    TempPkt.Type = FDPCMD_SYNC_PHYSICAL_MEMORY;
+    return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
 }
 
 FDP_EXPORTED
-bool FDP_GetPhysicalMemorySize(FDP_SHM* pFDP, uint64_t* PhysicalMemorySize)
+bool FDP_GetDirtyPages(FDP_SHM* pFDP, uint64_t FirstPage, uint64_t* pPages, uint32_t* pPageCount)
 {
-    if(pFDP == NULL)
+    if(pFDP == NULL || pPages == NULL || pPageCount == NULL)
     {
         return false;
     }
-    bool               bReturnValue = true;
-    FDP_SIMPLE_PKT_REQ TempPkt;
-    TempPkt.Type = FDPCMD_GET_MEMORYSIZE;
-    RunCmd(pFDP, PhysicalMemorySize, &TempPkt, sizeof TempPkt);
-    // TODO return bool !
-    return bReturnValue;
+    const uint32_t MaxCount = *pPageCount;
+    uint32_t       Count    = 0;
+    while(Count < MaxCount)
+    {
+        const uint32_t               CurrentCount = std::min<uint32_t>(MaxCount - Count, (pFDP->CanalSize - sizeof(FDP_GET_DIRTY_PAGES_PKT_ANS)) / sizeof(uint64_t));
+        FDP_GET_DIRTY_PAGES_PKT_ANS* pAnswer      = (FDP_GET_DIRTY_PAGES_PKT_ANS*) pFDP->InputBuffer;
+        uint32_t                     ReadCount    = 0;
+        bool                         bStatus      = false;
+        LockSHM(pFDP->pSharedFDPSHM);
+        {
+            FDP_GET_DIRTY_PAGES_PKT_REQ TempPkt = {};
+            TempPkt.Type            = FDPCMD_GET_DIRTY_PAGES;
+            TempPkt.FirstPage       = Count ? pPages[Count - 1] + 1 : FirstPage;
+            TempPkt.MaxCount        = CurrentCount;
+            ClientWrite(pFDP, (uint8_t*) &TempPkt, sizeof TempPkt);
+            const uint32_t ReadSize = ClientReadWithStatus(pFDP, pFDP->InputBuffer, &bStatus);
+            bStatus                 = bStatus
+                      && ReadSize >= sizeof *pAnswer
+                      && pAnswer->Count <= CurrentCount
+                      && ReadSize == sizeof *pAnswer + pAnswer->Count * sizeof(uint64_t);
+            if(bStatus)
+            {
+                ReadCount = pAnswer->Count;
+                memcpy(&pPages[Count], pAnswer->Pages, ReadCount * sizeof(uint64_t));
+            }
+        }
+        UnlockSHM(pFDP->pSharedFDPSHM);
+        if(!bStatus)
+        {
+            return false;
+        }
+        Count += ReadCount;
+        if(ReadCount < CurrentCount)
+        {
+            break;
+        }
+    }
+    *pPageCount = Count;
+    return true;
 }
 
 FDP_EXPORTED
-bool FDP_GetCpuCount(FDP_SHM* pFDP, uint32_t* CPUCount)
+bool FDP_ResetDirtyLog(FDP_SHM* pFDP)
 {
     if(pFDP == NULL)
     {
         return false;
     }
-    bool               bReturnValue = true;
-    FDP_SIMPLE_PKT_REQ TempPkt;
-    TempPkt.Type = FDPCMD_GET_CPU_COUNT;
-    RunCmd(pFDP, CPUCount, &TempPkt, sizeof TempPkt);
-    return bReturnValue;
+    FDP_SIMPLE_PKT_REQ TempPkt = {};
+    TempPkt.Type = FDPCMD_RESET_DIRTY_LOG;
+    return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
 }
 
 FDP_EXPORTED
-bool FDP_GetCpuState(FDP_SHM* pFDP, uint32_t CpuId, FDP_State* pDebuggeeState)
+bool FDP_SaveSlot(FDP_SHM* pFDP, uint32_t SlotId)
 {
     if(pFDP == NULL)
     {
         return false;
     }
-    FDP_GET_CPU_STATE_PKT_REQ TempPkt;
-    TempPkt.Type  = FDPCMD_GET_CPU_STATE;
-    TempPkt.CpuId = CpuId;
-    RunCmd(pFDP, pDebuggeeState, &TempPkt, sizeof TempPkt);
-    return true;
+    FDP_SLOT_PKT_REQ TempPkt = {};
+    TempPkt.Type   = FDPCMD_SAVE_SLOT;
+    TempPkt.SlotId = SlotId;
+    return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
 }
 
 FDP_EXPORTED
-bool FDP_Save(FDP_SHM* pFDP)
+bool FDP_RestoreSlot(FDP_SHM* pFDP, uint32_t SlotId)
 {
     if(pFDP == NULL)
     {
         return false;
     }
-    FDP_SIMPLE_PKT_REQ TempPkt;
-    TempPkt.Type = FDPCMD_SAVE;
+    FDP_SLOT_PKT_REQ TempPkt = {};
+    TempPkt.Type   = FDPCMD_RESTORE_SLOT;
+    TempPkt.SlotId = SlotId;
     return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
 }
 
+bool FDP_ReadVirtualMemoryInternal(FDP_SHM* pFDP, uint32_t CpuId, uint64_t Dtb, uint8_t* pDstBuffer, uint32_t ReadSize,
+                                   uint64_t VirtualAddress)
+{
+    FDP_READ_VIRTUAL_MEMORY_PKT_REQ tmpPkt = {};
+    tmpPkt.Type           = FDPCMD_READ_VIRTUAL;
+    tmpPkt.CpuId          = CpuId;
+    tmpPkt.Dtb            = Dtb;
+    tmpPkt.VirtualAddress = VirtualAddress;
+    tmpPkt.ReadSize       = ReadSize;
+    return RunCmdBuffer(pFDP, pDstBuffer, &tmpPkt, sizeof tmpPkt);
+}
+
 FDP_EXPORTED
-bool FDP_Restore(FDP_SHM* pFDP)
+bool FDP_ReadVirtualMemoryDtb(FDP_SHM* pFDP, uint32_t CpuId, uint64_t Dtb, uint8_t* pDstBuffer, uint32_t ReadSize,
+                              uint64_t VirtualAddress)
 {
-    if(pFDP == NULL)
+    if(pFDP == NULL || ReadSize <= 0)
     {
         return false;
     }
-    FDP_SIMPLE_PKT_REQ TempPkt;
-    TempPkt.Type = FDPCMD_RESTORE;
-    return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
+    uint32_t CurrentOffset = 0;
+    do
+    {
+        uint32_t CurrentReadSize = std::min<uint32_t>(ReadSize - CurrentOffset, pFDP->CanalSize);
+        if(FDP_ReadVirtualMemoryInternal(pFDP, CpuId, Dtb, pDstBuffer + CurrentOffset, CurrentReadSize,
+                                         VirtualAddress + CurrentOffset)
+           == false)
+        {
+            return false;
+        }
+        CurrentOffset += CurrentReadSize;
+    } while(CurrentOffset < ReadSize);
+    return true;
 }
 
 FDP_EXPORTED
-bool FDP_GetStateChanged(FDP_SHM* pFDP)
+bool FDP_ReadVirtualMemoryPartial(FDP_SHM* pFDP, uint32_t CpuId, uint64_t Dtb, uint8_t* pDstBuffer, uint32_t ReadSize,
+                                  uint64_t VirtualAddress, uint8_t* pFaultBitmap)
 {
-    if(pFDP == NULL)
+    if(pFDP == NULL || pDstBuffer == NULL || pFaultBitmap == NULL || ReadSize == 0)
     {
         return false;
     }
-    bool StateChanged;
-    // LockSHM(pFDP->pSharedFDPSHM);
-    ttas_spinlock_lock(&pFDP->pSharedFDPSHM->stateChangedLock);
+    // each chunk answers its data & one bit per page
+    const uint32_t PageSize = 0x1000;
+    const uint32_t MaxPages = (pFDP->CanalSize - 1) / (PageSize + 1);
+    memset(pFaultBitmap, 0, FDP_FAULT_BITMAP_SIZE(VirtualAddress, ReadSize));
+    for(uint32_t Offset = 0; Offset < ReadSize;)
     {
-        StateChanged                      = pFDP->pSharedFDPSHM->stateChanged;
-        pFDP->pSharedFDPSHM->stateChanged = false;
+        const uint64_t Address     = VirtualAddress + Offset;
+        const uint32_t PageOffset  = (uint32_t)(Address & (PageSize - 1));
+        const uint32_t CurrentSize = std::min<uint32_t>(ReadSize - Offset, MaxPages * PageSize - PageOffset);
+        const uint32_t PageCount   = (PageOffset + CurrentSize + PageSize - 1) / PageSize;
+        const uint32_t FirstPage   = (uint32_t)((Address / PageSize) - (VirtualAddress / PageSize));
+        bool           bStatus     = false;
+        LockSHM(pFDP->pSharedFDPSHM);
+        {
+            FDP_READ_VIRTUAL_MEMORY_PKT_REQ TempPkt = {};
+            TempPkt.Type                            = FDPCMD_READ_VIRTUAL_PARTIAL;
+            TempPkt.CpuId                           = CpuId;
+            TempPkt.Dtb                             = Dtb;
+            TempPkt.VirtualAddress                  = Address;
+            TempPkt.ReadSize                        = CurrentSize;
+            ClientWrite(pFDP, (uint8_t*) &TempPkt, sizeof TempPkt);
+            const uint32_t AnswerSize = ClientReadWithStatus(pFDP, pFDP->InputBuffer, &bStatus);
+            bStatus                   = bStatus && AnswerSize == CurrentSize + (PageCount + 7) / 8;
+            if(bStatus)
+            {
+                memcpy(pDstBuffer + Offset, pFDP->InputBuffer, CurrentSize);
+                const uint8_t* pFaults = pFDP->InputBuffer + CurrentSize;
+                for(uint32_t i = 0; i < PageCount; ++i)
+                {
+                    if(pFaults[i / 8] & (1 << (i % 8)))
+                    {
+                        pFaultBitmap[(FirstPage + i) / 8] |= (uint8_t)(1 << ((FirstPage + i) % 8));
+                    }
+                }
+            }
+        }
+        UnlockSHM(pFDP->pSharedFDPSHM);
+        if(!bStatus)
+        {
+            return false;
+        }
+        Offset += CurrentSize;
     }
-    // UnlockSHM(pFDP->pSharedFDPSHM);
-    ttas_spinlock_unlock(&pFDP->pSharedFDPSHM->stateChangedLock);
-    return StateChanged;
+    return true;
 }
 
 FDP_EXPORTED
-void FDP_SetStateChanged(FDP_SHM* pFDP)
+bool FDP_ReadVirtualMemory(FDP_SHM* pFDP, uint32_t CpuId, uint8_t* pDstBuffer, uint32_t ReadSize,
+                           uint64_t VirtualAddress)
+{
+    return FDP_ReadVirtualMemoryDtb(pFDP, CpuId, FDP_NO_CR3, pDstBuffer, ReadSize, VirtualAddress);
+}
+
+FDP_EXPORTED
+bool FDP_WritePhysicalMemory(FDP_SHM* pFDP, uint8_t* pSrcBuffer, uint32_t WriteSize, uint64_t PhysicalAddress)
 {
     if(pFDP == NULL)
     {
-        return;
+        return false;
     }
-    // LockSHM(pFDP->pSharedFDPSHM);
-    ttas_spinlock_lock(&pFDP->pSharedFDPSHM->stateChangedLock);
+    bool bReturnValue = false;
+    LockSHM(pFDP->pSharedFDPSHM);
     {
-        pFDP->pSharedFDPSHM->stateChanged = true;
+        FDP_WRITE_PHYSICAL_MEMORY_PKT_REQ* TempPkt = (FDP_WRITE_PHYSICAL_MEMORY_PKT_REQ*) pFDP->OutputBuffer;
+        memset(TempPkt, 0, sizeof *TempPkt);
+        TempPkt->Type                              = FDPCMD_WRITE_PHYSICAL;
+        TempPkt->PhysicalAddress                   = PhysicalAddress;
+        TempPkt->WriteSize                         = WriteSize;
+        if(WriteSize < pFDP->CanalSize - sizeof *TempPkt)
+        {
+            memcpy(TempPkt->Data, pSrcBuffer, WriteSize);
+            ClientWrite(pFDP, (uint8_t*) TempPkt, sizeof *TempPkt + WriteSize);
+            ClientRead(pFDP, (uint8_t*) &bReturnValue);
+        }
     }
-    // UnlockSHM(pFDP->pSharedFDPSHM);
-    ttas_spinlock_unlock(&pFDP->pSharedFDPSHM->stateChangedLock);
-    return;
+    UnlockSHM(pFDP->pSharedFDPSHM);
+    return bReturnValue;
 }
 
 FDP_EXPORTED
-bool FDP_InjectInterrupt(FDP_SHM* pFDP, uint32_t CpuId, uint32_t uInterruptionCode, uint32_t uErrorCode,
-                         uint64_t Cr2Value)
+bool FDP_WriteVirtualMemoryDtb(FDP_SHM* pFDP, uint32_t CpuId, uint64_t Dtb, uint8_t* pSrcBuffer, uint32_t WriteSize,
+                               uint64_t VirtualAddress)
 {
     if(pFDP == NULL)
     {
@@ -973,322 +1421,2629 @@ bool FDP_InjectInterrupt(FDP_SHM* pFDP, uint32_t CpuId, uint32_t uInterruptionCo
     bool bReturnValue = false;
     LockSHM(pFDP->pSharedFDPSHM);
     {
-        FDP_INJECT_INTERRUPT_PKT_REQ* tmpPkt = (FDP_INJECT_INTERRUPT_PKT_REQ*) pFDP->OutputBuffer;
-        tmpPkt->Type                         = FDPCMD_INJECT_INTERRUPT;
-        tmpPkt->CpuId                        = CpuId;
-        tmpPkt->Cr2Value                     = Cr2Value;
-        tmpPkt->ErrorCode                    = uErrorCode;
-        tmpPkt->InterruptionCode             = uInterruptionCode;
-        WriteFDPData(&pFDP->pSharedFDPSHM->ClientToServer, pFDP->OutputBuffer, sizeof *tmpPkt);
-        ReadFDPData(&pFDP->pSharedFDPSHM->ServerToClient, (uint8_t*) &bReturnValue); // TODO: return success/fail !
+        FDP_WRITE_VIRTUAL_MEMORY_PKT_REQ* TempPkt = (FDP_WRITE_VIRTUAL_MEMORY_PKT_REQ*) pFDP->OutputBuffer;
+        memset(TempPkt, 0, sizeof *TempPkt);
+        TempPkt->Type                             = FDPCMD_WRITE_VIRTUAL;
+        TempPkt->CpuId                            = CpuId;
+        TempPkt->Dtb                              = Dtb;
+        TempPkt->VirtualAddress                   = VirtualAddress;
+        TempPkt->WriteSize                        = WriteSize;
+        if(WriteSize < pFDP->CanalSize - sizeof *TempPkt)
+        {
+            memcpy(TempPkt->Data, pSrcBuffer, WriteSize);
+            ClientWrite(pFDP, pFDP->OutputBuffer, sizeof *TempPkt + WriteSize);
+            ClientRead(pFDP, (uint8_t*) &bReturnValue);
+        }
     }
     UnlockSHM(pFDP->pSharedFDPSHM);
     return bReturnValue;
 }
 
-// Server Part
 FDP_EXPORTED
-bool FDP_ServerLoop(FDP_SHM* pFDP)
+bool FDP_WriteVirtualMemory(FDP_SHM* pFDP, uint32_t CpuId, uint8_t* pSrcBuffer, uint32_t WriteSize,
+                            uint64_t VirtualAddress)
 {
-    if(pFDP == NULL)
+    return FDP_WriteVirtualMemoryDtb(pFDP, CpuId, FDP_NO_CR3, pSrcBuffer, WriteSize, VirtualAddress);
+}
+
+namespace
+{
+    struct ReadVectorChunk
+    {
+        uint32_t Entry;
+        uint32_t Offset;
+        uint32_t Size;
+    };
+}
+
+FDP_EXPORTED
+bool FDP_ReadMemoryVector(FDP_SHM* pFDP, uint32_t CpuId, FDP_READ_VECTOR_T* pEntries, uint32_t EntryCount)
+{
+    if(pFDP == NULL || pEntries == NULL)
     {
         return false;
     }
-    uint32_t u32InputBufferSize  = 0;
-    uint32_t u32OutputBuffersize = 0;
-    pFDP->pFdpServer->bIsRunning = true;
-    while(pFDP->pFdpServer->bIsRunning)
+    // physical entries are served locally when guest memory is exported
+    std::vector<uint8_t> Done(EntryCount);
+    for(uint32_t i = 0; i < EntryCount; ++i)
     {
-        bool bStatus       = true;
-        u32InputBufferSize = ReadFDPData(&pFDP->pSharedFDPSHM->ClientToServer, pFDP->InputBuffer);
-        if(u32InputBufferSize == 0)
-        {
-            return false;
-        }
-        uint8_t Type = pFDP->InputBuffer[0];
-        switch(Type)
+        pEntries[i].bSuccess = true;
+        if(pEntries[i].AddressType == FDP_PHYSICAL_ADDRESS)
         {
-            case FDPCMD_TEST:
-            {
-                pFDP->OutputBuffer[0] = 0; // TODO: true !
-                u32OutputBuffersize   = 1;
-                break;
-            }
-            case FDPCMD_SAVE:
-            {
-                pFDP->OutputBuffer[0] = pFDP->pFdpServer->pfnSave(pFDP->pFdpServer->pUserHandle);
-                u32OutputBuffersize   = 1;
-                break;
-            }
-            case FDPCMD_RESTORE:
-            {
-                pFDP->OutputBuffer[0] = pFDP->pFdpServer->pfnRestore(pFDP->pFdpServer->pUserHandle);
-                u32OutputBuffersize   = 1;
-                break;
-            }
-            case FDPCMD_REBOOT:
-            {
-                pFDP->OutputBuffer[0] = pFDP->pFdpServer->pfnReboot(pFDP->pFdpServer->pUserHandle);
-                u32OutputBuffersize   = 1;
-                break;
-            }
-            case FDPCMD_GET_CPU_COUNT:
-            {
-                uint32_t CpuCout;
-                pFDP->pFdpServer->pfnGetCpuCount(pFDP->pFdpServer->pUserHandle, &CpuCout);
-                ((uint32_t*) pFDP->OutputBuffer)[0] = CpuCout;
-                u32OutputBuffersize                 = sizeof CpuCout;
-                break;
-            }
-            case FDPCMD_GET_STATE:
-            {
-                uint8_t CurrentState;
-                pFDP->pFdpServer->pfnGetState(pFDP->pFdpServer->pUserHandle, &CurrentState);
-                pFDP->OutputBuffer[0] = CurrentState;
-                u32OutputBuffersize   = sizeof CurrentState;
-                break;
-            }
-            case FDPCMD_GET_CPU_STATE:
-            {
-                uint8_t                CurrentState = 0;
-                FDP_GET_STATE_PKT_REQ* TempPkt      = (FDP_GET_STATE_PKT_REQ*) pFDP->InputBuffer;
-                pFDP->pFdpServer->pfnGetCpuState(pFDP->pFdpServer->pUserHandle, TempPkt->CpuId, &CurrentState);
-                pFDP->OutputBuffer[0] = CurrentState;
-                u32OutputBuffersize   = sizeof CurrentState;
-                break;
-            }
-            case FDPCMD_GET_MEMORYSIZE:
-            {
-                uint64_t u64PhysicalMemorySize;
-                pFDP->pFdpServer->pfnGetMemorySize(pFDP->pFdpServer->pUserHandle, &u64PhysicalMemorySize);
-                ((uint64_t*) pFDP->OutputBuffer)[0] = u64PhysicalMemorySize;
-                u32OutputBuffersize                 = sizeof u64PhysicalMemorySize;
-                break;
-            }
-            case FDPCMD_UNSET_BP:
-            {
-                FDP_CLEAR_BREAKPOINT_PKT_REQ* TempPkt = (FDP_CLEAR_BREAKPOINT_PKT_REQ*) pFDP->InputBuffer;
-                pFDP->OutputBuffer[0]                 = pFDP->pFdpServer->pfnUnsetBreakpoint(pFDP->pFdpServer->pUserHandle, TempPkt->BreakpointId);
-                u32OutputBuffersize                   = 1;
-                break;
-            }
-            case FDPCMD_SET_BP:
-            {
-                FDP_SET_BREAKPOINT_PKT_REQ* TempPkt = (FDP_SET_BREAKPOINT_PKT_REQ*) pFDP->InputBuffer;
-                ((int*) pFDP->OutputBuffer)[0]      = pFDP->pFdpServer->pfnSetBreakpoint(pFDP->pFdpServer->pUserHandle,
-                                                                                    TempPkt->CpuId,
-                                                                                    TempPkt->BreakpointType,
-                                                                                    TempPkt->BreakpointId,
-                                                                                    TempPkt->BreakpointAccessType,
-                                                                                    TempPkt->BreakpointAddressType,
-                                                                                    TempPkt->BreakpointAddress,
-                                                                                    TempPkt->BreakpointLength,
-                                                                                    TempPkt->BreakpointCr3);
-                u32OutputBuffersize                 = sizeof(int);
-                break;
-            }
-            case FDPCMD_VIRTUAL_PHYSICAL:
+            Done[i] = ReadRamShm(pFDP, pEntries[i].pDstBuffer, pEntries[i].ReadSize, pEntries[i].Address);
+            if(Done[i])
             {
-                uint64_t                      PhysicalAddress = 0;
-                FDP_VIRTUAL_PHYSICAL_PKT_REQ* TempPkt         = (FDP_VIRTUAL_PHYSICAL_PKT_REQ*) pFDP->InputBuffer;
-                pFDP->pFdpServer->pfnVirtualToPhysical(pFDP->pFdpServer->pUserHandle,
-                                                       TempPkt->CpuId,
-                                                       TempPkt->VirtualAddress,
-                                                       &PhysicalAddress);
-                ((uint64_t*) pFDP->OutputBuffer)[0] = PhysicalAddress;
-                u32OutputBuffersize                 = sizeof PhysicalAddress;
-                break;
+                CountFastRead(pFDP, &FDP_STATS_::RamShmReads);
             }
-            case FDPCMD_RESUME_VM:
-                pFDP->OutputBuffer[0] = pFDP->pFdpServer->pfnResume(pFDP->pFdpServer->pUserHandle);
-                u32OutputBuffersize   = sizeof(bool);
-                break;
-            case FDPCMD_PAUSE_VM:
-                pFDP->OutputBuffer[0] = pFDP->pFdpServer->pfnPause(pFDP->pFdpServer->pUserHandle);
-                u32OutputBuffersize   = sizeof(bool);
-                break;
-            case FDPCMD_SINGLE_STEP:
+        }
+    }
+
+    // split entries into batches fitting both request & answer canals
+    std::vector<ReadVectorChunk> Chunks;
+    uint32_t                     CurrentEntry  = 0;
+    uint32_t                     CurrentOffset = 0;
+    while(CurrentEntry < EntryCount)
+    {
+        Chunks.clear();
+        uint32_t RequestSize  = sizeof(FDP_READ_VECTOR_PKT_REQ);
+        uint32_t ResponseSize = 0;
+        while(CurrentEntry < EntryCount)
+        {
+            if(Done[CurrentEntry])
             {
-                FDP_GET_STATE_PKT_REQ* TempPkt = (FDP_GET_STATE_PKT_REQ*) pFDP->InputBuffer;
-                pFDP->OutputBuffer[0]          = pFDP->pFdpServer->pfnSingleStep(pFDP->pFdpServer->pUserHandle, TempPkt->CpuId);
-                u32OutputBuffersize            = sizeof(bool);
-                break;
+                CurrentEntry++;
+                continue;
             }
-            case FDPCMD_READ_REGISTER:
+            const FDP_READ_VECTOR_T* pEntry = &pEntries[CurrentEntry];
+            if(RequestSize + sizeof(FDP_READ_VECTOR_ENTRY) > pFDP->CanalSize || ResponseSize + 2 > pFDP->CanalSize - 1)
             {
-                uint64_t                   RegisterValue = 0;
-                FDP_READ_REGISTER_PKT_REQ* TempPkt       = (FDP_READ_REGISTER_PKT_REQ*) pFDP->InputBuffer;
-                pFDP->pFdpServer->pfnReadRegister(pFDP->pFdpServer->pUserHandle,
-                                                  TempPkt->CpuId,
-                                                  TempPkt->RegisterId,
-                                                  &RegisterValue);
-                ((uint64_t*) pFDP->OutputBuffer)[0] = RegisterValue;
-                u32OutputBuffersize                 = sizeof RegisterValue;
                 break;
             }
-            case FDPCMD_GET_FXSTATE:
+            const uint32_t Left = pEntry->ReadSize - CurrentOffset;
+            const uint32_t Size = std::min<uint32_t>(Left, pFDP->CanalSize - 2 - ResponseSize);
+            if(Size)
             {
-                FDP_GET_STATE_PKT_REQ* TempPkt = (FDP_GET_STATE_PKT_REQ*) pFDP->InputBuffer;
-                pFDP->pFdpServer->pfnGetFxState64(pFDP->pFdpServer->pUserHandle,
-                                                  TempPkt->CpuId,
-                                                  pFDP->OutputBuffer,
-                                                  &u32OutputBuffersize);
-                break;
+                Chunks.push_back(ReadVectorChunk{CurrentEntry, CurrentOffset, Size});
+                RequestSize += sizeof(FDP_READ_VECTOR_ENTRY);
+                ResponseSize += 1 + Size;
             }
-            case FDPCMD_SET_FXSTATE:
+            CurrentOffset += Size;
+            if(CurrentOffset < pEntry->ReadSize)
             {
-                FDP_SET_FX_STATE_REQ* TempPkt = (FDP_SET_FX_STATE_REQ*) pFDP->InputBuffer;
-                pFDP->OutputBuffer[0]         = pFDP->pFdpServer->pfnSetFxState64(pFDP->pFdpServer->pUserHandle,
-                                                                          TempPkt->CpuId,
-                                                                          (uint8_t*) &TempPkt->FxState64,
-                                                                          sizeof TempPkt->FxState64);
-                u32OutputBuffersize           = sizeof(bool);
                 break;
             }
-            case FDPCMD_READ_MSR:
+            CurrentEntry++;
+            CurrentOffset = 0;
+        }
+        if(Chunks.empty())
+        {
+            continue;
+        }
+
+        bool     bStatus  = false;
+        uint32_t ReadSize = 0;
+        LockSHM(pFDP->pSharedFDPSHM);
+        {
+            FDP_READ_VECTOR_PKT_REQ* TempPkt = (FDP_READ_VECTOR_PKT_REQ*) pFDP->OutputBuffer;
+            memset(TempPkt, 0, sizeof *TempPkt);
+            TempPkt->Type                    = FDPCMD_READ_VECTOR;
+            TempPkt->CpuId                   = CpuId;
+            TempPkt->EntryCount              = (uint32_t) Chunks.size();
+            for(size_t i = 0; i < Chunks.size(); ++i)
             {
-                uint64_t              MsrValue = 0;
-                FDP_READ_MSR_PKT_REQ* TempPkt  = (FDP_READ_MSR_PKT_REQ*) pFDP->InputBuffer;
-                pFDP->pFdpServer->pfnReadMsr(pFDP->pFdpServer->pUserHandle,
-                                             TempPkt->CpuId,
-                                             TempPkt->MsrId,
-                                             &MsrValue);
-                ((uint64_t*) pFDP->OutputBuffer)[0] = MsrValue;
-                u32OutputBuffersize                 = sizeof MsrValue;
-                break;
+                const FDP_READ_VECTOR_T* pEntry = &pEntries[Chunks[i].Entry];
+                TempPkt->Entries[i].Address     = pEntry->Address + Chunks[i].Offset;
+                TempPkt->Entries[i].Dtb         = pEntry->Dtb;
+                TempPkt->Entries[i].ReadSize    = Chunks[i].Size;
+                TempPkt->Entries[i].AddressType = pEntry->AddressType;
             }
-            case FDPCMD_WRITE_MSR:
+            ClientWrite(pFDP, pFDP->OutputBuffer, RequestSize);
+            ReadSize = ClientReadWithStatus(pFDP, pFDP->InputBuffer, &bStatus);
+        }
+        UnlockSHM(pFDP->pSharedFDPSHM);
+
+        const uint8_t* pStatus = pFDP->InputBuffer;
+        const uint8_t* pData   = pFDP->InputBuffer + Chunks.size();
+        for(size_t i = 0; i < Chunks.size(); ++i)
+        {
+            FDP_READ_VECTOR_T* pEntry = &pEntries[Chunks[i].Entry];
+            if(!bStatus || ReadSize != ResponseSize || !pStatus[i])
             {
-                FDP_WRITE_MSR_PKT_REQ* TempPkt = (FDP_WRITE_MSR_PKT_REQ*) pFDP->InputBuffer;
-                pFDP->OutputBuffer[0]          = pFDP->pFdpServer->pfnWriteMsr(pFDP->pFdpServer->pUserHandle,
-                                                                      TempPkt->CpuId,
-                                                                      TempPkt->MsrId,
-                                                                      TempPkt->MsrValue);
-                u32OutputBuffersize            = sizeof(bool);
-                break;
+                pEntry->bSuccess = false;
             }
-            case FDPCMD_WRITE_REGISTER:
+            else
             {
-                FDP_WRITE_REGISTER_PKT_REQ* TempPkt = (FDP_WRITE_REGISTER_PKT_REQ*) pFDP->InputBuffer;
-                pFDP->OutputBuffer[0]               = pFDP->pFdpServer->pfnWriteRegister(pFDP->pFdpServer->pUserHandle,
-                                                                           TempPkt->CpuId,
-                                                                           TempPkt->RegisterId,
-                                                                           TempPkt->RegisterValue);
-                u32OutputBuffersize                 = sizeof(bool);
-                break;
+                memcpy(pEntry->pDstBuffer + Chunks[i].Offset, pData, Chunks[i].Size);
             }
-            case FDPCMD_READ_PHYSICAL:
+            pData += Chunks[i].Size;
+        }
+    }
+
+    bool bReturnValue = true;
+    for(uint32_t i = 0; i < EntryCount; ++i)
+    {
+        bReturnValue &= pEntries[i].bSuccess;
+    }
+    return bReturnValue;
+}
+
+FDP_EXPORTED
+uint64_t FDP_SearchPhysicalMemory(FDP_SHM* pFDP, const void* pPatternData, uint32_t PatternSize, uint64_t StartOffset)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    uint64_t FoundAddress = 0x0;
+    LockSHM(pFDP->pSharedFDPSHM);
+    {
+        FDP_SEARCH_PHYSICAL_MEMORY_PKT_REQ* TempPkt = (FDP_SEARCH_PHYSICAL_MEMORY_PKT_REQ*) pFDP->OutputBuffer;
+        memset(TempPkt, 0, sizeof *TempPkt);
+        TempPkt->Type                               = FDPCMD_SEARCH_PHYSICAL_MEMORY;
+        TempPkt->PatternSize                        = PatternSize;
+        TempPkt->StartOffset                        = StartOffset;
+        memcpy(TempPkt->PatternData, pPatternData, PatternSize);
+        ClientWrite(pFDP, pFDP->OutputBuffer, sizeof *TempPkt + PatternSize);
+        ClientRead(pFDP, (uint8_t*) &FoundAddress); // TODO: return success/fail !
+    }
+    UnlockSHM(pFDP->pSharedFDPSHM);
+    return FoundAddress;
+}
+
+// TODO !
+FDP_EXPORTED
+bool FDP_SearchVirtualMemory(FDP_SHM* pFDP, uint32_t CpuId, const void* pPatternData, uint32_t PatternSize,
+                             uint64_t StartOffset)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    uint64_t FoundAddress = 0x0;
+    bool     bReturnCode  = false;
+    LockSHM(pFDP->pSharedFDPSHM);
+    {
+        FDP_SEARCH_VIRTUAL_MEMORY_PKT_REQ* TempPkt = (FDP_SEARCH_VIRTUAL_MEMORY_PKT_REQ*) pFDP->OutputBuffer;
+        memset(TempPkt, 0, sizeof *TempPkt);
+        TempPkt->Type                              = FDPCMD_SEARCH_VIRTUAL_MEMORY;
+        TempPkt->CpuId                             = CpuId;
+        TempPkt->PatternSize                       = PatternSize;
+        TempPkt->StartOffset                       = StartOffset;
+        memcpy(TempPkt->PatternData, pPatternData, PatternSize);
+        ClientWrite(pFDP, pFDP->OutputBuffer, sizeof *TempPkt + PatternSize);
+        ClientRead(pFDP, (uint8_t*) &FoundAddress); // TODO: return success/fail !
+        bReturnCode = true;
+    }
+    UnlockSHM(pFDP->pSharedFDPSHM);
+    return bReturnCode;
+}
+
+namespace
+{
+    constexpr size_t cpu_ctx_none      = ~size_t(0);
+    constexpr size_t cpu_ctx_max_retry = 64;
+
+    size_t GetCpuCtxRegisterOffset(FDP_Register RegisterId)
+    {
+        switch(RegisterId)
+        {
+            case FDP_RIP_REGISTER: return offsetof(FDP_CPU_CTX, rip);
+            case FDP_RAX_REGISTER: return offsetof(FDP_CPU_CTX, rax);
+            case FDP_RCX_REGISTER: return offsetof(FDP_CPU_CTX, rcx);
+            case FDP_RDX_REGISTER: return offsetof(FDP_CPU_CTX, rdx);
+            case FDP_RBX_REGISTER: return offsetof(FDP_CPU_CTX, rbx);
+            case FDP_RSP_REGISTER: return offsetof(FDP_CPU_CTX, rsp);
+            case FDP_RBP_REGISTER: return offsetof(FDP_CPU_CTX, rbp);
+            case FDP_RSI_REGISTER: return offsetof(FDP_CPU_CTX, rsi);
+            case FDP_RDI_REGISTER: return offsetof(FDP_CPU_CTX, rdi);
+            case FDP_R8_REGISTER: return offsetof(FDP_CPU_CTX, r8);
+            case FDP_R9_REGISTER: return offsetof(FDP_CPU_CTX, r9);
+            case FDP_R10_REGISTER: return offsetof(FDP_CPU_CTX, r10);
+            case FDP_R11_REGISTER: return offsetof(FDP_CPU_CTX, r11);
+            case FDP_R12_REGISTER: return offsetof(FDP_CPU_CTX, r12);
+            case FDP_R13_REGISTER: return offsetof(FDP_CPU_CTX, r13);
+            case FDP_R14_REGISTER: return offsetof(FDP_CPU_CTX, r14);
+            case FDP_R15_REGISTER: return offsetof(FDP_CPU_CTX, r15);
+            case FDP_CS_REGISTER: return offsetof(FDP_CPU_CTX, cs);
+            case FDP_DS_REGISTER: return offsetof(FDP_CPU_CTX, ds);
+            case FDP_ES_REGISTER: return offsetof(FDP_CPU_CTX, es);
+            case FDP_FS_REGISTER: return offsetof(FDP_CPU_CTX, fs);
+            case FDP_GS_REGISTER: return offsetof(FDP_CPU_CTX, gs);
+            case FDP_SS_REGISTER: return offsetof(FDP_CPU_CTX, ss);
+            case FDP_RFLAGS_REGISTER: return offsetof(FDP_CPU_CTX, rflags);
+            case FDP_CR0_REGISTER: return offsetof(FDP_CPU_CTX, cr0);
+            case FDP_CR2_REGISTER: return offsetof(FDP_CPU_CTX, cr2);
+            case FDP_CR3_REGISTER: return offsetof(FDP_CPU_CTX, cr3);
+            case FDP_CR4_REGISTER: return offsetof(FDP_CPU_CTX, cr4);
+            case FDP_CR8_REGISTER: return offsetof(FDP_CPU_CTX, cr8);
+            case FDP_DR0_REGISTER: return offsetof(FDP_CPU_CTX, dr0);
+            case FDP_DR1_REGISTER: return offsetof(FDP_CPU_CTX, dr1);
+            case FDP_DR2_REGISTER: return offsetof(FDP_CPU_CTX, dr2);
+            case FDP_DR3_REGISTER: return offsetof(FDP_CPU_CTX, dr3);
+            case FDP_DR6_REGISTER: return offsetof(FDP_CPU_CTX, dr6);
+            case FDP_DR7_REGISTER: return offsetof(FDP_CPU_CTX, dr7);
+            case FDP_GDTRB_REGISTER: return offsetof(FDP_CPU_CTX, gdtr_base);
+            case FDP_GDTRL_REGISTER: return offsetof(FDP_CPU_CTX, gdtr_limit);
+            case FDP_IDTRB_REGISTER: return offsetof(FDP_CPU_CTX, idtr_base);
+            case FDP_IDTRL_REGISTER: return offsetof(FDP_CPU_CTX, idtr_limit);
+            case FDP_LDTR_REGISTER: return offsetof(FDP_CPU_CTX, ldtr);
+            case FDP_LDTRB_REGISTER: return offsetof(FDP_CPU_CTX, ldtr_base);
+            case FDP_LDTRL_REGISTER: return offsetof(FDP_CPU_CTX, ldtr_limit);
+            case FDP_TR_REGISTER: return offsetof(FDP_CPU_CTX, tr);
+            default: break;
+        }
+        return cpu_ctx_none;
+    }
+
+    size_t GetCpuCtxMsrOffset(uint64_t MsrId)
+    {
+        switch(MsrId)
+        {
+            case 0x174: return offsetof(FDP_CPU_CTX, sysenter_cs);         // IA32_SYSENTER_CS
+            case 0x175: return offsetof(FDP_CPU_CTX, sysenter_esp);        // IA32_SYSENTER_ESP
+            case 0x176: return offsetof(FDP_CPU_CTX, sysenter_eip);        // IA32_SYSENTER_EIP
+            case 0xC0000080: return offsetof(FDP_CPU_CTX, efer);           // IA32_EFER
+            case 0xC0000081: return offsetof(FDP_CPU_CTX, star);           // IA32_STAR
+            case 0xC0000082: return offsetof(FDP_CPU_CTX, lstar);          // IA32_LSTAR
+            case 0xC0000083: return offsetof(FDP_CPU_CTX, cstar);          // IA32_CSTAR
+            case 0xC0000084: return offsetof(FDP_CPU_CTX, sfmask);         // IA32_FMASK
+            case 0xC0000100: return offsetof(FDP_CPU_CTX, fs_base);        // IA32_FS_BASE
+            case 0xC0000101: return offsetof(FDP_CPU_CTX, gs_base);        // IA32_GS_BASE
+            case 0xC0000102: return offsetof(FDP_CPU_CTX, kernel_gs_base); // IA32_KERNEL_GS_BASE
+            default: break;
+        }
+        return cpu_ctx_none;
+    }
+
+    // seqlock read of one FDP_CPU_CTX field published by the server
+    bool ReadCpuCtx(FDP_SHM* pFDP, uint32_t CpuId, size_t Offset, uint64_t* pValue)
+    {
+        if(CpuId >= FDP_MAX_CPU || Offset == cpu_ctx_none || pFDP->pCpuShm == NULL || pFDP->pRecorder)
+            return false;
+
+        const auto pCpuCtx = &pFDP->pCpuShm[CpuId];
+        const auto pCtx    = (volatile uint8_t*) pCpuCtx;
+        for(size_t i = 0; i < cpu_ctx_max_retry; ++i)
+        {
+            const auto generation = pCpuCtx->generation;
+            if(!generation)
+                return false;
+
+            if(generation & 1)
+            {
+                PAUSE;
+                continue;
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t value;
+            memcpy(&value, (const void*) &pCtx[Offset], sizeof value);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(pCpuCtx->generation != generation)
+                continue;
+
+            *pValue = value;
+            return true;
+        }
+        return false;
+    }
+}
+
+FDP_EXPORTED
+bool FDP_ReadRegister(FDP_SHM* pFDP, uint32_t CpuId, FDP_Register RegisterId, uint64_t* pRegisterValue)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    // Fast way...
+    if(ReadCpuCtx(pFDP, CpuId, GetCpuCtxRegisterOffset(RegisterId), pRegisterValue))
+    {
+        CountFastRead(pFDP, &FDP_STATS_::CpuCtxReads);
+        return true;
+    }
+    // Old version => low performance
+    FDP_READ_REGISTER_PKT_REQ TempPkt = {};
+    TempPkt.Type       = FDPCMD_READ_REGISTER;
+    TempPkt.CpuId      = CpuId;
+    TempPkt.RegisterId = RegisterId;
+    RunCmd(pFDP, pRegisterValue, &TempPkt, sizeof TempPkt);
+    return true;
+}
+
+FDP_EXPORTED
+bool FDP_ReadMsr(FDP_SHM* pFDP, uint32_t CpuId, uint64_t MsrId, uint64_t* pMsrValue)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    if(ReadCpuCtx(pFDP, CpuId, GetCpuCtxMsrOffset(MsrId), pMsrValue))
+    {
+        CountFastRead(pFDP, &FDP_STATS_::CpuCtxReads);
+        return true;
+    }
+    FDP_READ_MSR_PKT_REQ TempPkt = {};
+    TempPkt.Type  = FDPCMD_READ_MSR;
+    TempPkt.CpuId = CpuId;
+    TempPkt.MsrId = MsrId;
+    RunCmd(pFDP, pMsrValue, &TempPkt, sizeof TempPkt);
+    return true;
+}
+
+FDP_EXPORTED
+bool FDP_WriteMsr(FDP_SHM* pFDP, uint32_t CpuId, uint64_t MsrId, uint64_t MsrValue)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    FDP_WRITE_MSR_PKT_REQ TempPkt = {};
+    TempPkt.Type     = FDPCMD_WRITE_MSR;
+    TempPkt.CpuId    = CpuId;
+    TempPkt.MsrId    = MsrId;
+    TempPkt.MsrValue = MsrValue;
+    return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
+}
+
+FDP_EXPORTED
+bool FDP_WriteRegister(FDP_SHM* pFDP, uint32_t CpuId, FDP_Register RegisterId, uint64_t RegisterValue)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    FDP_WRITE_REGISTER_PKT_REQ TempPkt = {};
+    TempPkt.Type          = FDPCMD_WRITE_REGISTER;
+    TempPkt.CpuId         = CpuId;
+    TempPkt.RegisterId    = RegisterId;
+    TempPkt.RegisterValue = RegisterValue;
+    return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
+}
+
+FDP_EXPORTED
+bool FDP_UnsetBreakpoint(FDP_SHM* pFDP, int BreakpointId)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    FDP_CLEAR_BREAKPOINT_PKT_REQ TempPkt = {};
+    TempPkt.Type         = FDPCMD_UNSET_BP;
+    TempPkt.BreakpointId = BreakpointId;
+    return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
+}
+
+// ids are -1 for breakpoints which failed
+FDP_EXPORTED
+bool FDP_SetBreakpoints(FDP_SHM* pFDP, const FDP_BREAKPOINT_T* pBreakpoints, uint32_t Count, int* pBreakpointIds)
+{
+    if(pFDP == NULL || pBreakpoints == NULL || pBreakpointIds == NULL)
+    {
+        return false;
+    }
+    bool bReturnValue = true;
+    for(uint32_t Offset = 0; Offset < Count; Offset += FDP_MAX_BREAKPOINT)
+    {
+        const uint32_t CurrentCount = std::min<uint32_t>(Count - Offset, FDP_MAX_BREAKPOINT);
+        const uint32_t AnswerSize   = CurrentCount * sizeof(int);
+        int*           pIds         = &pBreakpointIds[Offset];
+        bool           bStatus      = false;
+        LockSHM(pFDP->pSharedFDPSHM);
+        {
+            FDP_SET_BREAKPOINTS_PKT_REQ* TempPkt = (FDP_SET_BREAKPOINTS_PKT_REQ*) pFDP->OutputBuffer;
+            memset(TempPkt, 0, sizeof *TempPkt);
+            TempPkt->Type                        = FDPCMD_SET_BREAKPOINTS;
+            TempPkt->Count                       = CurrentCount;
+            memcpy(TempPkt->Breakpoints, &pBreakpoints[Offset], CurrentCount * sizeof *pBreakpoints);
+            ClientWrite(pFDP, pFDP->OutputBuffer, sizeof *TempPkt + CurrentCount * sizeof *pBreakpoints);
+            const uint32_t ReadSize = ClientReadWithStatus(pFDP, pFDP->InputBuffer, &bStatus);
+            bStatus                 = bStatus && ReadSize == AnswerSize;
+            if(bStatus)
+            {
+                memcpy(pIds, pFDP->InputBuffer, AnswerSize);
+            }
+        }
+        UnlockSHM(pFDP->pSharedFDPSHM);
+        for(uint32_t i = 0; i < CurrentCount; ++i)
+        {
+            if(!bStatus)
+            {
+                pIds[i] = -1;
+            }
+            bReturnValue &= pIds[i] >= 0;
+        }
+    }
+    return bReturnValue;
+}
+
+FDP_EXPORTED
+bool FDP_UnsetAllBreakpoints(FDP_SHM* pFDP)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    FDP_SIMPLE_PKT_REQ TempPkt = {};
+    TempPkt.Type = FDPCMD_UNSET_ALL_BREAKPOINTS;
+    return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
+}
+
+FDP_EXPORTED
+int FDP_SetBreakpoint(
+    FDP_SHM*           pFDP,
+    uint32_t           CpuId,
+    FDP_BreakpointType BreakpointType,
+    int                BreakpointId,
+    FDP_Access         BreakpointAccessType,
+    FDP_AddressType    BreakpointAddressType,
+    uint64_t           BreakpointAddress,
+    uint64_t           BreakpointLength,
+    uint64_t           BreakpointCr3)
+{
+    FDP_BREAKPOINT_T Breakpoint;
+    memset(&Breakpoint, 0, sizeof Breakpoint);
+    Breakpoint.CpuId                 = CpuId;
+    Breakpoint.BreakpointType        = BreakpointType;
+    Breakpoint.BreakpointId          = BreakpointId;
+    Breakpoint.BreakpointAccessType  = BreakpointAccessType;
+    Breakpoint.BreakpointAddressType = BreakpointAddressType;
+    Breakpoint.BreakpointAddress     = BreakpointAddress;
+    Breakpoint.BreakpointLength      = BreakpointLength;
+    Breakpoint.BreakpointCr3         = BreakpointCr3;
+    Breakpoint.Match.MatchType       = FDP_NO_MATCH;
+    return FDP_SetBreakpointEx(pFDP, &Breakpoint);
+}
+
+FDP_EXPORTED
+int FDP_SetBreakpointEx(FDP_SHM* pFDP, const FDP_BREAKPOINT_T* pBreakpoint)
+{
+    if(pFDP == NULL || pBreakpoint == NULL)
+    {
+        return -1;
+    }
+    int                        iReturnedBreakpointId = -1;
+    FDP_SET_BREAKPOINT_PKT_REQ TempPkt = {};
+    TempPkt.Type                  = FDPCMD_SET_BP;
+    TempPkt.CpuId                 = pBreakpoint->CpuId;
+    TempPkt.BreakpointType        = pBreakpoint->BreakpointType;
+    TempPkt.BreakpointId          = pBreakpoint->BreakpointId;
+    TempPkt.BreakpointAccessType  = pBreakpoint->BreakpointAccessType;
+    TempPkt.BreakpointAddressType = pBreakpoint->BreakpointAddressType;
+    TempPkt.BreakpointAddress     = pBreakpoint->BreakpointAddress;
+    TempPkt.BreakpointLength      = pBreakpoint->BreakpointLength;
+    TempPkt.BreakpointCr3         = pBreakpoint->BreakpointCr3;
+    TempPkt.Match                 = pBreakpoint->Match;
+    RunCmd(pFDP, &iReturnedBreakpointId, &TempPkt, sizeof TempPkt);
+    return iReturnedBreakpointId;
+}
+
+FDP_EXPORTED
+bool FDP_VirtualToPhysicalDtb(FDP_SHM* pFDP, uint32_t CpuId, uint64_t Dtb, uint64_t VirtualAddress, uint64_t* PhysicalAddress)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    FDP_VIRTUAL_PHYSICAL_PKT_REQ TempPkt = {};
+    TempPkt.Type           = FDPCMD_VIRTUAL_PHYSICAL;
+    TempPkt.CpuId          = CpuId;
+    TempPkt.Dtb            = Dtb;
+    TempPkt.VirtualAddress = VirtualAddress;
+    RunCmd(pFDP, PhysicalAddress, &TempPkt, sizeof TempPkt);
+    return true;
+}
+
+FDP_EXPORTED
+bool FDP_VirtualToPhysical(FDP_SHM* pFDP, uint32_t CpuId, uint64_t VirtualAddress, uint64_t* PhysicalAddress)
+{
+    return FDP_VirtualToPhysicalDtb(pFDP, CpuId, FDP_NO_CR3, VirtualAddress, PhysicalAddress);
+}
+
+FDP_EXPORTED
+bool FDP_TranslateVector(FDP_SHM* pFDP, uint32_t CpuId, uint64_t Dtb, FDP_TRANSLATE_T* pEntries, uint32_t EntryCount)
+{
+    if(pFDP == NULL || pEntries == NULL)
+    {
+        return false;
+    }
+    const uint32_t MaxCount     = (pFDP->CanalSize - 1) / (sizeof(uint64_t) + 1);
+    bool           bReturnValue = true;
+    for(uint32_t Offset = 0; Offset < EntryCount; Offset += MaxCount)
+    {
+        const uint32_t   CurrentCount = std::min<uint32_t>(EntryCount - Offset, MaxCount);
+        const uint32_t   AnswerSize   = CurrentCount * (sizeof(uint64_t) + 1);
+        FDP_TRANSLATE_T* pCurrent     = &pEntries[Offset];
+        bool             bStatus      = false;
+        LockSHM(pFDP->pSharedFDPSHM);
+        {
+            FDP_TRANSLATE_VECTOR_PKT_REQ* TempPkt = (FDP_TRANSLATE_VECTOR_PKT_REQ*) pFDP->OutputBuffer;
+            memset(TempPkt, 0, sizeof *TempPkt);
+            TempPkt->Type                         = FDPCMD_TRANSLATE_VECTOR;
+            TempPkt->CpuId                        = CpuId;
+            TempPkt->Dtb                          = Dtb;
+            TempPkt->EntryCount                   = CurrentCount;
+            for(uint32_t i = 0; i < CurrentCount; ++i)
+            {
+                TempPkt->VirtualAddresses[i] = pCurrent[i].VirtualAddress;
+            }
+            ClientWrite(pFDP, pFDP->OutputBuffer, sizeof *TempPkt + CurrentCount * sizeof(uint64_t));
+            const uint32_t ReadSize = ClientReadWithStatus(pFDP, pFDP->InputBuffer, &bStatus);
+            bStatus                 = bStatus && ReadSize == AnswerSize;
+        }
+        UnlockSHM(pFDP->pSharedFDPSHM);
+
+        const uint8_t* pFlags = pFDP->InputBuffer + CurrentCount * sizeof(uint64_t);
+        for(uint32_t i = 0; i < CurrentCount; ++i)
+        {
+            pCurrent[i].PhysicalAddress = 0;
+            pCurrent[i].Flags           = 0;
+            if(bStatus)
+            {
+                memcpy(&pCurrent[i].PhysicalAddress, &pFDP->InputBuffer[i * sizeof(uint64_t)], sizeof(uint64_t));
+                pCurrent[i].Flags = pFlags[i];
+            }
+            bReturnValue &= !!(pCurrent[i].Flags & FDP_TRANSLATE_PRESENT);
+        }
+    }
+    return bReturnValue;
+}
+
+FDP_EXPORTED
+bool FDP_GetState(FDP_SHM* pFDP, FDP_State* DebuggeeState)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    FDP_GET_STATE_PKT_REQ TempPkt = {};
+    TempPkt.Type = FDPCMD_GET_STATE;
+    RunCmd(pFDP, DebuggeeState, &TempPkt, sizeof TempPkt);
+    return true;
+}
+
+namespace
+{
+    // only valid while the server is not using the canal
+    void ResetCanal(FDP_SHM_CANAL* pCanal)
+    {
+        pCanal->dataSize = 0;
+        pCanal->bStatus  = false;
+        pCanal->writeSeq = 0;
+        pCanal->readSeq  = 0;
+    }
+
+    // only valid while the server is not using the ring, keeps peers sleeping on completed
+    void ResetRing(FDP_SHM_RING* pRing)
+    {
+        pRing->lock        = false;
+        pRing->submitIndex = 0;
+        pRing->serverIndex = 0;
+        pRing->completed   = 0;
+        for(auto& Slot : pRing->slots)
+        {
+            Slot.state    = FDP_RING_SLOT_FREE;
+            Slot.dataSize = 0;
+            Slot.bStatus  = false;
+        }
+    }
+
+    // sleep until stateChangedSeq moves away from seq or timeout
+    void WaitStateChangedSeq(FDP_SHM_SHARED* pShared, uint32_t seq, std::chrono::nanoseconds timeout)
+    {
+#ifdef __linux__
+        futex_wait_for(&pShared->stateChangedSeq, seq, timeout);
+#else
+        (void) timeout;
+        if(pShared->stateChangedSeq == seq)
+            std::this_thread::yield();
+#endif
+    }
+
+    bool WaitForStateChanged(FDP_SHM* pFDP, std::chrono::nanoseconds timeout)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while(true)
+        {
+            // read seq first so a change between the check & the wait is not lost
+            const auto seq = pFDP->pSharedFDPSHM->stateChangedSeq.load();
+            if(FDP_GetStateChanged(pFDP) == true)
+            {
+                return true;
+            }
+            const auto now = std::chrono::steady_clock::now();
+            if(now >= deadline)
+            {
+                return false;
+            }
+            WaitStateChangedSeq(pFDP->pSharedFDPSHM, seq, deadline - now);
+        }
+    }
+}
+
+FDP_EXPORTED
+bool FDP_WaitForStateChanged(FDP_SHM* pFDP, FDP_State* DebuggeeState)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    while(!WaitForStateChanged(pFDP, std::chrono::hours(1)))
+    {
+        continue;
+    }
+    return FDP_GetState(pFDP, DebuggeeState);
+}
+
+// returns false on timeout
+FDP_EXPORTED
+bool FDP_WaitForStateChangedTimeout(FDP_SHM* pFDP, FDP_State* pState, uint32_t TimeoutMs)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    if(!WaitForStateChanged(pFDP, std::chrono::milliseconds(TimeoutMs)))
+    {
+        return false;
+    }
+    return FDP_GetState(pFDP, pState);
+}
+
+FDP_EXPORTED
+bool FDP_Init(FDP_SHM* pFDP)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    bool bReturnValue = true;
+    // drop what a previous client left, keep version, flags & peers sleeping on a canal
+    auto* pShared = pFDP->pSharedFDPSHM;
+
+    pShared->lock         = false;
+    pShared->stateChanged = false;
+    ResetCanal(&pShared->ClientToServer);
+    ResetCanal(&pShared->ServerToClient);
+    ResetRing(&pShared->Ring);
+    return bReturnValue;
+}
+
+FDP_EXPORTED
+bool FDP_SingleStep(FDP_SHM* pFDP, uint32_t CpuId)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    FDP_SINGLE_STEP_PKT_REQ TempPkt = {};
+    TempPkt.Type  = FDPCMD_SINGLE_STEP;
+    TempPkt.CpuId = CpuId;
+    return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
+}
+
+uint8_t FDP_Test(FDP_SHM* pFDP)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    uint8_t DebuggeState;
+    LockSHM(pFDP->pSharedFDPSHM);
+    {
+        FDP_GET_STATE_PKT_REQ* tmpPkt = (FDP_GET_STATE_PKT_REQ*) pFDP->OutputBuffer;
+        memset(tmpPkt, 0, sizeof *tmpPkt);
+        tmpPkt->Type                  = FDPCMD_TEST;
+        ClientWrite(pFDP, pFDP->OutputBuffer, sizeof *tmpPkt);
+        ClientRead(pFDP, (uint8_t*) &DebuggeState); // TODO: return success/fail !
+    }
+    UnlockSHM(pFDP->pSharedFDPSHM);
+    return DebuggeState;
+}
+
+FDP_EXPORTED
+bool FDP_GetFxState64(FDP_SHM* pFDP, uint32_t CpuId, FDP_XSAVE_FORMAT64_T* pFxState)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    LockSHM(pFDP->pSharedFDPSHM);
+    {
+        FDP_GET_STATE_PKT_REQ* TempPkt = (FDP_GET_STATE_PKT_REQ*) pFDP->OutputBuffer;
+        memset(TempPkt, 0, sizeof *TempPkt);
+        TempPkt->Type                  = FDPCMD_GET_FXSTATE;
+        TempPkt->CpuId                 = CpuId;
+        ClientWrite(pFDP, pFDP->OutputBuffer, sizeof *TempPkt);
+        ClientRead(pFDP, (uint8_t*) pFxState); // TODO: return success/fail !
+    }
+    UnlockSHM(pFDP->pSharedFDPSHM);
+    return true;
+}
+
+FDP_EXPORTED
+bool FDP_SetFxState64(FDP_SHM* pFDP, uint32_t CpuId, FDP_XSAVE_FORMAT64_T* pFxState64)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    bool bReturnValue = false;
+    LockSHM(pFDP->pSharedFDPSHM);
+    {
+        FDP_SET_FX_STATE_REQ* TempPkt = (FDP_SET_FX_STATE_REQ*) pFDP->OutputBuffer;
+        memset(TempPkt, 0, sizeof *TempPkt);
+        TempPkt->Type                 = FDPCMD_SET_FXSTATE;
+        TempPkt->CpuId                = CpuId;
+        memcpy(&TempPkt->FxState64, pFxState64, sizeof *pFxState64);
+        ClientWrite(pFDP, pFDP->OutputBuffer, sizeof *TempPkt);
+        ClientRead(pFDP, (uint8_t*) &bReturnValue); // TODO: return success/fail !
+    }
+    UnlockSHM(pFDP->pSharedFDPSHM);
+    return bReturnValue;
+}
+
+FDP_EXPORTED
+bool FDP_GetPhysicalMemorySize(FDP_SHM* pFDP, uint64_t* PhysicalMemorySize)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    bool               bReturnValue = true;
+    FDP_SIMPLE_PKT_REQ TempPkt = {};
+    TempPkt.Type = FDPCMD_GET_MEMORYSIZE;
+    RunCmd(pFDP, PhysicalMemorySize, &TempPkt, sizeof TempPkt);
+    // TODO return bool !
+    return bReturnValue;
+}
+
+FDP_EXPORTED
+bool FDP_GetCpuCount(FDP_SHM* pFDP, uint32_t* CPUCount)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    bool               bReturnValue = true;
+    FDP_SIMPLE_PKT_REQ TempPkt = {};
+    TempPkt.Type = FDPCMD_GET_CPU_COUNT;
+    RunCmd(pFDP, CPUCount, &TempPkt, sizeof TempPkt);
+    return bReturnValue;
+}
+
+FDP_EXPORTED
+bool FDP_GetCpuState(FDP_SHM* pFDP, uint32_t CpuId, FDP_State* pDebuggeeState)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    FDP_GET_CPU_STATE_PKT_REQ TempPkt = {};
+    TempPkt.Type  = FDPCMD_GET_CPU_STATE;
+    TempPkt.CpuId = CpuId;
+    RunCmd(pFDP, pDebuggeeState, &TempPkt, sizeof TempPkt);
+    return true;
+}
+
+FDP_EXPORTED
+bool FDP_Save(FDP_SHM* pFDP)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    FDP_SIMPLE_PKT_REQ TempPkt = {};
+    TempPkt.Type = FDPCMD_SAVE;
+    return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
+}
+
+FDP_EXPORTED
+bool FDP_Restore(FDP_SHM* pFDP)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    FDP_SIMPLE_PKT_REQ TempPkt = {};
+    TempPkt.Type = FDPCMD_RESTORE;
+    return CheckRunCmd(pFDP, &TempPkt, sizeof TempPkt);
+}
+
+FDP_EXPORTED
+bool FDP_GetStateChanged(FDP_SHM* pFDP)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    const bool StateChanged = pFDP->pSharedFDPSHM->stateChanged.exchange(false);
+    if(StateChanged && pFDP->pRecorder)
+    {
+        // ordered with recorded commands by the SHM lock
+        LockSHM(pFDP->pSharedFDPSHM);
+        if(pFDP->pRecorder)
+        {
+            fwrite(&record_state_changed, sizeof record_state_changed, 1, pFDP->pRecorder->pFile);
+        }
+        UnlockSHM(pFDP->pSharedFDPSHM);
+    }
+    return StateChanged;
+}
+
+FDP_EXPORTED
+void FDP_SetStateChanged(FDP_SHM* pFDP)
+{
+    if(pFDP == NULL)
+    {
+        return;
+    }
+    // flag first, waiters read the seq before checking it
+    pFDP->pSharedFDPSHM->stateChanged = true;
+    pFDP->pSharedFDPSHM->stateChangedSeq++;
+#ifdef __linux__
+    // state changes are rare, always wake
+    futex_wake(&pFDP->pSharedFDPSHM->stateChangedSeq);
+#endif
+    return;
+}
+
+FDP_EXPORTED
+bool FDP_InjectInterrupt(FDP_SHM* pFDP, uint32_t CpuId, uint32_t uInterruptionCode, uint32_t uErrorCode,
+                         uint64_t Cr2Value)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    bool bReturnValue = false;
+    LockSHM(pFDP->pSharedFDPSHM);
+    {
+        FDP_INJECT_INTERRUPT_PKT_REQ* tmpPkt = (FDP_INJECT_INTERRUPT_PKT_REQ*) pFDP->OutputBuffer;
+        memset(tmpPkt, 0, sizeof *tmpPkt);
+        tmpPkt->Type                         = FDPCMD_INJECT_INTERRUPT;
+        tmpPkt->CpuId                        = CpuId;
+        tmpPkt->Cr2Value                     = Cr2Value;
+        tmpPkt->ErrorCode                    = uErrorCode;
+        tmpPkt->InterruptionCode             = uInterruptionCode;
+        ClientWrite(pFDP, pFDP->OutputBuffer, sizeof *tmpPkt);
+        ClientRead(pFDP, (uint8_t*) &bReturnValue); // TODO: return success/fail !
+    }
+    UnlockSHM(pFDP->pSharedFDPSHM);
+    return bReturnValue;
+}
+
+namespace
+{
+    enum
+    {
+        FDP_RING_ANSWER_DATA, // answer is copied to pDst, must be DstSize bytes
+        FDP_RING_ANSWER_BOOL, // answer is a single bool
+    };
+
+    bool RingSubmit(FDP_SHM* pFDP, const void* pSrc, uint32_t SrcSize, void* pDst, uint32_t DstSize, uint8_t AnswerType, uint32_t* pTag)
+    {
+        if(SrcSize > FDP_RING_SLOT_DATA_SIZE || DstSize > FDP_RING_SLOT_DATA_SIZE)
+        {
+            return false;
+        }
+        FDP_SHM_RING* pRing   = &pFDP->pSharedFDPSHM->Ring;
+        bool          bQueued = false;
+        ttas_spinlock_lock(&pRing->lock);
+        {
+            const uint32_t     Index = pRing->submitIndex.load(std::memory_order_relaxed);
+            FDP_SHM_RING_SLOT* pSlot = &pRing->slots[Index % FDP_RING_SLOT_COUNT];
+            if(pSlot->state.load(std::memory_order_acquire) == FDP_RING_SLOT_FREE)
+            {
+                // tag 0 marks slots this client is not waiting on
+                if(++pFDP->RingNextTag == 0)
+                {
+                    pFDP->RingNextTag = 1;
+                }
+                FDP_RING_REQUEST* pRequest = &pFDP->aRingRequests[Index % FDP_RING_SLOT_COUNT];
+                pRequest->pDst             = pDst;
+                pRequest->DstSize          = DstSize;
+                pRequest->Tag              = pFDP->RingNextTag;
+                pRequest->AnswerType       = AnswerType;
+                memcpy((char*) pSlot->data, pSrc, SrcSize);
+                pSlot->dataSize = SrcSize;
+                pSlot->state.store(FDP_RING_SLOT_SUBMITTED, std::memory_order_release);
+                pRing->submitIndex.store(Index + 1, std::memory_order_relaxed);
+                *pTag   = pRequest->Tag;
+                bQueued = true;
+            }
+        }
+        ttas_spinlock_unlock(&pRing->lock);
+        if(bQueued)
+        {
+            ring_doorbell(&pFDP->pSharedFDPSHM->ClientToServer);
+        }
+        return bQueued;
+    }
+
+    // collect one completed command, oldest first
+    // under the ring lock, so concurrent polls never return a tag twice
+    // & never free a slot a concurrent submit is refilling
+    bool RingCollect(FDP_SHM* pFDP, uint32_t* pTag, bool* pbSuccess, bool* pbPending)
+    {
+        FDP_SHM_RING* pRing      = &pFDP->pSharedFDPSHM->Ring;
+        bool          bCollected = false;
+        *pbPending               = false;
+        ttas_spinlock_lock(&pRing->lock);
+        {
+            const uint32_t First = pRing->submitIndex.load(std::memory_order_relaxed);
+            for(uint32_t i = 0; i < FDP_RING_SLOT_COUNT; ++i)
+            {
+                const uint32_t    Index    = (First + i) % FDP_RING_SLOT_COUNT;
+                FDP_RING_REQUEST* pRequest = &pFDP->aRingRequests[Index];
+                if(pRequest->Tag == 0)
+                {
+                    continue;
+                }
+                FDP_SHM_RING_SLOT* pSlot = &pRing->slots[Index];
+                if(pSlot->state.load(std::memory_order_acquire) != FDP_RING_SLOT_COMPLETED)
+                {
+                    *pbPending = true;
+                    continue;
+                }
+                bool bSuccess = pSlot->bStatus;
+                if(pRequest->AnswerType == FDP_RING_ANSWER_BOOL)
+                {
+                    bSuccess = bSuccess && pSlot->dataSize >= 1 && pSlot->data[0];
+                }
+                else if(bSuccess && pSlot->dataSize == pRequest->DstSize)
+                {
+                    memcpy(pRequest->pDst, (char*) pSlot->data, pRequest->DstSize);
+                }
+                else
+                {
+                    bSuccess = false;
+                }
+                *pTag         = pRequest->Tag;
+                *pbSuccess    = bSuccess;
+                pRequest->Tag = 0;
+                pSlot->state.store(FDP_RING_SLOT_FREE, std::memory_order_release);
+                bCollected = true;
+                break;
+            }
+        }
+        ttas_spinlock_unlock(&pRing->lock);
+        return bCollected;
+    }
+}
+
+FDP_EXPORTED
+bool FDP_SubmitReadPhysicalMemory(FDP_SHM* pFDP, uint8_t* pDstBuffer, uint32_t ReadSize, uint64_t PhysicalAddress, uint32_t* pTag)
+{
+    if(pFDP == NULL || pTag == NULL || ReadSize == 0)
+    {
+        return false;
+    }
+    FDP_READ_PHYSICAL_MEMORY_PKT_REQ TempPkt = {};
+    TempPkt.Type            = FDPCMD_READ_PHYSICAL;
+    TempPkt.CpuId           = 0;
+    TempPkt.PhysicalAddress = PhysicalAddress;
+    TempPkt.ReadSize        = ReadSize;
+    return RingSubmit(pFDP, &TempPkt, sizeof TempPkt, pDstBuffer, ReadSize, FDP_RING_ANSWER_DATA, pTag);
+}
+
+FDP_EXPORTED
+bool FDP_SubmitReadVirtualMemory(FDP_SHM* pFDP, uint32_t CpuId, uint64_t Dtb, uint8_t* pDstBuffer, uint32_t ReadSize,
+                                 uint64_t VirtualAddress, uint32_t* pTag)
+{
+    if(pFDP == NULL || pTag == NULL || ReadSize == 0)
+    {
+        return false;
+    }
+    FDP_READ_VIRTUAL_MEMORY_PKT_REQ TempPkt = {};
+    TempPkt.Type           = FDPCMD_READ_VIRTUAL;
+    TempPkt.CpuId          = CpuId;
+    TempPkt.Dtb            = Dtb;
+    TempPkt.VirtualAddress = VirtualAddress;
+    TempPkt.ReadSize       = ReadSize;
+    return RingSubmit(pFDP, &TempPkt, sizeof TempPkt, pDstBuffer, ReadSize, FDP_RING_ANSWER_DATA, pTag);
+}
+
+FDP_EXPORTED
+bool FDP_SubmitReadRegister(FDP_SHM* pFDP, uint32_t CpuId, FDP_Register RegisterId, uint64_t* pRegisterValue, uint32_t* pTag)
+{
+    if(pFDP == NULL || pTag == NULL)
+    {
+        return false;
+    }
+    FDP_READ_REGISTER_PKT_REQ TempPkt = {};
+    TempPkt.Type       = FDPCMD_READ_REGISTER;
+    TempPkt.CpuId      = CpuId;
+    TempPkt.RegisterId = RegisterId;
+    return RingSubmit(pFDP, &TempPkt, sizeof TempPkt, pRegisterValue, sizeof *pRegisterValue, FDP_RING_ANSWER_DATA, pTag);
+}
+
+FDP_EXPORTED
+bool FDP_SubmitReadMsr(FDP_SHM* pFDP, uint32_t CpuId, uint64_t MsrId, uint64_t* pMsrValue, uint32_t* pTag)
+{
+    if(pFDP == NULL || pTag == NULL)
+    {
+        return false;
+    }
+    FDP_READ_MSR_PKT_REQ TempPkt = {};
+    TempPkt.Type  = FDPCMD_READ_MSR;
+    TempPkt.CpuId = CpuId;
+    TempPkt.MsrId = MsrId;
+    return RingSubmit(pFDP, &TempPkt, sizeof TempPkt, pMsrValue, sizeof *pMsrValue, FDP_RING_ANSWER_DATA, pTag);
+}
+
+FDP_EXPORTED
+bool FDP_SubmitWriteRegister(FDP_SHM* pFDP, uint32_t CpuId, FDP_Register RegisterId, uint64_t RegisterValue, uint32_t* pTag)
+{
+    if(pFDP == NULL || pTag == NULL)
+    {
+        return false;
+    }
+    FDP_WRITE_REGISTER_PKT_REQ TempPkt = {};
+    TempPkt.Type          = FDPCMD_WRITE_REGISTER;
+    TempPkt.CpuId         = CpuId;
+    TempPkt.RegisterId    = RegisterId;
+    TempPkt.RegisterValue = RegisterValue;
+    return RingSubmit(pFDP, &TempPkt, sizeof TempPkt, NULL, 0, FDP_RING_ANSWER_BOOL, pTag);
+}
+
+FDP_EXPORTED
+bool FDP_SubmitSetBreakpoint(
+    FDP_SHM*           pFDP,
+    uint32_t           CpuId,
+    FDP_BreakpointType BreakpointType,
+    int                BreakpointId,
+    FDP_Access         BreakpointAccessType,
+    FDP_AddressType    BreakpointAddressType,
+    uint64_t           BreakpointAddress,
+    uint64_t           BreakpointLength,
+    uint64_t           BreakpointCr3,
+    int*               pBreakpointId,
+    uint32_t*          pTag)
+{
+    if(pFDP == NULL || pBreakpointId == NULL || pTag == NULL)
+    {
+        return false;
+    }
+    FDP_SET_BREAKPOINT_PKT_REQ TempPkt = {};
+    TempPkt.Type                  = FDPCMD_SET_BP;
+    TempPkt.CpuId                 = CpuId;
+    TempPkt.BreakpointType        = BreakpointType;
+    TempPkt.BreakpointId          = BreakpointId;
+    TempPkt.BreakpointAccessType  = BreakpointAccessType;
+    TempPkt.BreakpointAddressType = BreakpointAddressType;
+    TempPkt.BreakpointAddress     = BreakpointAddress;
+    TempPkt.BreakpointLength      = BreakpointLength;
+    TempPkt.BreakpointCr3         = BreakpointCr3;
+    TempPkt.Match.MatchType       = FDP_NO_MATCH;
+    TempPkt.Match.MatchAddress    = 0;
+    TempPkt.Match.MatchValue      = 0;
+    return RingSubmit(pFDP, &TempPkt, sizeof TempPkt, pBreakpointId, sizeof *pBreakpointId, FDP_RING_ANSWER_DATA, pTag);
+}
+
+FDP_EXPORTED
+bool FDP_SubmitUnsetBreakpoint(FDP_SHM* pFDP, int BreakpointId, uint32_t* pTag)
+{
+    if(pFDP == NULL || pTag == NULL)
+    {
+        return false;
+    }
+    FDP_CLEAR_BREAKPOINT_PKT_REQ TempPkt = {};
+    TempPkt.Type         = FDPCMD_UNSET_BP;
+    TempPkt.BreakpointId = BreakpointId;
+    return RingSubmit(pFDP, &TempPkt, sizeof TempPkt, NULL, 0, FDP_RING_ANSWER_BOOL, pTag);
+}
+
+// returns false on timeout or when nothing is pending
+FDP_EXPORTED
+bool FDP_Poll(FDP_SHM* pFDP, uint32_t TimeoutMs, uint32_t* pTag, bool* pbSuccess)
+{
+    if(pFDP == NULL || pTag == NULL || pbSuccess == NULL)
+    {
+        return false;
+    }
+    FDP_SHM_RING* pRing     = &pFDP->pSharedFDPSHM->Ring;
+    const auto    deadline  = std::chrono::steady_clock::now() + std::chrono::milliseconds(TimeoutMs);
+    size_t        num_iters = 0;
+    while(true)
+    {
+        // read completed first so a completion between the scan & the wait is not lost
+        const uint32_t Completed = pRing->completed.load();
+        bool           bPending  = false;
+        if(RingCollect(pFDP, pTag, pbSuccess, &bPending))
+        {
+            return true;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if(!bPending || now >= deadline)
+        {
+            return false;
+        }
+#ifdef __linux__
+        if(pFDP->pSharedFDPSHM->flags & FDP_SHM_FLAG_FUTEX_WAIT)
+        {
+            pRing->waiters.fetch_add(1);
+            futex_wait_for(&pRing->completed, Completed, deadline - now);
+            pRing->waiters.fetch_sub(1);
+            continue;
+        }
+#else
+        (void) Completed;
+#endif
+        if(num_iters < max_wait_iters)
+        {
+            ++num_iters;
+            PAUSE;
+        }
+        else
+        {
+            yield_sleep();
+        }
+    }
+}
+
+// Server Part
+static bool ServerReadMemory(FDP_SHM* pFDP, uint32_t CpuId, FDP_AddressType AddressType, uint64_t Dtb, uint64_t Address, uint32_t ReadSize, uint8_t* pDstBuffer)
+{
+    FDP_SERVER_INTERFACE_T* pServer = pFDP->pFdpServer;
+    switch(AddressType)
+    {
+        case FDP_PHYSICAL_ADDRESS:
+            return pServer->pfnReadPhysicalMemory(pServer->pUserHandle, pDstBuffer, Address, ReadSize);
+
+        case FDP_VIRTUAL_ADDRESS:
+            if(Dtb == FDP_NO_CR3)
+            {
+                return pServer->pfnReadVirtualMemory(pServer->pUserHandle, CpuId, Address, ReadSize, pDstBuffer);
+            }
+            if(pServer->pfnReadVirtualMemoryDtb == NULL)
+            {
+                return false;
+            }
+            return pServer->pfnReadVirtualMemoryDtb(pServer->pUserHandle, CpuId, Dtb, Address, ReadSize, pDstBuffer);
+
+        default:
+            return false;
+    }
+}
+
+// fill every readable page & zero the others, see FDPCMD_READ_VIRTUAL_PARTIAL
+static uint32_t ServerReadVirtualPartial(FDP_SHM* pFDP, const FDP_READ_VIRTUAL_MEMORY_PKT_REQ* pReq, uint32_t u32OutputCapacity, bool* pbStatus)
+{
+    const uint32_t PageSize   = 0x1000;
+    const uint32_t PageOffset = (uint32_t)(pReq->VirtualAddress & (PageSize - 1));
+    const uint64_t PageCount  = ((uint64_t) PageOffset + pReq->ReadSize + PageSize - 1) / PageSize;
+    const uint64_t AnswerSize = pReq->ReadSize + (PageCount + 7) / 8;
+    if(!pReq->ReadSize || AnswerSize > u32OutputCapacity)
+    {
+        *pbStatus = false;
+        return 1;
+    }
+    uint8_t* pData   = pFDP->OutputBuffer;
+    uint8_t* pFaults = pFDP->OutputBuffer + pReq->ReadSize;
+    memset(pFaults, 0, (size_t)(PageCount + 7) / 8);
+    *pbStatus = true;
+    // most reads are fully mapped, only split them on failure
+    if(ServerReadMemory(pFDP, pReq->CpuId, FDP_VIRTUAL_ADDRESS, pReq->Dtb, pReq->VirtualAddress, pReq->ReadSize, pData))
+    {
+        return (uint32_t) AnswerSize;
+    }
+    uint32_t Offset = 0;
+    for(uint32_t Page = 0; Page < PageCount; ++Page)
+    {
+        const uint32_t Size = std::min<uint32_t>(pReq->ReadSize - Offset, PageSize - (Page ? 0 : PageOffset));
+        if(!ServerReadMemory(pFDP, pReq->CpuId, FDP_VIRTUAL_ADDRESS, pReq->Dtb, pReq->VirtualAddress + Offset, Size, pData + Offset))
+        {
+            memset(pData + Offset, 0, Size);
+            pFaults[Page / 8] |= (uint8_t)(1 << (Page % 8));
+        }
+        Offset += Size;
+    }
+    return (uint32_t) AnswerSize;
+}
+
+// 4-level long mode page walk through guest physical memory
+static bool ServerTranslate(FDP_SHM* pFDP, uint32_t CpuId, uint64_t Dtb, uint64_t VirtualAddress, uint64_t* pPhysicalAddress, uint8_t* pFlags)
+{
+    const uint64_t          PhysicalMask = 0x000FFFFFFFFFF000ULL;
+    FDP_SERVER_INTERFACE_T* pServer      = pFDP->pFdpServer;
+    if(Dtb == FDP_NO_CR3 && !pServer->pfnReadRegister(pServer->pUserHandle, CpuId, FDP_CR3_REGISTER, &Dtb))
+    {
+        return false;
+    }
+    // non canonical addresses are never mapped
+    const uint64_t Canonical = (uint64_t)(((int64_t)(VirtualAddress << 16)) >> 16);
+    if(Canonical != VirtualAddress)
+    {
+        return false;
+    }
+    uint64_t Table = Dtb & PhysicalMask;
+    for(int Level = 3; Level >= 0; --Level)
+    {
+        const uint32_t Shift = 12 + 9 * Level;
+        const uint64_t Index = (VirtualAddress >> Shift) & 0x1FF;
+        uint64_t       Entry = 0;
+        if(!pServer->pfnReadPhysicalMemory(pServer->pUserHandle, (uint8_t*) &Entry, Table + Index * sizeof Entry, sizeof Entry))
+        {
+            return false;
+        }
+        if(!(Entry & 0x1))
+        {
+            return false;
+        }
+        // page size bit on pdpt & pd entries
+        const bool bLargePage = Level == 1 || Level == 2 ? !!(Entry & 0x80) : false;
+        if(Level == 0 || bLargePage)
+        {
+            const uint64_t PageMask = (1ULL << Shift) - 1;
+            *pPhysicalAddress       = (Entry & PhysicalMask & ~PageMask) | (VirtualAddress & PageMask);
+            *pFlags                 = FDP_TRANSLATE_PRESENT | (bLargePage ? FDP_TRANSLATE_LARGE_PAGE : 0);
+            return true;
+        }
+        Table = Entry & PhysicalMask;
+    }
+    return false;
+}
+
+static bool ServerWriteVirtualMemory(FDP_SHM* pFDP, uint32_t CpuId, uint64_t Dtb, uint8_t* pSrcBuffer, uint64_t VirtualAddress, uint32_t WriteSize)
+{
+    FDP_SERVER_INTERFACE_T* pServer = pFDP->pFdpServer;
+    if(Dtb == FDP_NO_CR3)
+    {
+        return pServer->pfnWriteVirtualMemory(pServer->pUserHandle, CpuId, pSrcBuffer, VirtualAddress, WriteSize);
+    }
+    if(pServer->pfnWriteVirtualMemoryDtb == NULL)
+    {
+        return false;
+    }
+    return pServer->pfnWriteVirtualMemoryDtb(pServer->pUserHandle, CpuId, Dtb, pSrcBuffer, VirtualAddress, WriteSize);
+}
+
+static bool ServerVirtualToPhysical(FDP_SHM* pFDP, uint32_t CpuId, uint64_t Dtb, uint64_t VirtualAddress, uint64_t* pPhysicalAddress)
+{
+    FDP_SERVER_INTERFACE_T* pServer = pFDP->pFdpServer;
+    if(Dtb == FDP_NO_CR3)
+    {
+        return pServer->pfnVirtualToPhysical(pServer->pUserHandle, CpuId, VirtualAddress, pPhysicalAddress);
+    }
+    if(pServer->pfnVirtualToPhysicalDtb == NULL)
+    {
+        return false;
+    }
+    return pServer->pfnVirtualToPhysicalDtb(pServer->pUserHandle, CpuId, Dtb, VirtualAddress, pPhysicalAddress);
+}
+
+namespace
+{
+    uint64_t AlignRamShmSize(uint64_t Size)
+    {
+        return (Size + FDP_RAM_SHM_DATA_OFFSET - 1) & ~(uint64_t)(FDP_RAM_SHM_DATA_OFFSET - 1);
+    }
+
+    uint32_t GetServerPhysicalRanges(FDP_SHM* pFDP, FDP_PHYSICAL_RANGE_T* pRanges)
+    {
+        FDP_SERVER_INTERFACE_T* pServer = pFDP->pFdpServer;
+        if(pServer->pfnGetPhysicalRanges != NULL)
+        {
+            uint32_t RangeCount = FDP_MAX_PHYSICAL_RANGES;
+            if(!pServer->pfnGetPhysicalRanges(pServer->pUserHandle, pRanges, &RangeCount))
+            {
+                return 0;
+            }
+            return std::min<uint32_t>(RangeCount, FDP_MAX_PHYSICAL_RANGES);
+        }
+        if(pServer->pfnGetMemorySize == NULL || !pServer->pfnGetMemorySize(pServer->pUserHandle, &pRanges[0].Size))
+        {
+            return 0;
+        }
+        pRanges[0].PhysicalAddress = 0;
+        return 1;
+    }
+
+    bool IsRamShmStaleAfter(uint8_t Type)
+    {
+        switch(Type)
+        {
+            case FDPCMD_RESUME_VM:
+            case FDPCMD_SINGLE_STEP:
+            case FDPCMD_REBOOT:
+            case FDPCMD_SAVE:
+            case FDPCMD_RESTORE:
+            case FDPCMD_WRITE_VIRTUAL:
+            case FDPCMD_SET_BP:
+            case FDPCMD_UNSET_BP:
+            case FDPCMD_SET_BREAKPOINTS:
+            case FDPCMD_UNSET_ALL_BREAKPOINTS:
+            case FDPCMD_RESTORE_SLOT:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+    void InvalidateRamShm(FDP_SHM* pFDP)
+    {
+        FDP_RAM_SHM* pRam = pFDP->pRamShm;
+        if(pRam == NULL || pRam->generation & 1)
+        {
+            return;
+        }
+        pRam->generation = pRam->generation + 1;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    // keep a published snapshot in sync with physical writes
+    void UpdateRamShm(FDP_SHM* pFDP, const uint8_t* pSrcBuffer, uint32_t WriteSize, uint64_t PhysicalAddress)
+    {
+        FDP_RAM_SHM* pRam = pFDP->pRamShm;
+        if(pRam == NULL || pRam->generation & 1)
+        {
+            return;
+        }
+        pRam->generation = pRam->generation + 1;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for(uint32_t i = 0; i < pRam->rangeCount; ++i)
+        {
+            const FDP_RAM_RANGE* pRange = &pRam->ranges[i];
+            const uint64_t       Start  = std::max(PhysicalAddress, pRange->PhysicalAddress);
+            const uint64_t       End    = std::min(PhysicalAddress + WriteSize, pRange->PhysicalAddress + pRange->Size);
+            if(Start < End)
+            {
+                memcpy((uint8_t*) pRam + pRange->Offset + (Start - pRange->PhysicalAddress),
+                       pSrcBuffer + (Start - PhysicalAddress),
+                       (size_t)(End - Start));
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        pRam->generation = pRam->generation + 1;
+    }
+
+    // copy guest memory to the segment & publish it, ranges failing to read are skipped
+    bool ServerSyncRamShm(FDP_SHM* pFDP)
+    {
+        FDP_RAM_SHM* pRam = pFDP->pRamShm;
+        if(pRam == NULL)
+        {
+            return false;
+        }
+        if(!(pRam->generation & 1))
+        {
+            return true;
+        }
+        const size_t            ChunkSize = 1024 * 1024;
+        FDP_SERVER_INTERFACE_T* pServer   = pFDP->pFdpServer;
+        FDP_PHYSICAL_RANGE_T    aRanges[FDP_MAX_PHYSICAL_RANGES];
+        const uint32_t          RangeCount = GetServerPhysicalRanges(pFDP, aRanges);
+        uint64_t                Offset     = FDP_RAM_SHM_DATA_OFFSET;
+        uint32_t                Published  = 0;
+        for(uint32_t i = 0; i < RangeCount; ++i)
+        {
+            const FDP_PHYSICAL_RANGE_T* pRange = &aRanges[i];
+            if(Offset + pRange->Size > pRam->size)
+            {
+                continue;
+            }
+            bool bRead = true;
+            for(uint64_t Done = 0; bRead && Done < pRange->Size; Done += ChunkSize)
+            {
+                const uint32_t Size = (uint32_t) std::min<uint64_t>(pRange->Size - Done, ChunkSize);
+                bRead               = pServer->pfnReadPhysicalMemory(pServer->pUserHandle, (uint8_t*) pRam + Offset + Done,
+                                                       pRange->PhysicalAddress + Done, Size);
+            }
+            if(!bRead)
+            {
+                continue;
+            }
+            pRam->ranges[Published].PhysicalAddress = pRange->PhysicalAddress;
+            pRam->ranges[Published].Size            = pRange->Size;
+            pRam->ranges[Published].Offset          = Offset;
+            Published++;
+            Offset += AlignRamShmSize(pRange->Size);
+        }
+        pRam->rangeCount = Published;
+        std::atomic_thread_fence(std::memory_order_release);
+        pRam->generation = pRam->generation + 1;
+        return true;
+    }
+}
+
+// snapshot slots, built on the server dirty log. Pages drained from the log
+// are credited to every slot & to FDP_GetDirtyPages callers
+namespace
+{
+    const uint64_t slot_page_size  = 0x1000;
+    const uint32_t slot_chunk_size = 1024 * 1024;
+
+    // selectors are left untouched, their hidden parts cannot be written back
+    const FDP_Register g_SlotRegisters[] =
+    {
+        FDP_RAX_REGISTER, FDP_RBX_REGISTER, FDP_RCX_REGISTER, FDP_RDX_REGISTER,
+        FDP_RSI_REGISTER, FDP_RDI_REGISTER, FDP_RSP_REGISTER, FDP_RBP_REGISTER,
+        FDP_R8_REGISTER, FDP_R9_REGISTER, FDP_R10_REGISTER, FDP_R11_REGISTER,
+        FDP_R12_REGISTER, FDP_R13_REGISTER, FDP_R14_REGISTER, FDP_R15_REGISTER,
+        FDP_RIP_REGISTER, FDP_RFLAGS_REGISTER,
+        FDP_CR0_REGISTER, FDP_CR2_REGISTER, FDP_CR3_REGISTER, FDP_CR4_REGISTER,
+    };
+
+    const uint64_t g_SlotMsrs[] =
+    {
+        0xC0000100, // IA32_FS_BASE
+        0xC0000101, // IA32_GS_BASE
+        0xC0000102, // IA32_KERNEL_GS_BASE
+    };
+
+    const size_t slot_register_count = sizeof g_SlotRegisters / sizeof *g_SlotRegisters;
+    const size_t slot_msr_count      = sizeof g_SlotMsrs / sizeof *g_SlotMsrs;
+
+    // one bit per page index, scanned a word at a time
+    struct PageBitmap
+    {
+        std::vector<uint64_t> Words;
+
+        void Reset(uint64_t PageCount, bool bValue)
+        {
+            Words.assign((PageCount + 63) / 64, bValue ? ~uint64_t(0) : 0);
+            if(bValue && PageCount % 64)
+            {
+                Words.back() = (uint64_t(1) << (PageCount % 64)) - 1;
+            }
+        }
+
+        bool Test(uint64_t Index) const { return !!(Words[Index / 64] & (uint64_t(1) << (Index % 64))); }
+        void Set(uint64_t Index) { Words[Index / 64] |= uint64_t(1) << (Index % 64); }
+        void Clear(uint64_t Index) { Words[Index / 64] &= ~(uint64_t(1) << (Index % 64)); }
+
+        // first set index at or above Index, PageCount when none
+        uint64_t Next(uint64_t Index, uint64_t PageCount) const
+        {
+            while(Index < PageCount)
+            {
+                const uint64_t Word = Words[Index / 64] >> (Index % 64);
+                if(Word)
+                {
+                    for(uint64_t Bit = 0;; ++Bit)
+                    {
+                        if(Word & (uint64_t(1) << Bit))
+                        {
+                            return std::min(Index + Bit, PageCount);
+                        }
+                    }
+                }
+                Index = (Index / 64 + 1) * 64;
+            }
+            return PageCount;
+        }
+    };
+
+    struct SlotCpu
+    {
+        uint64_t             aRegisters[slot_register_count];
+        uint64_t             aMsrs[slot_msr_count];
+        uint32_t             FxStateSize; // 0 when unavailable
+        FDP_XSAVE_FORMAT64_T FxState;
+    };
+
+    struct Slot
+    {
+        bool                 bValid;
+        std::vector<SlotCpu> Cpus;
+        std::vector<uint8_t> Memory; // every physical range, back to back
+        PageBitmap           Dirty;  // pages which may differ from Memory
+    };
+}
+
+struct FDP_SLOTS_
+{
+    FDP_PHYSICAL_RANGE_T  aRanges[FDP_MAX_PHYSICAL_RANGES]; // page aligned & sorted
+    uint64_t              aFirstPages[FDP_MAX_PHYSICAL_RANGES];
+    uint32_t              RangeCount;
+    uint64_t              PageCount;
+    PageBitmap            ClientDirty; // what FDP_GetDirtyPages answers once slots exist
+    std::vector<uint64_t> DrainBuffer;
+    Slot                  aSlots[FDP_MAX_SNAPSHOT_SLOTS];
+};
+
+static void DeleteSlots(FDP_SLOTS_* pSlots)
+{
+    delete pSlots;
+}
+
+namespace
+{
+    bool IsServerPaused(FDP_SHM* pFDP)
+    {
+        FDP_SERVER_INTERFACE_T* pServer = pFDP->pFdpServer;
+        uint8_t                 State   = 0;
+        return pServer->pfnGetState(pServer->pUserHandle, &State) && (State & FDP_STATE_PAUSED);
+    }
+
+    uint32_t GetSlotRange(const FDP_SLOTS_* pSlots, uint64_t Index)
+    {
+        uint32_t i = 0;
+        while(i + 1 < pSlots->RangeCount && Index >= pSlots->aFirstPages[i + 1])
+        {
+            i++;
+        }
+        return i;
+    }
+
+    uint64_t GetSlotPageAddress(const FDP_SLOTS_* pSlots, uint64_t Index)
+    {
+        const uint32_t i = GetSlotRange(pSlots, Index);
+        return pSlots->aRanges[i].PhysicalAddress + (Index - pSlots->aFirstPages[i]) * slot_page_size;
+    }
+
+    // first page index at or above PhysicalAddress, PageCount when none
+    uint64_t GetSlotPageIndex(const FDP_SLOTS_* pSlots, uint64_t PhysicalAddress)
+    {
+        for(uint32_t i = 0; i < pSlots->RangeCount; ++i)
+        {
+            const FDP_PHYSICAL_RANGE_T* pRange = &pSlots->aRanges[i];
+            if(PhysicalAddress < pRange->PhysicalAddress)
+            {
+                return pSlots->aFirstPages[i];
+            }
+            if(PhysicalAddress < pRange->PhysicalAddress + pRange->Size)
+            {
+                return pSlots->aFirstPages[i] + (PhysicalAddress - pRange->PhysicalAddress) / slot_page_size;
+            }
+        }
+        return pSlots->PageCount;
+    }
+
+    void MarkSlotsDirty(FDP_SLOTS_* pSlots, uint64_t Index)
+    {
+        pSlots->ClientDirty.Set(Index);
+        for(size_t i = 0; i < FDP_MAX_SNAPSHOT_SLOTS; ++i)
+        {
+            if(pSlots->aSlots[i].bValid)
+            {
+                pSlots->aSlots[i].Dirty.Set(Index);
+            }
+        }
+    }
+
+    void MarkSlotsAllDirty(FDP_SLOTS_* pSlots)
+    {
+        pSlots->ClientDirty.Reset(pSlots->PageCount, true);
+        for(size_t i = 0; i < FDP_MAX_SNAPSHOT_SLOTS; ++i)
+        {
+            if(pSlots->aSlots[i].bValid)
+            {
+                pSlots->aSlots[i].Dirty.Reset(pSlots->PageCount, true);
+            }
+        }
+    }
+
+    // move the server dirty log into slot dirty sets
+    void DrainDirtyLog(FDP_SHM* pFDP, FDP_SLOTS_* pSlots)
+    {
+        FDP_SERVER_INTERFACE_T* pServer = pFDP->pFdpServer;
+        if(pServer->pfnGetDirtyPages == NULL || pServer->pfnResetDirtyLog == NULL)
+        {
+            MarkSlotsAllDirty(pSlots);
+            return;
+        }
+        std::vector<uint64_t>& Pages     = pSlots->DrainBuffer;
+        uint64_t               FirstPage = 0;
+        while(true)
+        {
+            uint32_t Count = (uint32_t) Pages.size();
+            if(!pServer->pfnGetDirtyPages(pServer->pUserHandle, FirstPage, &Pages[0], &Count) || Count > Pages.size())
+            {
+                MarkSlotsAllDirty(pSlots);
+                return;
+            }
+            for(uint32_t i = 0; i < Count; ++i)
+            {
+                const uint64_t Index = GetSlotPageIndex(pSlots, Pages[i] * slot_page_size);
+                if(Index < pSlots->PageCount && GetSlotPageAddress(pSlots, Index) == Pages[i] * slot_page_size)
+                {
+                    MarkSlotsDirty(pSlots, Index);
+                }
+            }
+            if(Count < Pages.size())
+            {
+                break;
+            }
+            FirstPage = Pages[Count - 1] + 1;
+        }
+        // a failed reset only means pages are reported again
+        pServer->pfnResetDirtyLog(pServer->pUserHandle);
+    }
+
+    FDP_SLOTS_* GetSlots(FDP_SHM* pFDP)
+    {
+        if(pFDP->pSlots != NULL)
+        {
+            return pFDP->pSlots;
+        }
+        FDP_PHYSICAL_RANGE_T aRanges[FDP_MAX_PHYSICAL_RANGES];
+        const uint32_t       RangeCount = GetServerPhysicalRanges(pFDP, aRanges);
+        std::sort(aRanges, aRanges + RangeCount, [](const FDP_PHYSICAL_RANGE_T& a, const FDP_PHYSICAL_RANGE_T& b)
+        {
+            return a.PhysicalAddress < b.PhysicalAddress;
+        });
+        FDP_SLOTS_* pSlots = new FDP_SLOTS_();
+        for(uint32_t i = 0; i < RangeCount; ++i)
+        {
+            const uint64_t Size = aRanges[i].Size & ~(slot_page_size - 1);
+            if(!Size || aRanges[i].PhysicalAddress & (slot_page_size - 1))
+            {
+                continue;
+            }
+            pSlots->aRanges[pSlots->RangeCount].PhysicalAddress = aRanges[i].PhysicalAddress;
+            pSlots->aRanges[pSlots->RangeCount].Size            = Size;
+            pSlots->aFirstPages[pSlots->RangeCount]             = pSlots->PageCount;
+            pSlots->RangeCount++;
+            pSlots->PageCount += Size / slot_page_size;
+        }
+        if(!pSlots->PageCount)
+        {
+            delete pSlots;
+            return NULL;
+        }
+        pSlots->ClientDirty.Reset(pSlots->PageCount, false);
+        pSlots->DrainBuffer.resize(pFDP->CanalSize / sizeof(uint64_t));
+        pFDP->pSlots = pSlots;
+        // pages dirty so far must still be reported to clients
+        DrainDirtyLog(pFDP, pSlots);
+        return pSlots;
+    }
+
+    // save or restore every dirty page of a slot, in runs of contiguous guest pages
+    bool CopySlotPages(FDP_SHM* pFDP, FDP_SLOTS_* pSlots, Slot* pSlot, bool bRestore)
+    {
+        FDP_SERVER_INTERFACE_T* pServer      = pFDP->pFdpServer;
+        bool                    bReturnValue = true;
+        for(uint64_t Index = pSlot->Dirty.Next(0, pSlots->PageCount); Index < pSlots->PageCount;)
+        {
+            const uint32_t RangeId  = GetSlotRange(pSlots, Index);
+            const uint64_t RangeEnd = pSlots->aFirstPages[RangeId] + pSlots->aRanges[RangeId].Size / slot_page_size;
+            const uint64_t MaxCount = std::min<uint64_t>(RangeEnd - Index, slot_chunk_size / slot_page_size);
+            uint64_t       Count    = 1;
+            while(Count < MaxCount && pSlot->Dirty.Test(Index + Count))
+            {
+                Count++;
+            }
+            const uint64_t PhysicalAddress = pSlots->aRanges[RangeId].PhysicalAddress + (Index - pSlots->aFirstPages[RangeId]) * slot_page_size;
+            uint8_t*       pData           = &pSlot->Memory[Index * slot_page_size];
+            const uint32_t Size            = (uint32_t)(Count * slot_page_size);
+            if(bRestore)
+            {
+                bReturnValue &= pServer->pfnWritePhysicalMemory(pServer->pUserHandle, pData, PhysicalAddress, Size);
+            }
+            else if(!pServer->pfnReadPhysicalMemory(pServer->pUserHandle, pData, PhysicalAddress, Size))
+            {
+                // pages failing to read are saved as zeroes
+                for(uint64_t i = 0; i < Count; ++i)
+                {
+                    uint8_t* pPage = &pData[i * slot_page_size];
+                    if(!pServer->pfnReadPhysicalMemory(pServer->pUserHandle, pPage, PhysicalAddress + i * slot_page_size, slot_page_size))
+                    {
+                        memset(pPage, 0, slot_page_size);
+                    }
+                }
+            }
+            for(uint64_t i = 0; i < Count; ++i)
+            {
+                // restored pages changed for every other slot
+                if(bRestore)
+                {
+                    MarkSlotsDirty(pSlots, Index + i);
+                }
+                pSlot->Dirty.Clear(Index + i);
+            }
+            Index = pSlot->Dirty.Next(Index + Count, pSlots->PageCount);
+        }
+        return bReturnValue;
+    }
+
+    bool SaveSlotCpus(FDP_SHM* pFDP, Slot* pSlot)
+    {
+        FDP_SERVER_INTERFACE_T* pServer  = pFDP->pFdpServer;
+        uint32_t                CpuCount = 0;
+        if(!pServer->pfnGetCpuCount(pServer->pUserHandle, &CpuCount) || !CpuCount)
+        {
+            return false;
+        }
+        pSlot->Cpus.resize(CpuCount);
+        for(uint32_t CpuId = 0; CpuId < CpuCount; ++CpuId)
+        {
+            SlotCpu* pCpu = &pSlot->Cpus[CpuId];
+            for(size_t i = 0; i < slot_register_count; ++i)
+            {
+                if(!pServer->pfnReadRegister(pServer->pUserHandle, CpuId, g_SlotRegisters[i], &pCpu->aRegisters[i]))
+                {
+                    return false;
+                }
+            }
+            for(size_t i = 0; i < slot_msr_count; ++i)
+            {
+                if(!pServer->pfnReadMsr(pServer->pUserHandle, CpuId, g_SlotMsrs[i], &pCpu->aMsrs[i]))
+                {
+                    return false;
+                }
+            }
+            pCpu->FxStateSize = 0;
+            if(!pServer->pfnGetFxState64(pServer->pUserHandle, CpuId, (uint8_t*) &pCpu->FxState, &pCpu->FxStateSize)
+               || pCpu->FxStateSize > sizeof pCpu->FxState)
+            {
+                pCpu->FxStateSize = 0;
+            }
+        }
+        return true;
+    }
+
+    // only values which changed are written, some registers are costly to set
+    bool RestoreSlotCpus(FDP_SHM* pFDP, Slot* pSlot)
+    {
+        FDP_SERVER_INTERFACE_T* pServer      = pFDP->pFdpServer;
+        bool                    bReturnValue = true;
+        for(uint32_t CpuId = 0; CpuId < pSlot->Cpus.size(); ++CpuId)
+        {
+            SlotCpu* pCpu = &pSlot->Cpus[CpuId];
+            for(size_t i = 0; i < slot_register_count; ++i)
+            {
+                uint64_t Value = 0;
+                if(!pServer->pfnReadRegister(pServer->pUserHandle, CpuId, g_SlotRegisters[i], &Value) || Value != pCpu->aRegisters[i])
+                {
+                    bReturnValue &= pServer->pfnWriteRegister(pServer->pUserHandle, CpuId, g_SlotRegisters[i], pCpu->aRegisters[i]);
+                }
+            }
+            for(size_t i = 0; i < slot_msr_count; ++i)
+            {
+                uint64_t Value = 0;
+                if(!pServer->pfnReadMsr(pServer->pUserHandle, CpuId, g_SlotMsrs[i], &Value) || Value != pCpu->aMsrs[i])
+                {
+                    bReturnValue &= pServer->pfnWriteMsr(pServer->pUserHandle, CpuId, g_SlotMsrs[i], pCpu->aMsrs[i]);
+                }
+            }
+            if(pCpu->FxStateSize)
+            {
+                bReturnValue &= pServer->pfnSetFxState64(pServer->pUserHandle, CpuId, (uint8_t*) &pCpu->FxState, pCpu->FxStateSize);
+            }
+        }
+        return bReturnValue;
+    }
+
+    bool ServerSaveSlot(FDP_SHM* pFDP, uint32_t SlotId)
+    {
+        if(SlotId >= FDP_MAX_SNAPSHOT_SLOTS || !IsServerPaused(pFDP))
+        {
+            return false;
+        }
+        FDP_SLOTS_* pSlots = GetSlots(pFDP);
+        if(pSlots == NULL)
+        {
+            return false;
+        }
+        DrainDirtyLog(pFDP, pSlots);
+        Slot* pSlot = &pSlots->aSlots[SlotId];
+        if(!pSlot->bValid)
+        {
+            pSlot->Memory.resize(pSlots->PageCount * slot_page_size);
+            pSlot->Dirty.Reset(pSlots->PageCount, true);
+        }
+        CopySlotPages(pFDP, pSlots, pSlot, false);
+        pSlot->bValid = SaveSlotCpus(pFDP, pSlot);
+        return pSlot->bValid;
+    }
+
+    bool ServerRestoreSlot(FDP_SHM* pFDP, uint32_t SlotId)
+    {
+        FDP_SLOTS_* pSlots = pFDP->pSlots;
+        if(SlotId >= FDP_MAX_SNAPSHOT_SLOTS || pSlots == NULL || !pSlots->aSlots[SlotId].bValid || !IsServerPaused(pFDP))
+        {
+            return false;
+        }
+        FDP_SERVER_INTERFACE_T* pServer = pFDP->pFdpServer;
+        Slot*                   pSlot   = &pSlots->aSlots[SlotId];
+        DrainDirtyLog(pFDP, pSlots);
+        bool bReturnValue = CopySlotPages(pFDP, pSlots, pSlot, true);
+        // our own writes are already accounted for
+        if(pServer->pfnResetDirtyLog != NULL)
+        {
+            pServer->pfnResetDirtyLog(pServer->pUserHandle);
+        }
+        bReturnValue &= RestoreSlotCpus(pFDP, pSlot);
+        return bReturnValue;
+    }
+
+    uint32_t SlotGetDirtyPages(FDP_SHM* pFDP, FDP_SLOTS_* pSlots, uint64_t FirstPage, uint32_t MaxCount)
+    {
+        FDP_GET_DIRTY_PAGES_PKT_ANS* pAnswer = (FDP_GET_DIRTY_PAGES_PKT_ANS*) pFDP->OutputBuffer;
+        uint32_t                     Count   = 0;
+        DrainDirtyLog(pFDP, pSlots);
+        uint64_t Index = pSlots->ClientDirty.Next(GetSlotPageIndex(pSlots, FirstPage * slot_page_size), pSlots->PageCount);
+        for(; Index < pSlots->PageCount && Count < MaxCount; Index = pSlots->ClientDirty.Next(Index + 1, pSlots->PageCount))
+        {
+            pAnswer->Pages[Count++] = GetSlotPageAddress(pSlots, Index) / slot_page_size;
+        }
+        pAnswer->Count = Count;
+        return sizeof *pAnswer + Count * sizeof(uint64_t);
+    }
+}
+
+namespace
+{
+    // attach the hit predicate, a breakpoint which cannot be filtered is removed
+    int ServerSetBreakpointMatch(FDP_SHM* pFDP, int BreakpointId, const FDP_BREAKPOINT_MATCH_T* pMatch)
+    {
+        FDP_SERVER_INTERFACE_T* pServer = pFDP->pFdpServer;
+        if(BreakpointId < 0 || pMatch->MatchType == FDP_NO_MATCH)
+        {
+            return BreakpointId;
+        }
+        if(pServer->pfnSetBreakpointMatch != NULL && pServer->pfnSetBreakpointMatch(pServer->pUserHandle, BreakpointId, pMatch))
+        {
+            return BreakpointId;
+        }
+        pServer->pfnUnsetBreakpoint(pServer->pUserHandle, BreakpointId);
+        return -1;
+    }
+
+    int ServerSetBreakpoint(FDP_SHM* pFDP, const FDP_BREAKPOINT_T* pBreakpoint)
+    {
+        FDP_SERVER_INTERFACE_T* pServer      = pFDP->pFdpServer;
+        const int               BreakpointId = pServer->pfnSetBreakpoint(pServer->pUserHandle,
+                                                           pBreakpoint->CpuId,
+                                                           pBreakpoint->BreakpointType,
+                                                           pBreakpoint->BreakpointId,
+                                                           pBreakpoint->BreakpointAccessType,
+                                                           pBreakpoint->BreakpointAddressType,
+                                                           pBreakpoint->BreakpointAddress,
+                                                           pBreakpoint->BreakpointLength,
+                                                           pBreakpoint->BreakpointCr3);
+        return ServerSetBreakpointMatch(pFDP, BreakpointId, &pBreakpoint->Match);
+    }
+
+    void ServerSetBreakpoints(FDP_SHM* pFDP, const FDP_BREAKPOINT_T* pBreakpoints, uint32_t Count, int* pBreakpointIds)
+    {
+        FDP_SERVER_INTERFACE_T* pServer = pFDP->pFdpServer;
+        if(pServer->pfnSetBreakpoints != NULL)
+        {
+            pServer->pfnSetBreakpoints(pServer->pUserHandle, pBreakpoints, Count, pBreakpointIds);
+            for(uint32_t i = 0; i < Count; ++i)
+            {
+                pBreakpointIds[i] = ServerSetBreakpointMatch(pFDP, pBreakpointIds[i], &pBreakpoints[i].Match);
+            }
+            return;
+        }
+        for(uint32_t i = 0; i < Count; ++i)
+        {
+            pBreakpointIds[i] = ServerSetBreakpoint(pFDP, &pBreakpoints[i]);
+        }
+    }
+
+    uint32_t ServerGetDirtyPages(FDP_SHM* pFDP, uint64_t FirstPage, uint32_t MaxCount, bool* pbStatus)
+    {
+        FDP_SERVER_INTERFACE_T*      pServer = pFDP->pFdpServer;
+        FDP_GET_DIRTY_PAGES_PKT_ANS* pAnswer = (FDP_GET_DIRTY_PAGES_PKT_ANS*) pFDP->OutputBuffer;
+        uint32_t                     Count   = MaxCount;
+        if(pFDP->pSlots != NULL)
+        {
+            *pbStatus = true;
+            return SlotGetDirtyPages(pFDP, pFDP->pSlots, FirstPage, MaxCount);
+        }
+        *pbStatus = pServer->pfnGetDirtyPages != NULL
+                        && pServer->pfnGetDirtyPages(pServer->pUserHandle, FirstPage, pAnswer->Pages, &Count)
+                        && Count <= MaxCount;
+        if(!*pbStatus)
+        {
+            return 1;
+        }
+        pAnswer->Count = Count;
+        return sizeof *pAnswer + Count * sizeof(uint64_t);
+    }
+
+    bool ServerResetDirtyLog(FDP_SHM* pFDP)
+    {
+        FDP_SERVER_INTERFACE_T* pServer = pFDP->pFdpServer;
+        if(pFDP->pSlots != NULL)
+        {
+            DrainDirtyLog(pFDP, pFDP->pSlots);
+            pFDP->pSlots->ClientDirty.Reset(pFDP->pSlots->PageCount, false);
+            return true;
+        }
+        return pServer->pfnResetDirtyLog != NULL && pServer->pfnResetDirtyLog(pServer->pUserHandle);
+    }
+
+    bool ServerUnsetAllBreakpoints(FDP_SHM* pFDP)
+    {
+        FDP_SERVER_INTERFACE_T* pServer = pFDP->pFdpServer;
+        if(pServer->pfnUnsetAllBreakpoints != NULL)
+        {
+            return pServer->pfnUnsetAllBreakpoints(pServer->pUserHandle);
+        }
+        // unused ids fail to unset
+        for(int BreakpointId = 0; BreakpointId < FDP_MAX_BREAKPOINT; ++BreakpointId)
+        {
+            pServer->pfnUnsetBreakpoint(pServer->pUserHandle, BreakpointId);
+        }
+        return true;
+    }
+}
+
+// Runs the command in InputBuffer & returns the answer size in OutputBuffer
+static uint32_t HandleCommand(FDP_SHM* pFDP, uint32_t u32InputBufferSize, uint32_t u32OutputCapacity, bool* pbStatus)
+{
+    uint32_t u32OutputBuffersize = 0;
+    *pbStatus                    = true;
+    uint8_t Type                 = pFDP->InputBuffer[0];
+    if(IsRamShmStaleAfter(Type))
+    {
+        InvalidateRamShm(pFDP);
+    }
+    switch(Type)
+    {
+        case FDPCMD_TEST:
+        {
+            pFDP->OutputBuffer[0] = 0; // TODO: true !
+            u32OutputBuffersize   = 1;
+            break;
+        }
+        case FDPCMD_SAVE:
+        {
+            pFDP->OutputBuffer[0] = pFDP->pFdpServer->pfnSave(pFDP->pFdpServer->pUserHandle);
+            u32OutputBuffersize   = 1;
+            break;
+        }
+        case FDPCMD_RESTORE:
+        {
+            pFDP->OutputBuffer[0] = pFDP->pFdpServer->pfnRestore(pFDP->pFdpServer->pUserHandle);
+            u32OutputBuffersize   = 1;
+            break;
+        }
+        case FDPCMD_REBOOT:
+        {
+            pFDP->OutputBuffer[0] = pFDP->pFdpServer->pfnReboot(pFDP->pFdpServer->pUserHandle);
+            u32OutputBuffersize   = 1;
+            break;
+        }
+        case FDPCMD_GET_CPU_COUNT:
+        {
+            uint32_t CpuCout;
+            pFDP->pFdpServer->pfnGetCpuCount(pFDP->pFdpServer->pUserHandle, &CpuCout);
+            ((uint32_t*) pFDP->OutputBuffer)[0] = CpuCout;
+            u32OutputBuffersize                 = sizeof CpuCout;
+            break;
+        }
+        case FDPCMD_GET_STATE:
+        {
+            uint8_t CurrentState;
+            pFDP->pFdpServer->pfnGetState(pFDP->pFdpServer->pUserHandle, &CurrentState);
+            pFDP->OutputBuffer[0] = CurrentState;
+            u32OutputBuffersize   = sizeof CurrentState;
+            break;
+        }
+        case FDPCMD_GET_CPU_STATE:
+        {
+            uint8_t                CurrentState = 0;
+            FDP_GET_STATE_PKT_REQ* TempPkt      = (FDP_GET_STATE_PKT_REQ*) pFDP->InputBuffer;
+            pFDP->pFdpServer->pfnGetCpuState(pFDP->pFdpServer->pUserHandle, TempPkt->CpuId, &CurrentState);
+            pFDP->OutputBuffer[0] = CurrentState;
+            u32OutputBuffersize   = sizeof CurrentState;
+            break;
+        }
+        case FDPCMD_GET_MEMORYSIZE:
+        {
+            uint64_t u64PhysicalMemorySize;
+            pFDP->pFdpServer->pfnGetMemorySize(pFDP->pFdpServer->pUserHandle, &u64PhysicalMemorySize);
+            ((uint64_t*) pFDP->OutputBuffer)[0] = u64PhysicalMemorySize;
+            u32OutputBuffersize                 = sizeof u64PhysicalMemorySize;
+            break;
+        }
+        case FDPCMD_UNSET_BP:
+        {
+            FDP_CLEAR_BREAKPOINT_PKT_REQ* TempPkt = (FDP_CLEAR_BREAKPOINT_PKT_REQ*) pFDP->InputBuffer;
+            pFDP->OutputBuffer[0]                 = pFDP->pFdpServer->pfnUnsetBreakpoint(pFDP->pFdpServer->pUserHandle, TempPkt->BreakpointId);
+            u32OutputBuffersize                   = 1;
+            break;
+        }
+        case FDPCMD_SET_BP:
+        {
+            FDP_SET_BREAKPOINT_PKT_REQ* TempPkt = (FDP_SET_BREAKPOINT_PKT_REQ*) pFDP->InputBuffer;
+            FDP_BREAKPOINT_T            Breakpoint;
+            Breakpoint.CpuId                    = TempPkt->CpuId;
+            Breakpoint.BreakpointType           = TempPkt->BreakpointType;
+            Breakpoint.BreakpointId             = TempPkt->BreakpointId;
+            Breakpoint.BreakpointAccessType     = TempPkt->BreakpointAccessType;
+            Breakpoint.BreakpointAddressType    = TempPkt->BreakpointAddressType;
+            Breakpoint.BreakpointAddress        = TempPkt->BreakpointAddress;
+            Breakpoint.BreakpointLength         = TempPkt->BreakpointLength;
+            Breakpoint.BreakpointCr3            = TempPkt->BreakpointCr3;
+            Breakpoint.Match                    = TempPkt->Match;
+            ((int*) pFDP->OutputBuffer)[0]      = ServerSetBreakpoint(pFDP, &Breakpoint);
+            u32OutputBuffersize                 = sizeof(int);
+            break;
+        }
+        case FDPCMD_VIRTUAL_PHYSICAL:
+        {
+            uint64_t                      PhysicalAddress = 0;
+            FDP_VIRTUAL_PHYSICAL_PKT_REQ* TempPkt         = (FDP_VIRTUAL_PHYSICAL_PKT_REQ*) pFDP->InputBuffer;
+            ServerVirtualToPhysical(pFDP,
+                                    TempPkt->CpuId,
+                                    TempPkt->Dtb,
+                                    TempPkt->VirtualAddress,
+                                    &PhysicalAddress);
+            ((uint64_t*) pFDP->OutputBuffer)[0] = PhysicalAddress;
+            u32OutputBuffersize                 = sizeof PhysicalAddress;
+            break;
+        }
+        case FDPCMD_RESUME_VM:
+            pFDP->OutputBuffer[0] = pFDP->pFdpServer->pfnResume(pFDP->pFdpServer->pUserHandle);
+            u32OutputBuffersize   = sizeof(bool);
+            break;
+        case FDPCMD_PAUSE_VM:
+            pFDP->OutputBuffer[0] = pFDP->pFdpServer->pfnPause(pFDP->pFdpServer->pUserHandle);
+            u32OutputBuffersize   = sizeof(bool);
+            break;
+        case FDPCMD_SINGLE_STEP:
+        {
+            FDP_GET_STATE_PKT_REQ* TempPkt = (FDP_GET_STATE_PKT_REQ*) pFDP->InputBuffer;
+            pFDP->OutputBuffer[0]          = pFDP->pFdpServer->pfnSingleStep(pFDP->pFdpServer->pUserHandle, TempPkt->CpuId);
+            u32OutputBuffersize            = sizeof(bool);
+            break;
+        }
+        case FDPCMD_READ_REGISTER:
+        {
+            uint64_t                   RegisterValue = 0;
+            FDP_READ_REGISTER_PKT_REQ* TempPkt       = (FDP_READ_REGISTER_PKT_REQ*) pFDP->InputBuffer;
+            pFDP->pFdpServer->pfnReadRegister(pFDP->pFdpServer->pUserHandle,
+                                              TempPkt->CpuId,
+                                              TempPkt->RegisterId,
+                                              &RegisterValue);
+            ((uint64_t*) pFDP->OutputBuffer)[0] = RegisterValue;
+            u32OutputBuffersize                 = sizeof RegisterValue;
+            break;
+        }
+        case FDPCMD_GET_FXSTATE:
+        {
+            FDP_GET_STATE_PKT_REQ* TempPkt = (FDP_GET_STATE_PKT_REQ*) pFDP->InputBuffer;
+            pFDP->pFdpServer->pfnGetFxState64(pFDP->pFdpServer->pUserHandle,
+                                              TempPkt->CpuId,
+                                              pFDP->OutputBuffer,
+                                              &u32OutputBuffersize);
+            break;
+        }
+        case FDPCMD_SET_FXSTATE:
+        {
+            FDP_SET_FX_STATE_REQ* TempPkt = (FDP_SET_FX_STATE_REQ*) pFDP->InputBuffer;
+            pFDP->OutputBuffer[0]         = pFDP->pFdpServer->pfnSetFxState64(pFDP->pFdpServer->pUserHandle,
+                                                                      TempPkt->CpuId,
+                                                                      (uint8_t*) &TempPkt->FxState64,
+                                                                      sizeof TempPkt->FxState64);
+            u32OutputBuffersize           = sizeof(bool);
+            break;
+        }
+        case FDPCMD_READ_MSR:
+        {
+            uint64_t              MsrValue = 0;
+            FDP_READ_MSR_PKT_REQ* TempPkt  = (FDP_READ_MSR_PKT_REQ*) pFDP->InputBuffer;
+            pFDP->pFdpServer->pfnReadMsr(pFDP->pFdpServer->pUserHandle,
+                                         TempPkt->CpuId,
+                                         TempPkt->MsrId,
+                                         &MsrValue);
+            ((uint64_t*) pFDP->OutputBuffer)[0] = MsrValue;
+            u32OutputBuffersize                 = sizeof MsrValue;
+            break;
+        }
+        case FDPCMD_WRITE_MSR:
+        {
+            FDP_WRITE_MSR_PKT_REQ* TempPkt = (FDP_WRITE_MSR_PKT_REQ*) pFDP->InputBuffer;
+            pFDP->OutputBuffer[0]          = pFDP->pFdpServer->pfnWriteMsr(pFDP->pFdpServer->pUserHandle,
+                                                                  TempPkt->CpuId,
+                                                                  TempPkt->MsrId,
+                                                                  TempPkt->MsrValue);
+            u32OutputBuffersize            = sizeof(bool);
+            break;
+        }
+        case FDPCMD_WRITE_REGISTER:
+        {
+            FDP_WRITE_REGISTER_PKT_REQ* TempPkt = (FDP_WRITE_REGISTER_PKT_REQ*) pFDP->InputBuffer;
+            pFDP->OutputBuffer[0]               = pFDP->pFdpServer->pfnWriteRegister(pFDP->pFdpServer->pUserHandle,
+                                                                       TempPkt->CpuId,
+                                                                       TempPkt->RegisterId,
+                                                                       TempPkt->RegisterValue);
+            u32OutputBuffersize                 = sizeof(bool);
+            break;
+        }
+        case FDPCMD_READ_PHYSICAL:
+        {
+            FDP_READ_PHYSICAL_MEMORY_PKT_REQ* TempPkt = (FDP_READ_PHYSICAL_MEMORY_PKT_REQ*) pFDP->InputBuffer;
+            if(TempPkt->ReadSize > u32OutputCapacity)
             {
-                FDP_READ_PHYSICAL_MEMORY_PKT_REQ* TempPkt = (FDP_READ_PHYSICAL_MEMORY_PKT_REQ*) pFDP->InputBuffer;
-                if(TempPkt->ReadSize > FDP_MAX_DATA_SIZE)
-                {
-                    bStatus = false;
-                }
-                else
-                {
-                    bStatus = pFDP->pFdpServer->pfnReadPhysicalMemory(pFDP->pFdpServer->pUserHandle,
-                                                                      pFDP->OutputBuffer,
-                                                                      TempPkt->PhysicalAddress,
-                                                                      TempPkt->ReadSize);
-                }
-                if(bStatus)
-                {
-                    u32OutputBuffersize = TempPkt->ReadSize;
-                }
-                else
-                {
-                    u32OutputBuffersize = 1;
-                }
+                *pbStatus = false;
+            }
+            else
+            {
+                *pbStatus = pFDP->pFdpServer->pfnReadPhysicalMemory(pFDP->pFdpServer->pUserHandle,
+                                                                    pFDP->OutputBuffer,
+                                                                    TempPkt->PhysicalAddress,
+                                                                    TempPkt->ReadSize);
+            }
+            if(*pbStatus)
+            {
+                u32OutputBuffersize = TempPkt->ReadSize;
+            }
+            else
+            {
+                u32OutputBuffersize = 1;
+            }
+            break;
+        }
+        case FDPCMD_READ_VIRTUAL:
+        {
+            FDP_READ_VIRTUAL_MEMORY_PKT_REQ* TempPkt = (FDP_READ_VIRTUAL_MEMORY_PKT_REQ*) pFDP->InputBuffer;
+            if(TempPkt->ReadSize > u32OutputCapacity)
+            {
+                *pbStatus = false;
+            }
+            else
+            {
+                *pbStatus = ServerReadMemory(pFDP,
+                                             TempPkt->CpuId,
+                                             FDP_VIRTUAL_ADDRESS,
+                                             TempPkt->Dtb,
+                                             TempPkt->VirtualAddress,
+                                             TempPkt->ReadSize,
+                                             pFDP->OutputBuffer);
+            }
+            if(*pbStatus)
+            {
+                u32OutputBuffersize = TempPkt->ReadSize;
+            }
+            else
+            {
+                u32OutputBuffersize = 1;
+            }
+            break;
+        }
+        case FDPCMD_READ_VECTOR:
+        {
+            FDP_READ_VECTOR_PKT_REQ* TempPkt = (FDP_READ_VECTOR_PKT_REQ*) pFDP->InputBuffer;
+            const uint64_t           MaxSize = (u32InputBufferSize - sizeof *TempPkt) / sizeof(FDP_READ_VECTOR_ENTRY);
+            if(u32InputBufferSize < sizeof *TempPkt || !TempPkt->EntryCount || TempPkt->EntryCount > MaxSize)
+            {
+                *pbStatus           = false;
+                u32OutputBuffersize = 1;
                 break;
             }
-            case FDPCMD_READ_VIRTUAL:
+            uint8_t* pStatus    = pFDP->OutputBuffer;
+            u32OutputBuffersize = TempPkt->EntryCount;
+            for(uint32_t i = 0; i < TempPkt->EntryCount; ++i)
             {
-                FDP_READ_VIRTUAL_MEMORY_PKT_REQ* TempPkt = (FDP_READ_VIRTUAL_MEMORY_PKT_REQ*) pFDP->InputBuffer;
-                if(TempPkt->ReadSize > FDP_MAX_DATA_SIZE)
-                {
-                    bStatus = false;
-                }
-                else
-                {
-                    bStatus = pFDP->pFdpServer->pfnReadVirtualMemory(pFDP->pFdpServer->pUserHandle,
-                                                                     TempPkt->CpuId,
-                                                                     TempPkt->VirtualAddress,
-                                                                     TempPkt->ReadSize,
-                                                                     pFDP->OutputBuffer);
-                }
-                if(bStatus)
-                {
-                    u32OutputBuffersize = TempPkt->ReadSize;
-                }
-                else
+                const FDP_READ_VECTOR_ENTRY* pEntry = &TempPkt->Entries[i];
+                pStatus[i]                          = false;
+                if(pEntry->ReadSize >= u32OutputCapacity - u32OutputBuffersize)
                 {
-                    u32OutputBuffersize = 1;
+                    *pbStatus = false;
+                    break;
                 }
-                break;
+                pStatus[i] = ServerReadMemory(pFDP,
+                                              TempPkt->CpuId,
+                                              pEntry->AddressType,
+                                              pEntry->Dtb,
+                                              pEntry->Address,
+                                              pEntry->ReadSize,
+                                              &pFDP->OutputBuffer[u32OutputBuffersize]);
+                u32OutputBuffersize += pEntry->ReadSize;
             }
-            case FDPCMD_WRITE_PHYSICAL:
+            break;
+        }
+        case FDPCMD_READ_VIRTUAL_PARTIAL:
+        {
+            FDP_READ_VIRTUAL_MEMORY_PKT_REQ* TempPkt = (FDP_READ_VIRTUAL_MEMORY_PKT_REQ*) pFDP->InputBuffer;
+            u32OutputBuffersize                      = ServerReadVirtualPartial(pFDP, TempPkt, u32OutputCapacity, pbStatus);
+            break;
+        }
+        case FDPCMD_TRANSLATE_VECTOR:
+        {
+            FDP_TRANSLATE_VECTOR_PKT_REQ* TempPkt  = (FDP_TRANSLATE_VECTOR_PKT_REQ*) pFDP->InputBuffer;
+            const uint64_t                MaxCount = (u32InputBufferSize - sizeof *TempPkt) / sizeof(uint64_t);
+            if(u32InputBufferSize < sizeof *TempPkt || !TempPkt->EntryCount || TempPkt->EntryCount > MaxCount
+               || TempPkt->EntryCount > u32OutputCapacity / (sizeof(uint64_t) + 1))
             {
-                FDP_WRITE_PHYSICAL_MEMORY_PKT_REQ* TempPkt = (FDP_WRITE_PHYSICAL_MEMORY_PKT_REQ*) pFDP->InputBuffer;
-                pFDP->OutputBuffer[0]                      = pFDP->pFdpServer->pfnWritePhysicalMemory(pFDP->pFdpServer->pUserHandle,
-                                                                                 TempPkt->Data,
-                                                                                 TempPkt->PhysicalAddress,
-                                                                                 TempPkt->WriteSize);
-                u32OutputBuffersize                        = sizeof(bool);
+                *pbStatus           = false;
+                u32OutputBuffersize = 1;
                 break;
             }
-            case FDPCMD_WRITE_VIRTUAL:
+            uint8_t* pFlags = &pFDP->OutputBuffer[TempPkt->EntryCount * sizeof(uint64_t)];
+            for(uint32_t i = 0; i < TempPkt->EntryCount; ++i)
             {
-                FDP_WRITE_VIRTUAL_MEMORY_PKT_REQ* TempPkt = (FDP_WRITE_VIRTUAL_MEMORY_PKT_REQ*) pFDP->InputBuffer;
-                pFDP->OutputBuffer[0]                     = pFDP->pFdpServer->pfnWriteVirtualMemory(
-                    pFDP->pFdpServer->pUserHandle,
-                    TempPkt->CpuId,
-                    TempPkt->Data,
-                    TempPkt->VirtualAddress,
-                    TempPkt->WriteSize);
-                u32OutputBuffersize = sizeof(bool);
-                break;
+                uint64_t PhysicalAddress = 0;
+                pFlags[i]                = 0;
+                ServerTranslate(pFDP, TempPkt->CpuId, TempPkt->Dtb, TempPkt->VirtualAddresses[i], &PhysicalAddress, &pFlags[i]);
+                memcpy(&pFDP->OutputBuffer[i * sizeof(uint64_t)], &PhysicalAddress, sizeof PhysicalAddress);
+            }
+            u32OutputBuffersize = TempPkt->EntryCount * (sizeof(uint64_t) + 1);
+            break;
+        }
+        case FDPCMD_WRITE_PHYSICAL:
+        {
+            FDP_WRITE_PHYSICAL_MEMORY_PKT_REQ* TempPkt = (FDP_WRITE_PHYSICAL_MEMORY_PKT_REQ*) pFDP->InputBuffer;
+            pFDP->OutputBuffer[0]                      = pFDP->pFdpServer->pfnWritePhysicalMemory(pFDP->pFdpServer->pUserHandle,
+                                                                             TempPkt->Data,
+                                                                             TempPkt->PhysicalAddress,
+                                                                             TempPkt->WriteSize);
+            u32OutputBuffersize                        = sizeof(bool);
+            if(pFDP->OutputBuffer[0])
+            {
+                UpdateRamShm(pFDP, TempPkt->Data, TempPkt->WriteSize, TempPkt->PhysicalAddress);
             }
-            case FDPCMD_INJECT_INTERRUPT:
+            break;
+        }
+        case FDPCMD_SET_BREAKPOINTS:
+        {
+            FDP_SET_BREAKPOINTS_PKT_REQ* TempPkt = (FDP_SET_BREAKPOINTS_PKT_REQ*) pFDP->InputBuffer;
+            if(u32InputBufferSize < sizeof *TempPkt
+               || !TempPkt->Count
+               || TempPkt->Count > (u32InputBufferSize - sizeof *TempPkt) / sizeof(FDP_BREAKPOINT_T)
+               || TempPkt->Count > u32OutputCapacity / sizeof(int))
             {
-                FDP_INJECT_INTERRUPT_PKT_REQ* TempPkt = (FDP_INJECT_INTERRUPT_PKT_REQ*) pFDP->InputBuffer;
-                pFDP->OutputBuffer[0]                 = pFDP->pFdpServer->pfnInjectInterrupt(
-                    pFDP->pFdpServer->pUserHandle,
-                    TempPkt->CpuId,
-                    TempPkt->InterruptionCode,
-                    TempPkt->ErrorCode,
-                    TempPkt->Cr2Value);
-                u32OutputBuffersize = sizeof(bool);
+                *pbStatus           = false;
+                u32OutputBuffersize = 1;
                 break;
             }
-            // TODO !
-            case FDPCMD_SEARCH_PHYSICAL_MEMORY:
-            {
-                /*FDP_SEARCH_PHYSICAL_MEMORY_PKT_REQ* tmpPkt = (FDP_SEARCH_PHYSICAL_MEMORY_PKT_REQ*)pFDP->InputBuffer;
+            ServerSetBreakpoints(pFDP, TempPkt->Breakpoints, TempPkt->Count, (int*) pFDP->OutputBuffer);
+            u32OutputBuffersize = TempPkt->Count * sizeof(int);
+            break;
+        }
+        case FDPCMD_UNSET_ALL_BREAKPOINTS:
+        {
+            pFDP->OutputBuffer[0] = ServerUnsetAllBreakpoints(pFDP);
+            u32OutputBuffersize   = sizeof(bool);
+            break;
+        }
+        case FDPCMD_GET_DIRTY_PAGES:
+        {
+            FDP_GET_DIRTY_PAGES_PKT_REQ* TempPkt = (FDP_GET_DIRTY_PAGES_PKT_REQ*) pFDP->InputBuffer;
+            const uint32_t               MaxCount = std::min<uint32_t>(TempPkt->MaxCount, (u32OutputCapacity - sizeof(FDP_GET_DIRTY_PAGES_PKT_ANS)) / sizeof(uint64_t));
+            u32OutputBuffersize                   = ServerGetDirtyPages(pFDP, TempPkt->FirstPage, MaxCount, pbStatus);
+            break;
+        }
+        case FDPCMD_RESET_DIRTY_LOG:
+        {
+            pFDP->OutputBuffer[0] = ServerResetDirtyLog(pFDP);
+            u32OutputBuffersize   = sizeof(bool);
+            break;
+        }
+        case FDPCMD_SAVE_SLOT:
+        {
+            FDP_SLOT_PKT_REQ* TempPkt = (FDP_SLOT_PKT_REQ*) pFDP->InputBuffer;
+            pFDP->OutputBuffer[0]     = ServerSaveSlot(pFDP, TempPkt->SlotId);
+            u32OutputBuffersize       = sizeof(bool);
+            break;
+        }
+        case FDPCMD_RESTORE_SLOT:
+        {
+            FDP_SLOT_PKT_REQ* TempPkt = (FDP_SLOT_PKT_REQ*) pFDP->InputBuffer;
+            pFDP->OutputBuffer[0]     = ServerRestoreSlot(pFDP, TempPkt->SlotId);
+            u32OutputBuffersize       = sizeof(bool);
+            break;
+        }
+        case FDPCMD_SYNC_PHYSICAL_MEMORY:
+        {
+            pFDP->OutputBuffer[0] = ServerSyncRamShm(pFDP);
+            u32OutputBuffersize   = sizeof(bool);
+            break;
+        }
+        case FDPCMD_WRITE_VIRTUAL:
+        {
+            FDP_WRITE_VIRTUAL_MEMORY_PKT_REQ* TempPkt = (FDP_WRITE_VIRTUAL_MEMORY_PKT_REQ*) pFDP->InputBuffer;
+            pFDP->OutputBuffer[0]                     = ServerWriteVirtualMemory(
+                pFDP,
+                TempPkt->CpuId,
+                TempPkt->Dtb,
+                TempPkt->Data,
+                TempPkt->VirtualAddress,
+                TempPkt->WriteSize);
+            u32OutputBuffersize = sizeof(bool);
+            break;
+        }
+        case FDPCMD_INJECT_INTERRUPT:
+        {
+            FDP_INJECT_INTERRUPT_PKT_REQ* TempPkt = (FDP_INJECT_INTERRUPT_PKT_REQ*) pFDP->InputBuffer;
+            pFDP->OutputBuffer[0]                 = pFDP->pFdpServer->pfnInjectInterrupt(
+                pFDP->pFdpServer->pUserHandle,
+                TempPkt->CpuId,
+                TempPkt->InterruptionCode,
+                TempPkt->ErrorCode,
+                TempPkt->Cr2Value);
+            u32OutputBuffersize = sizeof(bool);
+            break;
+        }
+        // TODO !
+        case FDPCMD_SEARCH_PHYSICAL_MEMORY:
+        {
+            /*FDP_SEARCH_PHYSICAL_MEMORY_PKT_REQ* tmpPkt = (FDP_SEARCH_PHYSICAL_MEMORY_PKT_REQ*)pFDP->InputBuffer;
 
-            ((uint64_t*)pFDP->OutputBuffer)[0] = pFDP->pFdpServer->pfnSear
+        ((uint64_t*)pFDP->OutputBuffer)[0] = pFDP->pFdpServer->pfnSear
 
-            ((uint64_t*)myFDPHandle.OutputBuffer)[0] = -1;
-            if (tmpPkt->StartOffset < MMR3PhysGetRamSizeU(pUVM)){
-            int rc = PGMR3DbgScanPhysicalU(pUVM, tmpPkt->StartOffset, MMR3PhysGetRamSizeU(pUVM) - tmpPkt->StartOffset, 1, tmpPkt->PatternData, tmpPkt->PatternSize, &HitAddress);
-            ((uint64_t*)myFDPHandle.OutputBuffer)[0] = HitAddress;
-            if (RT_FAILURE(rc)){
-            ((uint64_t*)myFDPHandle.OutputBuffer)[0] = -1;
+        ((uint64_t*)myFDPHandle.OutputBuffer)[0] = -1;
+        if (tmpPkt->StartOffset < MMR3PhysGetRamSizeU(pUVM)){
+        int rc = PGMR3DbgScanPhysicalU(pUVM, tmpPkt->StartOffset, MMR3PhysGetRamSizeU(pUVM) - tmpPkt->StartOffset, 1, tmpPkt->PatternData, tmpPkt->PatternSize, &HitAddress);
+        ((uint64_t*)myFDPHandle.OutputBuffer)[0] = HitAddress;
+        if (RT_FAILURE(rc)){
+        ((uint64_t*)myFDPHandle.OutputBuffer)[0] = -1;
 
-            }
+        }
+
+        }
+        myFDPHandle.OutputBufferSize = sizeof(uint64_t);
+        */
+            break;
+        }
+        default:
+            break;
+    }
+    return u32OutputBuffersize;
+}
+
+namespace
+{
+    struct ReplayCommand
+    {
+        size_t   RequestOffset;
+        size_t   AnswerOffset;
+        uint32_t RequestSize;
+        uint32_t AnswerSize;
+        bool     bStatus;
+        bool     bStateChanged; // the client saw a state change after this answer
+    };
+
+    // commands skipped at most to find the next request after a divergence
+    constexpr size_t replay_max_skip = 256;
+
+    template <typename T>
+    bool ReadRecord(const std::vector<uint8_t>& Data, size_t* pOffset, T* pValue)
+    {
+        if(Data.size() - *pOffset < sizeof *pValue)
+        {
+            return false;
+        }
+        memcpy(pValue, &Data[*pOffset], sizeof *pValue);
+        *pOffset += sizeof *pValue;
+        return true;
+    }
+
+    bool SkipRecord(const std::vector<uint8_t>& Data, size_t* pOffset, uint32_t Size)
+    {
+        if(Data.size() - *pOffset < Size)
+        {
+            return false;
+        }
+        *pOffset += Size;
+        return true;
+    }
+}
 
+struct FDP_REPLAY_
+{
+    std::vector<uint8_t>       Data; // whole recording
+    std::vector<ReplayCommand> Commands;
+    bool                       bStateChanged; // before the first command
+    size_t                     Next;          // next expected command
+    size_t                     Last;          // last answered command
+    uint64_t                   Misses;
+};
+
+static void DeleteReplay(FDP_REPLAY_* pReplay)
+{
+    delete pReplay;
+}
+
+// a truncated last record is ignored, so a recording cut short by a crash is still usable
+static FDP_REPLAY_* LoadReplay(const char* pPath)
+{
+    FILE* pFile = fopen(pPath, "rb");
+    if(pFile == NULL)
+    {
+        return NULL;
+    }
+    FDP_REPLAY_* pReplay = new FDP_REPLAY_{};
+    uint8_t      Chunk[64 * 1024];
+    size_t       ChunkSize;
+    while((ChunkSize = fread(Chunk, 1, sizeof Chunk, pFile)) > 0)
+    {
+        pReplay->Data.insert(pReplay->Data.end(), Chunk, Chunk + ChunkSize);
+    }
+    fclose(pFile);
+
+    const std::vector<uint8_t>& Data = pReplay->Data;
+    if(Data.size() < sizeof record_magic || memcmp(Data.data(), record_magic, sizeof record_magic))
+    {
+        DeleteReplay(pReplay);
+        return NULL;
+    }
+    size_t  Offset = sizeof record_magic;
+    uint8_t Type;
+    while(ReadRecord(Data, &Offset, &Type))
+    {
+        if(Type == record_state_changed)
+        {
+            if(pReplay->Commands.empty())
+                pReplay->bStateChanged = true;
+            else
+                pReplay->Commands.back().bStateChanged = true;
+            continue;
+        }
+        ReplayCommand Command = {};
+        uint8_t       Status  = 0;
+        if(Type != record_command
+           || !ReadRecord(Data, &Offset, &Command.RequestSize)
+           || !SkipRecord(Data, &Offset, Command.RequestSize)
+           || !ReadRecord(Data, &Offset, &Status)
+           || !ReadRecord(Data, &Offset, &Command.AnswerSize)
+           || !SkipRecord(Data, &Offset, Command.AnswerSize))
+        {
+            break;
+        }
+        Command.AnswerOffset  = Offset - Command.AnswerSize;
+        Command.RequestOffset = Command.AnswerOffset - sizeof Command.AnswerSize - sizeof Status - Command.RequestSize;
+        Command.bStatus       = !!Status;
+        pReplay->Commands.push_back(Command);
+    }
+    pReplay->Last = SIZE_MAX;
+    return pReplay;
+}
+
+// answer with the next recorded command matching the request.
+// A request repeating the last one gets the same answer, so extra polls do not desync the replay.
+// Otherwise up to replay_max_skip commands are skipped, and unknown requests fail.
+static uint32_t ServerReplayCommand(FDP_SHM* pFDP, uint32_t u32InputBufferSize, uint32_t u32OutputCapacity, bool* pbStatus)
+{
+    FDP_REPLAY_* pReplay = pFDP->pReplay;
+    const auto   Matches = [&](size_t Index)
+    {
+        if(Index >= pReplay->Commands.size())
+        {
+            return false;
+        }
+        const ReplayCommand& Command = pReplay->Commands[Index];
+        return Command.RequestSize == u32InputBufferSize
+               && !memcmp(&pReplay->Data[Command.RequestOffset], pFDP->InputBuffer, u32InputBufferSize)
+               && Command.AnswerSize <= u32OutputCapacity;
+    };
+
+    size_t Index = SIZE_MAX;
+    if(Matches(pReplay->Next))
+    {
+        Index = pReplay->Next;
+    }
+    else if(Matches(pReplay->Last))
+    {
+        Index = pReplay->Last;
+    }
+    else
+    {
+        const size_t End = std::min(pReplay->Commands.size(), pReplay->Next + replay_max_skip);
+        for(size_t i = pReplay->Next + 1; i < End && Index == SIZE_MAX; ++i)
+        {
+            if(Matches(i))
+            {
+                Index = i;
             }
-            myFDPHandle.OutputBufferSize = sizeof(uint64_t);
-            */
-                break;
+        }
+    }
+    if(Index == SIZE_MAX)
+    {
+        pReplay->Misses++;
+        *pbStatus             = false;
+        pFDP->OutputBuffer[0] = 0;
+        return 1;
+    }
+
+    const ReplayCommand& Command = pReplay->Commands[Index];
+    if(Index != pReplay->Last)
+    {
+        // raised before answering so the client sees it at the same point
+        if(Command.bStateChanged || (Index == 0 && pReplay->bStateChanged))
+        {
+            FDP_SetStateChanged(pFDP);
+        }
+        pReplay->Next = Index + 1;
+        pReplay->Last = Index;
+    }
+    memcpy(pFDP->OutputBuffer, &pReplay->Data[Command.AnswerOffset], Command.AnswerSize);
+    *pbStatus = Command.bStatus;
+    return Command.AnswerSize;
+}
+
+static uint32_t ServerCommand(FDP_SHM* pFDP, uint32_t u32InputBufferSize, uint32_t u32OutputCapacity, bool* pbStatus)
+{
+    if(pFDP->pReplay)
+    {
+        return ServerReplayCommand(pFDP, u32InputBufferSize, u32OutputCapacity, pbStatus);
+    }
+    return HandleCommand(pFDP, u32InputBufferSize, u32OutputCapacity, pbStatus);
+}
+
+namespace
+{
+    bool RingPending(FDP_SHM_RING* pRing)
+    {
+        const auto& Slot = pRing->slots[pRing->serverIndex.load(std::memory_order_relaxed) % FDP_RING_SLOT_COUNT];
+        return Slot.state.load(std::memory_order_acquire) == FDP_RING_SLOT_SUBMITTED;
+    }
+
+    // wait for a command on the canal or on the ring
+    void ServerWaitWork(FDP_SHM* pFDP)
+    {
+        FDP_SHM_SHARED*      pShared   = pFDP->pSharedFDPSHM;
+        FDP_SHM_CANAL*       pCanal    = &pShared->ClientToServer;
+        const volatile bool* pbRunning = &pFDP->pFdpServer->bIsRunning;
+        wait_until(pCanal, &pCanal->doorbell, [=]
+        {
+            return canal_has_data(pCanal) || RingPending(&pShared->Ring) || !*pbRunning;
+        });
+    }
+
+    // run every submitted ring command, in order
+    void ServerRunRing(FDP_SHM* pFDP)
+    {
+        FDP_SHM_RING* pRing = &pFDP->pSharedFDPSHM->Ring;
+        while(RingPending(pRing))
+        {
+            const uint32_t     Index = pRing->serverIndex.load(std::memory_order_relaxed);
+            FDP_SHM_RING_SLOT* pSlot = &pRing->slots[Index % FDP_RING_SLOT_COUNT];
+            const uint32_t     Size  = std::min<uint32_t>((uint32_t) pSlot->dataSize, FDP_RING_SLOT_DATA_SIZE);
+            memcpy(pFDP->InputBuffer, (char*) pSlot->data, Size);
+            bool     bStatus    = false;
+            uint32_t OutputSize = Size ? ServerCommand(pFDP, Size, FDP_RING_SLOT_DATA_SIZE, &bStatus) : 0;
+            if(OutputSize > FDP_RING_SLOT_DATA_SIZE)
+            {
+                bStatus    = false;
+                OutputSize = 0;
             }
-            default:
-                break;
+            memcpy((char*) pSlot->data, pFDP->OutputBuffer, OutputSize);
+            pSlot->dataSize = OutputSize;
+            pSlot->bStatus  = bStatus;
+            pSlot->state.store(FDP_RING_SLOT_COMPLETED, std::memory_order_release);
+            pRing->serverIndex.store(Index + 1, std::memory_order_relaxed);
+            pRing->completed++;
+#ifdef __linux__
+            if(pRing->waiters.load())
+                futex_wake(&pRing->completed);
+#endif
+        }
+    }
+}
+
+FDP_EXPORTED
+bool FDP_ServerLoop(FDP_SHM* pFDP)
+{
+    if(pFDP == NULL)
+    {
+        return false;
+    }
+    pFDP->pFdpServer->bIsRunning = true;
+    while(pFDP->pFdpServer->bIsRunning)
+    {
+        ServerWaitWork(pFDP);
+        if(pFDP->pSharedFDPSHM->abiVersion != FDP_ABI_VERSION)
+        {
+            // cleared by a client built with another layout
+            return false;
+        }
+        ServerRunRing(pFDP);
+        if(!canal_has_data(&pFDP->pSharedFDPSHM->ClientToServer))
+        {
+            continue;
+        }
+        const uint32_t u32InputBufferSize = ReadFDPData(pFDP->pSharedFDPSHM, &pFDP->pSharedFDPSHM->ClientToServer, pFDP->InputBuffer);
+        if(u32InputBufferSize == 0)
+        {
+            return false;
         }
+        bool           bStatus             = true;
+        const uint32_t u32OutputBuffersize = ServerCommand(pFDP, u32InputBufferSize, pFDP->CanalSize, &bStatus);
         // There is something to send !
         if(u32OutputBuffersize > 0)
         {
-            WriteFDPDataWithStatus(&pFDP->pSharedFDPSHM->ServerToClient, pFDP->OutputBuffer, u32OutputBuffersize, bStatus);
-            u32OutputBuffersize = 0;
+            WriteFDPDataWithStatus(pFDP->pSharedFDPSHM, &pFDP->pSharedFDPSHM->ServerToClient, pFDP->OutputBuffer, u32OutputBuffersize, bStatus);
         }
     }
     return true;
@@ -1305,10 +4060,75 @@ bool FDP_SetFDPServer(FDP_SHM* pFDP, FDP_SERVER_INTERFACE_T* pFDPServer)
     return true;
 }
 
+FDP_EXPORTED
+bool FDP_SetReplayFile(FDP_SHM* pFDP, const char* pPath)
+{
+    if(pFDP == NULL || pPath == NULL)
+    {
+        return false;
+    }
+    FDP_REPLAY_* pReplay = LoadReplay(pPath);
+    if(pReplay == NULL)
+    {
+        return false;
+    }
+    DeleteReplay(pFDP->pReplay);
+    pFDP->pReplay = pReplay;
+    return true;
+}
+
+FDP_EXPORTED
+uint64_t FDP_GetReplayMisses(FDP_SHM* pFDP)
+{
+    if(pFDP == NULL || pFDP->pReplay == NULL)
+    {
+        return 0;
+    }
+    return pFDP->pReplay->Misses;
+}
+
 FDP_EXPORTED
 bool FDP_SetFDPServerRunning(FDP_SHM* pFDP, bool bRunning)
 {
     pFDP->pFdpServer->bIsRunning = bRunning;
+    // wake FDP_ServerLoop so it can exit
+    ring_doorbell(&pFDP->pSharedFDPSHM->ClientToServer);
+    return true;
+}
+
+FDP_EXPORTED
+bool FDP_CreatePhysicalMemorySHM(FDP_SHM* pFDP, const char* pShmName)
+{
+    if(pFDP == NULL || pFDP->pFdpServer == NULL || pShmName == NULL)
+    {
+        return false;
+    }
+    if(pFDP->pRamShm != NULL)
+    {
+        return true;
+    }
+    FDP_PHYSICAL_RANGE_T aRanges[FDP_MAX_PHYSICAL_RANGES];
+    const uint32_t       RangeCount = GetServerPhysicalRanges(pFDP, aRanges);
+    uint64_t             Size       = FDP_RAM_SHM_DATA_OFFSET;
+    for(uint32_t i = 0; i < RangeCount; ++i)
+    {
+        Size += AlignRamShmSize(aRanges[i].Size);
+    }
+    if(RangeCount == 0 || Size != (size_t) Size)
+    {
+        return false;
+    }
+    char aRamShmName[512];
+    GetRamShmName(aRamShmName, sizeof aRamShmName, pShmName);
+    FDP_RAM_SHM* pRam = (FDP_RAM_SHM*) CreateShm(aRamShmName, (size_t) Size);
+    if(pRam == NULL)
+    {
+        return false;
+    }
+    memset(pRam, 0, sizeof *pRam);
+    pRam->generation = 1;
+    pRam->size       = Size;
+    pFDP->pRamShm    = pRam;
     return true;
 }
 
@@ -1356,6 +4176,7 @@ bool FDP_ClientServerTest()
 {
     // Building FDP Server Interface
     FDP_SERVER_INTERFACE_T FDPServerInterface;
+    memset(&FDPServerInterface, 0, sizeof FDPServerInterface);
     // FDPServerInterface.bIsRunning = true;
     FDPServerInterface.pUserHandle      = NULL;
     FDPServerInterface.pfnReadRegister  = FDP_DummyReadRegister;
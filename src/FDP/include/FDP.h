@@ -53,6 +53,10 @@ extern "C"
 
 #define FDP_NO_CR3 0
 
+// FDP_CreateSHMEx/FDP_OpenSHMEx flags, shared by both peers
+#define FDP_SHM_FLAG_FUTEX_WAIT 0x1 // block on futexes instead of sleeping (linux only)
+#define FDP_SHM_FLAG_HUGEPAGES  0x2 // back the shared memory with transparent huge pages (linux only)
+
     typedef struct _uint128_t_
     {
         uint64_t high;
@@ -82,6 +86,102 @@ extern "C"
 
 #define FDP_MAX_BREAKPOINT 1024
 
+// vCPUs with a context published in the "CPU_<name>" segment
+#define FDP_MAX_CPU 64
+
+// guest memory exported by the server, see FDP_SyncPhysicalMemory
+#define FDP_MAX_PHYSICAL_RANGES 64
+
+// snapshots kept by the server, see FDP_SaveSlot
+#define FDP_MAX_SNAPSHOT_SLOTS 16
+
+// asynchronous command ring, see FDP_Submit* & FDP_Poll
+#define FDP_RING_SLOT_COUNT     32
+#define FDP_RING_SLOT_DATA_SIZE (64 * 1024)
+
+// largest command or answer in one round trip, selected by the server, see FDP_CreateSHMSized
+#define FDP_DEFAULT_CANAL_SIZE (10 * 1024 * 1024)
+#define FDP_MIN_CANAL_SIZE     FDP_RING_SLOT_DATA_SIZE
+#define FDP_MAX_CANAL_SIZE     (1024 * 1024 * 1024)
+
+    // one read in a FDP_ReadMemoryVector batch
+    typedef struct FDP_READ_VECTOR_T_
+    {
+        uint8_t*        pDstBuffer;  // destination buffer, at least ReadSize bytes
+        uint64_t        Address;     // virtual or physical address, see AddressType
+        uint64_t        Dtb;         // virtual only, FDP_NO_CR3 to use current cr3
+        uint32_t        ReadSize;
+        FDP_AddressType AddressType;
+        bool            bSuccess;    // set on return
+    } FDP_READ_VECTOR_T;
+
+#define FDP_TRANSLATE_PRESENT    0x1
+#define FDP_TRANSLATE_LARGE_PAGE 0x2 // mapped by a 2MB or 1GB page
+
+    // one translation in a FDP_TranslateVector batch
+    typedef struct FDP_TRANSLATE_T_
+    {
+        uint64_t VirtualAddress;
+        uint64_t PhysicalAddress; // set on return
+        uint32_t Flags;           // set on return, FDP_TRANSLATE_* flags
+    } FDP_TRANSLATE_T;
+
+// bytes needed by the FDP_ReadVirtualMemoryPartial fault bitmap, one bit per touched page
+#define FDP_FAULT_BITMAP_SIZE(VirtualAddress, ReadSize) \
+    ((((((VirtualAddress) & 0xFFF) + (uint64_t)(ReadSize) + 0xFFF) >> 12) + 7) / 8)
+
+// client statistics, see FDP_GetStatistics
+#define FDP_MAX_COMMANDS    64  // room for every command type
+#define FDP_LATENCY_BUCKETS 128 // log-linear, 4 buckets per power of two nanoseconds
+
+    // canal commands of one type sent by a client, ring commands are not counted
+    typedef struct FDP_COMMAND_STATISTICS_T_
+    {
+        uint64_t Calls;
+        uint64_t BytesSent;
+        uint64_t BytesReceived;
+        uint64_t TotalNs;  // from sending a request to reading its answer
+        uint64_t SleepNs;  // part of TotalNs the client was asleep, the rest was spent spinning
+        uint64_t MaxNs;
+        uint64_t LatencyBuckets[FDP_LATENCY_BUCKETS]; // see FDP_GetLatencyBucketNs
+    } FDP_COMMAND_STATISTICS_T;
+
+    typedef struct FDP_STATISTICS_T_
+    {
+        FDP_COMMAND_STATISTICS_T Commands[FDP_MAX_COMMANDS]; // indexed by command type, see FDP_GetCommandName
+        uint64_t                 CpuCtxReads;                // register & msr reads served from the published cpu context
+        uint64_t                 RamShmReads;                // physical reads served from the exported guest memory
+    } FDP_STATISTICS_T;
+
+    // evaluated by the server on each hit, the VM only pauses when the
+    // 8 bytes at MatchAddress hold MatchValue (e.g. KPCR CurrentThread)
+    typedef struct FDP_BREAKPOINT_MATCH_T_
+    {
+        FDP_MatchType MatchType;
+        uint64_t      MatchAddress;
+        uint64_t      MatchValue;
+    } FDP_BREAKPOINT_MATCH_T;
+
+    // one breakpoint in a FDP_SetBreakpoints batch, see FDP_SetBreakpoint
+    typedef struct FDP_BREAKPOINT_T_
+    {
+        uint32_t               CpuId;
+        FDP_BreakpointType     BreakpointType;
+        int                    BreakpointId;
+        FDP_Access             BreakpointAccessType;
+        FDP_AddressType        BreakpointAddressType;
+        uint64_t               BreakpointAddress;
+        uint64_t               BreakpointLength;
+        uint64_t               BreakpointCr3;
+        FDP_BREAKPOINT_MATCH_T Match; // FDP_NO_MATCH to pause on every hit
+    } FDP_BREAKPOINT_T;
+
+    typedef struct FDP_PHYSICAL_RANGE_T_
+    {
+        uint64_t PhysicalAddress;
+        uint64_t Size;
+    } FDP_PHYSICAL_RANGE_T;
+
     typedef struct FDP_SHM_ FDP_SHM;
 
     typedef struct _FDP_SERVER_INTERFACE_T
@@ -115,19 +215,43 @@ extern "C"
         bool    (*pfnRestore)               (void*);
         bool    (*pfnReboot)                (void*);
         bool    (*pfnInjectInterrupt)       (void*, uint32_t, uint32_t, uint32_t, uint64_t);
+        bool    (*pfnReadVirtualMemoryDtb)  (void*, uint32_t, uint64_t, uint64_t, uint32_t, uint8_t*);
+        bool    (*pfnWriteVirtualMemoryDtb) (void*, uint32_t, uint64_t, uint8_t*, uint64_t, uint32_t);
+        bool    (*pfnVirtualToPhysicalDtb)  (void*, uint32_t, uint64_t, uint64_t, uint64_t*);
+        bool    (*pfnGetPhysicalRanges)     (void*, FDP_PHYSICAL_RANGE_T*, uint32_t*); // optional, in: max ranges, out: range count
+        bool    (*pfnSetBreakpoints)        (void*, const FDP_BREAKPOINT_T*, uint32_t, int*); // optional, ids are -1 on failure
+        bool    (*pfnUnsetAllBreakpoints)   (void*); // optional
+        bool    (*pfnSetBreakpointMatch)    (void*, int, const FDP_BREAKPOINT_MATCH_T*); // optional, breakpoints with a match fail without it
+        bool    (*pfnGetDirtyPages)         (void*, uint64_t, uint64_t*, uint32_t*); // optional, sorted page numbers from a first page, in: max pages, out: page count
+        bool    (*pfnResetDirtyLog)         (void*); // optional
     } FDP_SERVER_INTERFACE_T;
 
     // FDP API
     FDP_EXPORTED FDP_SHM*   FDP_CreateSHM               (const char* shmName);
     FDP_EXPORTED FDP_SHM*   FDP_OpenSHM                 (const char* pShmName);
+    FDP_EXPORTED FDP_SHM*   FDP_CreateSHMEx             (const char* shmName, uint32_t Flags);
+    FDP_EXPORTED FDP_SHM*   FDP_OpenSHMEx               (const char* pShmName, uint32_t Flags);
+    // CanalSize is clamped between FDP_MIN_CANAL_SIZE & FDP_MAX_CANAL_SIZE
+    FDP_EXPORTED FDP_SHM*   FDP_CreateSHMSized          (const char* shmName, uint32_t Flags, uint32_t CanalSize);
+    FDP_EXPORTED uint32_t   FDP_GetSHMFlags             (FDP_SHM* pShm);
+    FDP_EXPORTED uint32_t   FDP_GetCanalSize            (FDP_SHM* pShm);
     FDP_EXPORTED void       FDP_ExitSHM                 (FDP_SHM* pShm);
     FDP_EXPORTED bool       FDP_Init                    (FDP_SHM* pShm);
+    // process wide bounds of the random pause count when a lock is contended, doubled on each retry
+    // defaults to 32 & 1024
+    FDP_EXPORTED void       FDP_SetSpinBackoff          (uint32_t MinIters, uint32_t MaxIters);
     FDP_EXPORTED bool       FDP_Pause                   (FDP_SHM* pShm);
     FDP_EXPORTED bool       FDP_Resume                  (FDP_SHM* pShm);
     FDP_EXPORTED bool       FDP_ReadPhysicalMemory      (FDP_SHM* pShm, uint8_t* pDstBuffer, uint32_t ReadSize, uint64_t PhysicalAddress);
     FDP_EXPORTED bool       FDP_WritePhysicalMemory     (FDP_SHM* pShm, uint8_t* pSrcBuffer, uint32_t WriteSize, uint64_t PhysicalAddress);
     FDP_EXPORTED bool       FDP_ReadVirtualMemory       (FDP_SHM* pShm, uint32_t CpuId, uint8_t* pDstBuffer, uint32_t ReadSize, uint64_t VirtualAddress);
     FDP_EXPORTED bool       FDP_WriteVirtualMemory      (FDP_SHM* pShm, uint32_t CpuId, uint8_t* pSrcBuffer, uint32_t WriteSize, uint64_t VirtualAddress);
+    FDP_EXPORTED bool       FDP_ReadVirtualMemoryDtb    (FDP_SHM* pShm, uint32_t CpuId, uint64_t Dtb, uint8_t* pDstBuffer, uint32_t ReadSize, uint64_t VirtualAddress);
+    // read what is mapped & zero the rest, bit i of pFaultBitmap is set when the i-th page from VirtualAddress faulted
+    // pFaultBitmap holds FDP_FAULT_BITMAP_SIZE bytes, returns false only when the read could not be served
+    FDP_EXPORTED bool       FDP_ReadVirtualMemoryPartial(FDP_SHM* pShm, uint32_t CpuId, uint64_t Dtb, uint8_t* pDstBuffer, uint32_t ReadSize, uint64_t VirtualAddress, uint8_t* pFaultBitmap);
+    FDP_EXPORTED bool       FDP_WriteVirtualMemoryDtb   (FDP_SHM* pShm, uint32_t CpuId, uint64_t Dtb, uint8_t* pSrcBuffer, uint32_t WriteSize, uint64_t VirtualAddress);
+    FDP_EXPORTED bool       FDP_ReadMemoryVector        (FDP_SHM* pShm, uint32_t CpuId, FDP_READ_VECTOR_T* pEntries, uint32_t EntryCount);
     FDP_EXPORTED uint64_t   FDP_SearchPhysicalMemory    (FDP_SHM* pShm, const void* pPatternData, uint32_t PatternSize, uint64_t StartOffset);
     FDP_EXPORTED bool       FDP_SearchVirtualMemory     (FDP_SHM* pFDP, uint32_t CpuId, const void* pPatternData, uint32_t PatternSize, uint64_t StartOffset);
     FDP_EXPORTED bool       FDP_ReadRegister            (FDP_SHM* pShm, uint32_t CpuId, FDP_Register RegisterId, uint64_t* pRegisterValue);
@@ -135,8 +259,15 @@ extern "C"
     FDP_EXPORTED bool       FDP_ReadMsr                 (FDP_SHM* pShm, uint32_t CpuId, uint64_t MsrId, uint64_t* pMsrValue);
     FDP_EXPORTED bool       FDP_WriteMsr                (FDP_SHM* pShm, uint32_t CpuId, uint64_t MsrId, uint64_t MsrValue);
     FDP_EXPORTED int        FDP_SetBreakpoint           (FDP_SHM* pShm, uint32_t CpuId, FDP_BreakpointType BreakpointType, int BreakpointId, FDP_Access BreakpointAccessType, FDP_AddressType BreakpointAddressType, uint64_t BreakpointAddress, uint64_t BreakpointLength, uint64_t BreakpointCr3);
+    FDP_EXPORTED int        FDP_SetBreakpointEx         (FDP_SHM* pShm, const FDP_BREAKPOINT_T* pBreakpoint);
     FDP_EXPORTED bool       FDP_UnsetBreakpoint         (FDP_SHM* pShm, int BreakpointId);
+    FDP_EXPORTED bool       FDP_SetBreakpoints          (FDP_SHM* pShm, const FDP_BREAKPOINT_T* pBreakpoints, uint32_t Count, int* pBreakpointIds);
+    FDP_EXPORTED bool       FDP_UnsetAllBreakpoints     (FDP_SHM* pShm);
     FDP_EXPORTED bool       FDP_VirtualToPhysical       (FDP_SHM* pShm, uint32_t CpuId, uint64_t VirtualAddress, uint64_t* pPhysicalAddress);
+    FDP_EXPORTED bool       FDP_VirtualToPhysicalDtb    (FDP_SHM* pShm, uint32_t CpuId, uint64_t Dtb, uint64_t VirtualAddress, uint64_t* pPhysicalAddress);
+    // translate every entry with the same dtb in one round trip, long mode paging only
+    // returns false if any entry is not present
+    FDP_EXPORTED bool       FDP_TranslateVector         (FDP_SHM* pShm, uint32_t CpuId, uint64_t Dtb, FDP_TRANSLATE_T* pEntries, uint32_t EntryCount);
     FDP_EXPORTED bool       FDP_GetState                (FDP_SHM* pShm, FDP_State* pState);
     FDP_EXPORTED bool       FDP_GetFxState64            (FDP_SHM* pShm, uint32_t CpuId, FDP_XSAVE_FORMAT64_T* pFxState64);
     FDP_EXPORTED bool       FDP_SetFxState64            (FDP_SHM* pFDP, uint32_t CpuId, FDP_XSAVE_FORMAT64_T* pFxState64);
@@ -149,10 +280,49 @@ extern "C"
     FDP_EXPORTED bool       FDP_Restore                 (FDP_SHM* pShm);
     FDP_EXPORTED bool       FDP_GetStateChanged         (FDP_SHM* pShm);
     FDP_EXPORTED void       FDP_SetStateChanged         (FDP_SHM* pShm);
+    FDP_EXPORTED bool       FDP_WaitForStateChanged     (FDP_SHM* pShm, FDP_State* pState);
+    FDP_EXPORTED bool       FDP_WaitForStateChangedTimeout(FDP_SHM* pShm, FDP_State* pState, uint32_t TimeoutMs);
+    // queue a command on the ring, false when full. Answers are written by FDP_Poll
+    FDP_EXPORTED bool       FDP_SubmitReadPhysicalMemory(FDP_SHM* pShm, uint8_t* pDstBuffer, uint32_t ReadSize, uint64_t PhysicalAddress, uint32_t* pTag);
+    FDP_EXPORTED bool       FDP_SubmitReadVirtualMemory (FDP_SHM* pShm, uint32_t CpuId, uint64_t Dtb, uint8_t* pDstBuffer, uint32_t ReadSize, uint64_t VirtualAddress, uint32_t* pTag);
+    FDP_EXPORTED bool       FDP_SubmitReadRegister      (FDP_SHM* pShm, uint32_t CpuId, FDP_Register RegisterId, uint64_t* pRegisterValue, uint32_t* pTag);
+    FDP_EXPORTED bool       FDP_SubmitReadMsr           (FDP_SHM* pShm, uint32_t CpuId, uint64_t MsrId, uint64_t* pMsrValue, uint32_t* pTag);
+    FDP_EXPORTED bool       FDP_SubmitWriteRegister     (FDP_SHM* pShm, uint32_t CpuId, FDP_Register RegisterId, uint64_t RegisterValue, uint32_t* pTag);
+    FDP_EXPORTED bool       FDP_SubmitSetBreakpoint     (FDP_SHM* pShm, uint32_t CpuId, FDP_BreakpointType BreakpointType, int BreakpointId, FDP_Access BreakpointAccessType, FDP_AddressType BreakpointAddressType, uint64_t BreakpointAddress, uint64_t BreakpointLength, uint64_t BreakpointCr3, int* pBreakpointId, uint32_t* pTag);
+    FDP_EXPORTED bool       FDP_SubmitUnsetBreakpoint   (FDP_SHM* pShm, int BreakpointId, uint32_t* pTag);
+    FDP_EXPORTED bool       FDP_Poll                    (FDP_SHM* pShm, uint32_t TimeoutMs, uint32_t* pTag, bool* pbSuccess);
+    // ask the server for a snapshot of guest memory, FDP_ReadPhysicalMemory then reads it directly until the guest runs again
+    FDP_EXPORTED bool       FDP_SyncPhysicalMemory      (FDP_SHM* pShm);
+    // physical page numbers written since the last FDP_ResetDirtyLog, sorted & starting at FirstPage
+    // in: max pages, out: page count, fewer pages than requested means there are no more
+    FDP_EXPORTED bool       FDP_GetDirtyPages           (FDP_SHM* pShm, uint64_t FirstPage, uint64_t* pPages, uint32_t* pPageCount);
+    FDP_EXPORTED bool       FDP_ResetDirtyLog           (FDP_SHM* pShm);
+    // snapshot a paused VM into a server slot, saving again only copies pages dirtied since
+    // restoring rewrites pages dirtied since the slot was taken & the cpu context, not device state
+    FDP_EXPORTED bool       FDP_SaveSlot                (FDP_SHM* pShm, uint32_t SlotId);
+    FDP_EXPORTED bool       FDP_RestoreSlot             (FDP_SHM* pShm, uint32_t SlotId);
     FDP_EXPORTED bool       FDP_InjectInterrupt         (FDP_SHM* pShm, uint32_t CpuId, uint32_t uInterruptionCode, uint32_t uErrorCode, uint64_t Cr2Value);
     FDP_EXPORTED bool       FDP_SetFDPServer            (FDP_SHM* pFDP, FDP_SERVER_INTERFACE_T* pFDPServer);
     FDP_EXPORTED bool       FDP_SetFDPServerRunning     (FDP_SHM* pFDP, bool bRunning);
     FDP_EXPORTED bool       FDP_ServerLoop              (FDP_SHM* pFDP);
+    // export guest memory as "RAM_<name>", call after FDP_SetFDPServer
+    FDP_EXPORTED bool       FDP_CreatePhysicalMemorySHM (FDP_SHM* pFDP, const char* pShmName);
+    // count commands sent by this client & their latencies, disabled by default
+    FDP_EXPORTED bool       FDP_EnableStatistics        (FDP_SHM* pShm, bool bEnable);
+    FDP_EXPORTED bool       FDP_GetStatistics           (FDP_SHM* pShm, FDP_STATISTICS_T* pStatistics);
+    FDP_EXPORTED bool       FDP_ResetStatistics         (FDP_SHM* pShm);
+    // NULL for unknown command types
+    FDP_EXPORTED const char* FDP_GetCommandName        (uint32_t CommandType);
+    // smallest latency counted in a bucket, a bucket ends where the next one starts
+    FDP_EXPORTED uint64_t   FDP_GetLatencyBucketNs      (uint32_t Bucket);
+    // log every command sent on the canal & every state change seen by this client into pPath
+    // register & memory fast paths are bypassed while recording, ring commands are not recorded
+    FDP_EXPORTED bool       FDP_StartRecording          (FDP_SHM* pShm, const char* pPath);
+    FDP_EXPORTED void       FDP_StopRecording           (FDP_SHM* pShm);
+    // answer commands from a FDP_StartRecording log instead of the server interface, call before FDP_ServerLoop
+    FDP_EXPORTED bool       FDP_SetReplayFile           (FDP_SHM* pFDP, const char* pPath);
+    // requests not found in the replayed log, a replay is faithful while this stays at zero
+    FDP_EXPORTED uint64_t   FDP_GetReplayMisses         (FDP_SHM* pFDP);
 
     uint8_t FDP_Test(FDP_SHM* pShm);
 
@@ -62,6 +62,16 @@ enum FDP_Access_
 };
 typedef uint16_t FDP_Access;
 
+// breakpoint hit predicate, see FDP_BREAKPOINT_MATCH_T
+enum FDP_MatchType_
+{
+    FDP_NO_MATCH          = 0x0,
+    FDP_MATCH_VIRTUAL     = 0x01, // MatchAddress is a guest virtual address
+    FDP_MATCH_GS_RELATIVE = 0x02, // MatchAddress is an offset from the current gs base
+    FDP_MATCH_HACK        = 0xFFFF
+};
+typedef uint16_t FDP_MatchType;
+
 enum FDP_State_
 {
     FDP_STATE_NULL                = 0x0,
@@ -68,9 +68,63 @@ typedef struct FDP_CPU_CTX_
     uint64_t cr2;
     uint64_t cr3;
     uint64_t cr4;
+    uint64_t cr8;
+
+    uint64_t dr0;
+    uint64_t dr1;
+    uint64_t dr2;
+    uint64_t dr3;
+    uint64_t dr6;
+    uint64_t dr7;
+
+    uint64_t gdtr_base;
+    uint64_t gdtr_limit;
+    uint64_t idtr_base;
+    uint64_t idtr_limit;
+    uint64_t ldtr;
+    uint64_t ldtr_base;
+    uint64_t ldtr_limit;
+    uint64_t tr;
+
+    uint64_t efer;
+    uint64_t star;
+    uint64_t lstar;
+    uint64_t cstar;
+    uint64_t sfmask;
+    uint64_t fs_base;
+    uint64_t gs_base;
+    uint64_t kernel_gs_base;
+    uint64_t sysenter_cs;
+    uint64_t sysenter_esp;
+    uint64_t sysenter_eip;
+
+    // 0 until first published, odd while the server updates the context
+    volatile uint32_t generation;
 } FDP_CPU_CTX;
+
+// "CPU_<name>" segment, one FDP_CPU_CTX per vCPU indexed by cpu id
+#define FDP_CPU_SHM_SIZE (FDP_MAX_CPU * sizeof(FDP_CPU_CTX))
+
+typedef struct FDP_RAM_RANGE_
+{
+    uint64_t PhysicalAddress;
+    uint64_t Size;
+    uint64_t Offset; // from the start of the segment
+} FDP_RAM_RANGE;
+
+// header of the "RAM_<name>" segment, guest memory follows at FDP_RAM_SHM_DATA_OFFSET
+typedef struct FDP_RAM_SHM_
+{
+    // odd while the snapshot is stale or being copied
+    volatile uint32_t generation;
+    uint32_t          rangeCount;
+    uint64_t          size; // whole segment size
+    FDP_RAM_RANGE     ranges[FDP_MAX_PHYSICAL_RANGES];
+} FDP_RAM_SHM;
 #pragma pack(pop)
 
+#define FDP_RAM_SHM_DATA_OFFSET 0x1000
+
 enum
 {
     FDPCMD_INIT,
@@ -103,7 +157,18 @@ enum
     FDPCMD_SAVE,
     FDPCMD_RESTORE,
     FDPCMD_INJECT_INTERRUPT,
-    FDPCMD_TEST
+    FDPCMD_TEST,
+    FDPCMD_READ_VECTOR,
+    FDPCMD_SYNC_PHYSICAL_MEMORY,
+    FDPCMD_SET_BREAKPOINTS,
+    FDPCMD_UNSET_ALL_BREAKPOINTS,
+    FDPCMD_GET_DIRTY_PAGES,
+    FDPCMD_RESET_DIRTY_LOG,
+    FDPCMD_SAVE_SLOT,
+    FDPCMD_RESTORE_SLOT,
+    FDPCMD_TRANSLATE_VECTOR,
+    FDPCMD_READ_VIRTUAL_PARTIAL,
+    FDPCMD_COUNT, // keep last
 };
 
 typedef struct _FDP_UnsetBreakpoint_req
@@ -124,43 +189,100 @@ typedef struct _FDP_SetBreakpoint_req
 #    pragma warning(disable : 4200)
 #endif
 
-#define FDP_1M            1024 * 1024
-#define FDP_MAX_DATA_SIZE 10 * FDP_1M
-
 #ifdef FDP_INTERNAL_ONLY
 
 #    include <atomic>
 
+// single producer, single consumer: data is present while writeSeq != readSeq
 typedef struct FDP_SHM_CANAL_
 {
-    volatile uint8_t  data[FDP_MAX_DATA_SIZE];
-    volatile uint32_t dataSize;
-    std::atomic_bool  lock;         // Per channel lock
-    std::atomic_bool  bDataPresent; // is data present
-    volatile bool     bStatus;
-    uint8_t           _; // padding
+    uint64_t              dataOffset; // from the start of the segment
+    uint32_t              capacity;   // negotiated canal size
+    volatile uint32_t     dataSize;
+    std::atomic<uint32_t> writeSeq; // bumped by the producer once data is written, futex word
+    std::atomic<uint32_t> readSeq;  // bumped by the consumer once data is read, futex word
+    std::atomic<uint32_t> waiters;  // futex waiters on writeSeq, readSeq & doorbell
+    std::atomic<uint32_t> doorbell; // bumped on every write & ring submission, futex word
+    volatile bool         bStatus;
+    volatile bool         bFutexWait; // FDP_SHM_FLAG_FUTEX_WAIT
+    uint8_t               _[6];       // padding
 } FDP_SHM_CANAL;
 
+enum
+{
+    FDP_RING_SLOT_FREE,
+    FDP_RING_SLOT_SUBMITTED,
+    FDP_RING_SLOT_COMPLETED,
+};
+
+typedef struct FDP_SHM_RING_SLOT_
+{
+    std::atomic<uint32_t> state;    // FDP_RING_SLOT_*
+    volatile uint32_t     dataSize; // request size, then answer size
+    volatile bool         bStatus;
+    uint8_t               _[3]; // padding
+    volatile uint8_t      data[FDP_RING_SLOT_DATA_SIZE];
+} FDP_SHM_RING_SLOT;
+
+// requests are handled in submission order, completions are collected in any order
+typedef struct FDP_SHM_RING_
+{
+    std::atomic_bool      lock; // client side lock
+    uint8_t               _[3]; // padding
+    std::atomic<uint32_t> submitIndex; // next slot used by the client
+    std::atomic<uint32_t> serverIndex; // next slot handled by the server
+    std::atomic<uint32_t> completed;   // bumped on every completion, futex word
+    std::atomic<uint32_t> waiters;     // futex waiters on completed
+    uint32_t              _pad;        // padding
+    FDP_SHM_RING_SLOT     slots[FDP_RING_SLOT_COUNT];
+} FDP_SHM_RING;
+
+// bump on every change to the shared layout or to the canal protocol
+#    define FDP_ABI_VERSION 2
+
 typedef struct FDP_SHM_SHARED_
 {
-    std::atomic_bool lock; // General lock for the whole FDP_SHM_SHARED
-    std::atomic_bool stateChangedLock;
-    volatile bool    stateChanged;
-    uint8_t          _; // padding
-    FDP_SHM_CANAL    ClientToServer;
-    FDP_SHM_CANAL    ServerToClient;
+    uint32_t              abiVersion;      // FDP_ABI_VERSION, first so it is found in any layout
+    std::atomic_bool      lock;            // Client side lock, one command at a time on the canals
+    std::atomic_bool      stateChanged;    // set by the server, cleared by FDP_GetStateChanged
+    uint8_t               _[2];            // padding
+    std::atomic<uint32_t> flags;           // FDP_SHM_FLAG_*
+    std::atomic<uint32_t> stateChangedSeq; // bumped on every state change, futex word
+    uint64_t              size;            // whole segment, canal data follows this header
+    FDP_SHM_CANAL         ClientToServer;
+    FDP_SHM_CANAL         ServerToClient;
+    FDP_SHM_RING          Ring;
 } FDP_SHM_SHARED;
 
+// where FDP_Poll copies a ring answer
+typedef struct FDP_RING_REQUEST_
+{
+    void*    pDst;
+    uint32_t DstSize;
+    uint32_t Tag;
+    uint8_t  AnswerType; // FDP_RING_ANSWER_*
+} FDP_RING_REQUEST;
+
 struct ALIGNED_(1) FDP_SHM_
 {
-    FDP_SHM_SHARED* pSharedFDPSHM;                   // Shared part of the FDP SHM
-    uint8_t         InputBuffer[FDP_MAX_DATA_SIZE];  // Used as temporary input buffer
-    uint8_t         OutputBuffer[FDP_MAX_DATA_SIZE]; // Used as temporary output buffer
+    FDP_SHM_SHARED* pSharedFDPSHM; // Shared part of the FDP SHM
+    uint32_t        CanalSize;     // Negotiated canal size, checked once at open
+    uint8_t*        InputBuffer;   // Used as temporary input buffer, CanalSize bytes
+    uint8_t*        OutputBuffer;  // Used as temporary output buffer, CanalSize bytes
 
     FDP_SERVER_INTERFACE_T* pFdpServer;
-    FDP_CPU_CTX*            pCpuShm;
+    FDP_CPU_CTX*            pCpuShm;   // FDP_MAX_CPU contexts, indexed by cpu id
+    FDP_RAM_SHM*            pRamShm;   // NULL when the server does not export guest memory
+    struct FDP_SLOTS_*      pSlots;    // Server side, NULL until the first FDP_SaveSlot
+    struct FDP_RECORDER_*   pRecorder; // Client side, NULL unless recording
+    struct FDP_REPLAY_*     pReplay;   // Server side, NULL unless replaying a recording
+    struct FDP_STATS_*      pStats;    // Client side, NULL until FDP_EnableStatistics
+
+    FDP_RING_REQUEST aRingRequests[FDP_RING_SLOT_COUNT]; // Client side, indexed like ring slots
+    uint32_t         RingNextTag;
 };
 
+// header only, see FDP_SHM_SHARED.size
 #    define FDP_SHM_SHARED_SIZE sizeof(FDP_SHM_SHARED)
 #endif
 
@@ -177,14 +299,46 @@ typedef struct FDP_READ_PHYSICAL_MEMORY_PKT_REQ_
     uint32_t ReadSize;
 } FDP_READ_PHYSICAL_MEMORY_PKT_REQ;
 
+// Dtb is FDP_NO_CR3 to use current cpu cr3
 typedef struct FDP_READ_VIRTUAL_MEMORY_PKT_REQ_
 {
     uint8_t  Type;
     uint32_t CpuId;
+    uint64_t Dtb;
     uint64_t VirtualAddress;
     uint32_t ReadSize;
 } FDP_READ_VIRTUAL_MEMORY_PKT_REQ;
 
+// FDPCMD_READ_VIRTUAL_PARTIAL reuses FDP_READ_VIRTUAL_MEMORY_PKT_REQ
+// answer is ReadSize bytes, zeroed on faulted pages, followed by a fault bitmap
+
+typedef struct FDP_READ_VECTOR_ENTRY_
+{
+    uint64_t        Address;
+    uint64_t        Dtb;
+    uint32_t        ReadSize;
+    FDP_AddressType AddressType;
+} FDP_READ_VECTOR_ENTRY;
+
+// answer is one status byte per entry followed by every entry data
+typedef struct FDP_READ_VECTOR_PKT_REQ_
+{
+    uint8_t               Type;
+    uint32_t              CpuId;
+    uint32_t              EntryCount;
+    FDP_READ_VECTOR_ENTRY Entries[];
+} FDP_READ_VECTOR_PKT_REQ;
+
+// answer is every physical address followed by one FDP_TRANSLATE_* flags byte per entry
+typedef struct FDP_TRANSLATE_VECTOR_PKT_REQ_
+{
+    uint8_t  Type;
+    uint32_t CpuId;
+    uint64_t Dtb;
+    uint32_t EntryCount;
+    uint64_t VirtualAddresses[];
+} FDP_TRANSLATE_VECTOR_PKT_REQ;
+
 typedef struct FDP_WRITE_PHYSICAL_MEMORY_PKT_REQ_
 {
     uint8_t  Type;
@@ -197,6 +351,7 @@ typedef struct FDP_WRITE_VIRTUAL_MEMORY_PKT_REQ_
 {
     uint8_t  Type;
     uint32_t CpuId;
+    uint64_t Dtb;
     uint64_t VirtualAddress;
     uint32_t WriteSize;
     uint8_t  Data[];
@@ -254,6 +409,7 @@ typedef struct FDP_VIRTUAL_PHYSICAL_PKT_REQ
 {
     uint8_t  Type;
     uint32_t CpuId;
+    uint64_t Dtb;
     uint64_t VirtualAddress;
 } FDP_VIRTUAL_PHYSICAL_PKT_REQ;
 
@@ -283,17 +439,46 @@ typedef struct FDP_UNSET_BREAKPOINT_PKT_REQ
 
 typedef struct FDP_SET_BREAKPOINT_PKT_REQ_
 {
-    uint8_t            Type;
-    uint32_t           CpuId;
-    FDP_BreakpointType BreakpointType;
-    int                BreakpointId;
-    FDP_Access         BreakpointAccessType;
-    FDP_AddressType    BreakpointAddressType;
-    uint64_t           BreakpointAddress;
-    uint64_t           BreakpointLength;
-    uint64_t           BreakpointCr3;
+    uint8_t                Type;
+    uint32_t               CpuId;
+    FDP_BreakpointType     BreakpointType;
+    int                    BreakpointId;
+    FDP_Access             BreakpointAccessType;
+    FDP_AddressType        BreakpointAddressType;
+    uint64_t               BreakpointAddress;
+    uint64_t               BreakpointLength;
+    uint64_t               BreakpointCr3;
+    FDP_BREAKPOINT_MATCH_T Match;
 } FDP_SET_BREAKPOINT_PKT_REQ;
 
+// answer is one breakpoint id per entry
+typedef struct FDP_SET_BREAKPOINTS_PKT_REQ_
+{
+    uint8_t          Type;
+    uint32_t         Count;
+    FDP_BREAKPOINT_T Breakpoints[];
+} FDP_SET_BREAKPOINTS_PKT_REQ;
+
+typedef struct FDP_GET_DIRTY_PAGES_PKT_REQ_
+{
+    uint8_t  Type;
+    uint64_t FirstPage;
+    uint32_t MaxCount;
+} FDP_GET_DIRTY_PAGES_PKT_REQ;
+
+// never empty, canal answers must have data
+typedef struct FDP_GET_DIRTY_PAGES_PKT_ANS_
+{
+    uint32_t Count;
+    uint64_t Pages[];
+} FDP_GET_DIRTY_PAGES_PKT_ANS;
+
+typedef struct FDP_SLOT_PKT_REQ_
+{
+    uint8_t  Type;
+    uint32_t SlotId;
+} FDP_SLOT_PKT_REQ;
+
 typedef struct FDP_INJECT_INTERRUPT_PKT_REQ_
 {
     uint8_t  Type;
@@ -0,0 +1,1045 @@
+#include "include/MockFDP.h"
+
+#include <FDP.h>
+#include <FDP_structs.h>
+
+#ifdef _MSC_VER
+#    define NOMINMAX
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    constexpr uint64_t PAGE_SIZE      = 0x1000;
+    constexpr uint64_t PAGE_MASK      = ~(PAGE_SIZE - 1);
+    constexpr uint64_t PTE_PRESENT    = 1 << 0;
+    constexpr uint64_t PTE_LARGE      = 1 << 7;
+    constexpr uint64_t PTE_ADDR_MASK  = 0x000FFFFFFFFFF000;
+    constexpr uint64_t DUMP_CHUNK     = 1024 * 1024;
+    constexpr uint32_t MSR_FS_BASE    = 0xC0000100;
+    constexpr uint32_t MSR_GS_BASE    = 0xC0000101;
+    constexpr uint32_t MSR_KERNEL_GS  = 0xC0000102;
+    constexpr uint32_t MSR_EFER       = 0xC0000080;
+    constexpr uint32_t MSR_STAR       = 0xC0000081;
+    constexpr uint32_t MSR_LSTAR      = 0xC0000082;
+    constexpr uint32_t MSR_CSTAR      = 0xC0000083;
+    constexpr uint32_t MSR_SFMASK     = 0xC0000084;
+    constexpr uint32_t MSR_SYSENTER_C = 0x174;
+    constexpr uint32_t MSR_SYSENTER_S = 0x175;
+    constexpr uint32_t MSR_SYSENTER_I = 0x176;
+
+    struct CtxField
+    {
+        const char* name;
+        size_t      offset;
+    };
+
+#define CTX_FIELD(X) CtxField{#X, offsetof(FDP_CPU_CTX, X)}
+    const CtxField ctx_fields[] =
+    {
+        CTX_FIELD(rip), CTX_FIELD(rax), CTX_FIELD(rcx), CTX_FIELD(rdx), CTX_FIELD(rbx),
+        CTX_FIELD(rsp), CTX_FIELD(rbp), CTX_FIELD(rsi), CTX_FIELD(rdi), CTX_FIELD(r8),
+        CTX_FIELD(r9), CTX_FIELD(r10), CTX_FIELD(r11), CTX_FIELD(r12), CTX_FIELD(r13),
+        CTX_FIELD(r14), CTX_FIELD(r15), CTX_FIELD(es), CTX_FIELD(cs), CTX_FIELD(ss),
+        CTX_FIELD(ds), CTX_FIELD(fs), CTX_FIELD(gs), CTX_FIELD(rflags), CTX_FIELD(cr0),
+        CTX_FIELD(cr2), CTX_FIELD(cr3), CTX_FIELD(cr4), CTX_FIELD(cr8), CTX_FIELD(dr0),
+        CTX_FIELD(dr1), CTX_FIELD(dr2), CTX_FIELD(dr3), CTX_FIELD(dr6), CTX_FIELD(dr7),
+        CTX_FIELD(gdtr_base), CTX_FIELD(gdtr_limit), CTX_FIELD(idtr_base), CTX_FIELD(idtr_limit),
+        CTX_FIELD(ldtr), CTX_FIELD(ldtr_base), CTX_FIELD(ldtr_limit), CTX_FIELD(tr),
+        CTX_FIELD(efer), CTX_FIELD(star), CTX_FIELD(lstar), CTX_FIELD(cstar), CTX_FIELD(sfmask),
+        CTX_FIELD(fs_base), CTX_FIELD(gs_base), CTX_FIELD(kernel_gs_base),
+        CTX_FIELD(sysenter_cs), CTX_FIELD(sysenter_esp), CTX_FIELD(sysenter_eip),
+    };
+#undef CTX_FIELD
+
+    constexpr size_t ctx_none = ~size_t(0);
+
+    size_t GetRegisterOffset(FDP_Register RegisterId)
+    {
+        switch(RegisterId)
+        {
+            case FDP_RAX_REGISTER: return offsetof(FDP_CPU_CTX, rax);
+            case FDP_RBX_REGISTER: return offsetof(FDP_CPU_CTX, rbx);
+            case FDP_RCX_REGISTER: return offsetof(FDP_CPU_CTX, rcx);
+            case FDP_RDX_REGISTER: return offsetof(FDP_CPU_CTX, rdx);
+            case FDP_R8_REGISTER: return offsetof(FDP_CPU_CTX, r8);
+            case FDP_R9_REGISTER: return offsetof(FDP_CPU_CTX, r9);
+            case FDP_R10_REGISTER: return offsetof(FDP_CPU_CTX, r10);
+            case FDP_R11_REGISTER: return offsetof(FDP_CPU_CTX, r11);
+            case FDP_R12_REGISTER: return offsetof(FDP_CPU_CTX, r12);
+            case FDP_R13_REGISTER: return offsetof(FDP_CPU_CTX, r13);
+            case FDP_R14_REGISTER: return offsetof(FDP_CPU_CTX, r14);
+            case FDP_R15_REGISTER: return offsetof(FDP_CPU_CTX, r15);
+            case FDP_RSP_REGISTER: return offsetof(FDP_CPU_CTX, rsp);
+            case FDP_RBP_REGISTER: return offsetof(FDP_CPU_CTX, rbp);
+            case FDP_RSI_REGISTER: return offsetof(FDP_CPU_CTX, rsi);
+            case FDP_RDI_REGISTER: return offsetof(FDP_CPU_CTX, rdi);
+            case FDP_RIP_REGISTER: return offsetof(FDP_CPU_CTX, rip);
+            case FDP_DR0_REGISTER: return offsetof(FDP_CPU_CTX, dr0);
+            case FDP_DR1_REGISTER: return offsetof(FDP_CPU_CTX, dr1);
+            case FDP_DR2_REGISTER: return offsetof(FDP_CPU_CTX, dr2);
+            case FDP_DR3_REGISTER: return offsetof(FDP_CPU_CTX, dr3);
+            case FDP_DR6_REGISTER: return offsetof(FDP_CPU_CTX, dr6);
+            case FDP_DR7_REGISTER: return offsetof(FDP_CPU_CTX, dr7);
+            case FDP_VDR0_REGISTER: return offsetof(FDP_CPU_CTX, dr0);
+            case FDP_VDR1_REGISTER: return offsetof(FDP_CPU_CTX, dr1);
+            case FDP_VDR2_REGISTER: return offsetof(FDP_CPU_CTX, dr2);
+            case FDP_VDR3_REGISTER: return offsetof(FDP_CPU_CTX, dr3);
+            case FDP_VDR6_REGISTER: return offsetof(FDP_CPU_CTX, dr6);
+            case FDP_VDR7_REGISTER: return offsetof(FDP_CPU_CTX, dr7);
+            case FDP_CS_REGISTER: return offsetof(FDP_CPU_CTX, cs);
+            case FDP_DS_REGISTER: return offsetof(FDP_CPU_CTX, ds);
+            case FDP_ES_REGISTER: return offsetof(FDP_CPU_CTX, es);
+            case FDP_FS_REGISTER: return offsetof(FDP_CPU_CTX, fs);
+            case FDP_GS_REGISTER: return offsetof(FDP_CPU_CTX, gs);
+            case FDP_SS_REGISTER: return offsetof(FDP_CPU_CTX, ss);
+            case FDP_RFLAGS_REGISTER: return offsetof(FDP_CPU_CTX, rflags);
+            case FDP_GDTRB_REGISTER: return offsetof(FDP_CPU_CTX, gdtr_base);
+            case FDP_GDTRL_REGISTER: return offsetof(FDP_CPU_CTX, gdtr_limit);
+            case FDP_IDTRB_REGISTER: return offsetof(FDP_CPU_CTX, idtr_base);
+            case FDP_IDTRL_REGISTER: return offsetof(FDP_CPU_CTX, idtr_limit);
+            case FDP_CR0_REGISTER: return offsetof(FDP_CPU_CTX, cr0);
+            case FDP_CR2_REGISTER: return offsetof(FDP_CPU_CTX, cr2);
+            case FDP_CR3_REGISTER: return offsetof(FDP_CPU_CTX, cr3);
+            case FDP_CR4_REGISTER: return offsetof(FDP_CPU_CTX, cr4);
+            case FDP_CR8_REGISTER: return offsetof(FDP_CPU_CTX, cr8);
+            case FDP_LDTR_REGISTER: return offsetof(FDP_CPU_CTX, ldtr);
+            case FDP_LDTRB_REGISTER: return offsetof(FDP_CPU_CTX, ldtr_base);
+            case FDP_LDTRL_REGISTER: return offsetof(FDP_CPU_CTX, ldtr_limit);
+            case FDP_TR_REGISTER: return offsetof(FDP_CPU_CTX, tr);
+            default: break;
+        }
+        return ctx_none;
+    }
+
+    size_t GetMsrOffset(uint64_t MsrId)
+    {
+        switch(MsrId)
+        {
+            case MSR_EFER: return offsetof(FDP_CPU_CTX, efer);
+            case MSR_STAR: return offsetof(FDP_CPU_CTX, star);
+            case MSR_LSTAR: return offsetof(FDP_CPU_CTX, lstar);
+            case MSR_CSTAR: return offsetof(FDP_CPU_CTX, cstar);
+            case MSR_SFMASK: return offsetof(FDP_CPU_CTX, sfmask);
+            case MSR_FS_BASE: return offsetof(FDP_CPU_CTX, fs_base);
+            case MSR_GS_BASE: return offsetof(FDP_CPU_CTX, gs_base);
+            case MSR_KERNEL_GS: return offsetof(FDP_CPU_CTX, kernel_gs_base);
+            case MSR_SYSENTER_C: return offsetof(FDP_CPU_CTX, sysenter_cs);
+            case MSR_SYSENTER_S: return offsetof(FDP_CPU_CTX, sysenter_esp);
+            case MSR_SYSENTER_I: return offsetof(FDP_CPU_CTX, sysenter_eip);
+            default: break;
+        }
+        return ctx_none;
+    }
+
+    uint64_t GetCtx(const FDP_CPU_CTX& Ctx, size_t Offset)
+    {
+        uint64_t Value;
+        memcpy(&Value, reinterpret_cast<const uint8_t*>(&Ctx) + Offset, sizeof Value);
+        return Value;
+    }
+
+    void SetCtx(FDP_CPU_CTX& Ctx, size_t Offset, uint64_t Value)
+    {
+        memcpy(reinterpret_cast<uint8_t*>(&Ctx) + Offset, &Value, sizeof Value);
+    }
+
+    struct Breakpoint
+    {
+        bool                   bActive;
+        FDP_BreakpointType     Type;
+        FDP_AddressType        AddressType;
+        uint64_t               Address;
+        uint64_t               Length;
+        FDP_BREAKPOINT_MATCH_T Match; // never evaluated, the mock does not run
+    };
+
+    struct Snapshot
+    {
+        FDP_CPU_CTX                           Ctx;
+        FDP_XSAVE_FORMAT64_T                  FxState;
+        std::unordered_map<uint64_t, uint64_t> Msrs;
+        std::vector<uint8_t>                  Ram;
+    };
+
+    struct MappedFile
+    {
+        uint8_t* pData = nullptr;
+        uint64_t Size  = 0;
+#ifdef _MSC_VER
+        HANDLE hFile    = INVALID_HANDLE_VALUE;
+        HANDLE hMapping = nullptr;
+#endif
+    };
+
+    // private copy-on-write mapping, guest writes never reach the image
+    bool MapFile(MappedFile& File, const char* pPath)
+    {
+#ifdef _MSC_VER
+        File.hFile = CreateFileA(pPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(File.hFile == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        LARGE_INTEGER Size;
+        if(!GetFileSizeEx(File.hFile, &Size) || !Size.QuadPart)
+        {
+            return false;
+        }
+        File.hMapping = CreateFileMappingA(File.hFile, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        if(File.hMapping == nullptr)
+        {
+            return false;
+        }
+        File.pData = (uint8_t*) MapViewOfFile(File.hMapping, FILE_MAP_COPY, 0, 0, 0);
+        File.Size  = Size.QuadPart;
+        return File.pData != nullptr;
+#else
+        const int fd = open(pPath, O_RDONLY);
+        if(fd < 0)
+        {
+            return false;
+        }
+        struct stat Stat;
+        if(fstat(fd, &Stat) || !Stat.st_size)
+        {
+            close(fd);
+            return false;
+        }
+        void* pData = mmap(nullptr, Stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(pData == MAP_FAILED)
+        {
+            return false;
+        }
+        File.pData = (uint8_t*) pData;
+        File.Size  = Stat.st_size;
+        return true;
+#endif
+    }
+
+    void UnmapFile(MappedFile& File)
+    {
+#ifdef _MSC_VER
+        if(File.pData)
+        {
+            UnmapViewOfFile(File.pData);
+        }
+        if(File.hMapping)
+        {
+            CloseHandle(File.hMapping);
+        }
+        if(File.hFile != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(File.hFile);
+        }
+#else
+        if(File.pData)
+        {
+            munmap(File.pData, File.Size);
+        }
+#endif
+        File = MappedFile{};
+    }
+
+    // the client maps "CPU_<name>" read-only, the hypervisor usually creates it
+    FDP_CPU_CTX* CreateCpuShm(const std::string& Name)
+    {
+        const auto CpuShmName = "CPU_" + Name;
+#ifdef _MSC_VER
+        HANDLE hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, FDP_CPU_SHM_SIZE, CpuShmName.data());
+        if(hMapping == nullptr)
+        {
+            return nullptr;
+        }
+        return (FDP_CPU_CTX*) MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, FDP_CPU_SHM_SIZE);
+#else
+        const int fd = shm_open(CpuShmName.data(), O_CREAT | O_RDWR, 0666);
+        if(fd < 0)
+        {
+            return nullptr;
+        }
+        const int err   = ftruncate(fd, FDP_CPU_SHM_SIZE);
+        void*     pData = err ? MAP_FAILED : mmap(nullptr, FDP_CPU_SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if(pData == MAP_FAILED)
+        {
+            shm_unlink(CpuShmName.data());
+            return nullptr;
+        }
+        memset(pData, 0, FDP_CPU_SHM_SIZE);
+        return (FDP_CPU_CTX*) pData;
+#endif
+    }
+
+    // canal size & huge pages are selected like the VirtualBox server does
+    FDP_SHM* CreateFdpShm(const char* pShmName)
+    {
+        const char* pCanalSize = getenv("FDP_CANAL_SIZE");
+        uint32_t    CanalSize  = FDP_DEFAULT_CANAL_SIZE;
+        if(pCanalSize)
+        {
+            char*               pEnd  = nullptr;
+            const unsigned long Value = strtoul(pCanalSize, &pEnd, 0);
+            if(pEnd == pCanalSize || *pEnd || !Value || Value > UINT32_MAX)
+            {
+                fprintf(stderr, "FDP_CANAL_SIZE \"%s\" is invalid, using %u bytes\n", pCanalSize, CanalSize);
+            }
+            else
+            {
+                CanalSize = (uint32_t) Value;
+            }
+        }
+        const uint32_t Flags = getenv("FDP_HUGEPAGES") ? FDP_SHM_FLAG_HUGEPAGES : 0;
+        return FDP_CreateSHMSized(pShmName, Flags, CanalSize);
+    }
+
+    void DestroyCpuShm(const std::string& Name, FDP_CPU_CTX* pCpuShm)
+    {
+#ifdef _MSC_VER
+        UnmapViewOfFile(pCpuShm);
+#else
+        munmap(pCpuShm, FDP_CPU_SHM_SIZE);
+        shm_unlink(("CPU_" + Name).data());
+#endif
+    }
+
+    bool ReadFile(std::vector<uint8_t>& Data, const char* pPath)
+    {
+        std::ifstream File(pPath, std::ios::binary);
+        if(!File)
+        {
+            return false;
+        }
+        Data.assign(std::istreambuf_iterator<char>(File), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    bool ParseValue(const nlohmann::json& Json, uint64_t* pValue)
+    {
+        if(Json.is_number_unsigned())
+        {
+            *pValue = Json.get<uint64_t>();
+            return true;
+        }
+        if(!Json.is_string())
+        {
+            return false;
+        }
+        const auto  Text = Json.get<std::string>();
+        char*       pEnd = nullptr;
+        *pValue          = strtoull(Text.data(), &pEnd, 0);
+        return pEnd && !*pEnd && !Text.empty();
+    }
+
+    std::string ToHex(uint64_t Value)
+    {
+        char Buffer[32];
+        snprintf(Buffer, sizeof Buffer, "0x%" PRIx64, Value);
+        return Buffer;
+    }
+
+    bool LoadCpuState(FDP_CPU_CTX& Ctx, std::unordered_map<uint64_t, uint64_t>& Msrs, const char* pPath)
+    {
+        std::vector<uint8_t> Data;
+        if(!ReadFile(Data, pPath))
+        {
+            return false;
+        }
+        memset(&Ctx, 0, sizeof Ctx);
+        if(!Data.empty() && Data[0] != '{')
+        {
+            if(Data.size() < offsetof(FDP_CPU_CTX, generation))
+            {
+                return false;
+            }
+            memcpy(&Ctx, Data.data(), offsetof(FDP_CPU_CTX, generation));
+            return true;
+        }
+
+        const auto Json = nlohmann::json::parse(Data.begin(), Data.end(), nullptr, false);
+        if(!Json.is_object())
+        {
+            return false;
+        }
+        for(const auto& Field : ctx_fields)
+        {
+            const auto it    = Json.find(Field.name);
+            uint64_t   Value = 0;
+            if(it != Json.end() && !ParseValue(*it, &Value))
+            {
+                return false;
+            }
+            SetCtx(Ctx, Field.offset, Value);
+        }
+        const auto it = Json.find("msrs");
+        if(it == Json.end())
+        {
+            return true;
+        }
+        for(const auto& Msr : it->items())
+        {
+            uint64_t MsrId = 0;
+            uint64_t Value = 0;
+            if(!ParseValue(Msr.key(), &MsrId) || !ParseValue(Msr.value(), &Value))
+            {
+                return false;
+            }
+            Msrs[MsrId] = Value;
+        }
+        return true;
+    }
+}
+
+struct MOCK_FDP_
+{
+    std::string                            Name;
+    FDP_SHM*                               pFDP;
+    FDP_SERVER_INTERFACE_T                 Server;
+    MappedFile                             Ram;
+    FDP_CPU_CTX                            Ctx;
+    FDP_CPU_CTX*                           pCpuShm;
+    FDP_XSAVE_FORMAT64_T                   FxState;
+    std::unordered_map<uint64_t, uint64_t> Msrs;
+    Breakpoint                             Breakpoints[FDP_MAX_BREAKPOINT];
+    uint8_t                                State;
+    Snapshot                               Saved;
+    bool                                   bSaved;
+    std::vector<bool>                      Dirty; // one per page, only written by clients
+};
+
+namespace
+{
+    MOCK_FDP* Mock(void* pUserHandle)
+    {
+        return (MOCK_FDP*) pUserHandle;
+    }
+
+    // same seqlock protocol as the hypervisor, see FDP_CPU_CTX
+    void PublishCpuCtx(MOCK_FDP* pMock)
+    {
+        FDP_CPU_CTX* pShm = pMock->pCpuShm;
+        pShm->generation  = pShm->generation + 1;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        memcpy((void*) pShm, &pMock->Ctx, offsetof(FDP_CPU_CTX, generation));
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        pShm->generation = pShm->generation + 1;
+    }
+
+    bool IsValidPhysical(MOCK_FDP* pMock, uint64_t PhysicalAddress, uint64_t Size)
+    {
+        return PhysicalAddress <= pMock->Ram.Size && Size <= pMock->Ram.Size - PhysicalAddress;
+    }
+
+    void MarkDirty(MOCK_FDP* pMock, uint64_t PhysicalAddress, uint64_t Size)
+    {
+        for(uint64_t Page = PhysicalAddress / PAGE_SIZE; Page * PAGE_SIZE < PhysicalAddress + Size; ++Page)
+        {
+            pMock->Dirty[Page] = true;
+        }
+    }
+
+    bool ReadPhysical64(MOCK_FDP* pMock, uint64_t PhysicalAddress, uint64_t* pValue)
+    {
+        if(!IsValidPhysical(pMock, PhysicalAddress, sizeof *pValue))
+        {
+            return false;
+        }
+        memcpy(pValue, &pMock->Ram.pData[PhysicalAddress], sizeof *pValue);
+        return true;
+    }
+
+    // x64 4-level walk, 1G & 2M pages included
+    bool Translate(MOCK_FDP* pMock, uint64_t Dtb, uint64_t VirtualAddress, uint64_t* pPhysicalAddress)
+    {
+        uint64_t Table = (Dtb ? Dtb : pMock->Ctx.cr3) & PTE_ADDR_MASK;
+        for(int Level = 3; Level >= 0; --Level)
+        {
+            const uint64_t Shift = 12 + 9 * Level;
+            const uint64_t Index = (VirtualAddress >> Shift) & 0x1FF;
+            uint64_t       Entry = 0;
+            if(!ReadPhysical64(pMock, Table + Index * 8, &Entry) || !(Entry & PTE_PRESENT))
+            {
+                return false;
+            }
+            const bool bLarge = (Level == 1 || Level == 2) && (Entry & PTE_LARGE);
+            if(bLarge || Level == 0)
+            {
+                const uint64_t Mask = (uint64_t(1) << Shift) - 1;
+                *pPhysicalAddress   = ((Entry & PTE_ADDR_MASK) & ~Mask) | (VirtualAddress & Mask);
+                return true;
+            }
+            Table = Entry & PTE_ADDR_MASK;
+        }
+        return false;
+    }
+
+    template <typename T>
+    bool WalkVirtual(MOCK_FDP* pMock, uint64_t Dtb, uint64_t VirtualAddress, uint32_t Size, const T& Operand)
+    {
+        uint32_t Done = 0;
+        while(Done < Size)
+        {
+            const uint64_t Address  = VirtualAddress + Done;
+            const uint32_t Chunk    = (uint32_t) std::min<uint64_t>(Size - Done, PAGE_SIZE - (Address & ~PAGE_MASK));
+            uint64_t       Physical = 0;
+            if(!Translate(pMock, Dtb, Address, &Physical) || !IsValidPhysical(pMock, Physical, Chunk))
+            {
+                return false;
+            }
+            Operand(&pMock->Ram.pData[Physical], Done, Chunk);
+            Done += Chunk;
+        }
+        return true;
+    }
+
+    bool MockGetState(void* pUserHandle, uint8_t* pState)
+    {
+        *pState = Mock(pUserHandle)->State;
+        return true;
+    }
+
+    bool MockGetCpuState(void* pUserHandle, uint32_t CpuId, uint8_t* pState)
+    {
+        return CpuId == 0 && MockGetState(pUserHandle, pState);
+    }
+
+    bool MockGetCpuCount(void*, uint32_t* pCpuCount)
+    {
+        *pCpuCount = 1;
+        return true;
+    }
+
+    bool MockReadRegister(void* pUserHandle, uint32_t CpuId, FDP_Register RegisterId, uint64_t* pValue)
+    {
+        MOCK_FDP* pMock = Mock(pUserHandle);
+        if(RegisterId == FDP_MXCSR_REGISTER)
+        {
+            *pValue = pMock->FxState.MxCsr;
+            return CpuId == 0;
+        }
+        const size_t Offset = GetRegisterOffset(RegisterId);
+        if(CpuId != 0 || Offset == ctx_none)
+        {
+            return false;
+        }
+        *pValue = GetCtx(pMock->Ctx, Offset);
+        return true;
+    }
+
+    bool MockWriteRegister(void* pUserHandle, uint32_t CpuId, FDP_Register RegisterId, uint64_t Value)
+    {
+        MOCK_FDP* pMock = Mock(pUserHandle);
+        if(RegisterId == FDP_MXCSR_REGISTER)
+        {
+            pMock->FxState.MxCsr = (uint32_t) Value;
+            return CpuId == 0;
+        }
+        const size_t Offset = GetRegisterOffset(RegisterId);
+        if(CpuId != 0 || Offset == ctx_none)
+        {
+            return false;
+        }
+        SetCtx(pMock->Ctx, Offset, Value);
+        PublishCpuCtx(pMock);
+        return true;
+    }
+
+    bool MockReadMsr(void* pUserHandle, uint32_t CpuId, uint64_t MsrId, uint64_t* pValue)
+    {
+        MOCK_FDP*    pMock  = Mock(pUserHandle);
+        const size_t Offset = GetMsrOffset(MsrId);
+        if(CpuId != 0)
+        {
+            return false;
+        }
+        if(Offset != ctx_none)
+        {
+            *pValue = GetCtx(pMock->Ctx, Offset);
+            return true;
+        }
+        const auto it = pMock->Msrs.find(MsrId);
+        if(it == pMock->Msrs.end())
+        {
+            return false;
+        }
+        *pValue = it->second;
+        return true;
+    }
+
+    bool MockWriteMsr(void* pUserHandle, uint32_t CpuId, uint64_t MsrId, uint64_t Value)
+    {
+        MOCK_FDP*    pMock  = Mock(pUserHandle);
+        const size_t Offset = GetMsrOffset(MsrId);
+        if(CpuId != 0)
+        {
+            return false;
+        }
+        if(Offset == ctx_none)
+        {
+            pMock->Msrs[MsrId] = Value;
+            return true;
+        }
+        SetCtx(pMock->Ctx, Offset, Value);
+        PublishCpuCtx(pMock);
+        return true;
+    }
+
+    bool MockGetFxState64(void* pUserHandle, uint32_t CpuId, uint8_t* pDstBuffer, uint32_t* pDstSize)
+    {
+        if(CpuId != 0)
+        {
+            return false;
+        }
+        memcpy(pDstBuffer, &Mock(pUserHandle)->FxState, sizeof(FDP_XSAVE_FORMAT64_T));
+        *pDstSize = sizeof(FDP_XSAVE_FORMAT64_T);
+        return true;
+    }
+
+    bool MockSetFxState64(void* pUserHandle, uint32_t CpuId, uint8_t* pSrcBuffer, uint32_t SrcSize)
+    {
+        if(CpuId != 0 || SrcSize < sizeof(FDP_XSAVE_FORMAT64_T))
+        {
+            return false;
+        }
+        memcpy(&Mock(pUserHandle)->FxState, pSrcBuffer, sizeof(FDP_XSAVE_FORMAT64_T));
+        return true;
+    }
+
+    bool MockReadPhysicalMemory(void* pUserHandle, uint8_t* pDstBuffer, uint64_t PhysicalAddress, uint32_t ReadSize)
+    {
+        MOCK_FDP* pMock = Mock(pUserHandle);
+        if(!IsValidPhysical(pMock, PhysicalAddress, ReadSize))
+        {
+            return false;
+        }
+        memcpy(pDstBuffer, &pMock->Ram.pData[PhysicalAddress], ReadSize);
+        return true;
+    }
+
+    bool MockWritePhysicalMemory(void* pUserHandle, uint8_t* pSrcBuffer, uint64_t PhysicalAddress, uint32_t WriteSize)
+    {
+        MOCK_FDP* pMock = Mock(pUserHandle);
+        if(!IsValidPhysical(pMock, PhysicalAddress, WriteSize))
+        {
+            return false;
+        }
+        memcpy(&pMock->Ram.pData[PhysicalAddress], pSrcBuffer, WriteSize);
+        MarkDirty(pMock, PhysicalAddress, WriteSize);
+        return true;
+    }
+
+    bool MockReadVirtualMemoryDtb(void* pUserHandle, uint32_t CpuId, uint64_t Dtb, uint64_t VirtualAddress, uint32_t ReadSize, uint8_t* pDstBuffer)
+    {
+        return CpuId == 0 && WalkVirtual(Mock(pUserHandle), Dtb, VirtualAddress, ReadSize, [&](uint8_t* pPage, uint32_t Offset, uint32_t Size)
+        {
+            memcpy(&pDstBuffer[Offset], pPage, Size);
+        });
+    }
+
+    bool MockReadVirtualMemory(void* pUserHandle, uint32_t CpuId, uint64_t VirtualAddress, uint32_t ReadSize, uint8_t* pDstBuffer)
+    {
+        return MockReadVirtualMemoryDtb(pUserHandle, CpuId, 0, VirtualAddress, ReadSize, pDstBuffer);
+    }
+
+    bool MockWriteVirtualMemoryDtb(void* pUserHandle, uint32_t CpuId, uint64_t Dtb, uint8_t* pSrcBuffer, uint64_t VirtualAddress, uint32_t WriteSize)
+    {
+        MOCK_FDP* pMock = Mock(pUserHandle);
+        // check every page first, a failed write must not be partial
+        const bool bValid = WalkVirtual(pMock, Dtb, VirtualAddress, WriteSize, [](uint8_t*, uint32_t, uint32_t) {});
+        return CpuId == 0 && bValid && WalkVirtual(pMock, Dtb, VirtualAddress, WriteSize, [&](uint8_t* pPage, uint32_t Offset, uint32_t Size)
+        {
+            memcpy(pPage, &pSrcBuffer[Offset], Size);
+            MarkDirty(pMock, pPage - pMock->Ram.pData, Size);
+        });
+    }
+
+    bool MockWriteVirtualMemory(void* pUserHandle, uint32_t CpuId, uint8_t* pSrcBuffer, uint64_t VirtualAddress, uint32_t WriteSize)
+    {
+        return MockWriteVirtualMemoryDtb(pUserHandle, CpuId, 0, pSrcBuffer, VirtualAddress, WriteSize);
+    }
+
+    bool MockVirtualToPhysicalDtb(void* pUserHandle, uint32_t CpuId, uint64_t Dtb, uint64_t VirtualAddress, uint64_t* pPhysicalAddress)
+    {
+        return CpuId == 0 && Translate(Mock(pUserHandle), Dtb, VirtualAddress, pPhysicalAddress);
+    }
+
+    bool MockVirtualToPhysical(void* pUserHandle, uint32_t CpuId, uint64_t VirtualAddress, uint64_t* pPhysicalAddress)
+    {
+        return MockVirtualToPhysicalDtb(pUserHandle, CpuId, 0, VirtualAddress, pPhysicalAddress);
+    }
+
+    bool MockGetMemorySize(void* pUserHandle, uint64_t* pMemorySize)
+    {
+        *pMemorySize = Mock(pUserHandle)->Ram.Size;
+        return true;
+    }
+
+    bool MockGetPhysicalRanges(void* pUserHandle, FDP_PHYSICAL_RANGE_T* pRanges, uint32_t* pRangeCount)
+    {
+        if(*pRangeCount < 1)
+        {
+            return false;
+        }
+        pRanges[0].PhysicalAddress = 0;
+        pRanges[0].Size            = Mock(pUserHandle)->Ram.Size;
+        *pRangeCount               = 1;
+        return true;
+    }
+
+    bool MockPause(void* pUserHandle)
+    {
+        MOCK_FDP* pMock = Mock(pUserHandle);
+        if(pMock->State & FDP_STATE_PAUSED)
+        {
+            return true;
+        }
+        pMock->State = FDP_STATE_PAUSED;
+        FDP_SetStateChanged(pMock->pFDP);
+        return true;
+    }
+
+    // nothing runs, the VM stays "running" until the next pause
+    // both publish a state change so waiting clients see the transition
+    bool MockResume(void* pUserHandle)
+    {
+        MOCK_FDP* pMock = Mock(pUserHandle);
+        pMock->State    = FDP_STATE_NULL;
+        FDP_SetStateChanged(pMock->pFDP);
+        return true;
+    }
+
+    // the step completes at once & stops again
+    bool MockSingleStep(void* pUserHandle, uint32_t CpuId)
+    {
+        if(CpuId != 0)
+        {
+            return false;
+        }
+        MOCK_FDP* pMock = Mock(pUserHandle);
+        pMock->State    = FDP_STATE_PAUSED;
+        FDP_SetStateChanged(pMock->pFDP);
+        return true;
+    }
+
+    int MockSetBreakpoint(void* pUserHandle, uint32_t CpuId, FDP_BreakpointType BreakpointType, int BreakpointId, FDP_Access, FDP_AddressType BreakpointAddressType, uint64_t BreakpointAddress, uint64_t BreakpointLength, uint64_t)
+    {
+        MOCK_FDP* pMock = Mock(pUserHandle);
+        if(CpuId != 0 || BreakpointId >= FDP_MAX_BREAKPOINT)
+        {
+            return -1;
+        }
+        if(BreakpointId < 0)
+        {
+            for(int i = 0; i < FDP_MAX_BREAKPOINT && BreakpointId < 0; ++i)
+            {
+                if(!pMock->Breakpoints[i].bActive)
+                {
+                    BreakpointId = i;
+                }
+            }
+        }
+        if(BreakpointId < 0)
+        {
+            return -1;
+        }
+        Breakpoint& Entry = pMock->Breakpoints[BreakpointId];
+        Entry.bActive     = true;
+        Entry.Type        = BreakpointType;
+        Entry.AddressType = BreakpointAddressType;
+        Entry.Address     = BreakpointAddress;
+        Entry.Length      = BreakpointLength;
+        Entry.Match       = FDP_BREAKPOINT_MATCH_T{};
+        return BreakpointId;
+    }
+
+    bool MockSetBreakpointMatch(void* pUserHandle, int BreakpointId, const FDP_BREAKPOINT_MATCH_T* pMatch)
+    {
+        MOCK_FDP* pMock = Mock(pUserHandle);
+        if(BreakpointId < 0 || BreakpointId >= FDP_MAX_BREAKPOINT || !pMock->Breakpoints[BreakpointId].bActive)
+        {
+            return false;
+        }
+        pMock->Breakpoints[BreakpointId].Match = *pMatch;
+        return true;
+    }
+
+    bool MockUnsetBreakpoint(void* pUserHandle, int BreakpointId)
+    {
+        MOCK_FDP* pMock = Mock(pUserHandle);
+        if(BreakpointId < 0 || BreakpointId >= FDP_MAX_BREAKPOINT || !pMock->Breakpoints[BreakpointId].bActive)
+        {
+            return false;
+        }
+        pMock->Breakpoints[BreakpointId].bActive = false;
+        return true;
+    }
+
+    bool MockSave(void* pUserHandle)
+    {
+        MOCK_FDP* pMock     = Mock(pUserHandle);
+        pMock->Saved.Ctx     = pMock->Ctx;
+        pMock->Saved.FxState = pMock->FxState;
+        pMock->Saved.Msrs    = pMock->Msrs;
+        pMock->Saved.Ram.assign(pMock->Ram.pData, pMock->Ram.pData + pMock->Ram.Size);
+        pMock->bSaved = true;
+        return true;
+    }
+
+    bool MockRestore(void* pUserHandle)
+    {
+        MOCK_FDP* pMock = Mock(pUserHandle);
+        if(!pMock->bSaved)
+        {
+            return false;
+        }
+        pMock->Ctx     = pMock->Saved.Ctx;
+        pMock->FxState = pMock->Saved.FxState;
+        pMock->Msrs    = pMock->Saved.Msrs;
+        for(uint64_t Offset = 0; Offset < pMock->Ram.Size; Offset += PAGE_SIZE)
+        {
+            const uint64_t Size = std::min(PAGE_SIZE, pMock->Ram.Size - Offset);
+            if(memcmp(&pMock->Ram.pData[Offset], &pMock->Saved.Ram[Offset], Size))
+            {
+                memcpy(&pMock->Ram.pData[Offset], &pMock->Saved.Ram[Offset], Size);
+                MarkDirty(pMock, Offset, Size);
+            }
+        }
+        PublishCpuCtx(pMock);
+        pMock->State = FDP_STATE_PAUSED;
+        FDP_SetStateChanged(pMock->pFDP);
+        return true;
+    }
+
+    bool MockGetDirtyPages(void* pUserHandle, uint64_t FirstPage, uint64_t* pPages, uint32_t* pPageCount)
+    {
+        MOCK_FDP* pMock = Mock(pUserHandle);
+        uint32_t  Count = 0;
+        for(uint64_t Page = FirstPage; Page < pMock->Dirty.size() && Count < *pPageCount; ++Page)
+        {
+            if(pMock->Dirty[Page])
+            {
+                pPages[Count++] = Page;
+            }
+        }
+        *pPageCount = Count;
+        return true;
+    }
+
+    bool MockResetDirtyLog(void* pUserHandle)
+    {
+        MOCK_FDP* pMock = Mock(pUserHandle);
+        pMock->Dirty.assign(pMock->Dirty.size(), false);
+        return true;
+    }
+
+    bool MockReboot(void*)
+    {
+        return false;
+    }
+
+    bool MockInjectInterrupt(void*, uint32_t, uint32_t, uint32_t, uint64_t)
+    {
+        return false;
+    }
+}
+
+MOCK_FDP* MockFDP_Create(const char* pShmName, const char* pRamPath, const char* pCpuPath)
+{
+    if(pShmName == NULL || pRamPath == NULL || pCpuPath == NULL)
+    {
+        return NULL;
+    }
+    auto* pMock = new MOCK_FDP{};
+    pMock->Name = pShmName;
+    if(!MapFile(pMock->Ram, pRamPath) || !LoadCpuState(pMock->Ctx, pMock->Msrs, pCpuPath))
+    {
+        MockFDP_Destroy(pMock);
+        return NULL;
+    }
+    pMock->pCpuShm = CreateCpuShm(pMock->Name);
+    pMock->pFDP    = pMock->pCpuShm ? CreateFdpShm(pShmName) : NULL;
+    if(pMock->pFDP == NULL)
+    {
+        MockFDP_Destroy(pMock);
+        return NULL;
+    }
+    PublishCpuCtx(pMock);
+    pMock->Dirty.assign((pMock->Ram.Size + PAGE_SIZE - 1) / PAGE_SIZE, true);
+    pMock->FxState.MxCsr = 0x1F80;
+    pMock->State         = FDP_STATE_PAUSED;
+
+    FDP_SERVER_INTERFACE_T& Server = pMock->Server;
+    Server.pUserHandle              = pMock;
+    Server.pfnGetState              = &MockGetState;
+    Server.pfnReadRegister          = &MockReadRegister;
+    Server.pfnWriteRegister         = &MockWriteRegister;
+    Server.pfnWritePhysicalMemory   = &MockWritePhysicalMemory;
+    Server.pfnReadPhysicalMemory    = &MockReadPhysicalMemory;
+    Server.pfnWriteVirtualMemory    = &MockWriteVirtualMemory;
+    Server.pfnGetMemorySize         = &MockGetMemorySize;
+    Server.pfnResume                = &MockResume;
+    Server.pfnPause                 = &MockPause;
+    Server.pfnSingleStep            = &MockSingleStep;
+    Server.pfnWriteMsr              = &MockWriteMsr;
+    Server.pfnReadMsr               = &MockReadMsr;
+    Server.pfnGetCpuCount           = &MockGetCpuCount;
+    Server.pfnGetCpuState           = &MockGetCpuState;
+    Server.pfnUnsetBreakpoint       = &MockUnsetBreakpoint;
+    Server.pfnVirtualToPhysical     = &MockVirtualToPhysical;
+    Server.pfnGetFxState64          = &MockGetFxState64;
+    Server.pfnSetFxState64          = &MockSetFxState64;
+    Server.pfnReadVirtualMemory     = &MockReadVirtualMemory;
+    Server.pfnSetBreakpoint         = &MockSetBreakpoint;
+    Server.pfnSetBreakpointMatch    = &MockSetBreakpointMatch;
+    Server.pfnSave                  = &MockSave;
+    Server.pfnRestore               = &MockRestore;
+    Server.pfnReboot                = &MockReboot;
+    Server.pfnInjectInterrupt       = &MockInjectInterrupt;
+    Server.pfnReadVirtualMemoryDtb  = &MockReadVirtualMemoryDtb;
+    Server.pfnWriteVirtualMemoryDtb = &MockWriteVirtualMemoryDtb;
+    Server.pfnVirtualToPhysicalDtb  = &MockVirtualToPhysicalDtb;
+    Server.pfnGetPhysicalRanges     = &MockGetPhysicalRanges;
+    Server.pfnGetDirtyPages         = &MockGetDirtyPages;
+    Server.pfnResetDirtyLog         = &MockResetDirtyLog;
+    FDP_SetFDPServer(pMock->pFDP, &Server);
+    return pMock;
+}
+
+MOCK_FDP* MockFDP_CreateReplay(const char* pShmName, const char* pRecordPath)
+{
+    if(pShmName == NULL || pRecordPath == NULL)
+    {
+        return NULL;
+    }
+    auto* pMock    = new MOCK_FDP{};
+    pMock->Name    = pShmName;
+    pMock->pCpuShm = CreateCpuShm(pMock->Name);
+    pMock->pFDP    = pMock->pCpuShm ? CreateFdpShm(pShmName) : NULL;
+    if(pMock->pFDP == NULL || !FDP_SetReplayFile(pMock->pFDP, pRecordPath))
+    {
+        MockFDP_Destroy(pMock);
+        return NULL;
+    }
+    pMock->Server.pUserHandle = pMock;
+    FDP_SetFDPServer(pMock->pFDP, &pMock->Server);
+    return pMock;
+}
+
+void MockFDP_Destroy(MOCK_FDP* pMock)
+{
+    if(pMock == NULL)
+    {
+        return;
+    }
+    if(pMock->pFDP)
+    {
+        FDP_ExitSHM(pMock->pFDP);
+    }
+    if(pMock->pCpuShm)
+    {
+        DestroyCpuShm(pMock->Name, pMock->pCpuShm);
+    }
+    UnmapFile(pMock->Ram);
+    delete pMock;
+}
+
+bool MockFDP_ServerLoop(MOCK_FDP* pMock)
+{
+    return pMock && FDP_ServerLoop(pMock->pFDP);
+}
+
+void MockFDP_Stop(MOCK_FDP* pMock)
+{
+    if(pMock)
+    {
+        FDP_SetFDPServerRunning(pMock->pFDP, false);
+    }
+}
+
+bool MockFDP_Dump(const char* pShmName, const char* pRamPath, const char* pCpuPath)
+{
+    FDP_SHM* pFDP = FDP_OpenSHM(pShmName);
+    if(pFDP == NULL || !FDP_Init(pFDP) || !FDP_Pause(pFDP))
+    {
+        return false;
+    }
+
+    uint64_t MemorySize = 0;
+    FILE*    pRam       = fopen(pRamPath, "wb");
+    bool     bOk        = pRam && FDP_GetPhysicalMemorySize(pFDP, &MemorySize);
+    auto     Buffer     = std::vector<uint8_t>(DUMP_CHUNK);
+    for(uint64_t Offset = 0; bOk && Offset < MemorySize; Offset += DUMP_CHUNK)
+    {
+        // holes like mmio are saved as zeroes
+        const uint32_t Size = (uint32_t) std::min(DUMP_CHUNK, MemorySize - Offset);
+        if(!FDP_ReadPhysicalMemory(pFDP, Buffer.data(), Size, Offset))
+        {
+            memset(Buffer.data(), 0, Size);
+        }
+        bOk = fwrite(Buffer.data(), 1, Size, pRam) == Size;
+    }
+    if(pRam)
+    {
+        bOk &= !fclose(pRam);
+    }
+
+    auto Json = nlohmann::json::object();
+    for(int RegisterId = FDP_RAX_REGISTER; bOk && RegisterId <= FDP_TR_REGISTER; ++RegisterId)
+    {
+        const size_t Offset = GetRegisterOffset((FDP_Register) RegisterId);
+        uint64_t     Value  = 0;
+        if(Offset == ctx_none || (RegisterId >= FDP_VDR0_REGISTER && RegisterId <= FDP_VDR7_REGISTER))
+        {
+            continue;
+        }
+        FDP_ReadRegister(pFDP, 0, (FDP_Register) RegisterId, &Value);
+        for(const auto& Field : ctx_fields)
+        {
+            if(Field.offset == Offset)
+            {
+                Json[Field.name] = ToHex(Value);
+            }
+        }
+    }
+    for(const uint32_t MsrId : {MSR_EFER, MSR_STAR, MSR_LSTAR, MSR_CSTAR, MSR_SFMASK, MSR_FS_BASE, MSR_GS_BASE, MSR_KERNEL_GS, MSR_SYSENTER_C, MSR_SYSENTER_S, MSR_SYSENTER_I})
+    {
+        uint64_t Value = 0;
+        FDP_ReadMsr(pFDP, 0, MsrId, &Value);
+        for(const auto& Field : ctx_fields)
+        {
+            if(Field.offset == GetMsrOffset(MsrId))
+            {
+                Json[Field.name] = ToHex(Value);
+            }
+        }
+    }
+    if(bOk)
+    {
+        std::ofstream Cpu(pCpuPath);
+        Cpu << Json.dump(4) << std::endl;
+        bOk = !!Cpu;
+    }
+    FDP_Resume(pFDP);
+    FDP_ExitSHM(pFDP);
+    return bOk;
+}
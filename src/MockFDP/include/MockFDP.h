@@ -0,0 +1,40 @@
+#ifndef __MOCK_FDP_H__
+#define __MOCK_FDP_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef __cplusplus
+#    include <stdbool.h>
+#endif
+
+#include <stdint.h>
+
+    // FDP server serving a paused guest from files, without any hypervisor.
+    // pRamPath is a raw physical memory image, offset == physical address.
+    // pCpuPath is either a json object with FDP_CPU_CTX field names as keys,
+    // or a raw FDP_CPU_CTX dump.
+    // Guest code never executes: resume only marks the VM as running until
+    // the next pause, a single step stops at once, breakpoints are recorded
+    // but never hit. Every transition is published as a state change.
+    typedef struct MOCK_FDP_ MOCK_FDP;
+
+    MOCK_FDP*   MockFDP_Create      (const char* pShmName, const char* pRamPath, const char* pCpuPath);
+    // answer clients from a FDP_StartRecording log, nothing is published in shared memory
+    // so clients go through the canal like they did while recording
+    MOCK_FDP*   MockFDP_CreateReplay(const char* pShmName, const char* pRecordPath);
+    void        MockFDP_Destroy     (MOCK_FDP* pMock);
+    // serve commands until MockFDP_Stop, blocking
+    bool        MockFDP_ServerLoop  (MOCK_FDP* pMock);
+    void        MockFDP_Stop        (MOCK_FDP* pMock);
+
+    // capture a paused VM into files usable by MockFDP_Create, cpu state is saved as json
+    bool        MockFDP_Dump        (const char* pShmName, const char* pRamPath, const char* pCpuPath);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MOCK_FDP_H__
@@ -0,0 +1,56 @@
+#include <MockFDP.h>
+
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    MOCK_FDP* g_mock;
+
+    void on_signal(int)
+    {
+        MockFDP_Stop(g_mock);
+    }
+
+    int usage(const char* argv0)
+    {
+        fprintf(stderr, "usage: %s <name> <ram> <cpu>\n", argv0);
+        fprintf(stderr, "       %s --dump <name> <ram> <cpu.json>\n", argv0);
+        fprintf(stderr, "       %s --replay <name> <record>\n", argv0);
+        return -1;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc == 5 && !strcmp(argv[1], "--dump"))
+    {
+        if(!MockFDP_Dump(argv[2], argv[3], argv[4]))
+        {
+            fprintf(stderr, "unable to dump %s\n", argv[2]);
+            return -1;
+        }
+        return 0;
+    }
+
+    if(argc != 4)
+        return usage(argv[0]);
+
+    const auto replay = !strcmp(argv[1], "--replay");
+    const auto name   = replay ? argv[2] : argv[1];
+    g_mock            = replay ? MockFDP_CreateReplay(argv[2], argv[3]) : MockFDP_Create(argv[1], argv[2], argv[3]);
+    if(!g_mock)
+    {
+        fprintf(stderr, "unable to create mock %s\n", name);
+        return -1;
+    }
+
+    signal(SIGINT, &on_signal);
+    signal(SIGTERM, &on_signal);
+    printf("serving %s\n", name);
+    fflush(stdout);
+    const auto ok = MockFDP_ServerLoop(g_mock);
+    MockFDP_Destroy(g_mock);
+    return ok ? 0 : -1;
+}
@@ -196,6 +196,423 @@ bool testReadWritePhysicalMemory(FDP_SHM* pFDP){
     return true;
 }
 
+bool testReadMemoryVector(FDP_SHM* pFDP){
+    printf("%s ...", __FUNCTION__);
+    uint64_t LStar;
+    if (FDP_ReadMsr(pFDP, 0, MSR_LSTAR, &LStar) == false){
+        printf("Failed to read MSRValue !\n");
+        return false;
+    }
+
+    uint8_t physicalPage[4096];
+    uint8_t virtualPage[4096];
+    FDP_READ_VECTOR_T entries[2];
+    memset(entries, 0, sizeof entries);
+    entries[0].pDstBuffer = physicalPage;
+    entries[0].Address = 4096 * 12;
+    entries[0].ReadSize = sizeof physicalPage;
+    entries[0].AddressType = FDP_PHYSICAL_ADDRESS;
+    entries[1].pDstBuffer = virtualPage;
+    entries[1].Address = LStar;
+    entries[1].Dtb = FDP_NO_CR3;
+    entries[1].ReadSize = sizeof virtualPage;
+    entries[1].AddressType = FDP_VIRTUAL_ADDRESS;
+    if (FDP_ReadMemoryVector(pFDP, 0, entries, 2) == false){
+        printf("Failed to FDP_ReadMemoryVector !\n");
+        return false;
+    }
+
+    uint8_t expectedPage[4096];
+    if (FDP_ReadPhysicalMemory(pFDP, expectedPage, sizeof expectedPage, 4096 * 12) == false
+        || memcmp(expectedPage, physicalPage, sizeof expectedPage) != 0){
+        printf("Failed to compare physical entry !\n");
+        return false;
+    }
+    if (FDP_ReadVirtualMemory(pFDP, 0, expectedPage, sizeof expectedPage, LStar) == false
+        || memcmp(expectedPage, virtualPage, sizeof expectedPage) != 0){
+        printf("Failed to compare virtual entry !\n");
+        return false;
+    }
+    printf("[OK]\n");
+    return true;
+}
+
+bool testSubmitPoll(FDP_SHM* pFDP){
+    printf("%s ...", __FUNCTION__);
+    uint64_t Rip;
+    uint64_t LStar;
+    uint8_t physicalPage[4096];
+    uint8_t virtualPage[4096];
+    uint32_t tags[4];
+    bool queued = FDP_SubmitReadRegister(pFDP, 0, FDP_RIP_REGISTER, &Rip, &tags[0])
+        && FDP_SubmitReadMsr(pFDP, 0, MSR_LSTAR, &LStar, &tags[1])
+        && FDP_SubmitReadPhysicalMemory(pFDP, physicalPage, sizeof physicalPage, 4096 * 12, &tags[2]);
+    if (queued == false){
+        printf("Failed to submit !\n");
+        return false;
+    }
+
+    // the virtual read depends on LStar, wait for it first
+    int pending = 3;
+    bool hasLStar = false;
+    while (pending > 0){
+        uint32_t tag;
+        bool success;
+        if (FDP_Poll(pFDP, 1000, &tag, &success) == false){
+            printf("Failed to FDP_Poll !\n");
+            return false;
+        }
+        if (success == false){
+            printf("Failed to complete request %u !\n", tag);
+            return false;
+        }
+        if (tag == tags[1] && hasLStar == false){
+            hasLStar = true;
+            if (FDP_SubmitReadVirtualMemory(pFDP, 0, FDP_NO_CR3, virtualPage, sizeof virtualPage, LStar, &tags[3]) == false){
+                printf("Failed to submit virtual read !\n");
+                return false;
+            }
+            pending++;
+        }
+        pending--;
+    }
+
+    uint64_t expectedRip;
+    uint64_t expectedLStar;
+    uint8_t expectedPage[4096];
+    if (FDP_ReadRegister(pFDP, 0, FDP_RIP_REGISTER, &expectedRip) == false || expectedRip != Rip
+        || FDP_ReadMsr(pFDP, 0, MSR_LSTAR, &expectedLStar) == false || expectedLStar != LStar){
+        printf("Failed to compare registers !\n");
+        return false;
+    }
+    if (FDP_ReadPhysicalMemory(pFDP, expectedPage, sizeof expectedPage, 4096 * 12) == false
+        || memcmp(expectedPage, physicalPage, sizeof expectedPage) != 0){
+        printf("Failed to compare physical page !\n");
+        return false;
+    }
+    if (FDP_ReadVirtualMemory(pFDP, 0, expectedPage, sizeof expectedPage, LStar) == false
+        || memcmp(expectedPage, virtualPage, sizeof expectedPage) != 0){
+        printf("Failed to compare virtual page !\n");
+        return false;
+    }
+    printf("[OK]\n");
+    return true;
+}
+
+bool testSyncPhysicalMemory(FDP_SHM* pFDP){
+    printf("%s ...", __FUNCTION__);
+    uint8_t expectedPage[4096];
+    if (FDP_ReadPhysicalMemory(pFDP, expectedPage, sizeof expectedPage, 4096 * 12) == false){
+        printf("Failed to read physical page !\n");
+        return false;
+    }
+    if (FDP_SyncPhysicalMemory(pFDP) == false){
+        printf("[SKIP] guest memory is not exported\n");
+        return true;
+    }
+    uint8_t physicalPage[4096];
+    if (FDP_ReadPhysicalMemory(pFDP, physicalPage, sizeof physicalPage, 4096 * 12) == false
+        || memcmp(expectedPage, physicalPage, sizeof expectedPage) != 0){
+        printf("Failed to compare exported page !\n");
+        return false;
+    }
+    printf("[OK]\n");
+    return true;
+}
+
+bool testDirtyPages(FDP_SHM* pFDP){
+    printf("%s ...", __FUNCTION__);
+    if (FDP_Pause(pFDP) == false){
+        printf("Failed to pause !\n");
+        return false;
+    }
+    if (FDP_ResetDirtyLog(pFDP) == false){
+        printf("Failed to reset dirty log !\n");
+        return false;
+    }
+    uint8_t page[4096];
+    if (FDP_ReadPhysicalMemory(pFDP, page, sizeof page, 4096 * 12) == false
+        || FDP_WritePhysicalMemory(pFDP, page, sizeof page, 4096 * 12) == false){
+        printf("Failed to rewrite physical page !\n");
+        return false;
+    }
+    //Devices may still write guest memory, start at our page
+    uint64_t pages[16];
+    uint32_t count = 16;
+    if (FDP_GetDirtyPages(pFDP, 12, pages, &count) == false
+        || count == 0
+        || pages[0] != 12){
+        printf("Failed to get dirty pages !\n");
+        return false;
+    }
+    for (uint32_t i = 1; i < count; i++){
+        if (pages[i] <= pages[i - 1]){
+            printf("Failed, dirty pages are not sorted !\n");
+            return false;
+        }
+    }
+    printf("[OK]\n");
+    return true;
+}
+
+bool testSaveRestoreSlot(FDP_SHM* pFDP){
+    printf("%s ...", __FUNCTION__);
+    if (FDP_Pause(pFDP) == false){
+        printf("Failed to pause !\n");
+        return false;
+    }
+    uint8_t page[4096];
+    uint64_t OriginalRax;
+    if (FDP_ReadPhysicalMemory(pFDP, page, sizeof page, 4096 * 12) == false
+        || FDP_ReadRegister(pFDP, 0, FDP_RAX_REGISTER, &OriginalRax) == false){
+        printf("Failed to read state !\n");
+        return false;
+    }
+    if (FDP_SaveSlot(pFDP, 0) == false){
+        printf("Failed to save slot !\n");
+        return false;
+    }
+    uint8_t dirtyPage[4096];
+    memset(dirtyPage, 0xCC, sizeof dirtyPage);
+    if (FDP_WritePhysicalMemory(pFDP, dirtyPage, sizeof dirtyPage, 4096 * 12) == false
+        || FDP_WriteRegister(pFDP, 0, FDP_RAX_REGISTER, ~OriginalRax) == false){
+        printf("Failed to modify state !\n");
+        return false;
+    }
+    if (FDP_RestoreSlot(pFDP, 0) == false){
+        printf("Failed to restore slot !\n");
+        return false;
+    }
+    uint8_t restoredPage[4096];
+    uint64_t Rax;
+    if (FDP_ReadPhysicalMemory(pFDP, restoredPage, sizeof restoredPage, 4096 * 12) == false
+        || FDP_ReadRegister(pFDP, 0, FDP_RAX_REGISTER, &Rax) == false){
+        printf("Failed to read restored state !\n");
+        return false;
+    }
+    if (memcmp(page, restoredPage, sizeof page) != 0 || Rax != OriginalRax){
+        printf("Failed, state was not restored !\n");
+        return false;
+    }
+    if (FDP_RestoreSlot(pFDP, FDP_MAX_SNAPSHOT_SLOTS - 1) == true){
+        printf("Failed, restored an empty slot !\n");
+        return false;
+    }
+    printf("[OK]\n");
+    return true;
+}
+
+bool testRestoreSlotPerformance(FDP_SHM* pFDP){
+    printf("%s ...", __FUNCTION__);
+    if (FDP_Pause(pFDP) == false
+        || FDP_SaveSlot(pFDP, 0) == false){
+        printf("Failed to save slot !\n");
+        return false;
+    }
+    uint8_t page[4096];
+    if (FDP_ReadPhysicalMemory(pFDP, page, sizeof page, 4096 * 12) == false){
+        printf("Failed to read physical page !\n");
+        return false;
+    }
+    TimerOut = false;
+    TimerGo = true;
+    uint64_t RestoreCount = 0;
+    while (TimerOut == false){
+        // one dirty page per restore
+        if (FDP_WritePhysicalMemory(pFDP, page, sizeof page, 4096 * 12) == false
+            || FDP_RestoreSlot(pFDP, 0) == false){
+            printf("Failed to restore slot !\n");
+            return false;
+        }
+        RestoreCount++;
+    }
+
+    int RestorePerSecond = (int)(RestoreCount / TimerGetDelay());
+    printf("[OK] %d/s\n", RestorePerSecond);
+    return true;
+}
+
+bool testReadVirtualMemoryDtb(FDP_SHM* pFDP){
+    printf("%s ...", __FUNCTION__);
+    uint64_t LStar;
+    uint64_t Cr3;
+    if (FDP_ReadMsr(pFDP, 0, MSR_LSTAR, &LStar) == false
+        || FDP_ReadRegister(pFDP, 0, FDP_CR3_REGISTER, &Cr3) == false){
+        printf("Failed to read registers !\n");
+        return false;
+    }
+
+    uint8_t dtbPage[4096];
+    uint8_t currentPage[4096];
+    if (FDP_ReadVirtualMemoryDtb(pFDP, 0, Cr3, dtbPage, sizeof dtbPage, LStar) == false
+        || FDP_ReadVirtualMemory(pFDP, 0, currentPage, sizeof currentPage, LStar) == false){
+        printf("Failed to read VirtualMemory !\n");
+        return false;
+    }
+    if (memcmp(dtbPage, currentPage, sizeof dtbPage) != 0){
+        printf("Failed to compare dtbPage and currentPage !\n");
+        return false;
+    }
+
+    uint64_t PhysicalAddress;
+    uint64_t DtbPhysicalAddress;
+    if (FDP_VirtualToPhysical(pFDP, 0, LStar, &PhysicalAddress) == false
+        || FDP_VirtualToPhysicalDtb(pFDP, 0, Cr3, LStar, &DtbPhysicalAddress) == false
+        || PhysicalAddress != DtbPhysicalAddress){
+        printf("Failed to compare translations !\n");
+        return false;
+    }
+    printf("[OK]\n");
+    return true;
+}
+
+bool testReadVirtualMemoryPartial(FDP_SHM* pFDP){
+    printf("%s ...", __FUNCTION__);
+    uint64_t LStar;
+    uint64_t Cr3;
+    if (FDP_ReadMsr(pFDP, 0, MSR_LSTAR, &LStar) == false
+        || FDP_ReadRegister(pFDP, 0, FDP_CR3_REGISTER, &Cr3) == false){
+        printf("Failed to read registers !\n");
+        return false;
+    }
+
+    uint8_t partialPage[4096];
+    uint8_t currentPage[4096];
+    uint8_t Faults;
+    if (FDP_ReadVirtualMemoryPartial(pFDP, 0, Cr3, partialPage, sizeof partialPage, LStar, &Faults) == false
+        || FDP_ReadVirtualMemory(pFDP, 0, currentPage, sizeof currentPage, LStar) == false
+        || Faults != 0
+        || memcmp(partialPage, currentPage, sizeof partialPage) != 0){
+        printf("Failed to read mapped page !\n");
+        return false;
+    }
+
+    //Second page is non canonical & always faults, its bytes are zeroed
+    uint8_t crossPages[2 * 4096];
+    memset(crossPages, 0xCC, sizeof crossPages);
+    if (FDP_ReadVirtualMemoryPartial(pFDP, 0, Cr3, crossPages, sizeof crossPages, 0x00007FFFFFFFF000, &Faults) == false
+        || (Faults & 0x2) == 0
+        || crossPages[4096] != 0
+        || crossPages[sizeof crossPages - 1] != 0){
+        printf("Failed to report faulted page !\n");
+        return false;
+    }
+    printf("[OK]\n");
+    return true;
+}
+
+bool testTranslateVector(FDP_SHM* pFDP){
+    printf("%s ...", __FUNCTION__);
+    uint64_t LStar;
+    uint64_t Cr3;
+    if (FDP_ReadMsr(pFDP, 0, MSR_LSTAR, &LStar) == false
+        || FDP_ReadRegister(pFDP, 0, FDP_CR3_REGISTER, &Cr3) == false){
+        printf("Failed to read registers !\n");
+        return false;
+    }
+
+    FDP_TRANSLATE_T Entries[16];
+    for (int i = 0; i < 16; i++){
+        Entries[i].VirtualAddress = LStar + i * 0x10;
+    }
+    if (FDP_TranslateVector(pFDP, 0, Cr3, Entries, 16) == false){
+        printf("Failed to translate vector !\n");
+        return false;
+    }
+    for (int i = 0; i < 16; i++){
+        uint64_t PhysicalAddress;
+        if (FDP_VirtualToPhysicalDtb(pFDP, 0, Cr3, Entries[i].VirtualAddress, &PhysicalAddress) == false
+            || PhysicalAddress != Entries[i].PhysicalAddress){
+            printf("Failed to compare translations !\n");
+            return false;
+        }
+    }
+
+    //Non canonical addresses are never present
+    Entries[0].VirtualAddress = 0x8000000000000000;
+    if (FDP_TranslateVector(pFDP, 0, FDP_NO_CR3, Entries, 1) == true
+        || (Entries[0].Flags & FDP_TRANSLATE_PRESENT)){
+        printf("Failed to reject missing page !\n");
+        return false;
+    }
+    printf("[OK]\n");
+    return true;
+}
+
+bool testRecording(FDP_SHM* pFDP){
+    printf("%s ...", __FUNCTION__);
+    const char* pPath = "TestFDP_record.bin";
+    if (FDP_StartRecording(pFDP, pPath) == false){
+        printf("Failed to start recording !\n");
+        return false;
+    }
+    uint64_t LStar;
+    uint8_t Buffer[16];
+    bool bRead = FDP_ReadMsr(pFDP, 0, MSR_LSTAR, &LStar)
+        && FDP_ReadVirtualMemory(pFDP, 0, Buffer, sizeof Buffer, LStar);
+    FDP_StopRecording(pFDP);
+    if (bRead == false){
+        printf("Failed to read while recording !\n");
+        return false;
+    }
+
+    //The recording must be loadable by a replay server
+    FDP_SHM* pReplayFDP = FDP_CreateSHM("TestFDP_replay");
+    if (pReplayFDP == NULL){
+        printf("Failed to create replay SHM !\n");
+        return false;
+    }
+    bool bLoaded = FDP_SetReplayFile(pReplayFDP, pPath);
+    FDP_ExitSHM(pReplayFDP);
+    remove(pPath);
+    if (bLoaded == false){
+        printf("Failed to load recording !\n");
+        return false;
+    }
+    printf("[OK]\n");
+    return true;
+}
+
+bool testStatistics(FDP_SHM* pFDP){
+    printf("%s ...", __FUNCTION__);
+    FDP_STATISTICS_T* pStats = (FDP_STATISTICS_T*)malloc(sizeof(FDP_STATISTICS_T));
+    if (pStats == NULL){
+        printf("Failed to allocate statistics !\n");
+        return false;
+    }
+    uint64_t LStar;
+    bool bOk = FDP_EnableStatistics(pFDP, true)
+        && FDP_ResetStatistics(pFDP)
+        && FDP_ReadMsr(pFDP, 0, MSR_LSTAR, &LStar)
+        && FDP_ReadMsr(pFDP, 0, MSR_LSTAR, &LStar)
+        && FDP_GetStatistics(pFDP, pStats);
+    FDP_EnableStatistics(pFDP, false);
+    if (bOk == false){
+        printf("Failed to collect statistics !\n");
+        free(pStats);
+        return false;
+    }
+    FDP_COMMAND_STATISTICS_T* pReadMsr = NULL;
+    for (uint32_t i = 0; i < FDP_MAX_COMMANDS; i++){
+        const char* pName = FDP_GetCommandName(i);
+        if (pName != NULL && strcmp(pName, "READ_MSR") == 0){
+            pReadMsr = &pStats->Commands[i];
+        }
+    }
+    uint64_t BucketCalls = 0;
+    for (uint32_t i = 0; pReadMsr != NULL && i < FDP_LATENCY_BUCKETS; i++){
+        BucketCalls += pReadMsr->LatencyBuckets[i];
+    }
+    bOk = pReadMsr != NULL && pReadMsr->Calls == 2 && BucketCalls == 2 && pReadMsr->TotalNs >= pReadMsr->MaxNs;
+    free(pStats);
+    if (bOk == false){
+        printf("Invalid read msr statistics !\n");
+        return false;
+    }
+    printf("[OK]\n");
+    return true;
+}
+
 bool testReadWriteVirtualMemorySpeed(FDP_SHM* pFDP){
     printf("%s ...", __FUNCTION__);
 
@@ -278,6 +695,34 @@ bool testReadLargePhysicalMemory(FDP_SHM*  pFDP)
     return true;
 }
 
+bool testCanalSize(FDP_SHM* pFDP)
+{
+    printf("%s ...", __FUNCTION__);
+
+    uint32_t CanalSize = FDP_GetCanalSize(pFDP);
+    if (CanalSize < FDP_MIN_CANAL_SIZE || CanalSize > FDP_MAX_CANAL_SIZE) {
+        printf("Invalid canal size %u\n", CanalSize);
+        return false;
+    }
+
+    //One read filling the canal, then one split in two round trips
+    uint8_t *pBuffer = (uint8_t*)malloc(CanalSize + 1);
+    if (pBuffer == NULL) {
+        printf("Failed to malloc\n");
+        return false;
+    }
+    if (FDP_ReadPhysicalMemory(pFDP, pBuffer, CanalSize, 0) == false
+        || FDP_ReadPhysicalMemory(pFDP, pBuffer, CanalSize + 1, 0) == false) {
+        printf("Failed to FDP_ReadPhysicalMemory\n");
+        free(pBuffer);
+        return false;
+    }
+
+    free(pBuffer);
+    printf("[OK]\n");
+    return true;
+}
+
 //TODO: find contig virtual memory...
 bool testReadLargeVirtualMemory(FDP_SHM*  pFDP)
 {
@@ -879,6 +1324,10 @@ bool testMultiCpu(FDP_SHM* pFDP)
         return false;
     }
 
+    if (FDP_Pause(pFDP) == false){
+        return false;
+    }
+
     uint64_t oldRAXValue = 0;
     for (uint32_t c = 0; c < CPUCount; c++){
 
@@ -892,6 +1341,19 @@ bool testMultiCpu(FDP_SHM* pFDP)
             //printf("Failed to switch CPU!\n");
             //return false;
         }
+
+        //Every CPU publishes its own context
+        uint64_t modRAXValue;
+        if (FDP_WriteRegister(pFDP, c, FDP_RAX_REGISTER, TEST_REGISTER_VALUE + c) == false
+            || FDP_ReadRegister(pFDP, c, FDP_RAX_REGISTER, &modRAXValue) == false
+            || modRAXValue != TEST_REGISTER_VALUE + c){
+            printf("Failed to read back register on CPU %u!\n", c);
+            return false;
+        }
+        if (FDP_WriteRegister(pFDP, c, FDP_RAX_REGISTER, RAXValue) == false){
+            printf("Failed to write register value!\n");
+            return false;
+        }
     }
 
 
@@ -1174,6 +1636,124 @@ bool testMultiThread(FDP_SHM* pFDP)
 
 }
 
+bool testWaitForStateChanged(FDP_SHM* pFDP)
+{
+    printf("%s ...", __FUNCTION__);
+
+    if (FDP_Pause(pFDP) == false){
+        printf("Failed to pause !\n");
+        return false;
+    }
+    FDP_GetStateChanged(pFDP);
+
+    FDP_State state;
+    if (FDP_WaitForStateChangedTimeout(pFDP, &state, 100) == true){
+        printf("Unexpected state change !\n");
+        return false;
+    }
+
+    uint64_t LStar;
+    if (FDP_ReadMsr(pFDP, 0, MSR_LSTAR, &LStar) == false){
+        printf("Failed to read MSRValue !\n");
+        return false;
+    }
+    int breakpointId = FDP_SetBreakpoint(pFDP, 0, FDP_SOFTHBP, -1, FDP_EXECUTE_BP, FDP_VIRTUAL_ADDRESS, LStar, 1, FDP_NO_CR3);
+    if (breakpointId < 0){
+        printf("Failed to insert breakpoint !\n");
+        return false;
+    }
+    if (FDP_Resume(pFDP) == false){
+        printf("Failed to resume !\n");
+        return false;
+    }
+    if (FDP_WaitForStateChangedTimeout(pFDP, &state, 3000) == false
+        || !(state & FDP_STATE_BREAKPOINT_HIT)){
+        printf("Failed to wait for breakpoint !\n");
+        return false;
+    }
+    if (FDP_UnsetBreakpoint(pFDP, breakpointId) == false){
+        printf("Failed to remove breakpoint !\n");
+        return false;
+    }
+    if (FDP_Resume(pFDP) == false){
+        printf("Failed to resume !\n");
+        return false;
+    }
+
+    printf("[OK]\n");
+    return true;
+}
+
+bool testBreakpointMatch(FDP_SHM* pFDP)
+{
+    printf("%s ...", __FUNCTION__);
+
+    if (FDP_Pause(pFDP) == false){
+        printf("Failed to pause !\n");
+        return false;
+    }
+
+    uint64_t LStar;
+    if (FDP_ReadMsr(pFDP, 0, MSR_LSTAR, &LStar) == false){
+        printf("Failed to read MSRValue !\n");
+        return false;
+    }
+    uint64_t code;
+    if (FDP_ReadVirtualMemory(pFDP, 0, (uint8_t*)&code, sizeof code, LStar) == false){
+        printf("Failed to read LSTAR code !\n");
+        return false;
+    }
+
+    FDP_BREAKPOINT_T breakpoint;
+    breakpoint.CpuId = 0;
+    breakpoint.BreakpointType = FDP_SOFTHBP;
+    breakpoint.BreakpointId = -1;
+    breakpoint.BreakpointAccessType = FDP_EXECUTE_BP;
+    breakpoint.BreakpointAddressType = FDP_VIRTUAL_ADDRESS;
+    breakpoint.BreakpointAddress = LStar;
+    breakpoint.BreakpointLength = 1;
+    breakpoint.BreakpointCr3 = FDP_NO_CR3;
+    breakpoint.Match.MatchType = FDP_MATCH_VIRTUAL;
+    breakpoint.Match.MatchAddress = LStar;
+    for (int j = 0; j < 2; j++){
+        // first pass never matches, second pass always does
+        breakpoint.Match.MatchValue = j == 0 ? ~code : code;
+        int breakpointId = FDP_SetBreakpointEx(pFDP, &breakpoint);
+        if (breakpointId < 0){
+            printf("Failed to insert breakpoint !\n");
+            return false;
+        }
+        FDP_GetStateChanged(pFDP);
+        if (FDP_Resume(pFDP) == false){
+            printf("Failed to resume !\n");
+            return false;
+        }
+        FDP_State state;
+        const bool hit = FDP_WaitForStateChangedTimeout(pFDP, &state, 3000) == true
+            && (state & FDP_STATE_BREAKPOINT_HIT);
+        if (hit != (j == 1)){
+            printf("Unexpected breakpoint hit: %d !\n", hit);
+            return false;
+        }
+        if (FDP_Pause(pFDP) == false){
+            printf("Failed to pause !\n");
+            return false;
+        }
+        if (FDP_UnsetBreakpoint(pFDP, breakpointId) == false){
+            printf("Failed to remove breakpoint !\n");
+            return false;
+        }
+    }
+
+    if (FDP_Resume(pFDP) == false){
+        printf("Failed to resume !\n");
+        return false;
+    }
+
+    printf("[OK]\n");
+    return true;
+}
+
 bool testUnsetBreakpoint(FDP_SHM* pFDP)
 {
     printf("%s ...", __FUNCTION__);
@@ -1194,6 +1774,71 @@ bool testUnsetBreakpoint(FDP_SHM* pFDP)
     return true;
 }
 
+bool testSetBreakpoints(FDP_SHM* pFDP)
+{
+    printf("%s ...", __FUNCTION__);
+
+    if (FDP_Pause(pFDP) == false){
+        return false;
+    }
+
+    uint64_t originalMSRValue;
+    if (FDP_ReadMsr(pFDP, 0, MSR_LSTAR, &originalMSRValue) == false){
+        printf("Failed to read MSRValue !\n");
+        return false;
+    }
+
+    uint64_t physicalLSTAR;
+    if (FDP_VirtualToPhysical(pFDP, 0, originalMSRValue, &physicalLSTAR) == false){
+        printf("Failed to convert virtual to physical !\n");
+        return false;
+    }
+
+    FDP_BREAKPOINT_T breakpoints[10];
+    int breakpointIds[10];
+    for (int j = 0; j < 10; j++){
+        breakpoints[j].CpuId = 0;
+        breakpoints[j].BreakpointType = FDP_SOFTHBP;
+        breakpoints[j].BreakpointId = -1;
+        breakpoints[j].BreakpointAccessType = FDP_EXECUTE_BP;
+        breakpoints[j].BreakpointAddressType = FDP_PHYSICAL_ADDRESS;
+        breakpoints[j].BreakpointAddress = physicalLSTAR + j;
+        breakpoints[j].BreakpointLength = 1;
+        breakpoints[j].BreakpointCr3 = FDP_NO_CR3;
+        breakpoints[j].Match.MatchType = FDP_NO_MATCH;
+    }
+    if (FDP_SetBreakpoints(pFDP, breakpoints, 10, breakpointIds) == false){
+        printf("Failed to insert breakpoints !\n");
+        return false;
+    }
+    for (int j = 0; j < 10; j++){
+        for (int k = 0; k < j; k++){
+            if (breakpointIds[j] == breakpointIds[k]){
+                printf("Duplicated breakpoint id %d !\n", breakpointIds[j]);
+                return false;
+            }
+        }
+    }
+
+    if (FDP_UnsetAllBreakpoints(pFDP) == false){
+        printf("Failed to remove all breakpoints !\n");
+        return false;
+    }
+    for (int j = 0; j < 10; j++){
+        if (FDP_UnsetBreakpoint(pFDP, breakpointIds[j]) == true){
+            printf("Breakpoint %d still set !\n", breakpointIds[j]);
+            return false;
+        }
+    }
+
+    if (FDP_Resume(pFDP) == false){
+        return false;
+    }
+
+    printf("[OK]\n");
+    return true;
+}
+
 bool testSingleStep(FDP_SHM* pFDP){
     printf("%s ...", __FUNCTION__);
 
@@ -1515,6 +2160,10 @@ int testFDP(char *pVMName) {
 
         if (testUnsetBreakpoint(pFDP) == false)
             goto Fail;
+        if (testSetBreakpoints(pFDP) == false)
+            goto Fail;
+        if (testBreakpointMatch(pFDP) == false)
+            goto Fail;
         if (testSingleStepPause(pFDP) == false)
             goto Fail;
         if (testSingleStepPageBreakpoint(pFDP) == false)
@@ -1535,6 +2184,8 @@ int testFDP(char *pVMName) {
         */
         if (testVirtualSyscallBP(pFDP, FDP_SOFTHBP) == false)
             goto Fail;
+        if (testWaitForStateChanged(pFDP) == false)
+            goto Fail;
         if (testMultiCpu(pFDP) == false)
             goto Fail;
         if (testReadWriteRegister(pFDP) == false)
@@ -1543,6 +2194,28 @@ int testFDP(char *pVMName) {
             goto Fail;
         if (testReadWriteVirtualMemory(pFDP) == false)
             goto Fail;
+        if (testReadMemoryVector(pFDP) == false)
+            goto Fail;
+        if (testSubmitPoll(pFDP) == false)
+            goto Fail;
+        if (testSyncPhysicalMemory(pFDP) == false)
+            goto Fail;
+        if (testDirtyPages(pFDP) == false)
+            goto Fail;
+        if (testSaveRestoreSlot(pFDP) == false)
+            goto Fail;
+        if (testRestoreSlotPerformance(pFDP) == false)
+            goto Fail;
+        if (testReadVirtualMemoryDtb(pFDP) == false)
+            goto Fail;
+        if (testTranslateVector(pFDP) == false)
+            goto Fail;
+        if (testReadVirtualMemoryPartial(pFDP) == false)
+            goto Fail;
+        if (testRecording(pFDP) == false)
+            goto Fail;
+        if (testStatistics(pFDP) == false)
+            goto Fail;
         if (testGetStatePerformance(pFDP) == false)
             goto Fail;
         if (testDebugRegisters(pFDP) == false)
@@ -1580,6 +2253,8 @@ int testFDP(char *pVMName) {
             goto Fail;
         if (testReadLargePhysicalMemory(pFDP) == false)
             goto Fail;
+        if (testCanalSize(pFDP) == false)
+            goto Fail;
         if (testReadLargeVirtualMemory(pFDP) == false)
             goto Fail;
         /*if (testSaveRestore(pFDP) == false)
@@ -1,5 +1,7 @@
 #include <FDP.h>
 
+#include <icebox/core.hpp>
+
 #include <benchmark/benchmark.h>
 
 #include <memory>
@@ -38,6 +40,30 @@ namespace
 
         FDP_SHM* shm;
     };
+
+    struct icebox
+        : public ::benchmark::Fixture
+    {
+        void SetUp(::benchmark::State& state) override
+        {
+            core = core::attach(get_vm_name());
+            if(!core)
+                return state.SkipWithError("unable to attach");
+
+            const auto paused = state::pause(*core);
+            if(!paused)
+                return state.SkipWithError("unable to pause");
+        }
+
+        void TearDown(::benchmark::State& /*state*/) override
+        {
+            if(core)
+                state::resume(*core);
+            core.reset();
+        }
+
+        std::shared_ptr<core::Core> core;
+    };
 }
 
 BENCHMARK_F(win10, single_step)
@@ -131,5 +157,45 @@ BENCHMARK_F(win10, set_breakpoint)
     state.SetItemsProcessed(int64_t(state.iterations()));
 }
 
+// cold walks of the current callstack, arg is the read ahead in pages
+// works against a live vm or a mock_fdp replay recorded with the same arg
+BENCHMARK_DEFINE_F(icebox, read_callstack)
+(benchmark::State& state)
+{
+    if(!core)
+        return;
+
+    const auto proc = process::current(*core);
+    if(!proc)
+        return state.SkipWithError("unable to read current process");
+
+    modules::list(*core, *proc, [&](mod_t mod)
+    {
+        callstacks::load_module(*core, *proc, mod);
+        return walk_e::next;
+    });
+    memory::set_readahead(*core, size_t(state.range(0)));
+    memory::reset_cache_stats(*core);
+    auto callers = std::vector<callstacks::caller_t>(128);
+    for(auto _ : state)
+    {
+        (void) _;
+        state.PauseTiming();
+        memory::set_cache_size(*core, 4096);
+        memory::set_readahead(*core, size_t(state.range(0)));
+        state.ResumeTiming();
+
+        const auto n = callstacks::read(*core, &callers[0], callers.size(), *proc);
+        if(!n)
+            return state.SkipWithError("unable to read callstack");
+    }
+    const auto stats                    = memory::cache_stats(*core);
+    state.counters["readahead_hits"]    = double(stats.readahead_hits);
+    state.counters["readahead_fetches"] = double(stats.readahead_fetches);
+    state.SetItemsProcessed(int64_t(state.iterations()));
+    memory::set_readahead(*core, 16);
+}
+BENCHMARK_REGISTER_F(icebox, read_callstack)->Arg(0)->Arg(16);
+
 // Run the benchmark
 BENCHMARK_MAIN();
@@ -28,4 +28,13 @@ namespace core
 
     // detect try to detect current os & possibly change current os helper.
     bool detect(core::Core& core);
+
+    // enable_stats toggles per-command fdp statistics, also enabled at attach by FDP_STATS env.
+    bool enable_stats(core::Core& core, bool enable);
+
+    // dump_stats logs calls, bytes & latencies of each fdp command & page cache counters since last reset.
+    void dump_stats(core::Core& core);
+
+    // reset_stats clears fdp statistics & page cache counters.
+    bool reset_stats(core::Core& core);
 } // namespace core
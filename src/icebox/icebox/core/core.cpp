@@ -8,6 +8,7 @@
 #include "interfaces/if_os.hpp"
 #include "interfaces/if_symbols.hpp"
 #include "log.hpp"
+#include "memory.hpp"
 
 #include <chrono>
 #include <thread>
@@ -143,6 +144,27 @@ bool core::detect(core::Core& core)
     return try_load_os(core);
 }
 
+bool core::enable_stats(core::Core& core, bool enable)
+{
+    return fdp::enable_stats(core, enable);
+}
+
+void core::dump_stats(core::Core& core)
+{
+    fdp::dump_stats(core);
+    const auto cache = memory::cache_stats(core);
+    LOG(INFO, "physical page cache: %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64 " evictions", cache.hits, cache.misses, cache.evictions);
+    LOG(INFO, "translation cache: %" PRIu64 " hits, %" PRIu64 " misses", cache.tlb_hits, cache.tlb_misses);
+    LOG(INFO, "page table cache: %" PRIu64 " hits, %" PRIu64 " misses", cache.table_hits, cache.table_misses);
+    LOG(INFO, "read ahead: %" PRIu64 " hits, %" PRIu64 " fetches", cache.readahead_hits, cache.readahead_fetches);
+}
+
+bool core::reset_stats(core::Core& core)
+{
+    memory::reset_cache_stats(core);
+    return fdp::reset_stats(core);
+}
+
 std::shared_ptr<core::Core> core::attach(const std::string& name)
 {
     auto ptr = attach_only(name);
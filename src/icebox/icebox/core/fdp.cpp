@@ -11,27 +11,52 @@ extern "C"
 #include <FDP.h>
 }
 
+#include <algorithm>
+#include <cinttypes>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    void log_stats(FDP_SHM* ptr);
+}
+
 struct fdp::shm
 {
-    shm(FDP_SHM* ptr)
+    shm(FDP_SHM* ptr, uint32_t cpu_count)
         : ptr(ptr)
+        , cpu_count(cpu_count)
         , is_running(true)
+        , stop_epoch(1)
+        , has_ram(true)
+        , sync_epoch(0)
+        , synced_epoch(0)
     {
     }
 
     ~shm()
     {
+        if(getenv("FDP_STATS"))
+            log_stats(ptr);
         FDP_Resume(ptr);
         FDP_ExitSHM(ptr);
     }
 
     FDP_SHM* ptr;
+    uint32_t cpu_count;
     bool     is_running;
+    uint64_t stop_epoch;
+    bool     has_ram;      // false once guest memory failed to sync, or is not exported
+    uint64_t sync_epoch;   // stop worth a guest memory snapshot
+    uint64_t synced_epoch; // stop of the last snapshot
 };
 
 std::shared_ptr<fdp::shm> fdp::setup(const std::string& name)
 {
-    auto* ptr = FDP_OpenSHM(name.data());
+    // opt-in blocking waits, both peers switch to futexes
+    const auto flags = getenv("FDP_FUTEX_WAIT") ? FDP_SHM_FLAG_FUTEX_WAIT : 0;
+    auto*      ptr   = FDP_OpenSHMEx(name.data(), flags);
     if(!ptr)
         return nullptr;
 
@@ -39,11 +64,64 @@ std::shared_ptr<fdp::shm> fdp::setup(const std::string& name)
     if(!ok)
         return nullptr;
 
-    return std::make_shared<fdp::shm>(ptr);
+    // opt-in session log, replayed with mock_fdp --replay
+    if(const auto path = getenv("FDP_RECORD"))
+        if(!FDP_StartRecording(ptr, path))
+            LOG(ERROR, "unable to record fdp session into %s", path);
+
+    // opt-in per-command statistics, dumped on detach
+    if(getenv("FDP_STATS"))
+        if(!FDP_EnableStatistics(ptr, true))
+            LOG(ERROR, "unable to enable fdp statistics");
+
+    auto cpu_count = uint32_t{};
+    if(!FDP_GetCpuCount(ptr, &cpu_count) || !cpu_count)
+        cpu_count = 1;
+
+    return std::make_shared<fdp::shm>(ptr, cpu_count);
 }
 
 namespace
 {
+    uint64_t get_percentile_ns(const FDP_COMMAND_STATISTICS_T& cmd, uint64_t percent)
+    {
+        const auto rank = (cmd.Calls * percent + 99) / 100;
+        auto       sum  = uint64_t{};
+        for(uint32_t i = 0; i < FDP_LATENCY_BUCKETS; ++i)
+        {
+            sum += cmd.LatencyBuckets[i];
+            if(sum >= rank)
+                return std::min(FDP_GetLatencyBucketNs(i + 1), cmd.MaxNs);
+        }
+        return cmd.MaxNs;
+    }
+
+    void log_stats(FDP_SHM* ptr)
+    {
+        const auto stats = std::make_unique<FDP_STATISTICS_T>();
+        const auto ok    = FDP_GetStatistics(ptr, stats.get());
+        if(!ok)
+            return;
+
+        LOG(INFO, "%-24s %10s %12s %12s %9s %9s %9s %9s %6s", "command", "calls", "sent", "received", "avg_us", "p50_us", "p99_us", "max_us", "sleep%");
+        for(uint32_t i = 0; i < FDP_MAX_COMMANDS; ++i)
+        {
+            const auto& cmd  = stats->Commands[i];
+            const auto* name = FDP_GetCommandName(i);
+            if(!cmd.Calls || !name)
+                continue;
+
+            LOG(INFO, "%-24s %10" PRIu64 " %12" PRIu64 " %12" PRIu64 " %9.1f %9.1f %9.1f %9.1f %5.1f%%",
+                name, cmd.Calls, cmd.BytesSent, cmd.BytesReceived,
+                cmd.TotalNs / 1000. / cmd.Calls,
+                get_percentile_ns(cmd, 50) / 1000.,
+                get_percentile_ns(cmd, 99) / 1000.,
+                cmd.MaxNs / 1000.,
+                cmd.TotalNs ? cmd.SleepNs * 100. / cmd.TotalNs : 0.);
+        }
+        LOG(INFO, "served without round trip: %" PRIu64 " register reads, %" PRIu64 " memory reads", stats->CpuCtxReads, stats->RamShmReads);
+    }
+
     void check_vm(core::Core& core, const char* where)
     {
         if(!core.shm_)
@@ -62,15 +140,17 @@ void fdp::reset(core::Core& core)
 
     auto* ptr = core.shm_->ptr;
     check_vm(core, "fdp::reset");
-    for(int bpid = 0; bpid < FDP_MAX_BREAKPOINT; bpid++)
-        FDP_UnsetBreakpoint(ptr, bpid);
+    FDP_UnsetAllBreakpoints(ptr);
 
-    FDP_WriteRegister(ptr, 0, FDP_DR0_REGISTER, 0);
-    FDP_WriteRegister(ptr, 0, FDP_DR1_REGISTER, 0);
-    FDP_WriteRegister(ptr, 0, FDP_DR2_REGISTER, 0);
-    FDP_WriteRegister(ptr, 0, FDP_DR3_REGISTER, 0);
-    FDP_WriteRegister(ptr, 0, FDP_DR6_REGISTER, 0);
-    FDP_WriteRegister(ptr, 0, FDP_DR7_REGISTER, 0);
+    for(uint32_t cpu = 0; cpu < core.shm_->cpu_count; ++cpu)
+    {
+        FDP_WriteRegister(ptr, cpu, FDP_DR0_REGISTER, 0);
+        FDP_WriteRegister(ptr, cpu, FDP_DR1_REGISTER, 0);
+        FDP_WriteRegister(ptr, cpu, FDP_DR2_REGISTER, 0);
+        FDP_WriteRegister(ptr, cpu, FDP_DR3_REGISTER, 0);
+        FDP_WriteRegister(ptr, cpu, FDP_DR6_REGISTER, 0);
+        FDP_WriteRegister(ptr, cpu, FDP_DR7_REGISTER, 0);
+    }
 }
 
 opt<FDP_State> fdp::state(core::Core& core)
@@ -95,6 +175,19 @@ bool fdp::state_changed(core::Core& core)
         return false;
 
     core.shm_->is_running = !(*opt_state & FDP_STATE_PAUSED);
+    core.shm_->stop_epoch++;
+    return true;
+}
+
+bool fdp::wait_state_changed(core::Core& core, int timeout_ms)
+{
+    auto       value = FDP_State{};
+    const auto ok    = FDP_WaitForStateChangedTimeout(core.shm_->ptr, &value, timeout_ms);
+    if(!ok)
+        return false;
+
+    core.shm_->is_running = !(value & FDP_STATE_PAUSED);
+    core.shm_->stop_epoch++;
     return true;
 }
 
@@ -102,6 +195,10 @@ bool fdp::pause(core::Core& core)
 {
     const auto ret        = FDP_Pause(core.shm_->ptr);
     core.shm_->is_running = !ret;
+    core.shm_->stop_epoch++;
+    // explicit pauses usually walk a lot of memory, breakpoints & steps resume too soon
+    // for a full guest memory copy to pay off
+    core.shm_->sync_epoch = core.shm_->stop_epoch;
     return ret;
 }
 
@@ -109,13 +206,35 @@ bool fdp::resume(core::Core& core)
 {
     const auto ret        = FDP_Resume(core.shm_->ptr);
     core.shm_->is_running = ret;
+    core.shm_->stop_epoch++;
     return ret;
 }
 
-bool fdp::step_once(core::Core& core)
+uint64_t fdp::stop_epoch(core::Core& core)
+{
+    return core.shm_->is_running ? 0 : core.shm_->stop_epoch;
+}
+
+uint32_t fdp::cpu_count(core::Core& core)
+{
+    return core.shm_->cpu_count;
+}
+
+opt<FDP_State> fdp::cpu_state(core::Core& core, uint32_t cpu)
+{
+    auto       value = FDP_State{};
+    const auto ok    = FDP_GetCpuState(core.shm_->ptr, cpu, &value);
+    if(!ok)
+        return {};
+
+    return value;
+}
+
+bool fdp::step_once(core::Core& core, uint32_t cpu)
 {
     check_vm(core, "fdp::step_once");
-    return FDP_SingleStep(core.shm_->ptr, 0);
+    core.shm_->stop_epoch++;
+    return FDP_SingleStep(core.shm_->ptr, cpu);
 }
 
 bool fdp::unset_breakpoint(core::Core& core, int bpid)
@@ -130,9 +249,49 @@ int fdp::set_breakpoint(core::Core& core, FDP_BreakpointType type, int bpid, FDP
     return FDP_SetBreakpoint(core.shm_->ptr, 0, type, bpid, access, ptrtype, ptr, len, cr3);
 }
 
+bool fdp::set_breakpoints(core::Core& core, const breakpoint_t* bps, int* bpids, size_t num)
+{
+    check_vm(core, "fdp::set_breakpoints");
+    auto entries = std::vector<FDP_BREAKPOINT_T>(num);
+    for(size_t i = 0; i < num; ++i)
+    {
+        const auto& bp                   = bps[i];
+        entries[i].CpuId                 = 0;
+        entries[i].BreakpointType        = bp.type;
+        entries[i].BreakpointId          = bp.bpid;
+        entries[i].BreakpointAccessType  = bp.access;
+        entries[i].BreakpointAddressType = bp.ptrtype;
+        entries[i].BreakpointAddress     = bp.ptr;
+        entries[i].BreakpointLength      = bp.len;
+        entries[i].BreakpointCr3         = bp.cr3;
+        entries[i].Match.MatchType       = bp.match;
+        entries[i].Match.MatchAddress    = bp.match_ptr;
+        entries[i].Match.MatchValue      = bp.match_value;
+    }
+    const auto usize = static_cast<uint32_t>(num);
+    return FDP_SetBreakpoints(core.shm_->ptr, entries.data(), usize, bpids);
+}
+
+namespace
+{
+    // snapshot exported guest memory once per explicit pause,
+    // FDP_ReadPhysicalMemory then reads it without round trips until the vm runs
+    void sync_ram(core::Core& core)
+    {
+        auto&      shm   = *core.shm_;
+        const auto epoch = fdp::stop_epoch(core);
+        if(!shm.has_ram || !epoch || epoch != shm.sync_epoch || epoch == shm.synced_epoch)
+            return;
+
+        shm.synced_epoch = epoch;
+        shm.has_ram      = FDP_SyncPhysicalMemory(shm.ptr);
+    }
+}
+
 bool fdp::read_physical(core::Core& core, void* vdst, phy_t src, size_t size)
 {
     check_vm(core, "fdp::read_physical");
+    sync_ram(core);
     auto*      dst   = reinterpret_cast<uint8_t*>(vdst);
     const auto usize = static_cast<uint32_t>(size);
     return FDP_ReadPhysicalMemory(core.shm_->ptr, dst, usize, src.val);
@@ -146,62 +305,94 @@ bool fdp::write_physical(core::Core& core, phy_t dst, const void* vsrc, size_t s
     return FDP_WritePhysicalMemory(core.shm_->ptr, src, usize, dst.val);
 }
 
-namespace
+bool fdp::read_virtual(core::Core& core, void* vdst, uint64_t src, dtb_t dtb, size_t size)
 {
-    template <typename T>
-    auto switch_dtb(core::Core& core, dtb_t dtb, T operand)
-    {
-        const auto backup      = fdp::read_register(core, reg_e::cr3);
-        const auto need_switch = backup && *backup != dtb.val;
-        if(need_switch)
-            fdp::write_register(core, reg_e::cr3, dtb.val);
-        const auto ret = operand();
-        if(need_switch)
-            fdp::write_register(core, reg_e::cr3, *backup);
-        return ret;
-    }
+    check_vm(core, "fdp::read_virtual");
+    auto*      dst   = reinterpret_cast<uint8_t*>(vdst);
+    const auto usize = static_cast<uint32_t>(size);
+    return FDP_ReadVirtualMemoryDtb(core.shm_->ptr, 0, dtb.val, dst, usize, src);
 }
 
-bool fdp::read_virtual(core::Core& core, void* vdst, uint64_t src, dtb_t dtb, size_t size)
+bool fdp::read_virtual_partial(core::Core& core, void* vdst, uint64_t src, dtb_t dtb, size_t size, uint8_t* faults)
 {
+    check_vm(core, "fdp::read_virtual_partial");
     auto*      dst   = reinterpret_cast<uint8_t*>(vdst);
     const auto usize = static_cast<uint32_t>(size);
-    return switch_dtb(core, dtb, [&]
+    return FDP_ReadVirtualMemoryPartial(core.shm_->ptr, 0, dtb.val, dst, usize, src, faults);
+}
+
+bool fdp::read_vector(core::Core& core, memory::read_t* reads, size_t num, FDP_AddressType type)
+{
+    check_vm(core, "fdp::read_vector");
+    auto entries = std::vector<FDP_READ_VECTOR_T>(num);
+    for(size_t i = 0; i < num; ++i)
     {
-        check_vm(core, "fdp::read_virtual");
-        return FDP_ReadVirtualMemory(core.shm_->ptr, 0, dst, usize, src);
-    });
+        auto& r                = reads[i];
+        entries[i].pDstBuffer  = reinterpret_cast<uint8_t*>(r.dst);
+        entries[i].Address     = r.src;
+        entries[i].Dtb         = type == FDP_VIRTUAL_ADDRESS ? r.dtb.val : FDP_NO_CR3;
+        entries[i].ReadSize    = static_cast<uint32_t>(r.size);
+        entries[i].AddressType = type;
+    }
+    const auto usize = static_cast<uint32_t>(num);
+    const auto ok    = FDP_ReadMemoryVector(core.shm_->ptr, 0, &entries[0], usize);
+    for(size_t i = 0; i < num; ++i)
+        reads[i].ok = entries[i].bSuccess;
+    return ok;
 }
 
 bool fdp::write_virtual(core::Core& core, uint64_t dst, dtb_t dtb, const void* vsrc, size_t size)
 {
+    check_vm(core, "fdp::write_virtual");
     auto*      src   = reinterpret_cast<uint8_t*>(const_cast<void*>(vsrc));
     const auto usize = static_cast<uint32_t>(size);
-    return switch_dtb(core, dtb, [&]
-    {
-        check_vm(core, "fdp::write_virtual");
-        return FDP_WriteVirtualMemory(core.shm_->ptr, 0, src, usize, dst);
-    });
+    return FDP_WriteVirtualMemoryDtb(core.shm_->ptr, 0, dtb.val, src, usize, dst);
 }
 
-opt<phy_t> fdp::virtual_to_physical(core::Core& core, dtb_t dtb, uint64_t ptr)
+bool fdp::translate_vector(core::Core& core, memory::translate_t* translates, size_t num)
 {
-    uint64_t   phy = 0;
-    const auto ok  = switch_dtb(core, dtb, [&]
+    check_vm(core, "fdp::translate_vector");
+    // one batch per dtb
+    auto entries = std::vector<FDP_TRANSLATE_T>{};
+    auto indexes = std::vector<size_t>{};
+    auto done    = std::vector<bool>(num);
+    auto ok      = true;
+    for(size_t i = 0; i < num; ++i)
     {
-        check_vm(core, "fdp::virtual_to_physical");
-        return FDP_VirtualToPhysical(core.shm_->ptr, 0, ptr, &phy);
-    });
-    if(!ok)
-        return {};
+        if(done[i])
+            continue;
 
-    return phy_t{phy};
+        const auto dtb = translates[i].dtb;
+        entries.clear();
+        indexes.clear();
+        for(size_t j = i; j < num; ++j)
+        {
+            if(done[j] || translates[j].dtb.val != dtb.val)
+                continue;
+
+            done[j] = true;
+            indexes.push_back(j);
+            entries.push_back(FDP_TRANSLATE_T{translates[j].ptr, 0, 0});
+        }
+        // a failed batch leaves entries untouched, report them missing
+        const auto usize      = static_cast<uint32_t>(entries.size());
+        const auto translated = FDP_TranslateVector(core.shm_->ptr, 0, dtb.val, &entries[0], usize);
+        for(size_t j = 0; j < indexes.size(); ++j)
+        {
+            auto& t = translates[indexes[j]];
+            t.ok    = translated && !!(entries[j].Flags & FDP_TRANSLATE_PRESENT);
+            t.large = !!(entries[j].Flags & FDP_TRANSLATE_LARGE_PAGE);
+            t.phy   = phy_t{entries[j].PhysicalAddress};
+            ok &= t.ok;
+        }
+    }
+    return ok;
 }
 
-bool fdp::inject_interrupt(core::Core& core, uint32_t code, uint32_t error, uint64_t cr2)
+bool fdp::inject_interrupt(core::Core& core, uint32_t cpu, uint32_t code, uint32_t error, uint64_t cr2)
 {
     check_vm(core, "fdp::inject_interrupt");
-    return FDP_InjectInterrupt(core.shm_->ptr, 0, code, error, cr2);
+    return FDP_InjectInterrupt(core.shm_->ptr, cpu, code, error, cr2);
 }
 
 namespace
@@ -235,11 +426,11 @@ namespace
     }
 }
 
-opt<uint64_t> fdp::read_register(core::Core& core, reg_e reg)
+opt<uint64_t> fdp::read_register(core::Core& core, uint32_t cpu, reg_e reg)
 {
     check_vm(core, "fdp::read_register");
     auto       value = uint64_t{};
-    const auto ok    = FDP_ReadRegister(core.shm_->ptr, 0, cast(reg), &value);
+    const auto ok    = FDP_ReadRegister(core.shm_->ptr, cpu, cast(reg), &value);
     if(!ok)
         return {};
 
@@ -261,27 +452,27 @@ namespace
     }
 }
 
-opt<uint64_t> fdp::read_msr_register(core::Core& core, msr_e msr)
+opt<uint64_t> fdp::read_msr_register(core::Core& core, uint32_t cpu, msr_e msr)
 {
     check_vm(core, "fdp::read_msr_register");
     auto       value = uint64_t{};
-    const auto ok    = FDP_ReadMsr(core.shm_->ptr, 0, cast(msr), &value);
+    const auto ok    = FDP_ReadMsr(core.shm_->ptr, cpu, cast(msr), &value);
     if(!ok)
         return {};
 
     return value;
 }
 
-bool fdp::write_register(core::Core& core, reg_e reg, uint64_t value)
+bool fdp::write_register(core::Core& core, uint32_t cpu, reg_e reg, uint64_t value)
 {
     check_vm(core, "fdp::write_register");
-    return FDP_WriteRegister(core.shm_->ptr, 0, cast(reg), value);
+    return FDP_WriteRegister(core.shm_->ptr, cpu, cast(reg), value);
 }
 
-bool fdp::write_msr_register(core::Core& core, msr_e msr, uint64_t value)
+bool fdp::write_msr_register(core::Core& core, uint32_t cpu, msr_e msr, uint64_t value)
 {
     check_vm(core, "fdp::write_msr_register");
-    return FDP_WriteMsr(core.shm_->ptr, 0, cast(msr), value);
+    return FDP_WriteMsr(core.shm_->ptr, cpu, cast(msr), value);
 }
 
 bool fdp::save(core::Core& core)
@@ -293,5 +484,62 @@ bool fdp::save(core::Core& core)
 bool fdp::restore(core::Core& core)
 {
     check_vm(core, "fdp::restore");
+    core.shm_->stop_epoch++;
     return FDP_Restore(core.shm_->ptr);
 }
+
+bool fdp::save_slot(core::Core& core, uint32_t slot)
+{
+    check_vm(core, "fdp::save_slot");
+    return FDP_SaveSlot(core.shm_->ptr, slot);
+}
+
+bool fdp::restore_slot(core::Core& core, uint32_t slot)
+{
+    check_vm(core, "fdp::restore_slot");
+    core.shm_->stop_epoch++;
+    return FDP_RestoreSlot(core.shm_->ptr, slot);
+}
+
+bool fdp::dirty_pages(core::Core& core, std::vector<phy_t>& pages)
+{
+    check_vm(core, "fdp::dirty_pages");
+    auto gpfns = std::vector<uint64_t>(0x10000);
+    auto next  = uint64_t{};
+    pages.clear();
+    while(true)
+    {
+        auto       count = static_cast<uint32_t>(gpfns.size());
+        const auto ok    = FDP_GetDirtyPages(core.shm_->ptr, next, &gpfns[0], &count);
+        if(!ok)
+            return false;
+
+        for(size_t i = 0; i < count; ++i)
+            pages.push_back(phy_t{gpfns[i] << 12});
+        if(count < gpfns.size())
+            return true;
+
+        next = gpfns[count - 1] + 1;
+    }
+}
+
+bool fdp::reset_dirty_pages(core::Core& core)
+{
+    check_vm(core, "fdp::reset_dirty_pages");
+    return FDP_ResetDirtyLog(core.shm_->ptr);
+}
+
+bool fdp::enable_stats(core::Core& core, bool enable)
+{
+    return FDP_EnableStatistics(core.shm_->ptr, enable);
+}
+
+void fdp::dump_stats(core::Core& core)
+{
+    log_stats(core.shm_->ptr);
+}
+
+bool fdp::reset_stats(core::Core& core)
+{
+    return FDP_ResetStatistics(core.shm_->ptr);
+}
@@ -2,33 +2,65 @@
 
 #include "types.hpp"
 
+#include <vector>
+
 extern "C"
 {
 #include <FDP_enum.h>
 }
 
 namespace core { struct Core; }
+namespace memory { struct read_t; struct translate_t; }
 
 namespace fdp
 {
+    struct breakpoint_t
+    {
+        FDP_BreakpointType type;
+        int                bpid;
+        FDP_Access         access;
+        FDP_AddressType    ptrtype;
+        uint64_t           ptr;
+        uint64_t           len;
+        uint64_t           cr3;
+        FDP_MatchType      match;
+        uint64_t           match_ptr;
+        uint64_t           match_value;
+    };
+
     void            reset               (core::Core& core);
     opt<FDP_State>  state               (core::Core& core);
     bool            state_changed       (core::Core& core);
+    bool            wait_state_changed  (core::Core& core, int timeout_ms);
     bool            pause               (core::Core& core);
     bool            resume              (core::Core& core);
-    bool            step_once           (core::Core& core);
+    // changes whenever guest memory may have changed, 0 while the vm runs
+    uint64_t        stop_epoch          (core::Core& core);
+    uint32_t        cpu_count           (core::Core& core);
+    opt<FDP_State>  cpu_state           (core::Core& core, uint32_t cpu);
+    bool            step_once           (core::Core& core, uint32_t cpu);
     bool            unset_breakpoint    (core::Core& core, int bpid);
     int             set_breakpoint      (core::Core& core, FDP_BreakpointType type, int bpid, FDP_Access access, FDP_AddressType ptrtype, uint64_t ptr, uint64_t len, uint64_t cr3);
+    bool            set_breakpoints     (core::Core& core, const breakpoint_t* bps, int* bpids, size_t num);
     bool            read_physical       (core::Core& core, void* dst, phy_t src, size_t size);
     bool            read_virtual        (core::Core& core, void* dst, uint64_t src, dtb_t dtb, size_t size);
+    bool            read_virtual_partial(core::Core& core, void* dst, uint64_t src, dtb_t dtb, size_t size, uint8_t* faults);
+    bool            read_vector         (core::Core& core, memory::read_t* reads, size_t num, FDP_AddressType type);
     bool            write_physical      (core::Core& core, phy_t dst, const void* src, size_t size);
     bool            write_virtual       (core::Core& core, uint64_t dst, dtb_t dtb, const void* src, size_t size);
-    opt<phy_t>      virtual_to_physical (core::Core& core, dtb_t dtb, uint64_t ptr);
-    bool            inject_interrupt    (core::Core& core, uint32_t code, uint32_t error, uint64_t cr2);
-    opt<uint64_t>   read_register       (core::Core& core, reg_e reg);
-    opt<uint64_t>   read_msr_register   (core::Core& core, msr_e msr);
-    bool            write_register      (core::Core& core, reg_e reg, uint64_t value);
-    bool            write_msr_register  (core::Core& core, msr_e msr, uint64_t value);
+    bool            translate_vector    (core::Core& core, memory::translate_t* translates, size_t num);
+    bool            inject_interrupt    (core::Core& core, uint32_t cpu, uint32_t code, uint32_t error, uint64_t cr2);
+    opt<uint64_t>   read_register       (core::Core& core, uint32_t cpu, reg_e reg);
+    opt<uint64_t>   read_msr_register   (core::Core& core, uint32_t cpu, msr_e msr);
+    bool            write_register      (core::Core& core, uint32_t cpu, reg_e reg, uint64_t value);
+    bool            write_msr_register  (core::Core& core, uint32_t cpu, msr_e msr, uint64_t value);
     bool            save                (core::Core& core);
     bool            restore             (core::Core& core);
+    bool            save_slot           (core::Core& core, uint32_t slot);
+    bool            restore_slot        (core::Core& core, uint32_t slot);
+    bool            dirty_pages         (core::Core& core, std::vector<phy_t>& pages);
+    bool            reset_dirty_pages   (core::Core& core);
+    bool            enable_stats        (core::Core& core, bool enable);
+    void            dump_stats          (core::Core& core);
+    bool            reset_stats         (core::Core& core);
 } // namespace fdp
@@ -9,11 +9,102 @@
 #include "log.hpp"
 #include "utils/utils.hpp"
 
+#include <algorithm>
 #include <array>
+#include <list>
+#include <unordered_map>
+
+namespace
+{
+    constexpr size_t default_cache_pages = 4096;
+    constexpr size_t table_cache_pages   = 1024;
+    constexpr size_t readahead_streams   = 4;
+    constexpr size_t max_readahead_pages = 16;
+    constexpr size_t max_readahead_gap   = 0x100;
+    constexpr size_t max_translations    = 0x10000;
+    constexpr auto   large_page_size     = uint64_t{1} << 21;
+
+    struct CachedPage
+    {
+        uint64_t                       pfn;
+        uint64_t                       epoch; // valid while equal to fdp::stop_epoch
+        std::array<uint8_t, PAGE_SIZE> data;
+    };
+
+    // most recently used first
+    using CachedPages = std::list<CachedPage>;
+    using CacheIndex  = std::unordered_map<uint64_t, CachedPages::iterator>;
+
+    struct PageCache
+    {
+        size_t      max_pages;
+        CachedPages pages;
+        CacheIndex  index;
+    };
+
+    // virtual page base, low bit set on large pages
+    struct TlbKey
+    {
+        uint64_t dtb;
+        uint64_t page;
+
+        bool operator==(const TlbKey& other) const
+        {
+            return dtb == other.dtb && page == other.page;
+        }
+    };
+
+    struct TlbKeyHash
+    {
+        size_t operator()(const TlbKey& key) const
+        {
+            return std::hash<uint64_t>()(key.dtb * 0x9E3779B97F4A7C15ULL ^ key.page);
+        }
+    };
+
+    struct Translation
+    {
+        TlbKey   key;
+        uint64_t phy; // physical page base
+    };
+
+    // most recently used first, like cached pages
+    using Translations = std::list<Translation>;
+    using TlbIndex     = std::unordered_map<TlbKey, Translations::iterator, TlbKeyHash>;
+
+    struct Tlb
+    {
+        Translations entries;
+        TlbIndex     index;
+    };
+
+    // ascending reads of one dtb, served from a window read ahead of them
+    struct Stream
+    {
+        uint64_t             dtb;
+        uint64_t             last;  // last read start
+        uint64_t             next;  // last read end
+        uint64_t             used;  // least recently used stream is recycled
+        size_t               pages; // window size, doubled on each sequential miss
+        uint64_t             epoch; // window is valid while equal to fdp::stop_epoch
+        uint64_t             base;  // window virtual address
+        std::vector<uint8_t> data;
+        std::vector<uint8_t> faults;
+    };
+    using Streams = std::array<Stream, readahead_streams>;
+}
 
 struct memory::Memory
 {
-    int depth = 0;
+    int                   depth       = 0;
+    PageCache             cache       = {default_cache_pages, {}, {}};
+    PageCache             tables      = {table_cache_pages, {}, {}}; // read by os page walks
+    Tlb                   tlb;
+    uint64_t              tlb_epoch   = 0;
+    Streams               streams     = {};
+    uint64_t              stream_tick = 0;
+    size_t                readahead   = max_readahead_pages;
+    memory::cache_stats_t cache_stats = {};
 };
 
 std::shared_ptr<memory::Memory> memory::setup()
@@ -28,11 +119,99 @@ namespace
         return os::is_kernel_address(core, ptr) ? proc.kdtb : proc.udtb;
     }
 
+    void tlb_clear(Tlb& tlb)
+    {
+        tlb.index.clear();
+        tlb.entries.clear();
+    }
+
+    const Translation* tlb_lookup(Tlb& tlb, const TlbKey& key)
+    {
+        const auto it = tlb.index.find(key);
+        if(it == tlb.index.end())
+            return nullptr;
+
+        tlb.entries.splice(tlb.entries.begin(), tlb.entries, it->second);
+        return &*it->second;
+    }
+
+    // only hardware translations are cached, os ones may be transition or prototype pages
+    opt<phy_t> tlb_find(core::Core& core, memory::Memory& m, dtb_t dtb, uint64_t ptr)
+    {
+        const auto epoch = fdp::stop_epoch(core);
+        if(!epoch)
+            return {};
+
+        if(epoch != m.tlb_epoch)
+        {
+            tlb_clear(m.tlb);
+            m.tlb_epoch = epoch;
+        }
+        const auto small = tlb_lookup(m.tlb, TlbKey{dtb.val, utils::align<PAGE_SIZE>(ptr)});
+        if(small)
+        {
+            m.cache_stats.tlb_hits++;
+            return phy_t{small->phy | (ptr & (PAGE_SIZE - 1))};
+        }
+
+        const auto large = tlb_lookup(m.tlb, TlbKey{dtb.val, utils::align<large_page_size>(ptr) | 1});
+        if(large)
+        {
+            m.cache_stats.tlb_hits++;
+            return phy_t{large->phy | (ptr & (large_page_size - 1))};
+        }
+
+        m.cache_stats.tlb_misses++;
+        return {};
+    }
+
+    // 1gb pages are recorded as the 2mb pages we use
+    void tlb_insert(core::Core& core, memory::Memory& m, const memory::translate_t& t)
+    {
+        const auto epoch = fdp::stop_epoch(core);
+        if(!epoch || epoch != m.tlb_epoch)
+            return;
+
+        // refill the entry if any, else take a new one or evict the least recently used
+        const auto size  = t.large ? large_page_size : PAGE_SIZE;
+        const auto key   = TlbKey{t.dtb.val, (t.ptr & ~(size - 1)) | t.large};
+        auto&      tlb   = m.tlb;
+        const auto it    = tlb.index.find(key);
+        auto       entry = Translations::iterator{};
+        if(it != tlb.index.end())
+        {
+            entry = it->second;
+        }
+        else if(tlb.entries.size() < max_translations)
+        {
+            entry = tlb.entries.emplace(tlb.entries.end());
+            tlb.index.emplace(key, entry);
+        }
+        else
+        {
+            entry = std::prev(tlb.entries.end());
+            tlb.index.erase(entry->key);
+            tlb.index.emplace(key, entry);
+        }
+        entry->key = key;
+        entry->phy = t.phy.val & ~(size - 1);
+        tlb.entries.splice(tlb.entries.begin(), tlb.entries, entry);
+    }
+
     opt<phy_t> virtual_to_physical(core::Core& core, proc_t* proc, dtb_t dtb, uint64_t ptr)
     {
-        const auto ret = fdp::virtual_to_physical(core, dtb, ptr);
-        if(ret && ret->val)
-            return ret;
+        auto&      m   = *core.mem_;
+        const auto hit = tlb_find(core, m, dtb, ptr);
+        if(hit)
+            return hit;
+
+        auto t = memory::translate_t{ptr, dtb, {}, false, false};
+        fdp::translate_vector(core, &t, 1);
+        if(t.ok && t.phy.val)
+        {
+            tlb_insert(core, m, t);
+            return t.phy;
+        }
 
         return os::virtual_to_physical(core, proc, dtb, ptr);
     }
@@ -49,6 +228,56 @@ opt<phy_t> memory::virtual_to_physical_with_dtb(core::Core& core, dtb_t dtb, uin
     return ::virtual_to_physical(core, nullptr, dtb, ptr);
 }
 
+bool memory::virtual_to_physical_batch(core::Core& core, translate_t* translates, size_t num)
+{
+    if(!num)
+        return true;
+
+    // only send tlb misses to fdp
+    auto& m       = *core.mem_;
+    auto  misses  = std::vector<translate_t>{};
+    auto  indexes = std::vector<size_t>{};
+    for(size_t i = 0; i < num; ++i)
+    {
+        auto&      t   = translates[i];
+        const auto hit = tlb_find(core, m, t.dtb, t.ptr);
+        t.ok           = !!hit;
+        t.phy          = hit ? *hit : phy_t{};
+        if(hit)
+            continue;
+
+        misses.push_back(t);
+        indexes.push_back(i);
+    }
+    if(misses.empty())
+        return true;
+
+    const auto all = fdp::translate_vector(core, &misses[0], misses.size());
+    for(size_t i = 0; i < misses.size(); ++i)
+    {
+        translates[indexes[i]] = misses[i];
+        if(misses[i].ok)
+            tlb_insert(core, m, misses[i]);
+    }
+    if(all)
+        return true;
+
+    // retry missing pages one by one with os fallback
+    auto ok = true;
+    for(size_t i = 0; i < num; ++i)
+    {
+        auto& t = translates[i];
+        if(t.ok)
+            continue;
+
+        const auto phy = os::virtual_to_physical(core, nullptr, t.dtb, t.ptr);
+        t.ok           = !!phy;
+        t.phy          = phy ? *phy : phy_t{};
+        ok &= t.ok;
+    }
+    return ok;
+}
+
 namespace
 {
     template <typename T>
@@ -82,19 +311,209 @@ namespace
         return os::read_page(core, pgdst, pgsrc, proc, dtb);
     }
 
+    void drop_windows(memory::Memory& m)
+    {
+        for(auto& s : m.streams)
+            s.epoch = 0;
+    }
+
+    bool read_window(const Stream& s, uint8_t* dst, uint64_t src, uint32_t size)
+    {
+        if(src < s.base || src + size > s.base + s.data.size())
+            return false;
+
+        // let faulted pages go through the os fallback
+        const auto last = (src + size - 1 - s.base) / PAGE_SIZE;
+        for(auto i = (src - s.base) / PAGE_SIZE; i <= last; ++i)
+            if(s.faults[i / 8] & (1 << (i % 8)))
+                return false;
+
+        memcpy(dst, &s.data[src - s.base], size);
+        return true;
+    }
+
+    bool read_ahead(core::Core& core, memory::Memory& m, dtb_t dtb, uint8_t* dst, uint64_t src, uint32_t size)
+    {
+        const auto epoch = fdp::stop_epoch(core);
+        if(!m.readahead || !epoch)
+            return false;
+
+        // ascending reads skipping a few fields are still sequential
+        const auto sequential = [&](const Stream& s)
+        {
+            return s.dtb == dtb.val && src >= s.last && src <= s.next + max_readahead_gap;
+        };
+        const auto it = std::find_if(m.streams.begin(), m.streams.end(), sequential);
+        if(it == m.streams.end())
+        {
+            // random access, start a new stream without reading ahead
+            auto& s = *std::min_element(m.streams.begin(), m.streams.end(), [](const Stream& a, const Stream& b)
+            {
+                return a.used < b.used;
+            });
+            s.dtb   = dtb.val;
+            s.last  = src;
+            s.next  = src + size;
+            s.used  = ++m.stream_tick;
+            s.pages = 0;
+            s.epoch = 0;
+            return false;
+        }
+
+        auto& s = *it;
+        s.last  = src;
+        s.next  = src + size;
+        s.used  = ++m.stream_tick;
+        if(s.epoch == epoch && read_window(s, dst, src, size))
+        {
+            m.cache_stats.readahead_hits++;
+            return true;
+        }
+
+        // large reads gain nothing from reading ahead
+        if(size >= m.readahead * PAGE_SIZE)
+            return false;
+
+        // sequential miss, grow the window & fetch it in one round trip
+        s.pages         = std::min(std::max<size_t>(s.pages * 2, 2), m.readahead);
+        const auto base = utils::align<PAGE_SIZE>(src);
+        const auto end  = utils::align<PAGE_SIZE>(src + size + PAGE_SIZE - 1);
+        const auto wide = std::max<uint64_t>(end - base, s.pages * PAGE_SIZE);
+        s.data.resize(wide);
+        s.faults.resize((wide / PAGE_SIZE + 7) / 8);
+        s.epoch = 0;
+        m.cache_stats.readahead_fetches++;
+        const auto ok = fdp::read_virtual_partial(core, &s.data[0], base, dtb, wide, &s.faults[0]);
+        if(!ok)
+            return false;
+
+        s.epoch = epoch;
+        s.base  = base;
+        return read_window(s, dst, src, size);
+    }
+
     bool read_virtual(core::Core& core, proc_t* proc, dtb_t dtb, uint8_t* dst, uint64_t src, uint32_t size)
     {
         if(!size)
             return true;
 
-        const auto full = fdp::read_virtual(core, dst, src, dtb, size);
-        if(full)
+        const auto ahead = read_ahead(core, *core.mem_, dtb, dst, src, size);
+        if(ahead)
             return true;
 
-        return read_pages("virtual", dst, src, size, [&](uint8_t* pgdst, uint64_t pgsrc, uint32_t pgsize)
+        // one round trip for every mapped page, one bit per page
+        auto       ptr    = utils::align<PAGE_SIZE>(src);
+        auto       skip   = src - ptr;
+        const auto pages  = (skip + size + PAGE_SIZE - 1) / PAGE_SIZE;
+        auto       small  = std::array<uint8_t, 64>{};
+        auto       large  = std::vector<uint8_t>{};
+        auto*      faults = &small[0];
+        if((pages + 7) / 8 > small.size())
         {
-            return read_virtual_page(core, pgdst, pgsrc, proc, dtb, pgsize);
-        });
+            large.resize((pages + 7) / 8);
+            faults = &large[0];
+        }
+        const auto ok = fdp::read_virtual_partial(core, dst, src, dtb, size, faults);
+        if(!ok)
+            return read_pages("virtual", dst, src, size, [&](uint8_t* pgdst, uint64_t pgsrc, uint32_t pgsize)
+            {
+                return read_virtual_page(core, pgdst, pgsrc, proc, dtb, pgsize);
+            });
+
+        // only faulted pages go through the os paging fallback
+        auto buffer = std::array<uint8_t, PAGE_SIZE>{};
+        auto fill   = size_t{};
+        for(size_t i = 0; fill < size; ++i)
+        {
+            const auto chunk = std::min<size_t>(size - fill, sizeof buffer - skip);
+            if(faults[i / 8] & (1 << (i % 8)))
+            {
+                const auto paged = os::read_page(core, &buffer[0], ptr, proc, dtb);
+                if(!paged)
+                    return false;
+
+                memcpy(&dst[fill], &buffer[skip], chunk);
+            }
+            fill += chunk;
+            skip = 0;
+            ptr += sizeof buffer;
+        }
+        return true;
+    }
+
+    // returns true when a valid page was evicted
+    bool cache_insert(PageCache& c, uint64_t pfn, uint64_t epoch, const uint8_t* src)
+    {
+        // refill the stale copy if any, else take a new page or evict the least recently used
+        const auto it      = c.index.find(pfn);
+        auto       page    = CachedPages::iterator{};
+        auto       evicted = false;
+        if(it != c.index.end())
+        {
+            page = it->second;
+        }
+        else if(c.pages.size() < c.max_pages)
+        {
+            page = c.pages.emplace(c.pages.end());
+            c.index.emplace(pfn, page);
+        }
+        else
+        {
+            page    = std::prev(c.pages.end());
+            evicted = page->epoch == epoch;
+            c.index.erase(page->pfn);
+            c.index.emplace(pfn, page);
+        }
+        page->pfn   = pfn;
+        page->epoch = epoch;
+        memcpy(&page->data[0], src, PAGE_SIZE);
+        c.pages.splice(c.pages.begin(), c.pages, page);
+        return evicted;
+    }
+
+    const CachedPage* cache_find(PageCache& c, uint64_t pfn, uint64_t epoch)
+    {
+        const auto it = c.index.find(pfn);
+        if(it == c.index.end() || it->second->epoch != epoch)
+            return nullptr;
+
+        c.pages.splice(c.pages.begin(), c.pages, it->second);
+        return &*it->second;
+    }
+
+    void cache_drop(PageCache& c, uint64_t pfn)
+    {
+        const auto it = c.index.find(pfn);
+        if(it != c.index.end())
+            it->second->epoch = 0;
+    }
+
+    void cache_clear(PageCache& c)
+    {
+        c.index.clear();
+        c.pages.clear();
+    }
+
+    bool read_cached_page(core::Core& core, memory::Memory& m, uint64_t epoch, uint8_t* pgdst, uint64_t pgsrc)
+    {
+        const auto pfn  = pgsrc / PAGE_SIZE;
+        const auto page = cache_find(m.cache, pfn, epoch);
+        if(page)
+        {
+            m.cache_stats.hits++;
+            memcpy(pgdst, &page->data[0], PAGE_SIZE);
+            return true;
+        }
+
+        m.cache_stats.misses++;
+        const auto ok = fdp::read_physical(core, pgdst, phy_t{pgsrc}, PAGE_SIZE);
+        if(!ok)
+            return false;
+
+        const auto evicted = cache_insert(m.cache, pfn, epoch, pgdst);
+        if(evicted)
+            m.cache_stats.evictions++;
+        return true;
     }
 
     bool read_physical(core::Core& core, uint8_t* dst, uint64_t src, size_t size)
@@ -102,6 +521,15 @@ namespace
         if(!size)
             return true;
 
+        // guest memory can only change while the vm runs
+        auto&      m     = *core.mem_;
+        const auto epoch = fdp::stop_epoch(core);
+        if(m.cache.max_pages && epoch)
+            return read_pages("physical", dst, src, size, [&](uint8_t* pgdst, uint64_t pgsrc, uint32_t /*pgsize*/)
+            {
+                return read_cached_page(core, m, epoch, pgdst, pgsrc);
+            });
+
         return read_pages("physical", dst, src, size, [&](uint8_t* pgdst, uint64_t pgsrc, uint32_t pgsize)
         {
             return fdp::read_physical(core, pgdst, phy_t{pgsrc}, pgsize);
@@ -140,11 +568,53 @@ namespace
         return true;
     }
 
+    void cache_drop_physical(memory::Memory& m, uint64_t dst, size_t size)
+    {
+        if(m.cache.index.empty() && m.tables.index.empty())
+            return;
+
+        const auto last = (dst + size - 1) / PAGE_SIZE;
+        for(auto pfn = dst / PAGE_SIZE; pfn <= last; ++pfn)
+        {
+            cache_drop(m.cache, pfn);
+            cache_drop(m.tables, pfn);
+        }
+    }
+
+    void cache_drop_virtual(core::Core& core, memory::Memory& m, dtb_t dtb, uint64_t dst, size_t size)
+    {
+        if(m.cache.index.empty() && m.tables.index.empty())
+            return;
+
+        auto       translates = std::vector<memory::translate_t>{};
+        const auto last       = utils::align<PAGE_SIZE>(dst + size - 1);
+        for(auto ptr = utils::align<PAGE_SIZE>(dst); ptr <= last; ptr += PAGE_SIZE)
+            translates.push_back({ptr, dtb, {}, false, false});
+
+        // drop every page when we cannot tell which ones are written
+        const auto ok = memory::virtual_to_physical_batch(core, &translates[0], translates.size());
+        if(!ok)
+        {
+            cache_clear(m.cache);
+            cache_clear(m.tables);
+            return;
+        }
+
+        for(const auto& t : translates)
+        {
+            cache_drop(m.cache, t.phy.val / PAGE_SIZE);
+            cache_drop(m.tables, t.phy.val / PAGE_SIZE);
+        }
+    }
+
     bool write_virtual(core::Core& core, proc_t* proc, dtb_t dtb, uint64_t dst, const uint8_t* src, uint32_t size)
     {
         if(!size)
             return true;
 
+        cache_drop_virtual(core, *core.mem_, dtb, dst, size);
+        drop_windows(*core.mem_);
+        tlb_clear(core.mem_->tlb);
         const auto full = fdp::write_virtual(core, dst, dtb, src, size);
         if(full)
             return true;
@@ -169,6 +639,9 @@ namespace
         if(!size)
             return true;
 
+        cache_drop_physical(*core.mem_, dst, size);
+        drop_windows(*core.mem_);
+        tlb_clear(core.mem_->tlb);
         const auto read_physical = [&](uint8_t* pgdst, uint64_t pgsrc, size_t pgsize)
         {
             return fdp::read_physical(core, pgdst, phy_t{pgsrc}, pgsize);
@@ -202,6 +675,73 @@ bool memory::read_physical(core::Core& core, void* vdst, uint64_t src, size_t si
     return ::read_physical(core, dst, src, size);
 }
 
+opt<uint64_t> memory::read_page_table_entry(core::Core& core, uint64_t ptr)
+{
+    auto&      m     = *core.mem_;
+    const auto epoch = fdp::stop_epoch(core);
+    auto       entry = uint64_t{};
+    if(!epoch)
+    {
+        const auto ok = fdp::read_physical(core, &entry, phy_t{ptr}, sizeof entry);
+        if(!ok)
+            return {};
+
+        return entry;
+    }
+
+    // fetch the whole table on first touch, neighbour entries are read next
+    const auto pfn  = ptr / PAGE_SIZE;
+    const auto page = cache_find(m.tables, pfn, epoch);
+    if(page)
+    {
+        m.cache_stats.table_hits++;
+        memcpy(&entry, &page->data[ptr & (PAGE_SIZE - 1)], sizeof entry);
+        return entry;
+    }
+
+    m.cache_stats.table_misses++;
+    auto       buffer = std::array<uint8_t, PAGE_SIZE>{};
+    const auto ok     = fdp::read_physical(core, &buffer[0], phy_t{pfn * PAGE_SIZE}, PAGE_SIZE);
+    if(!ok)
+        return {};
+
+    cache_insert(m.tables, pfn, epoch, &buffer[0]);
+    memcpy(&entry, &buffer[ptr & (PAGE_SIZE - 1)], sizeof entry);
+    return entry;
+}
+
+bool memory::read_virtual_batch(core::Core& core, read_t* reads, size_t num)
+{
+    if(!num)
+        return true;
+
+    const auto all = fdp::read_vector(core, reads, num, FDP_VIRTUAL_ADDRESS);
+    if(all)
+        return true;
+
+    // retry failed reads one by one with os page fallback
+    auto ok = true;
+    for(size_t i = 0; i < num; ++i)
+    {
+        auto& r = reads[i];
+        if(r.ok)
+            continue;
+
+        auto* dst = reinterpret_cast<uint8_t*>(r.dst);
+        r.ok      = ::read_virtual(core, nullptr, r.dtb, dst, r.src, static_cast<uint32_t>(r.size));
+        ok &= r.ok;
+    }
+    return ok;
+}
+
+bool memory::read_physical_batch(core::Core& core, read_t* reads, size_t num)
+{
+    if(!num)
+        return true;
+
+    return fdp::read_vector(core, reads, num, FDP_PHYSICAL_ADDRESS);
+}
+
 bool memory::write_virtual(core::Core& core, proc_t proc, uint64_t dst, const void* vsrc, size_t size)
 {
     const auto* src   = reinterpret_cast<const uint8_t*>(vsrc);
@@ -222,3 +762,42 @@ bool memory::write_physical(core::Core& core, uint64_t dst, const void* vsrc, si
     const auto* src = reinterpret_cast<const uint8_t*>(vsrc);
     return ::write_physical(core, dst, src, size);
 }
+
+opt<std::vector<phy_t>> memory::dirty_pages(core::Core& core)
+{
+    auto       pages = std::vector<phy_t>{};
+    const auto ok    = fdp::dirty_pages(core, pages);
+    if(!ok)
+        return FAIL(std::nullopt, "unable to get dirty pages");
+
+    return pages;
+}
+
+bool memory::reset_dirty_pages(core::Core& core)
+{
+    return fdp::reset_dirty_pages(core);
+}
+
+void memory::set_cache_size(core::Core& core, size_t max_pages)
+{
+    auto& m           = *core.mem_;
+    m.cache.max_pages = max_pages;
+    cache_clear(m.cache);
+}
+
+void memory::set_readahead(core::Core& core, size_t max_pages)
+{
+    auto& m     = *core.mem_;
+    m.readahead = max_pages;
+    drop_windows(m);
+}
+
+memory::cache_stats_t memory::cache_stats(core::Core& core)
+{
+    return core.mem_->cache_stats;
+}
+
+void memory::reset_cache_stats(core::Core& core)
+{
+    core.mem_->cache_stats = {};
+}
@@ -8,8 +8,14 @@
 #include "interfaces/if_os.hpp"
 #include "os.hpp"
 
+#include <algorithm>
+#include <numeric>
+
 namespace
 {
+    // fields closer than this share a single read
+    constexpr uint64_t max_field_gap = 0x400;
+
     template <typename T, T (*read)(const void*)>
     opt<T> read_mem(const memory::Io& io, uint64_t src)
     {
@@ -28,6 +34,18 @@ namespace
         write(&value, arg);
         return io.write_all(dst, &value, sizeof value);
     }
+
+    opt<uint64_t> read_field(const uint8_t* src, uint32_t size)
+    {
+        switch(size)
+        {
+            case 1: return ::read_byte(src);
+            case 2: return ::read_le16(src);
+            case 4: return ::read_le32(src);
+            case 8: return ::read_le64(src);
+        }
+        return std::nullopt;
+    }
 }
 
 memory::Io memory::make_io_kernel(core::Core& core)
@@ -96,6 +114,45 @@ bool memory::Io::read_all(void* dst, uint64_t ptr, size_t size) const
     return memory::read_virtual_with_dtb(core, dtb, dst, ptr, size);
 }
 
+bool memory::Io::read_fields(uint64_t ptr, const field_t* fields, opt<uint64_t>* values, size_t num) const
+{
+    auto order = std::vector<size_t>(num);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+    {
+        return fields[a].offset < fields[b].offset;
+    });
+
+    auto buffer = std::vector<uint8_t>{};
+    auto all_ok = true;
+    for(size_t i = 0; i < num;)
+    {
+        // grow the span over every following field close enough
+        const auto begin = fields[order[i]].offset;
+        auto       end   = begin + fields[order[i]].size;
+        auto       next  = i + 1;
+        for(; next < num && fields[order[next]].offset <= end + max_field_gap; ++next)
+            end = std::max(end, fields[order[next]].offset + fields[order[next]].size);
+
+        buffer.resize(end - begin);
+        const auto ok = !buffer.empty() && read_all(&buffer[0], ptr + begin, buffer.size());
+        for(; i < next; ++i)
+        {
+            const auto& field = fields[order[i]];
+            auto&       value = values[order[i]];
+            auto        tmp   = uint64_t{};
+            value             = std::nullopt;
+            if(ok)
+                value = read_field(buffer.data() + field.offset - begin, field.size);
+            // the span may cross an unmapped page, retry alone
+            else if(field.size <= sizeof tmp && read_all(&tmp, ptr + field.offset, field.size))
+                value = read_field(reinterpret_cast<const uint8_t*>(&tmp), field.size);
+            all_ok &= !!value;
+        }
+    }
+    return all_ok;
+}
+
 opt<phy_t> memory::Io::physical(uint64_t ptr) const
 {
     if(proc)
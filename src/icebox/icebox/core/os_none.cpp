@@ -28,11 +28,12 @@ namespace
         flags_t             proc_flags      (proc_t proc) override;
         opt<proc_t>         proc_parent     (proc_t proc) override;
 
-        bool            thread_list     (proc_t proc, threads::on_thread_fn on_thread) override;
-        opt<thread_t>   thread_current  () override;
-        opt<proc_t>     thread_proc     (thread_t thread) override;
-        opt<uint64_t>   thread_pc       (proc_t proc, thread_t thread) override;
-        uint64_t        thread_id       (proc_t proc, thread_t thread) override;
+        bool            thread_list       (proc_t proc, threads::on_thread_fn on_thread) override;
+        opt<thread_t>   thread_current    () override;
+        opt<proc_t>     thread_proc       (thread_t thread) override;
+        opt<uint64_t>   thread_pc         (proc_t proc, thread_t thread) override;
+        uint64_t        thread_id         (proc_t proc, thread_t thread) override;
+        opt<uint64_t>   thread_gs_offset  () override;
 
         bool                mod_list(proc_t proc, modules::on_mod_fn on_module) override;
         opt<std::string>    mod_name(proc_t proc, mod_t mod) override;
@@ -155,6 +156,11 @@ opt<thread_t> None::thread_current()
     return {};
 }
 
+opt<uint64_t> None::thread_gs_offset()
+{
+    return {};
+}
+
 opt<proc_t> None::thread_proc(thread_t /*thread*/)
 {
     return {};
@@ -2,27 +2,48 @@
 
 #define PRIVATE_CORE_
 #include "fdp.hpp"
+#include "state.hpp"
 
 uint64_t registers::read(core::Core& core, reg_e reg)
 {
-    const auto ret = fdp::read_register(core, reg);
+    return read(core, state::current_cpu(core), reg);
+}
+
+uint64_t registers::read(core::Core& core, uint32_t cpu, reg_e reg)
+{
+    const auto ret = fdp::read_register(core, cpu, reg);
     return ret ? *ret : 0;
 }
 
 bool registers::write(core::Core& core, reg_e reg, uint64_t value)
 {
-    return fdp::write_register(core, reg, value);
+    return write(core, state::current_cpu(core), reg, value);
+}
+
+bool registers::write(core::Core& core, uint32_t cpu, reg_e reg, uint64_t value)
+{
+    return fdp::write_register(core, cpu, reg, value);
 }
 
 uint64_t registers::read_msr(core::Core& core, msr_e reg)
 {
-    const auto ret = fdp::read_msr_register(core, reg);
+    return read_msr(core, state::current_cpu(core), reg);
+}
+
+uint64_t registers::read_msr(core::Core& core, uint32_t cpu, msr_e reg)
+{
+    const auto ret = fdp::read_msr_register(core, cpu, reg);
     return ret ? *ret : 0;
 }
 
 bool registers::write_msr(core::Core& core, msr_e reg, uint64_t value)
 {
-    return fdp::write_msr_register(core, reg, value);
+    return write_msr(core, state::current_cpu(core), reg, value);
+}
+
+bool registers::write_msr(core::Core& core, uint32_t cpu, msr_e reg, uint64_t value)
+{
+    return fdp::write_msr_register(core, cpu, reg, value);
 }
 
 std::string_view registers::to_string(reg_e reg)
@@ -11,10 +11,10 @@
 #include <libco.h>
 
 #include <atomic>
+#include <chrono>
 #include <cstring>
 #include <deque>
 #include <map>
-#include <thread>
 
 namespace std
 {
@@ -41,8 +41,9 @@ namespace
 {
     struct Breakpoint
     {
-        opt<dtb_t> dtb;
-        int        id;
+        opt<dtb_t>    dtb;
+        opt<thread_t> thread;
+        int           id;
     };
 
     struct BreakpointObserver
@@ -122,9 +123,11 @@ struct state::State
         : core(core)
         , last_bpid{}
         , breakphy{}
+        , breakcpu{}
         , co_main(co_active())
         , pool(16)
         , on_blocking([](auto /*unused*/) {})
+        , slot_stats{}
     {
     }
 
@@ -134,11 +137,13 @@ struct state::State
     Breakpoints       breakpoints;
     bpid_t            last_bpid;
     phy_t             breakphy;
+    uint32_t          breakcpu;
     cothread_t        co_main;
     WorkerPool        pool;
     Workers           workers;
     Blocking          on_blocking;
     std::atomic<bool> interrupted;
+    slot_stats_t      slot_stats;
 };
 
 std::shared_ptr<state::State> state::setup(core::Core& core)
@@ -253,11 +258,24 @@ namespace
         return true;
     }
 
+    uint32_t get_break_cpu(core::Core& core)
+    {
+        const auto count = fdp::cpu_count(core);
+        for(uint32_t cpu = 0; cpu < count; ++cpu)
+        {
+            const auto state = fdp::cpu_state(core, cpu);
+            if(state && *state & (FDP_STATE_BREAKPOINT_HIT | FDP_STATE_HARD_BREAKPOINT_HIT))
+                return cpu;
+        }
+        return 0;
+    }
+
     bool update_break_state(Data& d)
     {
         d.breakphy     = {};
-        const auto rip = registers::read(d.core, reg_e::rip);
-        const auto dtb = dtb_t{registers::read(d.core, reg_e::cr3)};
+        d.breakcpu     = get_break_cpu(d.core);
+        const auto rip = registers::read(d.core, d.breakcpu, reg_e::rip);
+        const auto dtb = dtb_t{registers::read(d.core, d.breakcpu, reg_e::cr3)};
         const auto phy = memory::virtual_to_physical_with_dtb(d.core, dtb, rip);
         if(!phy)
             return FAIL(false, "unable to get current physical address");
@@ -285,9 +303,9 @@ namespace
         return updated;
     }
 
-    bool try_single_step(core::Core& core)
+    bool try_single_step(Data& d)
     {
-        return fdp::step_once(core);
+        return fdp::step_once(d.core, d.breakcpu);
     }
 
     bool try_resume(Data& d)
@@ -300,7 +318,7 @@ namespace
             return true;
 
         if(*state & (FDP_STATE_BREAKPOINT_HIT | FDP_STATE_HARD_BREAKPOINT_HIT))
-            if(!try_single_step(d.core))
+            if(!try_single_step(d))
                 return false;
 
         const auto resumed = fdp::resume(d.core);
@@ -323,7 +341,20 @@ bool state::resume(core::Core& core)
 
 bool state::single_step(core::Core& core)
 {
-    return try_single_step(core);
+    return try_single_step(*core.state_);
+}
+
+uint32_t state::cpu_count(core::Core& core)
+{
+    return fdp::cpu_count(core);
+}
+
+uint32_t state::current_cpu(core::Core& core)
+{
+    if(!core.state_)
+        return 0;
+
+    return core.state_->breakcpu;
 }
 
 namespace
@@ -431,6 +462,9 @@ namespace
         skip,
     };
 
+    // how long we sleep before checking for state::interrupt
+    constexpr int interrupt_poll_ms = 10;
+
     bool try_wait(Data& d, state_e state, breakpoints_e check)
     {
         // notify caller we are blocking execution here
@@ -438,10 +472,8 @@ namespace
         d.interrupted = false;
         d.on_blocking(state::blocking_e::begin);
         while(!d.interrupted)
-            if(fdp::state_changed(d.core))
+            if(fdp::wait_state_changed(d.core, interrupt_poll_ms))
                 break;
-            else
-                std::this_thread::yield();
         d.on_blocking(state::blocking_e::end);
 
         // do not update state or call callbacks if we are interrupted
@@ -490,58 +522,159 @@ void state::wait_for(core::Core& core, int timeout_ms)
 
 namespace
 {
-    opt<int> try_add_breakpoint(core::Core& core, std::string_view name, phy_t phy, opt<dtb_t> dtb)
+    struct BreakpointRequest
+    {
+        phy_t         phy;
+        opt<dtb_t>    dtb;
+        opt<thread_t> thread; // filtered by the server, kernel addresses only
+        opt<int>      bpid;
+    };
+
+    struct BreakpointFilter
     {
-        auto&      d       = *core.state_;
-        auto&      targets = d.targets;
-        const auto it      = targets.find(phy);
-        if(it != targets.end())
+        opt<dtb_t>    dtb;
+        opt<thread_t> thread;
+    };
+
+    // reuse compatible breakpoints & set missing ones in a single batch
+    void try_add_breakpoints(core::Core& core, std::string_view name, std::vector<BreakpointRequest>& reqs)
+    {
+        auto& d       = *core.state_;
+        auto& targets = d.targets;
+        auto  pending = std::unordered_map<phy_t, size_t>{};
+        auto  filters = std::vector<BreakpointFilter>{};
+        auto  bps     = std::vector<fdp::breakpoint_t>{};
+        auto  indexes = std::vector<opt<size_t>>(reqs.size());
+        for(size_t i = 0; i < reqs.size(); ++i)
         {
-            // keep using found breakpoint if filtering rules are compatible
-            const auto bp_dtb = it->second.dtb;
-            if(!bp_dtb || bp_dtb == dtb)
-                return it->second.id;
-
-            // filtering rules are too restrictive, remove old breakpoint & add an unfiltered breakpoint
-            const auto ok = fdp::unset_breakpoint(core, it->second.id);
-            targets.erase(it);
-            if(!ok)
-                return std::nullopt;
-
-            // add new breakpoint without filtering
-            dtb = {};
+            auto&      req = reqs[i];
+            const auto it  = targets.find(req.phy);
+            if(it != targets.end())
+            {
+                // keep using found breakpoint if filtering rules are compatible
+                const auto bp_dtb    = it->second.dtb;
+                const auto bp_thread = it->second.thread;
+                if((!bp_dtb || bp_dtb == req.dtb) && (!bp_thread || bp_thread == req.thread))
+                {
+                    req.bpid = it->second.id;
+                    continue;
+                }
+
+                // filtering rules are too restrictive, remove old breakpoint & add an unfiltered breakpoint
+                const auto ok = fdp::unset_breakpoint(core, it->second.id);
+                targets.erase(it);
+                if(!ok)
+                    continue;
+
+                // add new breakpoint without filtering
+                req.dtb    = {};
+                req.thread = {};
+            }
+
+            const auto [jt, inserted] = pending.emplace(req.phy, bps.size());
+            indexes[i]                = jt->second;
+            if(!inserted)
+            {
+                // same address requested twice with different filters
+                auto& filter = filters[jt->second];
+                if(filter.dtb != req.dtb)
+                    filter.dtb = {};
+                if(filter.thread != req.thread)
+                    filter.thread = {};
+                continue;
+            }
+
+            filters.push_back(BreakpointFilter{req.dtb, req.thread});
+            bps.push_back(fdp::breakpoint_t{FDP_SOFTHBP, 0, FDP_EXECUTE_BP, FDP_PHYSICAL_ADDRESS, req.phy.val, 1, 0, FDP_NO_MATCH, 0, 0});
         }
+        if(bps.empty())
+            return;
 
-        const auto dtb_val = dtb ? dtb->val : 0;
-        const auto bpid    = fdp::set_breakpoint(core, FDP_SOFTHBP, 0, FDP_EXECUTE_BP, FDP_PHYSICAL_ADDRESS, phy.val, 1, dtb_val);
-        if(bpid < 0)
-            return FAIL(std::nullopt, "unable to set breakpoint %s phy:0x%" PRIx64 " dtb:0x%" PRIx64, std::string{name}.data(), phy.val, dtb_val);
+        // let the server skip hits from other threads
+        const auto thread_offset = core.os_->thread_gs_offset();
+        for(size_t i = 0; i < bps.size(); ++i)
+        {
+            auto& filter = filters[i];
+            if(!thread_offset)
+                filter.thread = {};
+            bps[i].cr3 = filter.dtb ? filter.dtb->val : 0;
+            if(!filter.thread)
+                continue;
+
+            bps[i].match       = FDP_MATCH_GS_RELATIVE;
+            bps[i].match_ptr   = *thread_offset;
+            bps[i].match_value = filter.thread->id;
+        }
 
-        targets.emplace(phy, Breakpoint{dtb, bpid});
-        return bpid;
+        auto bpids = std::vector<int>(bps.size(), -1);
+        fdp::set_breakpoints(core, &bps[0], &bpids[0], bps.size());
+
+        // servers without hit predicates drop matched breakpoints, check_breakpoints filters them instead
+        auto retries = std::vector<size_t>{};
+        for(size_t i = 0; i < bps.size(); ++i)
+            if(bpids[i] < 0 && bps[i].match != FDP_NO_MATCH)
+                retries.push_back(i);
+
+        if(!retries.empty())
+        {
+            auto unmatched = std::vector<fdp::breakpoint_t>{};
+            for(const auto i : retries)
+            {
+                unmatched.push_back(bps[i]);
+                unmatched.back().match       = FDP_NO_MATCH;
+                unmatched.back().match_ptr   = 0;
+                unmatched.back().match_value = 0;
+            }
+            auto unmatched_ids = std::vector<int>(unmatched.size(), -1);
+            fdp::set_breakpoints(core, &unmatched[0], &unmatched_ids[0], unmatched.size());
+            for(size_t j = 0; j < retries.size(); ++j)
+                bpids[retries[j]] = unmatched_ids[j];
+        }
+
+        for(size_t i = 0; i < bps.size(); ++i)
+            if(bpids[i] < 0)
+                LOG(ERROR, "unable to set breakpoint %s phy:0x%" PRIx64 " dtb:0x%" PRIx64, std::string{name}.data(), bps[i].ptr, bps[i].cr3);
+            else
+                targets.emplace(phy_t{bps[i].ptr}, Breakpoint{filters[i].dtb, filters[i].thread, bpids[i]});
+
+        for(size_t i = 0; i < reqs.size(); ++i)
+            if(indexes[i] && bpids[*indexes[i]] >= 0)
+                reqs[i].bpid = bpids[*indexes[i]];
     }
 
-    state::Breakpoint set_physical_breakpoint(core::Core& core, std::string_view name, phy_t phy, const opt<dtb_t>& dtb, opt<proc_t> proc, const opt<thread_t>& thread, const state::Task& task)
+    opt<int> try_add_breakpoint(core::Core& core, std::string_view name, phy_t phy, opt<dtb_t> dtb, opt<thread_t> thread)
+    {
+        auto reqs = std::vector<BreakpointRequest>{BreakpointRequest{phy, dtb, thread, {}}};
+        try_add_breakpoints(core, name, reqs);
+        return reqs[0].bpid;
+    }
+
+    state::Breakpoint observe_breakpoint(core::Core& core, std::string_view name, phy_t phy, int bpid, opt<proc_t> proc, const opt<thread_t>& thread, const state::Task& task)
     {
         auto& d = *core.state_;
         if(thread && !proc)
             proc = threads::process(core, *thread);
 
-        const auto bp   = std::make_shared<BreakpointObserver>(task, name, phy, proc, thread);
-        const auto bpid = try_add_breakpoint(core, std::string{name}, phy, dtb);
-        if(!bpid)
-            return {};
-
         // update all observers breakpoint id
+        const auto bp = std::make_shared<BreakpointObserver>(task, name, phy, proc, thread);
         d.observers.emplace(phy, bp);
         lookup_observers(d.observers, phy, [&](auto it)
         {
-            it->second->bpid = *bpid;
+            it->second->bpid = bpid;
             return walk_e::next;
         });
         return std::make_shared<state::BreakpointPrivate>(core, bp);
     }
 
+    state::Breakpoint set_physical_breakpoint(core::Core& core, std::string_view name, phy_t phy, const opt<dtb_t>& dtb, const opt<proc_t>& proc, const opt<thread_t>& thread, const state::Task& task)
+    {
+        const auto bpid = try_add_breakpoint(core, std::string{name}, phy, dtb, {});
+        if(!bpid)
+            return {};
+
+        return observe_breakpoint(core, name, phy, *bpid, proc, thread, task);
+    }
+
     dtb_t dtb_select(core::Core& core, proc_t proc, uint64_t ptr)
     {
         return core.os_->is_kernel_address(ptr) ? proc.kdtb : proc.udtb;
@@ -558,9 +691,42 @@ namespace
         if(!opt_phy)
             return nullptr;
 
-        const auto dtb     = dtb_select(core, *opt_proc, ptr);
-        const auto opt_dtb = proc || thread ? std::make_optional(dtb) : std::nullopt;
-        return set_physical_breakpoint(core, name, *opt_phy, opt_dtb, proc, thread, task);
+        // gs only points to the current thread in kernel mode
+        const auto dtb        = dtb_select(core, *opt_proc, ptr);
+        const auto opt_dtb    = proc || thread ? std::make_optional(dtb) : std::nullopt;
+        const auto opt_thread = core.os_->is_kernel_address(ptr) ? thread : std::nullopt;
+        const auto bpid       = try_add_breakpoint(core, name, *opt_phy, opt_dtb, opt_thread);
+        if(!bpid)
+            return {};
+
+        return observe_breakpoint(core, name, *opt_phy, *bpid, proc, thread, task);
+    }
+
+    std::vector<state::Breakpoint> set_virtual_breakpoints(core::Core& core, std::string_view name, const std::unordered_set<uint64_t>& ptrs)
+    {
+        auto       bps  = std::vector<state::Breakpoint>{};
+        const auto proc = process::current(core);
+        if(!proc)
+            return bps;
+
+        auto translates = std::vector<memory::translate_t>{};
+        translates.reserve(ptrs.size());
+        for(const auto ptr : ptrs)
+            translates.push_back(memory::translate_t{ptr, dtb_select(core, *proc, ptr), {}, false, false});
+        memory::virtual_to_physical_batch(core, translates.data(), translates.size());
+
+        auto reqs = std::vector<BreakpointRequest>{};
+        reqs.reserve(ptrs.size());
+        for(const auto& t : translates)
+            if(t.ok)
+                reqs.push_back(BreakpointRequest{t.phy, {}, {}, {}});
+
+        try_add_breakpoints(core, name, reqs);
+        bps.reserve(reqs.size());
+        for(const auto& req : reqs)
+            if(req.bpid)
+                bps.push_back(observe_breakpoint(core, name, req.phy, *req.bpid, {}, {}, {}));
+        return bps;
     }
 }
 
@@ -652,10 +818,7 @@ void state::run_to(core::Core& core, std::string_view name, std::unordered_set<u
     if((bp_cr3 == BP_CR3_NONE) & ptrs.empty())
         return;
 
-    auto bps = std::vector<state::Breakpoint>{};
-    bps.reserve(ptrs.size());
-    for(const uint64_t& ptr : ptrs)
-        bps.push_back(set_virtual_breakpoint(core, name, ptr, {}, {}, {}));
+    const auto bps = set_virtual_breakpoints(core, name, ptrs);
 
     int      bpid = -1;
     uint64_t cr3  = 0;
@@ -707,9 +870,40 @@ bool state::restore(core::Core& core)
     return fdp::restore(core);
 }
 
+bool state::save_slot(core::Core& core, uint32_t slot)
+{
+    auto&      d     = *core.state_;
+    const auto start = std::chrono::steady_clock::now();
+    const auto ok    = fdp::save_slot(core, slot);
+    d.slot_stats.save_time += std::chrono::steady_clock::now() - start;
+    d.slot_stats.saves++;
+    if(!ok)
+        return FAIL(false, "unable to save slot %u", slot);
+
+    return true;
+}
+
+bool state::restore_slot(core::Core& core, uint32_t slot)
+{
+    auto&      d     = *core.state_;
+    const auto start = std::chrono::steady_clock::now();
+    const auto ok    = fdp::restore_slot(core, slot);
+    d.slot_stats.restore_time += std::chrono::steady_clock::now() - start;
+    d.slot_stats.restores++;
+    if(!ok)
+        return FAIL(false, "unable to restore slot %u", slot);
+
+    return true;
+}
+
+state::slot_stats_t state::slot_stats(core::Core& core)
+{
+    return core.state_->slot_stats;
+}
+
 bool state::inject_interrupt(core::Core& core, uint32_t code, uint32_t error, uint64_t cr2)
 {
-    return fdp::inject_interrupt(core, code, error, cr2);
+    return fdp::inject_interrupt(core, current_cpu(core), code, error, cr2);
 }
 
 namespace
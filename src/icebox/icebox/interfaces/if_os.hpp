@@ -32,11 +32,12 @@ namespace os
         virtual flags_t             proc_flags      (proc_t proc) = 0;
         virtual opt<proc_t>         proc_parent     (proc_t proc) = 0;
 
-        virtual bool            thread_list     (proc_t proc, threads::on_thread_fn on_thread) = 0;
-        virtual opt<thread_t>   thread_current  () = 0;
-        virtual opt<proc_t>     thread_proc     (thread_t thread) = 0;
-        virtual opt<uint64_t>   thread_pc       (proc_t proc, thread_t thread) = 0;
-        virtual uint64_t        thread_id       (proc_t proc, thread_t thread) = 0;
+        virtual bool            thread_list       (proc_t proc, threads::on_thread_fn on_thread) = 0;
+        virtual opt<thread_t>   thread_current    () = 0;
+        virtual opt<proc_t>     thread_proc       (thread_t thread) = 0;
+        virtual opt<uint64_t>   thread_pc         (proc_t proc, thread_t thread) = 0;
+        virtual uint64_t        thread_id         (proc_t proc, thread_t thread) = 0;
+        virtual opt<uint64_t>   thread_gs_offset  () = 0;
 
         virtual bool                mod_list(proc_t proc, modules::on_mod_fn on_mod) = 0;
         virtual opt<std::string>    mod_name(proc_t proc, mod_t mod) = 0;
@@ -239,11 +239,12 @@ namespace
         flags_t             proc_flags      (proc_t proc) override;
         opt<proc_t>         proc_parent     (proc_t proc) override;
 
-        bool            thread_list     (proc_t proc, threads::on_thread_fn on_thread) override;
-        opt<thread_t>   thread_current  () override;
-        opt<proc_t>     thread_proc     (thread_t thread) override;
-        opt<uint64_t>   thread_pc       (proc_t proc, thread_t thread) override;
-        uint64_t        thread_id       (proc_t proc, thread_t thread) override;
+        bool            thread_list       (proc_t proc, threads::on_thread_fn on_thread) override;
+        opt<thread_t>   thread_current    () override;
+        opt<proc_t>     thread_proc       (thread_t thread) override;
+        opt<uint64_t>   thread_pc         (proc_t proc, thread_t thread) override;
+        uint64_t        thread_id         (proc_t proc, thread_t thread) override;
+        opt<uint64_t>   thread_gs_offset  () override;
 
         bool                mod_list(proc_t proc, modules::on_mod_fn on_module) override;
         opt<std::string>    mod_name(proc_t proc, mod_t mod) override;
@@ -815,6 +816,11 @@ opt<thread_t> OsLinux::thread_current()
     return thread_t{*addr};
 }
 
+opt<uint64_t> OsLinux::thread_gs_offset()
+{
+    return *symbols_[CURRENT_TASK] - *symbols_[PER_CPU_START];
+}
+
 namespace
 {
     opt<uint64_t> proc_mm(OsLinux& p, uint64_t proc_thread_id)
@@ -2,19 +2,86 @@
 
 #include "types.hpp"
 
+#include <vector>
+
 namespace core { struct Core; }
 
 namespace memory
 {
+    // one read in a batch, see read_*_batch
+    struct read_t
+    {
+        void*    dst;
+        uint64_t src;
+        dtb_t    dtb; // unused on physical reads
+        size_t   size;
+        bool     ok;
+    };
+
+    // one translation in a batch, see virtual_to_physical_batch
+    struct translate_t
+    {
+        uint64_t ptr;
+        dtb_t    dtb;
+        phy_t    phy;
+        bool     large; // mapped by a 2mb or 1gb page
+        bool     ok;
+    };
+
+    // one little endian field of 1, 2, 4 or 8 bytes, see Io::read_fields
+    struct field_t
+    {
+        uint64_t offset;
+        uint32_t size;
+    };
+
+    // physical page & translation cache counters since setup or reset_cache_stats
+    struct cache_stats_t
+    {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        uint64_t tlb_hits;
+        uint64_t tlb_misses;
+        uint64_t table_hits;
+        uint64_t table_misses;
+        uint64_t readahead_hits;
+        uint64_t readahead_fetches;
+    };
+
     opt<phy_t>  virtual_to_physical         (core::Core& core, proc_t proc, uint64_t ptr);
     opt<phy_t>  virtual_to_physical_with_dtb(core::Core& core, dtb_t dtb, uint64_t ptr);
+    bool        virtual_to_physical_batch   (core::Core& core, translate_t* translates, size_t num);
     bool        read_virtual                (core::Core& core, proc_t proc, void* dst, uint64_t src, size_t size);
     bool        read_virtual_with_dtb       (core::Core& core, dtb_t dtb, void* dst, uint64_t src, size_t size);
     bool        read_physical               (core::Core& core, void* dst, uint64_t src, size_t size);
+    bool        read_virtual_batch          (core::Core& core, read_t* reads, size_t num);
+    bool        read_physical_batch         (core::Core& core, read_t* reads, size_t num);
     bool        write_virtual               (core::Core& core, proc_t proc, uint64_t dst, const void*, size_t size);
     bool        write_virtual_with_dtb      (core::Core& core, dtb_t dtb, uint64_t dst, const void*, size_t size);
     bool        write_physical              (core::Core& core, uint64_t dst, const void* src, size_t size);
 
+    // read one 8-byte aligned page table entry at a physical address
+    // while the vm is paused, whole table pages are kept so page walks share them
+    opt<uint64_t>   read_page_table_entry(core::Core& core, uint64_t ptr);
+
+    // physical pages written since the last reset_dirty_pages, sorted
+    // every page is dirty until the first reset
+    opt<std::vector<phy_t>> dirty_pages         (core::Core& core);
+    bool                    reset_dirty_pages   (core::Core& core);
+
+    // physical pages read while the vm is paused are cached until it runs again or they are written
+    // default to 4096 pages, 0 disables the cache
+    // hardware translations are cached per dtb until the vm runs or any memory is written
+    void            set_cache_size      (core::Core& core, size_t max_pages);
+
+    // ascending virtual reads of one dtb fetch up to max_pages ahead in one round trip
+    // default to 16 pages, 0 disables read ahead
+    void            set_readahead       (core::Core& core, size_t max_pages);
+
+    cache_stats_t   cache_stats         (core::Core& core);
+    void            reset_cache_stats   (core::Core& core);
+
     struct Io
     {
         ~Io() = default;
@@ -31,6 +98,10 @@ namespace memory
         bool            read_all(void* dst, uint64_t ptr, size_t size) const;
         opt<phy_t>      physical(uint64_t ptr) const;
 
+        // read every field of the struct at ptr into values, with one read per cluster of fields
+        // return true if all fields were read
+        bool    read_fields(uint64_t ptr, const field_t* fields, opt<uint64_t>* values, size_t num) const;
+
         // write methods
         bool    write_byte  (uint64_t dst, uint8_t arg) const;
         bool    write_le16  (uint64_t dst, uint16_t arg) const;
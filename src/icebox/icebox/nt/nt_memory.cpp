@@ -137,10 +137,11 @@ namespace
         const auto pml4e_base = dtb.val & (mask(40) << 12);
         const auto pml4e_ptr  = pml4e_base + virt.u.f.pml4 * 8ULL;
         auto       pml4e      = MMPTE{};
-        const auto ok         = memory::read_physical(os.core_, &pml4e, pml4e_ptr, sizeof pml4e);
-        if(!ok)
+        const auto entry      = memory::read_page_table_entry(os.core_, pml4e_ptr);
+        if(!entry)
             return {};
 
+        pml4e.u.value = *entry;
         if(!pml4e.u.hard.Valid)
             return {};
 
@@ -151,10 +152,11 @@ namespace
     {
         auto       pdpe     = MMPTE{};
         const auto pdpe_ptr = pml4e.u.hard.PageFrameNumber * PAGE_SIZE + virt.u.f.pdp * sizeof pdpe;
-        auto       ok       = memory::read_physical(os.core_, &pdpe, pdpe_ptr, sizeof pdpe);
-        if(!ok)
+        const auto entry    = memory::read_page_table_entry(os.core_, pdpe_ptr);
+        if(!entry)
             return {};
 
+        pdpe.u.value = *entry;
         if(!pdpe.u.hard.Valid)
             return {};
 
@@ -163,12 +165,13 @@ namespace
 
     opt<MMPTE> read_pte(nt::Os& os, const virt_t& virt, const MMPTE& pde)
     {
-        auto pte     = MMPTE{};
-        auto pte_ptr = pde.u.hard.PageFrameNumber * PAGE_SIZE + virt.u.f.pt * sizeof pte;
-        auto ok      = memory::read_physical(os.core_, &pte, pte_ptr, sizeof pte);
-        if(!ok)
+        auto       pte     = MMPTE{};
+        const auto pte_ptr = pde.u.hard.PageFrameNumber * PAGE_SIZE + virt.u.f.pt * sizeof pte;
+        const auto entry   = memory::read_page_table_entry(os.core_, pte_ptr);
+        if(!entry)
             return {};
 
+        pte.u.value = *entry;
         return pte;
     }
 
@@ -176,10 +179,11 @@ namespace
     {
         auto       pde     = MMPTE{};
         const auto pde_ptr = pdpe.u.hard.PageFrameNumber * PAGE_SIZE + virt.u.f.pd * sizeof pde;
-        auto       ok      = memory::read_physical(os.core_, &pde, pde_ptr, sizeof pde);
-        if(!ok)
+        const auto entry   = memory::read_page_table_entry(os.core_, pde_ptr);
+        if(!entry)
             return {};
 
+        pde.u.value = *entry;
         return pde;
     }
 
@@ -118,9 +118,8 @@ opt<bpid_t> nt::Os::listen_drv_create(const drivers::on_event_fn& on_load)
 
 namespace
 {
-    opt<walk_e> mod_list_64(const nt::Os& os, proc_t proc, const memory::Io& io, const modules::on_mod_fn& on_mod)
+    opt<walk_e> mod_list_64(const nt::Os& os, opt<uint64_t> peb, const memory::Io& io, const modules::on_mod_fn& on_mod)
     {
-        const auto peb = io.read(proc.id + os.offsets_[EPROCESS_Peb]);
         if(!peb)
             return FAIL(std::nullopt, "unable to read EPROCESS.Peb");
 
@@ -147,9 +146,8 @@ namespace
         return walk_e::next;
     }
 
-    opt<uint64_t> read_wow64_peb(const nt::Os& os, const memory::Io& io, proc_t proc)
+    opt<uint64_t> read_wow64_peb(const nt::Os& os, const memory::Io& io, opt<uint64_t> wowp)
     {
-        const auto wowp = io.read(proc.id + os.offsets_[EPROCESS_Wow64Process]);
         if(!wowp)
             return FAIL(std::nullopt, "unable to read EPROCESS.Wow64Process");
 
@@ -171,9 +169,9 @@ namespace
 
 #define offsetof32(x, y) static_cast<uint32_t>(offsetof(x, y))
 
-    opt<walk_e> mod_list_32(const nt::Os& os, proc_t proc, const memory::Io& io, const modules::on_mod_fn& on_mod)
+    opt<walk_e> mod_list_32(const nt::Os& os, opt<uint64_t> wowp, const memory::Io& io, const modules::on_mod_fn& on_mod)
     {
-        const auto peb32 = read_wow64_peb(os, io, proc);
+        const auto peb32 = read_wow64_peb(os, io, wowp);
         if(!peb32)
             return {};
 
@@ -203,14 +201,21 @@ namespace
 
 bool nt::Os::mod_list(proc_t proc, modules::on_mod_fn on_mod)
 {
-    const auto io  = memory::make_io(core_, proc);
-    auto       ret = mod_list_64(*this, proc, io, on_mod);
+    // both peb pointers in one read
+    const auto io     = memory::make_io(core_, proc);
+    const auto fields = std::array<memory::field_t, 2>{{
+        {offsets_[EPROCESS_Peb], 8},
+        {offsets_[EPROCESS_Wow64Process], 8},
+    }};
+    auto values = std::array<opt<uint64_t>, 2>{};
+    io.read_fields(proc.id, &fields[0], &values[0], fields.size());
+    auto ret = mod_list_64(*this, values[0], io, on_mod);
     if(!ret)
         return false;
     if(*ret == walk_e::stop)
         return true;
 
-    ret = mod_list_32(*this, proc, io, on_mod);
+    ret = mod_list_32(*this, values[1], io, on_mod);
     return !!ret;
 }
 
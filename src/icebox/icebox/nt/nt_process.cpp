@@ -5,36 +5,28 @@
 #include "nt.hpp"
 #include "utils/path.hpp"
 
-namespace
-{
-    opt<dtb_t> read_user_dtb(nt::Os& os, uint64_t kprocess)
-    {
-        const auto dtb = os.io_.read(kprocess + os.offsets_[KPROCESS_UserDirectoryTableBase]);
-        if(dtb && *dtb != 0 && *dtb != 1)
-            return dtb_t{*dtb};
-
-        if(os.offsets_[KPROCESS_DirectoryTableBase] == os.offsets_[KPROCESS_UserDirectoryTableBase])
-            return {};
-
-        const auto kdtb = os.io_.read(kprocess + os.offsets_[KPROCESS_DirectoryTableBase]);
-        if(!kdtb)
-            return {};
-
-        return dtb_t{*kdtb};
-    }
-}
-
 opt<proc_t> nt::make_proc(nt::Os& os, uint64_t eproc)
 {
-    const auto dtb = read_user_dtb(os, eproc + os.offsets_[EPROCESS_Pcb]);
-    if(!dtb)
+    // both dtbs in one read
+    const auto kprocess = eproc + os.offsets_[EPROCESS_Pcb];
+    const auto fields   = std::array<memory::field_t, 2>{{
+        {os.offsets_[KPROCESS_DirectoryTableBase], 8},
+        {os.offsets_[KPROCESS_UserDirectoryTableBase], 8},
+    }};
+    auto values = std::array<opt<uint64_t>, 2>{};
+    os.io_.read_fields(kprocess, &fields[0], &values[0], fields.size());
+    const auto kdtb = values[0];
+    const auto udtb = values[1];
+    if(!kdtb)
         return {};
 
-    const auto kdtb = os.io_.read(eproc + os.offsets_[EPROCESS_Pcb] + os.offsets_[KPROCESS_DirectoryTableBase]);
-    if(!kdtb)
+    if(udtb && *udtb != 0 && *udtb != 1)
+        return proc_t{eproc, dtb_t{*kdtb}, dtb_t{*udtb}};
+
+    if(os.offsets_[KPROCESS_DirectoryTableBase] == os.offsets_[KPROCESS_UserDirectoryTableBase])
         return {};
 
-    return proc_t{eproc, dtb_t{*kdtb}, *dtb};
+    return proc_t{eproc, dtb_t{*kdtb}, dtb_t{*kdtb}};
 }
 
 bool nt::Os::proc_list(process::on_proc_fn on_process)
@@ -42,6 +42,11 @@ opt<thread_t> nt::Os::thread_current()
     return thread_t{*thread};
 }
 
+opt<uint64_t> nt::Os::thread_gs_offset()
+{
+    return offsets_[KPCR_Prcb] + offsets_[KPRCB_CurrentThread];
+}
+
 opt<proc_t> nt::Os::thread_proc(thread_t thread)
 {
     const auto kproc = io_.read(thread.id + offsets_[KTHREAD_Process]);
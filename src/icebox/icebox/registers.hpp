@@ -7,10 +7,15 @@ namespace core { struct Core; }
 
 namespace registers
 {
+    // without cpu id, registers of the vcpu which broke last, see state::current_cpu
     uint64_t            read        (core::Core& core, reg_e reg);
+    uint64_t            read        (core::Core& core, uint32_t cpu, reg_e reg);
     bool                write       (core::Core& core, reg_e reg, uint64_t value);
+    bool                write       (core::Core& core, uint32_t cpu, reg_e reg, uint64_t value);
     std::string_view    to_string   (reg_e reg);
     uint64_t            read_msr    (core::Core& core, msr_e reg);
+    uint64_t            read_msr    (core::Core& core, uint32_t cpu, msr_e reg);
     bool                write_msr   (core::Core& core, msr_e reg, uint64_t value);
+    bool                write_msr   (core::Core& core, uint32_t cpu, msr_e reg, uint64_t value);
     std::string_view    to_string   (msr_e reg);
 }; // namespace registers
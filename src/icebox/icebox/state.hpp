@@ -2,6 +2,7 @@
 
 #include "types.hpp"
 
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <unordered_set>
@@ -26,6 +27,15 @@ namespace state
         end,
     };
 
+    // time spent in save_slot & restore_slot since setup
+    struct slot_stats_t
+    {
+        uint64_t                 saves;
+        uint64_t                 restores;
+        std::chrono::nanoseconds save_time;
+        std::chrono::nanoseconds restore_time;
+    };
+
     // generic functor object
     using Task     = std::function<void(void)>;
     using Blocking = std::function<void(blocking_e)>;
@@ -33,9 +43,14 @@ namespace state
     bool        pause                       (core::Core& core);
     bool        resume                      (core::Core& core);
     bool        single_step                 (core::Core& core);
+    uint32_t    cpu_count                   (core::Core& core);
+    uint32_t    current_cpu                 (core::Core& core);
     bool        wait                        (core::Core& core);
     bool        save                        (core::Core& core);
     bool        restore                     (core::Core& core);
+    bool        save_slot                   (core::Core& core, uint32_t slot);
+    bool        restore_slot                (core::Core& core, uint32_t slot);
+    slot_stats_t slot_stats                 (core::Core& core);
     void        wait_for                    (core::Core& core, int timeout_ms);
     void        exec                        (core::Core& core);
     void        interrupt                   (core::Core& core);
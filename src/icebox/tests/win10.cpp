@@ -11,6 +11,7 @@
 #define GTEST_DONT_DEFINE_FAIL 1
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <map>
 #include <thread>
 #include <unordered_set>
@@ -41,6 +42,57 @@ namespace
             EXPECT_TRUE(resumed);
         }
 
+        // explorer.exe & its ntdll.dll image, mapped in every process
+        struct ntdll_t
+        {
+            proc_t proc;
+            span_t span;
+            phy_t  phy; // first image page
+        };
+
+        opt<ntdll_t> find_ntdll()
+        {
+            auto&      core = *ptr_core;
+            const auto proc = process::find_name(core, "explorer.exe", {});
+            if(!proc)
+                return {};
+
+            const auto mod = modules::find_name(core, *proc, "ntdll.dll", flags::x64);
+            if(!mod)
+                return {};
+
+            const auto span = modules::span(core, *proc, *mod);
+            if(!span)
+                return {};
+
+            const auto phy = memory::virtual_to_physical(core, *proc, span->addr);
+            if(!phy)
+                return {};
+
+            return ntdll_t{*proc, *span, *phy};
+        }
+
+        // bytes below the stack pointer of the paused vcpu, unused by the guest,
+        // so a failing test writing them cannot corrupt shared pages
+        struct scratch_t
+        {
+            dtb_t    dtb;
+            uint64_t ptr;
+            phy_t    phy;
+        };
+
+        opt<scratch_t> find_scratch()
+        {
+            auto&      core = *ptr_core;
+            const auto dtb  = dtb_t{registers::read(core, reg_e::cr3)};
+            const auto ptr  = (registers::read(core, reg_e::rsp) - 0x100) & ~0xFull;
+            const auto phy  = memory::virtual_to_physical_with_dtb(core, dtb, ptr);
+            if(!phy)
+                return {};
+
+            return scratch_t{dtb, ptr, *phy};
+        }
+
         std::shared_ptr<core::Core> ptr_core;
     };
 }
@@ -417,6 +469,221 @@ TEST_F(win10, memory)
     EXPECT_TRUE(!!ok);
 }
 
+TEST_F(win10, memory_batch)
+{
+    auto&      core = *ptr_core;
+    const auto proc = process::find_name(core, "explorer.exe", {});
+    EXPECT_TRUE(!!proc);
+
+    auto spans = std::vector<span_t>{};
+    modules::list(core, *proc, [&](mod_t mod)
+    {
+        const auto span = modules::span(core, *proc, mod);
+        if(span)
+            spans.push_back(*span);
+        return walk_e::next;
+    });
+    EXPECT_FALSE(spans.empty());
+
+    const auto size    = size_t{0x40};
+    auto       buffers = std::vector<uint8_t>(spans.size() * size);
+    auto       reads   = std::vector<memory::read_t>{};
+    for(size_t i = 0; i < spans.size(); ++i)
+        reads.push_back({&buffers[i * size], spans[i].addr, proc->udtb, size, false});
+    auto ok = memory::read_virtual_batch(core, &reads[0], reads.size());
+    EXPECT_TRUE(ok);
+
+    auto want = std::vector<uint8_t>(size);
+    for(size_t i = 0; i < spans.size(); ++i)
+    {
+        EXPECT_TRUE(reads[i].ok);
+        ok = memory::read_virtual(core, *proc, &want[0], spans[i].addr, size);
+        EXPECT_TRUE(ok);
+        EXPECT_EQ(0, memcmp(&want[0], &buffers[i * size], size));
+    }
+}
+
+TEST_F(win10, memory_translate_batch)
+{
+    auto&      core  = *ptr_core;
+    const auto ntdll = find_ntdll();
+    ASSERT_TRUE(!!ntdll);
+
+    auto translates = std::vector<memory::translate_t>{};
+    for(size_t i = 0; i < ntdll->span.size; i += PAGE_SIZE)
+        translates.push_back(memory::translate_t{ntdll->span.addr + i, ntdll->proc.udtb, {}, false, false});
+    memory::virtual_to_physical_batch(core, &translates[0], translates.size());
+    for(const auto& t : translates)
+    {
+        const auto phy = memory::virtual_to_physical(core, ntdll->proc, t.ptr);
+        EXPECT_EQ(!!phy, t.ok);
+        if(!phy || !t.ok)
+            continue;
+
+        EXPECT_EQ(phy->val, t.phy.val);
+    }
+}
+
+TEST_F(win10, memory_page_cache)
+{
+    auto&      core    = *ptr_core;
+    const auto scratch = find_scratch();
+    ASSERT_TRUE(!!scratch);
+
+    auto original = std::vector<uint8_t>(0x10);
+    auto ok       = memory::read_physical(core, &original[0], scratch->phy.val, original.size());
+    EXPECT_TRUE(ok);
+    const auto stats = memory::cache_stats(core);
+    auto       again = std::vector<uint8_t>(original.size());
+    ok               = memory::read_physical(core, &again[0], scratch->phy.val, again.size());
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(original, again);
+    EXPECT_EQ(memory::cache_stats(core).hits, stats.hits + 1);
+
+    // virtual writes must drop the cached physical page
+    const auto garbage = std::vector<uint8_t>(original.size(), 0xCC);
+    ok                 = memory::write_virtual_with_dtb(core, scratch->dtb, scratch->ptr, &garbage[0], garbage.size());
+    EXPECT_TRUE(ok);
+    ok = memory::read_physical(core, &again[0], scratch->phy.val, again.size());
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(garbage, again);
+    ok = memory::write_virtual_with_dtb(core, scratch->dtb, scratch->ptr, &original[0], original.size());
+    EXPECT_TRUE(ok);
+}
+
+TEST_F(win10, memory_translate_cache)
+{
+    auto&      core  = *ptr_core;
+    const auto ntdll = find_ntdll();
+    ASSERT_TRUE(!!ntdll);
+
+    // find_ntdll translated the first page
+    const auto stats = memory::cache_stats(core);
+    const auto again = memory::virtual_to_physical(core, ntdll->proc, ntdll->span.addr + 0x10);
+    EXPECT_TRUE(!!again);
+    EXPECT_EQ(ntdll->phy.val + 0x10, again->val);
+    EXPECT_EQ(memory::cache_stats(core).tlb_hits, stats.tlb_hits + 1);
+}
+
+TEST_F(win10, memory_readahead)
+{
+    auto&      core  = *ptr_core;
+    const auto ntdll = find_ntdll();
+    ASSERT_TRUE(!!ntdll);
+
+    const auto read_headers = [&](std::vector<uint8_t>& bytes)
+    {
+        for(size_t i = 0; i < bytes.size(); i += 8)
+        {
+            const auto ok = memory::read_virtual(core, ntdll->proc, &bytes[i], ntdll->span.addr + i, 8);
+            EXPECT_TRUE(ok);
+        }
+    };
+    auto ahead = std::vector<uint8_t>(0x4000);
+    auto bytes = std::vector<uint8_t>(ahead.size());
+    memory::set_readahead(core, 0);
+    read_headers(bytes);
+    memory::set_readahead(core, 16);
+    const auto stats = memory::cache_stats(core);
+    read_headers(ahead);
+    EXPECT_EQ(ahead, bytes);
+    EXPECT_GT(memory::cache_stats(core).readahead_hits, stats.readahead_hits);
+}
+
+TEST_F(win10, memory_read_fields)
+{
+    auto&      core  = *ptr_core;
+    const auto ntdll = find_ntdll();
+    ASSERT_TRUE(!!ntdll);
+
+    // IMAGE_DOS_HEADER e_magic & e_lfanew
+    const auto io     = memory::make_io(core, ntdll->proc);
+    const auto fields = std::array<memory::field_t, 2>{{{0x3C, 4}, {0, 2}}};
+    auto       values = std::array<opt<uint64_t>, 2>{};
+    const auto ok     = io.read_fields(ntdll->span.addr, &fields[0], &values[0], fields.size());
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(values[0], io.le32(ntdll->span.addr + 0x3C));
+    EXPECT_EQ(values[1], 0x5A4Du);
+}
+
+TEST_F(win10, dirty_pages)
+{
+    auto&      core  = *ptr_core;
+    const auto ntdll = find_ntdll();
+    ASSERT_TRUE(!!ntdll);
+    const auto phy = ntdll->phy;
+
+    auto ok = memory::reset_dirty_pages(core);
+    EXPECT_TRUE(ok);
+    auto dirty = memory::dirty_pages(core);
+    EXPECT_TRUE(!!dirty);
+    const auto page = [&](const std::vector<phy_t>& pages)
+    {
+        return std::find_if(pages.begin(), pages.end(), [&](phy_t x) { return x.val == (phy.val & ~0xFFFull); });
+    };
+    EXPECT_EQ(page(*dirty), dirty->end());
+
+    // writing back the same bytes still dirties the page
+    auto buffer = std::vector<uint8_t>(0x10);
+    ok          = memory::read_physical(core, &buffer[0], phy.val, buffer.size());
+    EXPECT_TRUE(ok);
+    ok = memory::write_physical(core, phy.val, &buffer[0], buffer.size());
+    EXPECT_TRUE(ok);
+    dirty = memory::dirty_pages(core);
+    EXPECT_TRUE(!!dirty);
+    EXPECT_NE(page(*dirty), dirty->end());
+    EXPECT_TRUE(std::is_sorted(dirty->begin(), dirty->end(), [](phy_t a, phy_t b) { return a.val < b.val; }));
+}
+
+TEST_F(win10, snapshot_slots)
+{
+    auto&      core    = *ptr_core;
+    const auto scratch = find_scratch();
+    ASSERT_TRUE(!!scratch);
+    const auto phy = scratch->phy;
+
+    auto original = std::vector<uint8_t>(0x10);
+    auto ok       = memory::read_physical(core, &original[0], phy.val, original.size());
+    EXPECT_TRUE(ok);
+    const auto stats = state::slot_stats(core);
+    ok               = state::save_slot(core, 0);
+    EXPECT_TRUE(ok);
+
+    const auto garbage = std::vector<uint8_t>(original.size(), 0xCC);
+    ok                 = memory::write_physical(core, phy.val, &garbage[0], garbage.size());
+    EXPECT_TRUE(ok);
+    ok = state::restore_slot(core, 0);
+    EXPECT_TRUE(ok);
+
+    auto restored = std::vector<uint8_t>(original.size());
+    ok            = memory::read_physical(core, &restored[0], phy.val, restored.size());
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(original, restored);
+
+    const auto next = state::slot_stats(core);
+    EXPECT_EQ(next.saves, stats.saves + 1);
+    EXPECT_EQ(next.restores, stats.restores + 1);
+}
+
+TEST_F(win10, vcpus)
+{
+    auto&      core  = *ptr_core;
+    const auto count = state::cpu_count(core);
+    EXPECT_GE(count, 1u);
+    EXPECT_LT(state::current_cpu(core), count);
+
+    // every vcpu has its own kpcr
+    auto kpcrs = std::unordered_set<uint64_t>{};
+    for(uint32_t cpu = 0; cpu < count; ++cpu)
+    {
+        EXPECT_NE(registers::read(core, cpu, reg_e::cr3), 0u);
+        const auto user = registers::read(core, cpu, reg_e::cs) & 3;
+        const auto msr  = user ? msr_e::kernel_gs_base : msr_e::gs_base;
+        kpcrs.insert(registers::read_msr(core, cpu, msr));
+    }
+    EXPECT_EQ(kpcrs.size(), count);
+}
+
 TEST_F(win10, memory_kernel_passive)
 {
     auto&      core     = *ptr_core;
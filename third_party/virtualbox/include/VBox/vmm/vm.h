@@ -97,6 +97,10 @@ typedef struct BreakpointEntrie_t{
             GCPhysArea_t*    breakpointGCPhysAreaTable;
             //Condition
             uint64_t    breakpointCr3;
+            //Hit predicate, the qword at breakpointMatchAddress must hold breakpointMatchValue
+            uint8_t     breakpointMatchType;
+            uint64_t    breakpointMatchAddress;
+            uint64_t    breakpointMatchValue;
 }BreakpointEntrie_t;
 
 #define MAX_BREAKPOINT_ID 1024
@@ -1411,7 +1415,7 @@ typedef struct VM
     /*MYCODE*/
     union{
         BreakpointEntrie_t  l[MAX_BREAKPOINT_ID+1];
-        uint8_t             padding[4096*32];      /* Must be page aligned ! */
+        uint8_t             padding[4096*40];      /* Must be page aligned ! */
     }bp;
 
     union{
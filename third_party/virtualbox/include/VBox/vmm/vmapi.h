@@ -491,6 +491,8 @@ VMMDECL(int)                VMR3PhysSimpleReadGCPhysU(PUVM pUVM, void *pvDst, RT
 VMMDECL(int)                VMR3PhysSimpleWriteGCPhysU(PUVM pUVM, const void *pvBuf, RTGCPHYS GCPhys, size_t cbWrite);
 VMMR3_INT_DECL(int)         VMR3AddExecPageBreakpoint(PUVM pUVM, PVMCPU pVCpu, uint64_t GCPtr, uint64_t Length);
 VMMR3_INT_DECL(bool)        VMR3RemoveBreakpoint(PUVM pUVM, int BreakpointId);
+VMMR3_INT_DECL(bool)        VMR3RemoveAllBreakpoints(PUVM pUVM);
+VMMR3_INT_DECL(bool)        VMR3SetBreakpointMatch(PUVM pUVM, int BreakpointId, uint8_t MatchType, uint64_t MatchAddress, uint64_t MatchValue);
 VMMDECL(int)                VMR3SingleStep(PUVM pUVM, PVMCPU pVCpu);
 VMMDECL(int)                VMR3Break(PUVM pUVM);
 VMMDECL(int)                VMR3Continue(PUVM pUVM);
@@ -499,6 +501,7 @@ VMMDECL(void)               VMR3SetFDPRunning(PUVM pUVM, bool newFDPRunning);
 VMMR3DECL(uint32_t)         VMR3GetCPUCount(PUVM pUVM);
 VMMDECL(bool)               VMR3HandleSingleStep(PVM pVM, PVMCPU pVCpu);
 VMMDECL(bool)               VMR3EnterPause(PVM pVM, PVMCPU pVCpu);
+VMMDECL(void)               VMR3UpdateFdpCpuCtx(PVMCPU pVCpu);
 VMMDECL(void)               VMR3SetFDPShm(PUVM pUVM, void *pFdpShm);
 VMMDECL(uint64_t)           VMR3Test(PVMCPU pVCpu);
 VMMDECL(int)                VMR3InjectInterrupt(PVM pVM, PVMCPU pVCpu, uint32_t enmXcpt, uint32_t uErr, uint64_t Cr2);
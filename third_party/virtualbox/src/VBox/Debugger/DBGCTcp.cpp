@@ -23,6 +23,7 @@
 #include <VBox/vmm/cfgm.h>
 #include <VBox/err.h>
 
+#include <iprt/env.h>
 #include <iprt/thread.h>
 #include <iprt/tcp.h>
 #include <VBox/log.h>
@@ -311,6 +312,28 @@ bool FDPVBOX_getMemorySize(void *pUserHandle, uint64_t* MemorySize)
     return true;
 }
 
+bool FDPVBOX_getPhysicalRanges(void *pUserHandle, FDP_PHYSICAL_RANGE_T *pRanges, uint32_t *pRangeCount)
+{
+    Log1(("[DBGC] GET_PHYSICAL_RANGES\n"));
+    FDPVBOX_USERHANDLE_T* myVBOXHandle = (FDPVBOX_USERHANDLE_T*)pUserHandle;
+    PVM pVM = VMR3GetVM(myVBOXHandle->pUVM);
+    uint32_t cRanges = 0;
+    for(uint32_t i = 0; i < PGMR3PhysGetRamRangeCount(pVM) && cRanges < *pRangeCount; i++){
+        RTGCPHYS GCPhysStart;
+        RTGCPHYS GCPhysLast;
+        bool fIsMmio;
+        int rc = PGMR3PhysGetRange(pVM, i, &GCPhysStart, &GCPhysLast, NULL, &fIsMmio);
+        if(RT_FAILURE(rc) || fIsMmio){
+            continue;
+        }
+        pRanges[cRanges].PhysicalAddress = GCPhysStart;
+        pRanges[cRanges].Size = GCPhysLast - GCPhysStart + 1;
+        cRanges++;
+    }
+    *pRangeCount = cRanges;
+    return true;
+}
+
 bool FDPVBOX_readPhysicalMemory(void *pUserHandle, uint8_t *pDstBuffer, uint64_t PhysicalAddress, uint32_t ReadSize)
 {
     Log1(("[DBGC] READ_PHYSICAL %p %d ... ", PhysicalAddress, ReadSize));
@@ -369,6 +392,7 @@ bool FDPVBOX_writeMsr(void *pUserHandle, uint32_t CpuId, uint64_t MSRId, uint64_
     PVMCPU pVCpu = VMMR3GetCpuByIdU(myVBOXHandle->pUVM, CpuId);
     int rc = CPUMSetGuestMsr(pVCpu, MSRId, MSRValue);
     if(RT_SUCCESS(rc)){
+        VMR3UpdateFdpCpuCtx(pVCpu);
         return true;
     }
     return false;
@@ -402,6 +426,36 @@ bool FDPVBOX_getCpuCount(void *pUserHandle, uint32_t *pCpuCount)
     return true;
 }
 
+bool FDPVBOX_getDirtyPages(void *pUserHandle, uint64_t FirstPage, uint64_t *pPages, uint32_t *pPageCount)
+{
+    Log1(("[DBGC] GET_DIRTY_PAGES %p %d\n", FirstPage, *pPageCount));
+    FDPVBOX_USERHANDLE_T* myVBOXHandle = (FDPVBOX_USERHANDLE_T*)pUserHandle;
+    PVM pVM = VMR3GetVM(myVBOXHandle->pUVM);
+    int rc = PGMR3PhysGetDirtyPages(pVM, FirstPage, pPages, pPageCount);
+    if(RT_SUCCESS(rc)){
+        return true;
+    }
+    return false;
+}
+
+bool FDPVBOX_resetDirtyLog(void *pUserHandle)
+{
+    Log1(("[DBGC] RESET_DIRTY_LOG\n"));
+    FDPVBOX_USERHANDLE_T* myVBOXHandle = (FDPVBOX_USERHANDLE_T*)pUserHandle;
+    //Page tables can't change under a running CPU
+    uint8_t State = 0;
+    FDPVBOX_getState(pUserHandle, &State);
+    if(!(State & FDP_STATE_PAUSED)){
+        return false;
+    }
+    PVM pVM = VMR3GetVM(myVBOXHandle->pUVM);
+    int rc = PGMR3PhysResetDirtyLog(pVM);
+    if(RT_SUCCESS(rc)){
+        return true;
+    }
+    return false;
+}
+
 bool FDPVBOX_readMsr(void *pUserHandle, uint32_t CpuId, uint64_t MsrId, uint64_t *pMsrValue)
 {
     FDPVBOX_USERHANDLE_T* myVBOXHandle = (FDPVBOX_USERHANDLE_T*)pUserHandle;
@@ -549,26 +603,24 @@ bool FDPVBOX_writeRegister(void *pUserHandle, uint32_t CpuId, FDP_Register Regis
     PCCPUMCTXCORE pCtxCore = CPUMGetGuestCtxCore(pVCpu);
     PCPUMCTXCORE pRegFrame = (PCPUMCTXCORE)CPUMGetGuestCtxCore(pVCpu);
 
-    FDP_CPU_CTX* pFdpCpuCtx = (FDP_CPU_CTX *)pVCpu->mystate.s.pCpuShm;
-
     switch(RegisterId){
-        case FDP_RAX_REGISTER: pRegFrame->rax = RegisterValue; pFdpCpuCtx->rax = RegisterValue; break;
-        case FDP_RBX_REGISTER: pRegFrame->rbx = RegisterValue; pFdpCpuCtx->rbx = RegisterValue; break;
-        case FDP_RCX_REGISTER: pRegFrame->rcx = RegisterValue; pFdpCpuCtx->rcx = RegisterValue; break;
-        case FDP_RDX_REGISTER: pRegFrame->rdx = RegisterValue; pFdpCpuCtx->rdx = RegisterValue; break;
-        case FDP_R8_REGISTER:  pRegFrame->r8 = RegisterValue; pFdpCpuCtx->r8 = RegisterValue; break;
-        case FDP_R9_REGISTER:  pRegFrame->r9 = RegisterValue; pFdpCpuCtx->r9 = RegisterValue; break;
-        case FDP_R10_REGISTER: pRegFrame->r10 = RegisterValue; pFdpCpuCtx->r10 = RegisterValue; break;
-        case FDP_R11_REGISTER: pRegFrame->r11 = RegisterValue; pFdpCpuCtx->r11 = RegisterValue; break;
-        case FDP_R12_REGISTER: pRegFrame->r12 = RegisterValue; pFdpCpuCtx->r12 = RegisterValue; break;
-        case FDP_R13_REGISTER: pRegFrame->r13 = RegisterValue; pFdpCpuCtx->r13 = RegisterValue; break;
-        case FDP_R14_REGISTER: pRegFrame->r14 = RegisterValue; pFdpCpuCtx->r14 = RegisterValue; break;
-        case FDP_R15_REGISTER: pRegFrame->r15 = RegisterValue; pFdpCpuCtx->r15 = RegisterValue; break;
-        case FDP_RSP_REGISTER: pRegFrame->rsp = RegisterValue; pFdpCpuCtx->rsp = RegisterValue; break;
-        case FDP_RBP_REGISTER: pRegFrame->rbp = RegisterValue; pFdpCpuCtx->rbp = RegisterValue; break;
-        case FDP_RSI_REGISTER: pRegFrame->rsi = RegisterValue; pFdpCpuCtx->rsi = RegisterValue; break;
-        case FDP_RDI_REGISTER: pRegFrame->rdi = RegisterValue; pFdpCpuCtx->rdi = RegisterValue; break;
-        case FDP_RIP_REGISTER: pRegFrame->rip = RegisterValue; pFdpCpuCtx->rip = RegisterValue; break;
+        case FDP_RAX_REGISTER: pRegFrame->rax = RegisterValue; break;
+        case FDP_RBX_REGISTER: pRegFrame->rbx = RegisterValue; break;
+        case FDP_RCX_REGISTER: pRegFrame->rcx = RegisterValue; break;
+        case FDP_RDX_REGISTER: pRegFrame->rdx = RegisterValue; break;
+        case FDP_R8_REGISTER:  pRegFrame->r8 = RegisterValue; break;
+        case FDP_R9_REGISTER:  pRegFrame->r9 = RegisterValue; break;
+        case FDP_R10_REGISTER: pRegFrame->r10 = RegisterValue; break;
+        case FDP_R11_REGISTER: pRegFrame->r11 = RegisterValue; break;
+        case FDP_R12_REGISTER: pRegFrame->r12 = RegisterValue; break;
+        case FDP_R13_REGISTER: pRegFrame->r13 = RegisterValue; break;
+        case FDP_R14_REGISTER: pRegFrame->r14 = RegisterValue; break;
+        case FDP_R15_REGISTER: pRegFrame->r15 = RegisterValue; break;
+        case FDP_RSP_REGISTER: pRegFrame->rsp = RegisterValue; break;
+        case FDP_RBP_REGISTER: pRegFrame->rbp = RegisterValue; break;
+        case FDP_RSI_REGISTER: pRegFrame->rsi = RegisterValue; break;
+        case FDP_RDI_REGISTER: pRegFrame->rdi = RegisterValue; break;
+        case FDP_RIP_REGISTER: pRegFrame->rip = RegisterValue; break;
 
         //Invisible for Guest Debug Register
         case FDP_DR0_REGISTER: CPUMSetGuestDR0(pVCpu, RegisterValue); break;
@@ -592,20 +644,20 @@ bool FDPVBOX_writeRegister(void *pUserHandle, uint32_t CpuId, FDP_Register Regis
         case FDP_FS_REGISTER: CPUMSetGuestFS(pVCpu, RegisterValue); break;
         case FDP_GS_REGISTER: CPUMSetGuestGS(pVCpu, RegisterValue); break;
         case FDP_SS_REGISTER: CPUMSetGuestSS(pVCpu, RegisterValue); break;
-        case FDP_CR0_REGISTER: CPUMSetGuestCR0(pVCpu, RegisterValue); pFdpCpuCtx->cr0 = RegisterValue; break;
-        case FDP_CR2_REGISTER: CPUMSetGuestCR2(pVCpu, RegisterValue); pFdpCpuCtx->cr3 = RegisterValue; break;
+        case FDP_CR0_REGISTER: CPUMSetGuestCR0(pVCpu, RegisterValue); break;
+        case FDP_CR2_REGISTER: CPUMSetGuestCR2(pVCpu, RegisterValue); break;
         case FDP_CR3_REGISTER:
         {
             CPUMSetGuestCR3(pVCpu, RegisterValue);
             PGMFlushTLB(pVCpu, RegisterValue, 0);
-            pFdpCpuCtx->cr3 = RegisterValue;
             break;
         }
-        case FDP_CR4_REGISTER: CPUMSetGuestCR4(pVCpu, RegisterValue); pFdpCpuCtx->cr4 = RegisterValue; break;
+        case FDP_CR4_REGISTER: CPUMSetGuestCR4(pVCpu, RegisterValue); break;
         //case FDP_CR8_REGISTER: CPUMSetGuestCR8(pVCpu, RegisterValue); break;
         case FDP_RFLAGS_REGISTER: CPUMSetGuestEFlags(pVCpu, RegisterValue); break;
         default: break;
     }
+    VMR3UpdateFdpCpuCtx(pVCpu);
     return true;
 }
 
@@ -634,6 +686,20 @@ bool FDPVBOX_unsetBreakpoint(void *pUserHandle, int BreakpointId)
     return false;
 }
 
+bool FDPVBOX_unsetAllBreakpoints(void *pUserHandle)
+{
+    Log1(("[DBGC] UNSET_ALL_BP\n"));
+    FDPVBOX_USERHANDLE_T* myVBOXHandle = (FDPVBOX_USERHANDLE_T*)pUserHandle;
+    return VMR3RemoveAllBreakpoints(myVBOXHandle->pUVM);
+}
+
+bool FDPVBOX_setBreakpointMatch(void *pUserHandle, int BreakpointId, const FDP_BREAKPOINT_MATCH_T *pMatch)
+{
+    Log1(("[DBGC] SET_BP_MATCH[%d] %d %p %p\n", BreakpointId, pMatch->MatchType, pMatch->MatchAddress, pMatch->MatchValue));
+    FDPVBOX_USERHANDLE_T* myVBOXHandle = (FDPVBOX_USERHANDLE_T*)pUserHandle;
+    return VMR3SetBreakpointMatch(myVBOXHandle->pUVM, BreakpointId, (uint8_t)pMatch->MatchType, pMatch->MatchAddress, pMatch->MatchValue);
+}
+
 bool FDPVBOX_getFxState64(void *pUserHandle, uint32_t CpuId, uint8_t *pDstBuffer, uint32_t *pDstSize)
 {
     Log1(("[DBGC] GET_FXSTATE\n"));
@@ -681,6 +747,97 @@ bool FDPVBOX_readVirtualMemory(void *pUserHandle, uint32_t CpuId, uint64_t Virtu
     return false;
 }
 
+static bool FDPVBOX_walkDtb(PUVM pUVM, PVMCPU pVCpu, uint64_t Dtb, uint64_t VirtualAddress, uint64_t *pPhysicalAddress)
+{
+    //Only 4-level long mode paging is supported
+    if(!CPUMIsGuestInLongMode(pVCpu)){
+        return false;
+    }
+    static const unsigned aShift[] = {X86_PML4_SHIFT, X86_PDPT_SHIFT, X86_PD_PAE_SHIFT, X86_PT_PAE_SHIFT};
+    uint64_t Entry = Dtb;
+    for(unsigned Level = 0; Level < RT_ELEMENTS(aShift); Level++){
+        const uint64_t EntryAddress = (Entry & X86_PTE_PAE_PG_MASK) + ((VirtualAddress >> aShift[Level]) & 0x1FF) * sizeof Entry;
+        int rc = VMR3PhysSimpleReadGCPhysU(pUVM, &Entry, EntryAddress, sizeof Entry);
+        if(RT_FAILURE(rc) || !(Entry & X86_PTE_P)){
+            return false;
+        }
+        //1G & 2M pages
+        if((Level == 1 || Level == 2) && (Entry & X86_PDE_PS)){
+            const uint64_t PageMask = (RT_BIT_64(aShift[Level]) - 1);
+            *pPhysicalAddress = (Entry & X86_PTE_PAE_PG_MASK & ~PageMask) + (VirtualAddress & PageMask);
+            return true;
+        }
+    }
+    *pPhysicalAddress = (Entry & X86_PTE_PAE_PG_MASK) + (VirtualAddress & PAGE_OFFSET_MASK);
+    return true;
+}
+
+bool FDPVBOX_readVirtualMemoryDtb(void *pUserHandle, uint32_t CpuId, uint64_t Dtb, uint64_t VirtualAddress, uint32_t ReadSize, uint8_t *pDstBuffer)
+{
+    FDPVBOX_USERHANDLE_T* myVBOXHandle = (FDPVBOX_USERHANDLE_T*)pUserHandle;
+    if(CpuId >= VMR3GetCPUCount(myVBOXHandle->pUVM)){
+        return false;
+    }
+    PVMCPU pVCpu = VMMR3GetCpuByIdU(myVBOXHandle->pUVM, CpuId);
+    if(Dtb == CPUMGetGuestCR3(pVCpu)){
+        return FDPVBOX_readVirtualMemory(pUserHandle, CpuId, VirtualAddress, ReadSize, pDstBuffer);
+    }
+
+    //Walk page tables ourself, we don't want to touch guest cr3
+    uint32_t Offset = 0;
+    while(Offset < ReadSize){
+        uint64_t PhysicalAddress;
+        if(FDPVBOX_walkDtb(myVBOXHandle->pUVM, pVCpu, Dtb, VirtualAddress + Offset, &PhysicalAddress) == false){
+            return false;
+        }
+        const uint32_t ChunkSize = MIN(ReadSize - Offset, PAGE_SIZE - ((VirtualAddress + Offset) & PAGE_OFFSET_MASK));
+        if(FDPVBOX_readPhysicalMemory(pUserHandle, pDstBuffer + Offset, PhysicalAddress, ChunkSize) == false){
+            return false;
+        }
+        Offset += ChunkSize;
+    }
+    return true;
+}
+
+bool FDPVBOX_writeVirtualMemoryDtb(void *pUserHandle, uint32_t CpuId, uint64_t Dtb, uint8_t *pSrcBuffer, uint64_t VirtualAddress, uint32_t WriteSize)
+{
+    FDPVBOX_USERHANDLE_T* myVBOXHandle = (FDPVBOX_USERHANDLE_T*)pUserHandle;
+    if(CpuId >= VMR3GetCPUCount(myVBOXHandle->pUVM)){
+        return false;
+    }
+    PVMCPU pVCpu = VMMR3GetCpuByIdU(myVBOXHandle->pUVM, CpuId);
+    if(Dtb == CPUMGetGuestCR3(pVCpu)){
+        return FDPVBOX_writeVirtualMemory(pUserHandle, CpuId, pSrcBuffer, VirtualAddress, WriteSize);
+    }
+
+    uint32_t Offset = 0;
+    while(Offset < WriteSize){
+        uint64_t PhysicalAddress;
+        if(FDPVBOX_walkDtb(myVBOXHandle->pUVM, pVCpu, Dtb, VirtualAddress + Offset, &PhysicalAddress) == false){
+            return false;
+        }
+        const uint32_t ChunkSize = MIN(WriteSize - Offset, PAGE_SIZE - ((VirtualAddress + Offset) & PAGE_OFFSET_MASK));
+        if(FDPVBOX_writePhysicalMemory(pUserHandle, pSrcBuffer + Offset, PhysicalAddress, ChunkSize) == false){
+            return false;
+        }
+        Offset += ChunkSize;
+    }
+    return true;
+}
+
+bool FDPVBOX_virtualToPhysicalDtb(void *pUserHandle, uint32_t CpuId, uint64_t Dtb, uint64_t VirtualAddress, uint64_t *PhysicalAddress)
+{
+    FDPVBOX_USERHANDLE_T* myVBOXHandle = (FDPVBOX_USERHANDLE_T*)pUserHandle;
+    if(CpuId >= VMR3GetCPUCount(myVBOXHandle->pUVM)){
+        return false;
+    }
+    PVMCPU pVCpu = VMMR3GetCpuByIdU(myVBOXHandle->pUVM, CpuId);
+    if(Dtb == CPUMGetGuestCR3(pVCpu)){
+        return FDPVBOX_virtualToPhysical(pUserHandle, CpuId, VirtualAddress, PhysicalAddress);
+    }
+    return FDPVBOX_walkDtb(myVBOXHandle->pUVM, pVCpu, Dtb, VirtualAddress, PhysicalAddress);
+}
+
 int FDPVBOX_setBreakpoint(
     void *pUserHandle,
     uint32_t CpuId,
@@ -1045,10 +1202,10 @@ void *CreateCPUSHM(PUVM pUVM)
     }
 
     /* configure the size of the shared memory segment */
-    ftruncate(fdSHM,sizeof(FDP_CPU_CTX));
+    ftruncate(fdSHM,FDP_CPU_SHM_SIZE);
 
     /* now map the shared memory segment in the address space of the process */
-    pBuf = mmap(0,sizeof(FDP_CPU_CTX), PROT_READ | PROT_WRITE, MAP_SHARED, fdSHM, 0);
+    pBuf = mmap(0,FDP_CPU_SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fdSHM, 0);
     if (pBuf == NULL){
         shm_unlink(aCpuShmName);
         return NULL;
@@ -1059,7 +1216,7 @@ void *CreateCPUSHM(PUVM pUVM)
         NULL,
         PAGE_READWRITE,
         0,
-        sizeof(FDP_CPU_CTX),
+        FDP_CPU_SHM_SIZE,
         aCpuShmName);
 
     if (hMapFile == NULL){
@@ -1070,7 +1227,7 @@ void *CreateCPUSHM(PUVM pUVM)
         FILE_MAP_ALL_ACCESS,
         0,
         0,
-        sizeof(FDP_CPU_CTX));
+        FDP_CPU_SHM_SIZE);
 
     if (pBuf == NULL){
         CloseHandle(hMapFile);
@@ -1079,9 +1236,7 @@ void *CreateCPUSHM(PUVM pUVM)
 #endif
 
     //Clear SHM
-    memset((void*)pBuf, 0, sizeof(FDP_CPU_CTX));
-
-    printf("0x%p\n", sizeof(FDP_CPU_CTX));
+    memset((void*)pBuf, 0, FDP_CPU_SHM_SIZE);
 
     return pBuf;
 }
@@ -1097,18 +1252,33 @@ DWORD WINAPI FDPServerThread(LPVOID lpParam)
     MemorySSM.pMemory = NULL;
     MemorySSM.CurrentOffset = 0;
 
-    FDP_SHM* pFDPServer = FDP_CreateSHM((char*)VMR3GetName(pUVM));
+    //Canal size bounds the largest read in one round trip, smaller saves memory on hosts with many VMs
+    uint32_t CanalSize = FDP_DEFAULT_CANAL_SIZE;
+    const char *pszCanalSize = RTEnvGet("FDP_CANAL_SIZE");
+    if(pszCanalSize != NULL){
+        int rc = RTStrToUInt32Full(pszCanalSize, 0, &CanalSize);
+        if(rc != VINF_SUCCESS || CanalSize == 0){
+            CanalSize = FDP_DEFAULT_CANAL_SIZE;
+            printf("FDP_CANAL_SIZE \"%s\" is invalid, using %u bytes\n", pszCanalSize, CanalSize);
+        }
+    }
+    uint32_t Flags = RTEnvExist("FDP_HUGEPAGES") ? FDP_SHM_FLAG_HUGEPAGES : 0;
+    FDP_SHM* pFDPServer = FDP_CreateSHMSized((char*)VMR3GetName(pUVM), Flags, CanalSize);
     if(pFDPServer == NULL){
         printf("FDP SHM creation failed !\n");
         return 0;
     }
 
-    PVMCPU pVCpu = VMMR3GetCpuByIdU(pUVM, 0);
-    //PCPUMCTX pCtx = CPUMQueryGuestCtxPtr(pVCpu);
-    void* pCpuShm = CreateCPUSHM(pUVM);
-    pVCpu->mystate.s.pCpuShm = pCpuShm;
+    //One FDP_CPU_CTX per vCPU, indexed by idCpu
+    FDP_CPU_CTX* pCpuShm = (FDP_CPU_CTX*)CreateCPUSHM(pUVM);
     if(pCpuShm == NULL){
         printf("Failed to CreateCpuShm\n");
+    }else{
+        uint32_t CpuCount = RT_MIN(VMR3GetCPUCount(pUVM), FDP_MAX_CPU);
+        for(uint32_t CpuId = 0; CpuId < CpuCount; CpuId++){
+            PVMCPU pVCpu = VMMR3GetCpuByIdU(pUVM, CpuId);
+            pVCpu->mystate.s.pCpuShm = &pCpuShm[CpuId];
+        }
     }
 
     printf("FDP_CreateSHM OK\n");
@@ -1119,6 +1289,7 @@ DWORD WINAPI FDPServerThread(LPVOID lpParam)
 
     //Configure FDP Server Interface
     FDP_SERVER_INTERFACE_T FDPServerInterface;
+    memset(&FDPServerInterface, 0, sizeof(FDPServerInterface));
     FDPServerInterface.pUserHandle = pUserHandle;
 
     FDPServerInterface.pfnGetState = &FDPVBOX_getState;
@@ -1146,6 +1317,14 @@ DWORD WINAPI FDPServerThread(LPVOID lpParam)
     FDPServerInterface.pfnRestore = &FDPVBOX_Restore;
     FDPServerInterface.pfnReboot = &FDPVBOX_Reboot;
     FDPServerInterface.pfnInjectInterrupt = &FDPVBOX_InjectInterrupt;
+    FDPServerInterface.pfnReadVirtualMemoryDtb = &FDPVBOX_readVirtualMemoryDtb;
+    FDPServerInterface.pfnWriteVirtualMemoryDtb = &FDPVBOX_writeVirtualMemoryDtb;
+    FDPServerInterface.pfnVirtualToPhysicalDtb = &FDPVBOX_virtualToPhysicalDtb;
+    FDPServerInterface.pfnGetPhysicalRanges = &FDPVBOX_getPhysicalRanges;
+    FDPServerInterface.pfnUnsetAllBreakpoints = &FDPVBOX_unsetAllBreakpoints;
+    FDPServerInterface.pfnSetBreakpointMatch = &FDPVBOX_setBreakpointMatch;
+    FDPServerInterface.pfnGetDirtyPages = &FDPVBOX_getDirtyPages;
+    FDPServerInterface.pfnResetDirtyLog = &FDPVBOX_resetDirtyLog;
 
     if (FDP_SetFDPServer(pFDPServer, &FDPServerInterface) == false){
         printf("Failed to FDP_SerFDPServer\n");
@@ -1154,6 +1333,13 @@ DWORD WINAPI FDPServerThread(LPVOID lpParam)
 
     printf("FDP_SetFDPServer OK\n");
 
+    //Export guest memory, doubles the memory used by the VM
+    if(RTEnvExist("FDP_RAM_SHM")){
+        if(FDP_CreatePhysicalMemorySHM(pFDPServer, VMR3GetName(pUVM)) == false){
+            printf("Failed to FDP_CreatePhysicalMemorySHM\n");
+        }
+    }
+
     VMR3SetFDPShm(pUVM, pFDPServer);
 
     printf("VMR3SetFDPShm OK\n");
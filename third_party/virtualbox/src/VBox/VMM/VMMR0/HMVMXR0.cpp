@@ -13650,6 +13650,34 @@ static int hmR0VmxExitXcptMF(PVMCPU pVCpu, PCPUMCTX pMixedCtx, PVMXTRANSIENT pVm
 }
 
 
+/*MYCODE*/
+/**
+ * Evaluates the hit predicate of a breakpoint, an unreadable address matches
+ * and lets the debugger decide.
+ */
+static bool hmR0VmxIsBreakpointMatching(PVMCPU pVCpu, PCPUMCTX pMixedCtx, BreakpointEntrie_t *pBreakpointEntrie)
+{
+    uint64_t GCPtr;
+    switch(pBreakpointEntrie->breakpointMatchType){
+        case FDP_MATCH_VIRTUAL:
+            GCPtr = pBreakpointEntrie->breakpointMatchAddress;
+            break;
+        case FDP_MATCH_GS_RELATIVE:
+            GCPtr = pMixedCtx->gs.u64Base + pBreakpointEntrie->breakpointMatchAddress;
+            break;
+        default:
+            return true;
+    }
+
+    uint64_t Value;
+    if(RT_FAILURE(PGMPhysSimpleReadGCPtr(pVCpu, &Value, GCPtr, sizeof(Value)))){
+        return true;
+    }
+    return Value == pBreakpointEntrie->breakpointMatchValue;
+}
+/*ENDMYCODE*/
+
+
 /**
  * VM-exit exception handler for \#BP (Breakpoint exception).
  */
@@ -13673,8 +13701,9 @@ static int hmR0VmxExitXcptBP(PVMCPU pVCpu, PCPUMCTX pMixedCtx, PVMXTRANSIENT pVm
         PGMPhysGCPtr2GCPhys(pVCpu, pMixedCtx->rip, &GCPhys);
         int SoftBreakpointId = VMMGetBreakpointId(pVM, GCPhys, FDP_SOFTHBP, FDP_EXECUTE_BP);
         if(SoftBreakpointId >= 0){
-            if(pVM->bp.l[SoftBreakpointId].breakpointCr3 == 0
-            || pVM->bp.l[SoftBreakpointId].breakpointCr3 == CPUMGetGuestCR3(pVCpu)){
+            if((pVM->bp.l[SoftBreakpointId].breakpointCr3 == 0
+            || pVM->bp.l[SoftBreakpointId].breakpointCr3 == CPUMGetGuestCR3(pVCpu))
+            && hmR0VmxIsBreakpointMatching(pVCpu, pMixedCtx, &pVM->bp.l[SoftBreakpointId])){
                 pVCpu->mystate.s.bSoftHyperBreakPointHitted = true;
                 return VINF_EM_HALT;
             }else{
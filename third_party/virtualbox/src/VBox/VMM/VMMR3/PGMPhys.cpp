@@ -1296,6 +1296,93 @@ VMMR3DECL(int) PGMR3PhysEnumDirtyFTPages(PVM pVM, PFNPGMENUMDIRTYFTPAGES pfnEnum
     return rc;
 }
 
+/*MYCODE*/
+/**
+ * Starts a new FDP dirty log: write monitors all RAM pages so the next guest
+ * write to each of them is recorded.
+ *
+ * The FTM dirty bits are reused, FDP and FTM can't run together.
+ *
+ * @returns VBox status code.
+ * @param   pVM         The cross context VM structure.
+ * @thread  Any, all EMTs must be paused by FDP.
+ */
+VMMR3DECL(int) PGMR3PhysResetDirtyLog(PVM pVM)
+{
+    pgmLock(pVM);
+#ifdef PGMPOOL_WITH_OPTIMIZED_DIRTY_PT
+    pgmPoolResetDirtyPages(pVM);
+#endif
+    for (PPGMRAMRANGE pRam = pVM->pgm.s.CTX_SUFF(pRamRangesX);
+         pRam;
+         pRam = pRam->CTX_SUFF(pNext))
+    {
+        uint32_t cPages = pRam->cb >> PAGE_SHIFT;
+        for (uint32_t iPage = 0; iPage < cPages; iPage++)
+        {
+            PPGMPAGE    pPage       = &pRam->aPages[iPage];
+            PGMPAGETYPE enmPageType = (PGMPAGETYPE)PGM_PAGE_GET_TYPE(pPage);
+            if (    enmPageType != PGMPAGETYPE_RAM
+                &&  enmPageType != PGMPAGETYPE_MMIO2)
+                continue;
+
+            PGM_PAGE_CLEAR_FT_DIRTY(pPage);
+            if (PGM_PAGE_GET_STATE(pPage) == PGM_PAGE_STATE_ALLOCATED)
+            {
+                PGM_PAGE_CLEAR_WRITTEN_TO(pVM, pPage);
+                pgmPhysPageWriteMonitor(pVM, pPage, pRam->GCPhys + ((RTGCPHYS)iPage << PAGE_SHIFT));
+            }
+        }
+    }
+    pgmR3PoolWriteProtectPages(pVM);
+    PGM_INVL_ALL_VCPU_TLBS(pVM);
+    for (VMCPUID idCpu = 0; idCpu < pVM->cCpus; idCpu++)
+        CPUMSetChangedFlags(&pVM->aCpus[idCpu], CPUM_CHANGED_GLOBAL_TLB_FLUSH);
+    pgmUnlock(pVM);
+    return VINF_SUCCESS;
+}
+
+/**
+ * Gets the RAM pages written since the last PGMR3PhysResetDirtyLog.
+ *
+ * Every allocated page is dirty until the first reset.
+ *
+ * @returns VBox status code.
+ * @param   pVM         The cross context VM structure.
+ * @param   iFirstPage  The first guest page number to report.
+ * @param   paPages     Where to store the sorted dirty page numbers.
+ * @param   pcPages     In: size of paPages, out: number of dirty pages stored.
+ */
+VMMR3DECL(int) PGMR3PhysGetDirtyPages(PVM pVM, uint64_t iFirstPage, uint64_t *paPages, uint32_t *pcPages)
+{
+    uint32_t cDirty = 0;
+    pgmLock(pVM);
+    for (PPGMRAMRANGE pRam = pVM->pgm.s.CTX_SUFF(pRamRangesX);
+         pRam && cDirty < *pcPages;
+         pRam = pRam->CTX_SUFF(pNext))
+    {
+        uint64_t iRamPage = pRam->GCPhys >> PAGE_SHIFT;
+        uint32_t cPages   = pRam->cb >> PAGE_SHIFT;
+        uint32_t iPage    = iFirstPage > iRamPage ? (uint32_t)RT_MIN(iFirstPage - iRamPage, cPages) : 0;
+        for (; iPage < cPages && cDirty < *pcPages; iPage++)
+        {
+            PPGMPAGE    pPage       = &pRam->aPages[iPage];
+            PGMPAGETYPE enmPageType = (PGMPAGETYPE)PGM_PAGE_GET_TYPE(pPage);
+            if (    enmPageType != PGMPAGETYPE_RAM
+                &&  enmPageType != PGMPAGETYPE_MMIO2)
+                continue;
+
+            if (    PGM_PAGE_GET_STATE(pPage) == PGM_PAGE_STATE_ALLOCATED
+                ||  PGM_PAGE_IS_FT_DIRTY(pPage))
+                paPages[cDirty++] = iRamPage + iPage;
+        }
+    }
+    pgmUnlock(pVM);
+    *pcPages = cDirty;
+    return VINF_SUCCESS;
+}
+/*ENDMYCODE*/
+
 
 /**
  * Gets the number of ram ranges.
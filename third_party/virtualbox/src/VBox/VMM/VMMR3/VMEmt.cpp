@@ -1110,11 +1110,18 @@ VMMR3_INT_DECL(void) VMR3NotifyCpuFFU(PUVMCPU pUVCpu, uint32_t fFlags)
 #endif
 
 
-//TODO: Add Cs, Ds, Es, Fs, Gs, SS, ...
-void VMR3UpdateFdpCpuCtx(PVMCPU pVCpu)
+VMMDECL(void) VMR3UpdateFdpCpuCtx(PVMCPU pVCpu)
 {
-    PCCPUMCTXCORE pCtxCore = CPUMGetGuestCtxCore(pVCpu);
     FDP_CPU_CTX* pFdpCpuCtx = (FDP_CPU_CTX *)pVCpu->mystate.s.pCpuShm;
+    if(pFdpCpuCtx == NULL){
+        return;
+    }
+
+    PCCPUMCTXCORE pCtxCore = CPUMGetGuestCtxCore(pVCpu);
+    PCPUMCTX pCtx = CPUMQueryGuestCtxPtr(pVCpu);
+
+    //Seqlock, clients retry while generation is odd or has changed
+    ASMAtomicIncU32((volatile uint32_t*)&pFdpCpuCtx->generation);
 
     pFdpCpuCtx->rip = pCtxCore->rip;
     pFdpCpuCtx->rax = pCtxCore->rax;
@@ -1133,11 +1140,55 @@ void VMR3UpdateFdpCpuCtx(PVMCPU pVCpu)
     pFdpCpuCtx->r13 = pCtxCore->r13;
     pFdpCpuCtx->r14 = pCtxCore->r14;
     pFdpCpuCtx->r15 = pCtxCore->r15;
+
+    pFdpCpuCtx->es = CPUMGetGuestES(pVCpu);
+    pFdpCpuCtx->cs = CPUMGetGuestCS(pVCpu);
+    pFdpCpuCtx->ss = CPUMGetGuestSS(pVCpu);
+    pFdpCpuCtx->ds = CPUMGetGuestDS(pVCpu);
+    pFdpCpuCtx->fs = CPUMGetGuestFS(pVCpu);
+    pFdpCpuCtx->gs = CPUMGetGuestGS(pVCpu);
+    pFdpCpuCtx->rflags = CPUMGetGuestEFlags(pVCpu);
+
     pFdpCpuCtx->cr0 = CPUMGetGuestCR0(pVCpu);
     pFdpCpuCtx->cr2 = CPUMGetGuestCR2(pVCpu);
     pFdpCpuCtx->cr3 = CPUMGetGuestCR3(pVCpu);
     pFdpCpuCtx->cr4 = CPUMGetGuestCR4(pVCpu);
-
+    pFdpCpuCtx->cr8 = CPUMGetGuestCR8(pVCpu);
+
+    pFdpCpuCtx->dr0 = CPUMGetGuestDR0(pVCpu);
+    pFdpCpuCtx->dr1 = CPUMGetGuestDR1(pVCpu);
+    pFdpCpuCtx->dr2 = CPUMGetGuestDR2(pVCpu);
+    pFdpCpuCtx->dr3 = CPUMGetGuestDR3(pVCpu);
+    pFdpCpuCtx->dr6 = CPUMGetGuestDR6(pVCpu);
+    pFdpCpuCtx->dr7 = CPUMGetGuestDR7(pVCpu);
+
+    VBOXGDTR gdtr = {0, 0};
+    CPUMGetGuestGDTR(pVCpu, &gdtr);
+    pFdpCpuCtx->gdtr_base = gdtr.pGdt;
+    pFdpCpuCtx->gdtr_limit = gdtr.cbGdt;
+    uint16_t cbIdt = 0;
+    pFdpCpuCtx->idtr_base = CPUMGetGuestIDTR(pVCpu, &cbIdt);
+    pFdpCpuCtx->idtr_limit = cbIdt;
+    uint64_t LdtrBase = 0;
+    uint32_t LdtrLimit = 0;
+    pFdpCpuCtx->ldtr = CPUMGetGuestLdtrEx(pVCpu, &LdtrBase, &LdtrLimit);
+    pFdpCpuCtx->ldtr_base = LdtrBase;
+    pFdpCpuCtx->ldtr_limit = LdtrLimit;
+    pFdpCpuCtx->tr = CPUMGetGuestTR(pVCpu, NULL);
+
+    pFdpCpuCtx->efer = pCtx->msrEFER;
+    pFdpCpuCtx->star = pCtx->msrSTAR;
+    pFdpCpuCtx->lstar = pCtx->msrLSTAR;
+    pFdpCpuCtx->cstar = pCtx->msrCSTAR;
+    pFdpCpuCtx->sfmask = pCtx->msrSFMASK;
+    pFdpCpuCtx->fs_base = pCtx->fs.u64Base;
+    pFdpCpuCtx->gs_base = pCtx->gs.u64Base;
+    pFdpCpuCtx->kernel_gs_base = pCtx->msrKERNELGSBASE;
+    pFdpCpuCtx->sysenter_cs = pCtx->SysEnter.cs;
+    pFdpCpuCtx->sysenter_esp = pCtx->SysEnter.esp;
+    pFdpCpuCtx->sysenter_eip = pCtx->SysEnter.eip;
+
+    ASMAtomicIncU32((volatile uint32_t*)&pFdpCpuCtx->generation);
 }
 
 HardwarePage_t* VMR3GetAllocatedHardwarePage(PUVM pUVM, uint64_t GCPhys)
@@ -1343,6 +1394,7 @@ VMMR3_INT_DECL(int)    VMR3AddSoftBreakpoint(PUVM pUVM, PVMCPU pVCpu, uint8_t Br
                 pTempBreakpointEntrie->breakpointType = FDP_SOFTHBP;
                 pTempBreakpointEntrie->breakpointLength = 1;
                 pTempBreakpointEntrie->breakpointCr3 = BreakpointCr3;
+                pTempBreakpointEntrie->breakpointMatchType = FDP_NO_MATCH;
                 pTempBreakpointEntrie->breakpointAccessType = FDP_EXECUTE_BP;
                 pTempBreakpointEntrie->breakpointPageSize = pTempHardwarePage->PageSize;
                 pTempBreakpointEntrie->breakpointHardwarePage = pTempHardwarePage;
@@ -1679,6 +1731,9 @@ VMMR3_INT_DECL(bool) VMR3RemoveBreakpoint(PUVM pUVM, int BreakpointId)
         pTempBreakpointEntrie->breakpointOriginalByte = 0x0;
         pTempBreakpointEntrie->breakpointHardwarePage = NULL;
         pTempBreakpointEntrie->breakpointPageSize = 0x0;
+        pTempBreakpointEntrie->breakpointMatchType = 0x0;
+        pTempBreakpointEntrie->breakpointMatchAddress = 0x0;
+        pTempBreakpointEntrie->breakpointMatchValue = 0x0;
 
         if(pTempBreakpointEntrie->breakpointGCPhysAreaTable){
             free(pTempBreakpointEntrie->breakpointGCPhysAreaTable);
@@ -1691,6 +1746,58 @@ VMMR3_INT_DECL(bool) VMR3RemoveBreakpoint(PUVM pUVM, int BreakpointId)
     return false;
 }
 
+//Remove only activated breakpoints, unused ids are skipped
+VMMR3_INT_DECL(bool) VMR3RemoveAllBreakpoints(PUVM pUVM)
+{
+    //If one Cpu is running, we can't remove a breakpoint !
+    if(IsOneCPURunning(pUVM) == true){
+        return false;
+    }
+
+    PVM pVM = pUVM->pVM;
+    bool bSuccess = true;
+    for(int BreakpointId=0; BreakpointId<MAX_BREAKPOINT_ID; BreakpointId++){
+        if(pVM->bp.l[BreakpointId].breakpointActivated == true){
+            bSuccess &= VMR3RemoveBreakpoint(pUVM, BreakpointId);
+        }
+    }
+    return bSuccess;
+}
+
+//Only SoftHyperBreakpoints are filtered before leaving the hypervisor
+VMMR3_INT_DECL(bool) VMR3SetBreakpointMatch(PUVM pUVM, int BreakpointId, uint8_t MatchType, uint64_t MatchAddress, uint64_t MatchValue)
+{
+    if(BreakpointId < 0 || BreakpointId > MAX_BREAKPOINT_ID){
+        return false;
+    }
+
+    //If one Cpu is running, we can't change a breakpoint !
+    if(IsOneCPURunning(pUVM) == true){
+        return false;
+    }
+
+    PVM pVM = pUVM->pVM;
+    BreakpointEntrie_t *pTempBreakpointEntrie = &pVM->bp.l[BreakpointId];
+    if(pTempBreakpointEntrie->breakpointActivated == false
+    || pTempBreakpointEntrie->breakpointType != FDP_SOFTHBP){
+        return false;
+    }
+
+    switch(MatchType){
+        case FDP_NO_MATCH:
+        case FDP_MATCH_VIRTUAL:
+        case FDP_MATCH_GS_RELATIVE:
+            break;
+        default:
+            return false;
+    }
+
+    pTempBreakpointEntrie->breakpointMatchAddress = MatchAddress;
+    pTempBreakpointEntrie->breakpointMatchValue = MatchValue;
+    pTempBreakpointEntrie->breakpointMatchType = MatchType;
+    return true;
+}
+
 VMMDECL(int) VMR3PhysSimpleReadGCPhysU(PUVM pUVM, void *pvDst, RTGCPHYS GCPhysSrc, size_t cb)
 {
     return PGMPhysSimpleReadGCPhys(pUVM->pVM, pvDst, GCPhysSrc, cb);
@@ -1931,39 +2038,37 @@ VMMDECL(void) VMR3SetFDPShm(PUVM pUVM, void *pFdpShm)
 
 VMMDECL(bool) VMR3EnterPause(PVM pVM, PVMCPU pVCpu)
 {
-    if(pVCpu->idCpu == 0){
-        //Update FDP_CPU_CTX
-        VMR3UpdateFdpCpuCtx(pVCpu);
-        TMR3NotifySuspend(pVM, pVCpu);
-
-        //Active wait
-        uint32_t u32WaitCount = 0;
-        while(pVCpu->mystate.s.bPauseRequired == true){
-            if(VMR3HandleSingleStep(pVM, pVCpu) == true){
-                //Update FDP_CPU_CTX
-                VMR3UpdateFdpCpuCtx(pVCpu);
-                u32WaitCount = 0;
-            }
-            //Powersaving :)
-            if((u32WaitCount & 0xFFFFFF) == 0xFFFFFF){
-                RTThreadSleep(5);
-            }else{
-                u32WaitCount++;
-            }
+    //Update FDP_CPU_CTX
+    VMR3UpdateFdpCpuCtx(pVCpu);
+    TMR3NotifySuspend(pVM, pVCpu);
+
+    //Active wait
+    uint32_t u32WaitCount = 0;
+    while(pVCpu->mystate.s.bPauseRequired == true){
+        if(VMR3HandleSingleStep(pVM, pVCpu) == true){
+            //Update FDP_CPU_CTX
+            VMR3UpdateFdpCpuCtx(pVCpu);
+            u32WaitCount = 0;
         }
-
-        TMR3NotifyResume(pVM, pVCpu);
-
-        //ProcessForcedAction avoid freeze in CLI...BP...SAVE...STI
-        if(VM_FF_IS_PENDING(pVM, VM_FF_ALL_REM_MASK)
-            || VMCPU_FF_IS_PENDING(pVCpu, VMCPU_FF_ALL_REM_MASK)){
-            EMR3ProcessForcedAction(pVM, pVCpu, 0);
+        //Powersaving :)
+        if((u32WaitCount & 0xFFFFFF) == 0xFFFFFF){
+            RTThreadSleep(5);
+        }else{
+            u32WaitCount++;
         }
+    }
 
+    TMR3NotifyResume(pVM, pVCpu);
 
-        //Update FDP_CPU_CTX
-        VMR3UpdateFdpCpuCtx(pVCpu);
+    //ProcessForcedAction avoid freeze in CLI...BP...SAVE...STI
+    if(VM_FF_IS_PENDING(pVM, VM_FF_ALL_REM_MASK)
+        || VMCPU_FF_IS_PENDING(pVCpu, VMCPU_FF_ALL_REM_MASK)){
+        EMR3ProcessForcedAction(pVM, pVCpu, 0);
     }
+
+
+    //Update FDP_CPU_CTX
+    VMR3UpdateFdpCpuCtx(pVCpu);
     return true;
 }
 